@@ -6,8 +6,14 @@ extern "C" {
 #endif
 
 
+#include <stddef.h>
+
 void itoa(int n, char * s);
 
+void *malloc(size_t size);
+void *calloc(size_t count, size_t size);
+void free(void *ptr);
+
 
 #ifdef __cplusplus
 }
@@ -12,6 +12,12 @@ uint32_t strlen(char * s);
 
 void *memcpy(void *dest, const void * src, size_t n);
 
+void *memmove(void *dest, const void *src, size_t n);
+
+void *memset(void *dest, int c, size_t n);
+
+int memcmp(const void *s1, const void *s2, size_t n);
+
 #ifdef __cplusplus
 }
 #endif
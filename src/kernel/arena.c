@@ -0,0 +1,52 @@
+#include "arena.h"
+#include "pmm.h"
+
+#define ARENA_STATIC_ORDER  0xFFFFFFFF
+
+bool arena_create(arena_t *arena, size_t size)
+{
+    uint32_t order = pmm_order_for(size);
+    void *pages = pmm_alloc_pages(order);
+
+    if (pages == NULL)
+        return false;
+
+    arena_init(arena, pages, (size_t)PAGE_SIZE << order);
+    arena->order = order;
+    return true;
+}
+
+void arena_init(arena_t *arena, void *buffer, size_t size)
+{
+    arena->base = (uint8_t *)buffer;
+    arena->size = size;
+    arena->used = 0;
+    arena->high_water = 0;
+    arena->order = ARENA_STATIC_ORDER;
+    arena->failures = 0;
+}
+
+void arena_destroy(arena_t *arena)
+{
+    if (arena->order != ARENA_STATIC_ORDER)
+        pmm_free_pages(arena->base, arena->order);
+    arena->base = NULL;
+    arena->size = 0;
+    arena->used = 0;
+}
+
+void *arena_alloc(arena_t *arena, size_t size, size_t align)
+{
+    uintptr_t start = ((uintptr_t)arena->base + arena->used + (align - 1)) & ~(uintptr_t)(align - 1);
+    size_t used = (start - (uintptr_t)arena->base) + size;
+
+    if (used > arena->size) {
+        arena->failures++;
+        return NULL;
+    }
+
+    arena->used = used;
+    if (used > arena->high_water)
+        arena->high_water = used;
+    return (void *)start;
+}
@@ -0,0 +1,43 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+/*
+ * Bump-pointer arenas
+ *
+ * Scratch memory for boot-time and per-holotape allocations : allocation
+ * moves a pointer forward, nothing is freed individually and the whole
+ * arena is reset in O(1).
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+    uint8_t *base;
+    size_t size;
+    size_t used;
+    size_t high_water;          // peak of used since creation
+    uint32_t order;             // page order when backed by the page allocator
+    uint32_t failures;          // requests that did not fit
+} arena_t;
+
+// Back the arena with pages from the page allocator
+bool arena_create(arena_t *arena, size_t size);
+
+// Back the arena with a caller-provided buffer
+void arena_init(arena_t *arena, void *buffer, size_t size);
+
+// Give the pages back (arenas from arena_create only)
+void arena_destroy(arena_t *arena);
+
+// <align> must be a power of two, NULL when the arena is exhausted
+void *arena_alloc(arena_t *arena, size_t size, size_t align);
+
+static inline void arena_reset(arena_t *arena)
+{
+    arena->used = 0;
+}
+
+#endif // ARENA_H
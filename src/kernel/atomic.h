@@ -0,0 +1,186 @@
+#ifndef ATOMIC_H
+#define ATOMIC_H
+
+/*
+ * Atomic operations on 32 bit words
+ *
+ * Read-modify-write operations are fully ordered (barrier before and after)
+ * and return the previous value. ARMv6/v7 use ldrex/strex loops, AArch64
+ * uses the LSE instructions when the target has them (ARMv8.1 and later)
+ * and ldxr/stxr pairs otherwise (Cortex-A53).
+ *
+ * Exclusive accesses only work on normal memory : the MMU must be on.
+ *
+ * References :
+ * ARM Architecture Reference Manual ARMv7-A/R, A3.4
+ * ARM Architecture Reference Manual ARMv8-A, B2.9 and C3.2.12
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cache.h"
+
+typedef struct {
+    volatile uint32_t value;
+} atomic_t;
+
+#define ATOMIC_INIT(v)      { (v) }
+
+static inline uint32_t atomic_read(const atomic_t *a)
+{
+    return a->value;
+}
+
+static inline void atomic_set(atomic_t *a, uint32_t v)
+{
+    a->value = v;
+}
+
+#if __aarch64__ && defined(__ARM_FEATURE_ATOMICS)
+
+#define ATOMIC_FETCH_OP(name, insn)                                         \
+static inline uint32_t atomic_fetch_##name(atomic_t *a, uint32_t v)         \
+{                                                                           \
+    uint32_t old;                                                           \
+    __asm__ volatile(insn " %w2, %w0, [%1]"                                 \
+                     : "=r"(old) : "r"(&a->value), "r"(v) : "memory");      \
+    return old;                                                             \
+}
+
+ATOMIC_FETCH_OP(add, "ldaddal")
+ATOMIC_FETCH_OP(or, "ldsetal")
+ATOMIC_FETCH_OP(andnot, "ldclral")
+
+static inline uint32_t atomic_fetch_and(atomic_t *a, uint32_t v)
+{
+    return atomic_fetch_andnot(a, ~v);
+}
+
+static inline uint32_t atomic_xchg(atomic_t *a, uint32_t v)
+{
+    uint32_t old;
+    __asm__ volatile("swpal %w2, %w0, [%1]"
+                     : "=r"(old) : "r"(&a->value), "r"(v) : "memory");
+    return old;
+}
+
+static inline uint32_t atomic_cmpxchg(atomic_t *a, uint32_t expected, uint32_t desired)
+{
+    __asm__ volatile("casal %w0, %w2, [%1]"
+                     : "+r"(expected) : "r"(&a->value), "r"(desired) : "memory");
+    return expected;
+}
+
+#elif __aarch64__
+
+#define ATOMIC_FETCH_OP(name, insn)                                         \
+static inline uint32_t atomic_fetch_##name(atomic_t *a, uint32_t v)         \
+{                                                                           \
+    uint32_t old, new, fail;                                                \
+    dmb();                                                                  \
+    __asm__ volatile("1: ldxr  %w0, [%3]        \n"                         \
+                     "   " insn " %w1, %w0, %w4 \n"                         \
+                     "   stxr  %w2, %w1, [%3]   \n"                         \
+                     "   cbnz  %w2, 1b          \n"                         \
+                     : "=&r"(old), "=&r"(new), "=&r"(fail)                  \
+                     : "r"(&a->value), "r"(v) : "memory");                  \
+    dmb();                                                                  \
+    return old;                                                             \
+}
+
+ATOMIC_FETCH_OP(add, "add")
+ATOMIC_FETCH_OP(or, "orr")
+ATOMIC_FETCH_OP(and, "and")
+
+static inline uint32_t atomic_xchg(atomic_t *a, uint32_t v)
+{
+    uint32_t old, fail;
+    dmb();
+    __asm__ volatile("1: ldxr  %w0, [%2]        \n"
+                     "   stxr  %w1, %w3, [%2]   \n"
+                     "   cbnz  %w1, 1b          \n"
+                     : "=&r"(old), "=&r"(fail) : "r"(&a->value), "r"(v) : "memory");
+    dmb();
+    return old;
+}
+
+static inline uint32_t atomic_cmpxchg(atomic_t *a, uint32_t expected, uint32_t desired)
+{
+    uint32_t old, fail;
+    dmb();
+    __asm__ volatile("1: ldxr  %w0, [%2]        \n"
+                     "   cmp   %w0, %w3         \n"
+                     "   b.ne  2f               \n"
+                     "   stxr  %w1, %w4, [%2]   \n"
+                     "   cbnz  %w1, 1b          \n"
+                     "2:                        \n"
+                     : "=&r"(old), "=&r"(fail)
+                     : "r"(&a->value), "r"(expected), "r"(desired) : "cc", "memory");
+    dmb();
+    return old;
+}
+
+#else // __aarch32__
+
+#define ATOMIC_FETCH_OP(name, insn)                                         \
+static inline uint32_t atomic_fetch_##name(atomic_t *a, uint32_t v)         \
+{                                                                           \
+    uint32_t old, new, fail;                                                \
+    dmb();                                                                  \
+    __asm__ volatile("1: ldrex %0, [%3]         \n"                         \
+                     "   " insn " %1, %0, %4    \n"                         \
+                     "   strex %2, %1, [%3]     \n"                         \
+                     "   teq   %2, #0           \n"                         \
+                     "   bne   1b               \n"                         \
+                     : "=&r"(old), "=&r"(new), "=&r"(fail)                  \
+                     : "r"(&a->value), "r"(v) : "cc", "memory");            \
+    dmb();                                                                  \
+    return old;                                                             \
+}
+
+ATOMIC_FETCH_OP(add, "add")
+ATOMIC_FETCH_OP(or, "orr")
+ATOMIC_FETCH_OP(and, "and")
+
+static inline uint32_t atomic_xchg(atomic_t *a, uint32_t v)
+{
+    uint32_t old, fail;
+    dmb();
+    __asm__ volatile("1: ldrex %0, [%2]         \n"
+                     "   strex %1, %3, [%2]     \n"
+                     "   teq   %1, #0           \n"
+                     "   bne   1b               \n"
+                     : "=&r"(old), "=&r"(fail) : "r"(&a->value), "r"(v) : "cc", "memory");
+    dmb();
+    return old;
+}
+
+static inline uint32_t atomic_cmpxchg(atomic_t *a, uint32_t expected, uint32_t desired)
+{
+    uint32_t old, fail;
+    dmb();
+    __asm__ volatile("1: ldrex %0, [%2]         \n"
+                     "   teq   %0, %3           \n"
+                     "   bne   2f               \n"
+                     "   strex %1, %4, [%2]     \n"
+                     "   teq   %1, #0           \n"
+                     "   bne   1b               \n"
+                     "2:                        \n"
+                     : "=&r"(old), "=&r"(fail)
+                     : "r"(&a->value), "r"(expected), "r"(desired) : "cc", "memory");
+    dmb();
+    return old;
+}
+
+#endif
+
+#undef ATOMIC_FETCH_OP
+
+static inline uint32_t atomic_fetch_sub(atomic_t *a, uint32_t v)
+{
+    return atomic_fetch_add(a, -v);
+}
+
+#endif // ATOMIC_H
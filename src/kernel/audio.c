@@ -1,4 +1,5 @@
 #include "audio.h"
+#include "timer.h"
 #include <stddef.h>
 
 static uint8_t audio_volume = 50;
@@ -19,38 +20,65 @@ void audio_stop_tone(void) {
     // TODO: Stop PWM output
 }
 
-void audio_boot_sequence(void) {
-    // Boot sound profile from development plan:
-    // - Initial power-on beep (440Hz, 200ms)
-    // - Data stream noise (white noise modulated)
-    // - Mechanical relay clicks
-    // - Final ready chime (C-E-G chord)
-    
+// Boot sound profile from development plan:
+// - Initial power-on beep (440Hz, 200ms)
+// - Data stream noise (white noise modulated)
+// - Mechanical relay clicks
+// - Final ready chime (C-E-G chord)
+static const audio_step_t audio_boot_steps[] = {
     // Power-on beep
-    audio_play_tone(440, 200);
-    
-    // Delay
-    for (volatile uint32_t d = 0; d < 1000000; d++);
-    
+    { 440, 200, 200 },
     // Data stream simulation (higher frequency beeps)
-    for (int i = 0; i < 5; i++) {
-        audio_play_tone(800 + i * 100, 50);
-        for (volatile uint32_t d = 0; d < 300000; d++);
-    }
-    
+    { 800, 50, 60 },
+    { 900, 50, 60 },
+    { 1000, 50, 60 },
+    { 1100, 50, 60 },
+    { 1200, 50, 60 },
     // Relay click simulation (short low tone)
-    audio_play_tone(200, 50);
-    for (volatile uint32_t d = 0; d < 500000; d++);
-    audio_play_tone(200, 50);
-    
+    { 200, 50, 100 },
+    { 200, 50, 0 },
     // Ready chime (C-E-G)
-    audio_play_tone(262, 150); // C
-    for (volatile uint32_t d = 0; d < 200000; d++);
-    audio_play_tone(330, 150); // E
-    for (volatile uint32_t d = 0; d < 200000; d++);
-    audio_play_tone(392, 300); // G
-    
-    audio_stop_tone();
+    { 262, 150, 40 },
+    { 330, 150, 40 },
+    { 392, 300, 300 },
+    { 0, 0, 0 },
+};
+
+static const audio_step_t *audio_steps;
+static uint32_t audio_step_count;
+static uint32_t audio_step_next;
+static timer_event_t audio_timer;
+
+// The steps due, from the timer interrupt
+static void audio_step(void *arg) {
+    (void)arg;
+
+    while (audio_step_next < audio_step_count) {
+        const audio_step_t *step = &audio_steps[audio_step_next++];
+
+        if (step->frequency) {
+            audio_play_tone(step->frequency, step->duration_ms);
+        } else {
+            audio_stop_tone();
+        }
+        if (step->next_ms) {
+            timer_after(&audio_timer, step->next_ms, audio_step, NULL);
+            return;
+        }
+    }
+}
+
+void audio_play_sequence(const audio_step_t *steps, uint32_t count) {
+    timer_cancel(&audio_timer);
+    audio_steps = steps;
+    audio_step_count = count;
+    audio_step_next = 0;
+    audio_step(NULL);
+}
+
+void audio_boot_sequence(void) {
+    audio_play_sequence(audio_boot_steps,
+                        sizeof(audio_boot_steps) / sizeof(audio_boot_steps[0]));
 }
 
 void audio_set_volume(uint8_t level) {
@@ -3,6 +3,13 @@
 
 #include <stdint.h>
 
+// One step of a sequence : a tone, then a wait before the next step
+typedef struct {
+    uint16_t frequency;     // Hz, 0 to stop the tone
+    uint16_t duration_ms;
+    uint16_t next_ms;       // 0 : the next step right away
+} audio_step_t;
+
 // Audio system initialization
 void audio_init(void);
 
@@ -10,7 +17,11 @@ void audio_init(void);
 void audio_play_tone(uint16_t frequency, uint16_t duration_ms);
 void audio_stop_tone(void);
 
-// Boot sound sequence
+// Play <count> steps from the timer interrupt, the call returns at once.
+// Replaces the sequence playing.
+void audio_play_sequence(const audio_step_t *steps, uint32_t count);
+
+// Boot sound sequence, played the same way
 void audio_boot_sequence(void);
 
 // Volume control
@@ -1,49 +1,219 @@
 #include "boot_display.h"
 #include "uart.h"
 #include "k_libc/k_stdio.h"
+#include "framebuffer.h"
+#include "raster.h"
+#include "font.h"
+#include "draw.h"
+#include "fbcon.h"
+#include "timer.h"
+#include "term.h"
 #include <stddef.h>
 
-// Character set for matrix display
+#define MATRIX_PERIOD_US        (1000000 / MATRIX_FPS)
+#define MATRIX_BUDGET_US        (MATRIX_PERIOD_US / 4)      // the rest is left to the boot
+#define MATRIX_COLS_MAX         (FB_WIDTH / FONT_WIDTH)
+#define MATRIX_TRAIL_COLOR      0xFF008000                  // half green, below the head
+#define MATRIX_SERIAL_BYTES     TERM_FRAME_BYTES(UART_BAUD, MATRIX_FPS)
+
+// Between two boot messages, twice after the first one
+#define BOOT_MESSAGE_PAUSE_MS   100
+
+// Character set for matrix display, all in the font
 static const char matrix_chars[] = 
-    "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789@#$%&*()[]{}+-*/=<>♠♣♥♦◊○●□■";
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789@#$%&*()[]{}+-*/=<>";
 
 // Simple random number generator for matrix effect
 static uint32_t random_seed = 12345;
 
+// One drop per column : its head row, negative while above the screen,
+// and a trail of <length> rows. It moves down a row every <speed> frames.
+static int16_t matrix_head[MATRIX_COLS_MAX];
+static uint8_t matrix_length[MATRIX_COLS_MAX];
+static uint8_t matrix_speed[MATRIX_COLS_MAX];
+static uint8_t matrix_wait[MATRIX_COLS_MAX];    // frames before the next move
+
+static raster_target_t matrix_target;
+static raster_clip_t matrix_clip;
+static uint32_t matrix_cols, matrix_rows;
+static uint32_t matrix_next;                    // first column of the next frame
+static uint32_t matrix_head_color, matrix_trail_color;
+static uint64_t matrix_end;
+static timer_event_t matrix_timer;
+static matrix_display_stats_t matrix_stats;
+
+#if MATRIX_SERIAL
+// The top rows of the rain, on the serial terminal
+static term_t matrix_term;
+static bool matrix_serial;
+#endif
+
 static uint32_t simple_rand(void) {
     random_seed = random_seed * 1103515245 + 12345;
     return (random_seed / 65536) % 32768;
 }
 
+static void matrix_drop(uint32_t col, bool top) {
+    matrix_length[col] = 4 + simple_rand() % (matrix_rows / 2 + 1);
+    matrix_speed[col] = 1 + simple_rand() % 3;
+    matrix_wait[col] = matrix_speed[col];
+    matrix_head[col] = top ? -1 : -(int16_t)(simple_rand() % matrix_rows) - 1;
+}
+
+// Rows outside the screen are clipped away
+static void matrix_glyph(uint32_t col, int32_t row, uint32_t color, uint8_t attr) {
+    char c = matrix_chars[simple_rand() % (sizeof(matrix_chars) - 1)];
+
+    raster_cell(&matrix_target, &matrix_clip, col * FONT_WIDTH, row * FONT_HEIGHT,
+                font_glyph(c), FONT_HEIGHT, color, 0);
+#if MATRIX_SERIAL
+    if (row >= 0)
+        term_set(&matrix_term, row, col, c, attr);
+#else
+    (void)attr;
+#endif
+}
+
+static void matrix_erase(uint32_t col, int32_t row) {
+    raster_fill_rect(&matrix_target, &matrix_clip, col * FONT_WIDTH, row * FONT_HEIGHT,
+                     FONT_WIDTH, FONT_HEIGHT, 0);
+#if MATRIX_SERIAL
+    if (row >= 0)
+        term_set(&matrix_term, row, col, ' ', 0);
+#endif
+}
+
+// Move a drop down a row : new head, the old one joins the trail, the
+// end of the trail is erased
+static void matrix_step(uint32_t col) {
+    int32_t head = matrix_head[col];
+
+    if (--matrix_wait[col])
+        return;
+    matrix_wait[col] = matrix_speed[col];
+
+    matrix_glyph(col, head, matrix_trail_color, TERM_FG(TERM_GREEN));
+    matrix_glyph(col, head + 1, matrix_head_color, TERM_FG(TERM_GREEN) | TERM_BOLD);
+    matrix_erase(col, head + 1 - matrix_length[col]);
+    matrix_head[col] = ++head;
+
+    // Trail erased down to the last row
+    if (head - matrix_length[col] + 1 >= (int32_t)matrix_rows)
+        matrix_drop(col, true);
+}
+
+// The console takes the screens back
+static void matrix_stop(void) {
+    timer_cancel(&matrix_timer);
+#if MATRIX_SERIAL
+    if (matrix_serial) {
+        term_release(&matrix_term);
+        k_set_output(k_get_output() | K_OUTPUT_UART);
+        matrix_serial = false;
+    }
+#endif
+}
+
+// Frame clock, from the timer interrupt
+static void matrix_tick(void *arg) {
+    (void)arg;
+
+    uint64_t start = timer_now();
+
+    // Gone from the screen (a frame was presented), or time is up
+    if (!fb_splash_shown() || start >= matrix_end) {
+        if (fb_splash_begin()) {
+            fbcon_show();
+            fb_splash_end();
+        } else if (fb_splash_shown()) {
+            return;     // fb_lock taken elsewhere, hand over next tick
+        }
+        matrix_stop();
+        return;
+    }
+
+    if (!fb_splash_begin()) {
+        matrix_stats.skipped++;
+        return;
+    }
+
+    // Columns in turn from where the last frame stopped, as many as the
+    // budget allows
+    uint32_t col = matrix_next, done = 0;
+    uint32_t elapsed = 0;
+    do {
+        matrix_step(col);
+        col = col + 1 < matrix_cols ? col + 1 : 0;
+        done++;
+        elapsed = (uint32_t)(timer_now() - start);
+    } while (done < matrix_cols && elapsed < MATRIX_BUDGET_US);
+#if MATRIX_SERIAL
+    if (matrix_serial)
+        term_present(&matrix_term, MATRIX_SERIAL_BYTES);
+#endif
+    fb_splash_end();
+
+    matrix_next = col;
+    matrix_stats.frames++;
+    if (done < matrix_cols)
+        matrix_stats.over_budget++;
+    if (elapsed > matrix_stats.max_us)
+        matrix_stats.max_us = elapsed;
+    matrix_stats.total_us += elapsed;
+}
+
 void matrix_display_init(void) {
     // Initialize random seed with some variation
     random_seed = 12345;
 }
 
-void matrix_display_run(uint32_t duration_ms) {
-    const uint32_t cols = 80;
-    const uint32_t rows = 24;
-    const uint32_t iterations = duration_ms / 100; // Update every 100ms
-    
-    for (uint32_t iter = 0; iter < iterations; iter++) {
-        // Clear screen (simple approach)
-        if (iter == 0) {
-            k_printf("\033[2J\033[H"); // ANSI clear screen and home
-        }
-        
-        // Generate random matrix characters
-        for (uint32_t i = 0; i < 20; i++) {
-            uint32_t col = simple_rand() % cols;
-            uint32_t row = simple_rand() % rows;
-            uint32_t char_idx = simple_rand() % (sizeof(matrix_chars) - 1);
-            
-            // Print character at position (simplified)
-            k_printf("%c", matrix_chars[char_idx]);
-        }
-        
-        // Delay
-        for (volatile uint32_t d = 0; d < 500000; d++);
+bool matrix_display_start(uint32_t duration_ms) {
+    fb_info_t splash;
+
+    if (!duration_ms || !fb_get_splash(&splash) || !raster_target_init(&matrix_target, &splash))
+        return false;
+
+    raster_clip_reset(&matrix_target, &matrix_clip);
+    raster_clear(&matrix_target, 0);
+    matrix_cols = splash.width / FONT_WIDTH;
+    matrix_rows = splash.height / FONT_HEIGHT;
+    if (matrix_cols > MATRIX_COLS_MAX)
+        matrix_cols = MATRIX_COLS_MAX;
+    if (!matrix_cols || !matrix_rows)
+        return false;
+
+    matrix_head_color = raster_color(matrix_target.bytes_pp, DRAW_DEFAULT_COLOR);
+    matrix_trail_color = raster_color(matrix_target.bytes_pp, MATRIX_TRAIL_COLOR);
+    matrix_next = 0;
+    matrix_stats = (matrix_display_stats_t){ 0 };
+    for (uint32_t col = 0; col < matrix_cols; col++)
+        matrix_drop(col, false);
+
+#if MATRIX_SERIAL
+    // The serial terminal too, if the boot messages have the console to go to
+    if (k_get_output() & K_OUTPUT_FB) {
+        term_init(&matrix_term);
+        k_set_output(K_OUTPUT_FB);
+        matrix_serial = true;
     }
+#endif
+
+    matrix_end = timer_now() + (uint64_t)duration_ms * 1000;
+    fb_show_splash();
+    return timer_every(&matrix_timer, MATRIX_PERIOD_US, matrix_tick, NULL);
+}
+
+void matrix_display_get_stats(matrix_display_stats_t *stats) {
+    *stats = matrix_stats;
+}
+
+void matrix_display_dump_stats(void) {
+    matrix_display_stats_t stats;
+
+    matrix_display_get_stats(&stats);
+    k_printf("  %u frames, %u over budget, %u skipped, longest %u us, average %u us\r\n",
+             stats.frames, stats.over_budget, stats.skipped, stats.max_us,
+             stats.frames ? (uint32_t)(stats.total_us / stats.frames) : 0);
 }
 
 void boot_messages_display(void) {
@@ -53,21 +223,21 @@ void boot_messages_display(void) {
     // Display boot sequence messages
     k_printf("LOADER V1.1\r\n");
     
-    // Small delay
-    for (volatile uint32_t d = 0; d < 1000000; d++);
+    // Paced by the timers, the CPU sleeps in between
+    timer_sleep(BOOT_MESSAGE_PAUSE_MS * 2);
     
     k_printf("EXEC VERSION 41.10\r\n");
     
-    for (volatile uint32_t d = 0; d < 500000; d++);
+    timer_sleep(BOOT_MESSAGE_PAUSE_MS);
     
     k_printf("64K RAM SYSTEM\r\n");
     k_printf("38911 BYTES FREE\r\n");
     
-    for (volatile uint32_t d = 0; d < 500000; d++);
+    timer_sleep(BOOT_MESSAGE_PAUSE_MS);
     
     k_printf("NO HOLOTAPE FOUND\r\n");
     
-    for (volatile uint32_t d = 0; d < 500000; d++);
+    timer_sleep(BOOT_MESSAGE_PAUSE_MS);
     
     k_printf("LOAD ROM(1): DEITRIX 303\r\n");
     
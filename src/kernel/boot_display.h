@@ -1,11 +1,50 @@
 #ifndef BOOT_DISPLAY_H
 #define BOOT_DISPLAY_H
 
+/*
+ * Boot display
+ *
+ * The matrix rain is a boot splash (fb_show_splash): drawn in the front
+ * buffer from the system timer interrupt, MATRIX_FPS times a second,
+ * while kernel_main goes on with the boot. Each frame moves the drops of
+ * the columns whose turn it is, a glyph blit for the new head, one for
+ * the old head now in the trail and a cell erased at its end. A frame
+ * stops at its time budget, the columns it did not reach go first in the
+ * next one.
+ *
+ * At the end the console (fbcon.h) is shown again, with the output of the
+ * boot so far. Presenting a frame ends the splash early.
+ *
+ * Building with MATRIX_SERIAL=1 mirrors the top rows of the rain on the
+ * serial terminal through a screen model (term.h), a frame's worth of the
+ * link per tick, queued for the UART interrupt to send. Kernel output
+ * then only goes to the console until the rain ends.
+ *
+ */
+
 #include <stdint.h>
+#include <stdbool.h>
+
+#define MATRIX_FPS              30
+
+typedef struct {
+    uint32_t frames;            // drawn
+    uint32_t over_budget;       // stopped before the last column
+    uint32_t skipped;           // framebuffer busy
+    uint32_t max_us;
+    uint64_t total_us;
+} matrix_display_stats_t;
 
 // Matrix-style boot display functions
 void matrix_display_init(void);
-void matrix_display_run(uint32_t duration_ms);
+
+// Start the rain for <duration_ms> and return, false without a spare
+// frame (single buffer, or a frame was presented already)
+bool matrix_display_start(uint32_t duration_ms);
+
+void matrix_display_get_stats(matrix_display_stats_t *stats);
+void matrix_display_dump_stats(void);
+
 void boot_messages_display(void);
 
 #endif // BOOT_DISPLAY_H
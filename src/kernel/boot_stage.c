@@ -0,0 +1,90 @@
+#include "boot_stage.h"
+#include "clock.h"
+#include "timer.h"
+#include "k_libc/k_stdio.h"
+
+typedef struct {
+    const char *name;
+    uint64_t start;             // clock ticks
+    uint64_t end;               // 0 while the stage runs
+    uint32_t depth;
+} boot_stage_t;
+
+static boot_stage_t boot_stages[BOOT_STAGES_MAX];
+static uint32_t boot_stage_count;
+static uint32_t boot_stage_depth;
+static uint64_t boot_start;
+static uint64_t boot_firmware_us;
+
+void boot_stage_init(void)
+{
+    boot_start = clock_ticks();
+    // The system timer runs from power on, through the firmware
+    boot_firmware_us = timer_now();
+}
+
+uint32_t boot_stage_begin(const char *name)
+{
+    if (boot_stage_count == BOOT_STAGES_MAX)
+        return BOOT_STAGES_MAX;
+
+    boot_stage_t *stage = &boot_stages[boot_stage_count];
+    stage->name = name;
+    stage->depth = boot_stage_depth++;
+    stage->end = 0;
+    stage->start = clock_ticks();
+    return boot_stage_count++;
+}
+
+void boot_stage_end(uint32_t stage)
+{
+    if (stage >= BOOT_STAGES_MAX)
+        return;
+
+    boot_stages[stage].end = clock_ticks();
+    boot_stage_depth--;
+}
+
+static uint32_t boot_stage_us(uint64_t ticks)
+{
+    return (clock_ticks_to_ns(ticks) + 500) / 1000;
+}
+
+static void boot_stage_line(const char *name, uint32_t depth, uint64_t ticks, uint64_t total)
+{
+    uint32_t permille = ticks * 1000 / total;
+    char label[32];
+    uint32_t length = 0;
+
+    // Nested stages indented under their parent
+    while (length < 2 * depth && length < sizeof(label) - 1)
+        label[length++] = ' ';
+    while (*name && length < sizeof(label) - 1)
+        label[length++] = *name++;
+    label[length] = '\0';
+
+    k_printf("  %-24s %10u  %3u.%u\r\n", label, boot_stage_us(ticks),
+             permille / 10, permille % 10);
+}
+
+void boot_stage_report(void)
+{
+    uint64_t now = clock_ticks();
+    uint64_t total = now - boot_start, staged = 0;
+
+    if (!total)
+        total = 1;
+
+    k_printf("  %-24s %10s  %5s\r\n", "stage", "us", "%");
+    k_printf("  %-24s %10u      -\r\n", "firmware", (uint32_t)boot_firmware_us);
+    for (uint32_t i = 0; i < boot_stage_count; i++) {
+        const boot_stage_t *stage = &boot_stages[i];
+        uint64_t ticks = (stage->end ? stage->end : now) - stage->start;
+
+        if (!stage->depth)
+            staged += ticks;
+        boot_stage_line(stage->name, stage->depth, ticks, total);
+    }
+    boot_stage_line("between stages", 0, total - staged, total);
+    boot_stage_line("total", 0, total, total);
+}
@@ -0,0 +1,42 @@
+#ifndef BOOT_STAGE_H
+#define BOOT_STAGE_H
+
+/*
+ * Boot stage timing
+ *
+ * BOOT_STAGE(name, statements) runs <statements> between two clocksource
+ * reads and records how long they took. Stages can nest, a stage inside
+ * another one is shown under it and counted in it. boot_stage_report()
+ * prints the time of every stage and its share of the boot, from
+ * boot_stage_init() at the entry of kernel_main, with the time left
+ * between the stages and the time the firmware took before the kernel.
+ *
+ *   uint32_t cores;
+ *   BOOT_STAGE("SMP", jobs_init(); cores = smp_init());
+ *
+ * Core 0 only. Stages past BOOT_STAGES_MAX run untimed.
+ *
+ */
+
+#include <stdint.h>
+
+#define BOOT_STAGES_MAX         32
+
+#define BOOT_STAGE(name, ...)                                                  \
+    do {                                                                       \
+        uint32_t boot_stage_ = boot_stage_begin(name);                         \
+        __VA_ARGS__;                                                           \
+        boot_stage_end(boot_stage_);                                           \
+    } while (0)
+
+// Start of the boot, first thing in kernel_main
+void boot_stage_init(void);
+
+// Index of the new stage, for boot_stage_end()
+uint32_t boot_stage_begin(const char *name);
+void boot_stage_end(uint32_t stage);
+
+// Table of the stages, their time and share of the boot up to now
+void boot_stage_report(void);
+
+#endif // BOOT_STAGE_H
@@ -0,0 +1,123 @@
+#include "cache.h"
+
+#if __aarch64__
+#define DC_LINE_OP(op, addr)  __asm__ volatile("dc " op ", %0" :: "r"(addr) : "memory")
+#define DC_CLEAN(addr)        DC_LINE_OP("cvac", addr)
+#define DC_INVALIDATE(addr)   DC_LINE_OP("ivac", addr)
+#define DC_CLEAN_INV(addr)    DC_LINE_OP("civac", addr)
+#else
+// ARMv6 and ARMv7 share the same c7 encodings for the by-MVA operations
+#define DC_LINE_OP(crm, addr) __asm__ volatile("mcr p15, 0, %0, c7, " crm ", 1" :: "r"(addr) : "memory")
+#define DC_CLEAN(addr)        DC_LINE_OP("c10", addr)
+#define DC_INVALIDATE(addr)   DC_LINE_OP("c6", addr)
+#define DC_CLEAN_INV(addr)    DC_LINE_OP("c14", addr)
+#endif
+
+uint32_t dcache_line_size(void)
+{
+#if __aarch64__
+    uint64_t ctr;
+    __asm__ volatile("mrs %0, ctr_el0" : "=r"(ctr));
+    return 4 << ((ctr >> 16) & 0xF);
+#elif BCM2835
+    // ARM1176JZF-S has fixed 32 byte lines
+    return 32;
+#else
+    uint32_t ctr;
+    __asm__ volatile("mrc p15, 0, %0, c0, c0, 1" : "=r"(ctr));
+    return 4 << ((ctr >> 16) & 0xF);
+#endif
+}
+
+void dcache_clean_range(const void *start, size_t size)
+{
+    uintptr_t line = dcache_line_size();
+    uintptr_t addr = (uintptr_t)start & ~(line - 1);
+    uintptr_t end = (uintptr_t)start + size;
+
+    for (; addr < end; addr += line)
+        DC_CLEAN(addr);
+    dsb();
+}
+
+void dcache_invalidate_range(const void *start, size_t size)
+{
+    uintptr_t line = dcache_line_size();
+    uintptr_t addr = (uintptr_t)start;
+    uintptr_t end = addr + size;
+
+    // Lines only partially covered may hold unrelated dirty data,
+    // write them back rather than losing it
+    if (addr & (line - 1)) {
+        addr &= ~(line - 1);
+        DC_CLEAN_INV(addr);
+        addr += line;
+    }
+    if (end & (line - 1)) {
+        end &= ~(line - 1);
+        if (end >= addr)
+            DC_CLEAN_INV(end);
+    }
+
+    for (; addr < end; addr += line)
+        DC_INVALIDATE(addr);
+    dsb();
+}
+
+void dcache_clean_invalidate_range(const void *start, size_t size)
+{
+    uintptr_t line = dcache_line_size();
+    uintptr_t addr = (uintptr_t)start & ~(line - 1);
+    uintptr_t end = (uintptr_t)start + size;
+
+    for (; addr < end; addr += line)
+        DC_CLEAN_INV(addr);
+    dsb();
+}
+
+void dcache_invalidate_all(void)
+{
+#if BCM2835
+    __asm__ volatile("mcr p15, 0, %0, c7, c6, 0" :: "r"(0) : "memory");
+#else
+    // Walk every set/way of the L1 data cache
+    uintptr_t ccsidr;
+#if __aarch64__
+    __asm__ volatile("msr csselr_el1, %0" :: "r"((uintptr_t)0));
+    isb();
+    __asm__ volatile("mrs %0, ccsidr_el1" : "=r"(ccsidr));
+#else
+    __asm__ volatile("mcr p15, 2, %0, c0, c0, 0" :: "r"(0));
+    isb();
+    __asm__ volatile("mrc p15, 1, %0, c0, c0, 0" : "=r"(ccsidr));
+#endif
+    uint32_t line_shift = (ccsidr & 0x7) + 4;
+    uint32_t ways = ((ccsidr >> 3) & 0x3FF) + 1;
+    uint32_t sets = ((ccsidr >> 13) & 0x7FFF) + 1;
+    uint32_t way_shift = (ways > 1) ? __builtin_clz(ways - 1) : 0;
+
+    for (uint32_t way = 0; way < ways; way++) {
+        for (uint32_t set = 0; set < sets; set++) {
+            uintptr_t sw = ((uintptr_t)way << way_shift) | ((uintptr_t)set << line_shift);
+#if __aarch64__
+            __asm__ volatile("dc isw, %0" :: "r"(sw) : "memory");
+#else
+            __asm__ volatile("mcr p15, 0, %0, c7, c6, 2" :: "r"(sw) : "memory");
+#endif
+        }
+    }
+#endif
+    dsb();
+}
+
+void icache_invalidate_all(void)
+{
+#if __aarch64__
+    __asm__ volatile("ic iallu" ::: "memory");
+#else
+    __asm__ volatile("mcr p15, 0, %0, c7, c5, 0" :: "r"(0) : "memory");   // I-cache
+    __asm__ volatile("mcr p15, 0, %0, c7, c5, 6" :: "r"(0) : "memory");   // branch predictor
+#endif
+    dsb();
+    isb();
+}
@@ -0,0 +1,55 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+/*
+ * Cache and barrier maintenance
+ *
+ * Once the MMU is enabled, RAM is mapped write-back cacheable. The VideoCore
+ * and the DMA engine do not snoop the ARM data cache, so any buffer shared
+ * with them must be cleaned before handing it over and invalidated before
+ * reading back what they wrote.
+ *
+ * Reference :
+ * ARM1176JZF-S TRM, chapter 3 (c7 cache operations)
+ * ARM Architecture Reference Manual ARMv7-A/R, B4.2
+ * ARM Architecture Reference Manual ARMv8-A, D4.4
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if __aarch64__
+static inline void dmb(void) { __asm__ volatile("dmb sy" ::: "memory"); }
+static inline void dsb(void) { __asm__ volatile("dsb sy" ::: "memory"); }
+static inline void isb(void) { __asm__ volatile("isb" ::: "memory"); }
+#elif BCM2835
+// ARMv6 has no dedicated barrier instructions, use the CP15 equivalents
+static inline void dmb(void) { __asm__ volatile("mcr p15, 0, %0, c7, c10, 5" :: "r"(0) : "memory"); }
+static inline void dsb(void) { __asm__ volatile("mcr p15, 0, %0, c7, c10, 4" :: "r"(0) : "memory"); }
+static inline void isb(void) { __asm__ volatile("mcr p15, 0, %0, c7, c5, 4" :: "r"(0) : "memory"); }
+#else
+static inline void dmb(void) { __asm__ volatile("dmb" ::: "memory"); }
+static inline void dsb(void) { __asm__ volatile("dsb" ::: "memory"); }
+static inline void isb(void) { __asm__ volatile("isb" ::: "memory"); }
+#endif
+
+// Size in bytes of the smallest data cache line
+uint32_t dcache_line_size(void);
+
+// Write dirty lines covering [start, start + size) back to memory
+void dcache_clean_range(const void *start, size_t size);
+
+// Discard lines covering [start, start + size) without writing them back
+void dcache_invalidate_range(const void *start, size_t size);
+
+// Write back then discard lines covering [start, start + size)
+void dcache_clean_invalidate_range(const void *start, size_t size);
+
+// Discard the whole L1 data cache (only safe before it is enabled)
+void dcache_invalidate_all(void);
+
+// Discard the instruction cache and branch predictor
+void icache_invalidate_all(void);
+
+#endif // CACHE_H
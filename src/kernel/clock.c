@@ -0,0 +1,67 @@
+#include "clock.h"
+#include "cpu.h"
+#include "timer.h"
+
+#include <stdbool.h>
+
+#define NSEC_PER_SEC            1000000000ull
+
+// The generic timer until clock_init() finds out the firmware did not set
+// it up, clock_ticks() works from the first instruction
+#if BCM2835
+static bool clock_generic = false;
+#else
+static bool clock_generic = true;
+#endif
+
+// ns = ticks * mult >> shift
+static uint32_t clock_mult;
+static uint32_t clock_shift;
+
+void clock_init(void)
+{
+#if !BCM2835
+    clock_generic = cpu_counter_hz() != 0;
+#endif
+    uint32_t hz = clock_hz();
+
+    // Largest shift keeping mult below 2^31 : a 32-bit count of ticks times
+    // mult fits in 64 bits
+    uint32_t shift = 32;
+    while (shift && (NSEC_PER_SEC << shift) / hz >= 1u << 31)
+        shift--;
+    clock_shift = shift;
+    clock_mult = (NSEC_PER_SEC << shift) / hz;
+}
+
+uint64_t clock_ticks(void)
+{
+#if !BCM2835
+    if (clock_generic)
+        return cpu_counter();
+#endif
+    return timer_now();
+}
+
+uint32_t clock_hz(void)
+{
+#if !BCM2835
+    if (clock_generic)
+        return cpu_counter_hz();
+#endif
+    return 1000000;
+}
+
+const char *clock_name(void)
+{
+    return clock_generic ? "generic timer" : "system timer";
+}
+
+uint64_t clock_ticks_to_ns(uint64_t ticks)
+{
+    // The high and low words apart, each product fits in 64 bits
+    uint64_t high = (uint64_t)(uint32_t)(ticks >> 32) * clock_mult;
+    uint64_t low = (uint64_t)(uint32_t)ticks * clock_mult;
+
+    return (high << (32 - clock_shift)) + (low >> clock_shift);
+}
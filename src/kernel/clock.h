@@ -0,0 +1,45 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+/*
+ * Clocksource
+ *
+ * The monotonic clock of the kernel, read as ticks of the fastest counter
+ * the target has : the ARM generic timer on the BCM2836/7 (19.2MHz, a
+ * coprocessor register read, the same on every core), the 1MHz BCM system
+ * timer on the BCM2835 or when the firmware left CNTFRQ unset (a
+ * peripheral read). Both count from power on and never wrap in practice.
+ *
+ * Ticks are converted to nanoseconds with a multiply and a shift
+ * computed once by clock_init(), no division.
+ *
+ * References :
+ * ARM Architecture Reference Manual ARMv7-A, B8 The Generic Timer
+ * BCM2835 ARM Peripherals, chapter 12
+ *
+ */
+
+#include <stdint.h>
+
+// Pick the counter and its conversion, before any other clock function
+// but clock_ticks()
+void clock_init(void);
+
+// Counter ticks since power on
+uint64_t clock_ticks(void);
+
+// Counter frequency
+uint32_t clock_hz(void);
+
+// "generic timer" or "system timer"
+const char *clock_name(void);
+
+uint64_t clock_ticks_to_ns(uint64_t ticks);
+
+// Nanoseconds since power on
+static inline uint64_t clock_ns(void)
+{
+    return clock_ticks_to_ns(clock_ticks());
+}
+
+#endif // CLOCK_H
@@ -0,0 +1,113 @@
+#ifndef CPU_H
+#define CPU_H
+
+#include <stdint.h>
+
+#include "mm.h"
+
+// Index of the running core, 0 to CORES-1
+static inline uint32_t core_id(void)
+{
+#if __aarch64__
+    uint64_t mpidr;
+    __asm__ volatile("mrs %0, mpidr_el1" : "=r"(mpidr));
+    return mpidr & 3;
+#elif BCM2835
+    return 0;
+#else
+    uint32_t mpidr;
+    __asm__ volatile("mrc p15, 0, %0, c0, c0, 5" : "=r"(mpidr));
+    return mpidr & 3;
+#endif
+}
+
+// Start the cycle counter of the running core, each core calls it once
+static inline void cpu_cycles_init(void)
+{
+#if __aarch64__
+    __asm__ volatile("msr pmcr_el0, %0" :: "r"((uint64_t)(1 << 0) | (1 << 2)));   // E, reset CCNT
+    __asm__ volatile("msr pmcntenset_el0, %0" :: "r"((uint64_t)1 << 31));
+#elif BCM2835
+    __asm__ volatile("mcr p15, 0, %0, c15, c12, 0" :: "r"((1 << 0) | (1 << 2)));  // PMNC: E, reset CCNT
+#else
+    __asm__ volatile("mcr p15, 0, %0, c9, c12, 0" :: "r"((1 << 0) | (1 << 2)));   // PMCR: E, reset CCNT
+    __asm__ volatile("mcr p15, 0, %0, c9, c12, 1" :: "r"(1 << 31));               // PMCNTENSET: CCNT
+#endif
+}
+
+// Free-running CPU cycle counter, wraps around
+static inline uint32_t cpu_cycles(void)
+{
+#if __aarch64__
+    uint64_t cycles;
+    __asm__ volatile("mrs %0, pmccntr_el0" : "=r"(cycles));
+    return cycles;
+#elif BCM2835
+    uint32_t cycles;
+    __asm__ volatile("mrc p15, 0, %0, c15, c12, 1" : "=r"(cycles));
+    return cycles;
+#else
+    uint32_t cycles;
+    __asm__ volatile("mrc p15, 0, %0, c9, c13, 0" : "=r"(cycles));
+    return cycles;
+#endif
+}
+
+#if !BCM2835
+// ARM generic timer count, the same on every core, wraps after years
+static inline uint64_t cpu_counter(void)
+{
+    uint64_t count;
+#if __aarch64__
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(count));
+#else
+    __asm__ volatile("mrrc p15, 1, %Q0, %R0, c14" : "=r"(count));
+#endif
+    return count;
+}
+
+// Its frequency, set by the firmware (19.2MHz on the BCM2836/7)
+static inline uint32_t cpu_counter_hz(void)
+{
+#if __aarch64__
+    uint64_t hz;
+    __asm__ volatile("mrs %0, cntfrq_el0" : "=r"(hz));
+    return hz;
+#else
+    uint32_t hz;
+    __asm__ volatile("mrc p15, 0, %0, c14, c0, 0" : "=r"(hz));
+    return hz;
+#endif
+}
+#endif
+
+// Sleep until an interrupt is pending, even a masked one. The ARM1176 has
+// it as a CP15 operation.
+static inline void cpu_wfi(void)
+{
+#if BCM2835
+    __asm__ volatile("mcr p15, 0, %0, c7, c0, 4" :: "r"(0) : "memory");
+#else
+    __asm__ volatile("wfi" ::: "memory");
+#endif
+}
+
+// Sleep until an event (sev from another core, interrupt)
+static inline void cpu_wfe(void)
+{
+#if !BCM2835
+    __asm__ volatile("wfe" ::: "memory");
+#endif
+}
+
+// Wake up the cores sleeping in cpu_wfe, after prior writes complete
+static inline void cpu_sev(void)
+{
+#if __aarch64__
+    __asm__ volatile("dsb sy\n sev" ::: "memory");
+#elif !BCM2835
+    __asm__ volatile("dsb\n sev" ::: "memory");
+#endif
+}
+
+#endif // CPU_H
@@ -0,0 +1,116 @@
+#include "crc32.h"
+
+#define CRC32_POLY      0xEDB88320
+
+typedef uint32_t __attribute__((may_alias)) crc_word_t;
+
+// x^(2^n) modulo the polynomial, for crc32_combine
+static uint32_t crc32_x2n[32];
+
+#if !defined(__ARM_FEATURE_CRC32)
+// crc32_table[k][b] : CRC of byte b followed by k zero bytes
+static uint32_t crc32_table[8][256];
+#endif
+
+// a * b modulo the polynomial, <a> must not be 0
+static uint32_t crc32_multmodp(uint32_t a, uint32_t b)
+{
+    uint32_t m = 1U << 31;
+    uint32_t p = 0;
+
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0)
+                break;
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ CRC32_POLY : b >> 1;
+    }
+    return p;
+}
+
+void crc32_init(void)
+{
+    uint32_t p;
+
+#if !defined(__ARM_FEATURE_CRC32)
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (uint32_t j = 0; j < 8; j++)
+            crc = (crc >> 1) ^ (CRC32_POLY & -(crc & 1));
+        crc32_table[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (uint32_t k = 1; k < 8; k++) {
+            uint32_t prev = crc32_table[k - 1][i];
+            crc32_table[k][i] = (prev >> 8) ^ crc32_table[0][prev & 0xFF];
+        }
+    }
+#endif
+
+    // Reflected representation : x^0 is bit 31, x^1 is bit 30
+    p = 1U << 30;
+    crc32_x2n[0] = p;
+    for (uint32_t n = 1; n < 32; n++)
+        crc32_x2n[n] = p = crc32_multmodp(p, p);
+}
+
+uint32_t crc32_update(uint32_t crc, const void *data, size_t length)
+{
+    const uint8_t *p = (const uint8_t *)data;
+
+    crc = ~crc;
+
+#if defined(__ARM_FEATURE_CRC32)
+    while (length && ((uintptr_t)p & 7)) {
+        __asm__("crc32b %w0, %w0, %w1" : "+r"(crc) : "r"((uint32_t)*p++));
+        length--;
+    }
+    for (; length >= 8; length -= 8, p += 8) {
+        uint64_t v = *(const uint64_t *)p;
+        __asm__("crc32x %w0, %w0, %x1" : "+r"(crc) : "r"(v));
+    }
+    while (length--)
+        __asm__("crc32b %w0, %w0, %w1" : "+r"(crc) : "r"((uint32_t)*p++));
+#else
+    while (length && ((uintptr_t)p & 3)) {
+        crc = (crc >> 8) ^ crc32_table[0][(crc ^ *p++) & 0xFF];
+        length--;
+    }
+
+    // Slicing-by-8 : 8 independent lookups per 8 bytes, little-endian words
+    for (; length >= 8; length -= 8, p += 8) {
+        uint32_t one = ((const crc_word_t *)p)[0] ^ crc;
+        uint32_t two = ((const crc_word_t *)p)[1];
+
+        crc = crc32_table[7][one & 0xFF] ^
+              crc32_table[6][(one >> 8) & 0xFF] ^
+              crc32_table[5][(one >> 16) & 0xFF] ^
+              crc32_table[4][one >> 24] ^
+              crc32_table[3][two & 0xFF] ^
+              crc32_table[2][(two >> 8) & 0xFF] ^
+              crc32_table[1][(two >> 16) & 0xFF] ^
+              crc32_table[0][two >> 24];
+    }
+
+    while (length--)
+        crc = (crc >> 8) ^ crc32_table[0][(crc ^ *p++) & 0xFF];
+#endif
+
+    return ~crc;
+}
+
+uint32_t crc32_combine(uint32_t crc_a, uint32_t crc_b, size_t length_b)
+{
+    // Shift crc(A) past the 8 * length_b bits of B : multiply by x^(8n)
+    uint32_t shift = 1U << 31;
+    uint32_t k = 3;
+
+    for (; length_b; length_b >>= 1, k++) {
+        if (length_b & 1)
+            shift = crc32_multmodp(crc32_x2n[k & 31], shift);
+    }
+
+    return crc32_multmodp(shift, crc_a) ^ crc_b;
+}
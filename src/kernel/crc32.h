@@ -0,0 +1,41 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+/*
+ * CRC-32 (IEEE 802.3, reflected polynomial 0xEDB88320)
+ *
+ * Same checksum as zlib's crc32() : ROM and holotape images can be signed
+ * with any standard tool. The backend is picked at build time :
+ * the ARMv8 crc32b/crc32x instructions when the CRC extension is available
+ * (BCM2837), slicing-by-8 tables everywhere else.
+ *
+ * crc32_update() takes and returns the finalized value, so a checksum can
+ * be computed chunk by chunk as data streams in, starting from 0.
+ * crc32_combine() merges the checksums of two adjacent chunks computed
+ * independently.
+ *
+ * References :
+ * https://create.stephan-brumme.com/crc32/ (slicing-by-8)
+ * zlib crc32.c (crc32_combine)
+ * ARM Architecture Reference Manual ARMv8-A, C6.2 CRC32B/CRC32X
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Build the lookup tables, must run before any other crc32 function
+void crc32_init(void);
+
+// Extend <crc> (0 to start) with <length> bytes of <data>
+uint32_t crc32_update(uint32_t crc, const void *data, size_t length);
+
+// CRC of the concatenation A|B from crc(A), crc(B) and the length of B
+uint32_t crc32_combine(uint32_t crc_a, uint32_t crc_b, size_t length_b);
+
+static inline uint32_t crc32(const void *data, size_t length)
+{
+    return crc32_update(0, data, length);
+}
+
+#endif // CRC32_H
@@ -0,0 +1,235 @@
+#include "dirty.h"
+#include "k_libc/k_string.h"
+
+// Bits of the tile columns c0..c1 (inclusive) in word <word> of a row
+static inline uint32_t dirty_mask(uint32_t word, uint32_t c0, uint32_t c1)
+{
+    uint32_t lo = word * 32, hi = lo + 31;
+
+    if (c1 < lo || c0 > hi)
+        return 0;
+
+    uint32_t first = c0 > lo ? c0 - lo : 0;
+    uint32_t last = c1 < hi ? c1 - lo : 31;
+    return (0xFFFFFFFF >> (31 - last)) & (0xFFFFFFFF << first);
+}
+
+static inline bool dirty_test(const dirty_map_t *map, uint32_t col, uint32_t row)
+{
+    return map->bits[row][col / 32] & (1u << (col % 32));
+}
+
+// Clip <rect> to the screen, false if nothing is left
+static inline bool dirty_clip(const dirty_map_t *map, dirty_rect_t *rect)
+{
+    if (rect->x0 < 0)
+        rect->x0 = 0;
+    if (rect->y0 < 0)
+        rect->y0 = 0;
+    if (rect->x1 > (int32_t)map->width)
+        rect->x1 = map->width;
+    if (rect->y1 > (int32_t)map->height)
+        rect->y1 = map->height;
+    return rect->x0 < rect->x1 && rect->y0 < rect->y1;
+}
+
+void dirty_init(dirty_map_t *map, uint32_t width, uint32_t height)
+{
+    uint32_t shift = DIRTY_TILE_SHIFT;
+
+    // Larger tiles for the screens the bitmap cannot hold
+    while (((width + (1 << shift) - 1) >> shift) > DIRTY_COLS_MAX
+           || ((height + (1 << shift) - 1) >> shift) > DIRTY_ROWS_MAX)
+        shift++;
+
+    map->shift = shift;
+    map->width = width;
+    map->height = height;
+    map->cols = (width + (1 << shift) - 1) >> shift;
+    map->rows = (height + (1 << shift) - 1) >> shift;
+    dirty_clear(map);
+}
+
+void dirty_clear(dirty_map_t *map)
+{
+    k_memset(map->bits, 0, sizeof(map->bits));
+}
+
+void dirty_fill(dirty_map_t *map)
+{
+    dirty_rect_t all = { 0, 0, map->width, map->height };
+    dirty_add(map, &all);
+}
+
+bool dirty_empty(const dirty_map_t *map)
+{
+    for (uint32_t row = 0; row < map->rows; row++) {
+        for (uint32_t w = 0; w < DIRTY_WORDS; w++) {
+            if (map->bits[row][w])
+                return false;
+        }
+    }
+    return true;
+}
+
+void dirty_add(dirty_map_t *map, const dirty_rect_t *rect)
+{
+    dirty_rect_t r = *rect;
+
+    if (!dirty_clip(map, &r))
+        return;
+
+    uint32_t c0 = r.x0 >> map->shift, c1 = (r.x1 - 1) >> map->shift;
+    uint32_t r0 = r.y0 >> map->shift, r1 = (r.y1 - 1) >> map->shift;
+
+    for (uint32_t w = 0; w < DIRTY_WORDS; w++) {
+        uint32_t mask = dirty_mask(w, c0, c1);
+        if (!mask)
+            continue;
+        for (uint32_t row = r0; row <= r1; row++)
+            map->bits[row][w] |= mask;
+    }
+}
+
+void dirty_merge(dirty_map_t *dst, const dirty_map_t *src)
+{
+    for (uint32_t row = 0; row < dst->rows; row++) {
+        for (uint32_t w = 0; w < DIRTY_WORDS; w++)
+            dst->bits[row][w] |= src->bits[row][w];
+    }
+}
+
+bool dirty_take_rect(dirty_map_t *map, dirty_rect_t *rect)
+{
+    uint32_t row, c0 = 0;
+
+    for (row = 0; row < map->rows; row++) {
+        uint32_t w;
+        for (w = 0; w < DIRTY_WORDS && !map->bits[row][w]; w++)
+            ;
+        if (w < DIRTY_WORDS) {
+            c0 = w * 32 + __builtin_ctz(map->bits[row][w]);
+            break;
+        }
+    }
+    if (row == map->rows)
+        return false;
+
+    // Run of tiles to the right, then the rows below with the same run
+    uint32_t c1 = c0;
+    while (c1 + 1 < map->cols && dirty_test(map, c1 + 1, row))
+        c1++;
+
+    uint32_t mask[DIRTY_WORDS];
+    for (uint32_t w = 0; w < DIRTY_WORDS; w++)
+        mask[w] = dirty_mask(w, c0, c1);
+
+    uint32_t r1 = row;
+    for (; r1 + 1 < map->rows; r1++) {
+        uint32_t w;
+        for (w = 0; w < DIRTY_WORDS && (map->bits[r1 + 1][w] & mask[w]) == mask[w]; w++)
+            ;
+        if (w < DIRTY_WORDS)
+            break;
+    }
+
+    for (uint32_t r = row; r <= r1; r++) {
+        for (uint32_t w = 0; w < DIRTY_WORDS; w++)
+            map->bits[r][w] &= ~mask[w];
+    }
+
+    rect->x0 = c0 << map->shift;
+    rect->y0 = row << map->shift;
+    rect->x1 = (c1 + 1) << map->shift;
+    rect->y1 = (r1 + 1) << map->shift;
+    dirty_clip(map, rect);
+    return true;
+}
+
+// Copy <rect> of the front buffer to the target, returns the bytes copied
+static uint32_t dirty_copy(const raster_target_t *target, const uint8_t *front,
+                           const dirty_rect_t *rect)
+{
+    uint32_t offset = (uint32_t)rect->y0 * target->pitch + (uint32_t)rect->x0 * target->bytes_pp;
+    uint32_t bytes = (uint32_t)(rect->x1 - rect->x0) * target->bytes_pp;
+
+    for (int32_t y = rect->y0; y < rect->y1; y++, offset += target->pitch)
+        k_memcpy(target->pixels + offset, front + offset, bytes);
+    return bytes * (rect->y1 - rect->y0);
+}
+
+void dirty_tracker_reset(dirty_tracker_t *tracker, const raster_target_t *target,
+                         const uint8_t *front, const dirty_map_t *stale)
+{
+    dirty_init(&tracker->drawn, target->width, target->height);
+    dirty_init(&tracker->stale, target->width, target->height);
+    if (front && stale)
+        dirty_merge(&tracker->stale, stale);
+
+    tracker->front = front;
+    tracker->drawn_bytes = 0;
+    tracker->copied_bytes = 0;
+}
+
+void dirty_track(dirty_tracker_t *tracker, const raster_target_t *target,
+                 const dirty_rect_t *rect, bool covers)
+{
+    dirty_map_t *stale = &tracker->stale;
+    dirty_rect_t r = *rect;
+
+    if (!dirty_clip(stale, &r))
+        return;
+
+    uint32_t shift = stale->shift;
+    uint32_t c0 = r.x0 >> shift, c1 = (r.x1 - 1) >> shift;
+    uint32_t r0 = r.y0 >> shift, r1 = (r.y1 - 1) >> shift;
+
+    tracker->drawn_bytes += (uint32_t)(r.x1 - r.x0) * (r.y1 - r.y0) * target->bytes_pp;
+
+    if (tracker->front) {
+        // Tiles the rect covers whole, screen edges included, need no copy
+        int32_t fc0 = (r.x0 + (1 << shift) - 1) >> shift;
+        int32_t fc1 = r.x1 == (int32_t)stale->width ? (int32_t)c1 : (r.x1 >> shift) - 1;
+        int32_t fr0 = (r.y0 + (1 << shift) - 1) >> shift;
+        int32_t fr1 = r.y1 == (int32_t)stale->height ? (int32_t)r1 : (r.y1 >> shift) - 1;
+
+        for (uint32_t row = r0; row <= r1; row++) {
+            bool full_row = covers && (int32_t)row >= fr0 && (int32_t)row <= fr1;
+
+            for (uint32_t w = 0; w < DIRTY_WORDS; w++) {
+                uint32_t mask = dirty_mask(w, c0, c1);
+                uint32_t copy = stale->bits[row][w] & mask;
+
+                if (full_row && fc0 <= fc1)
+                    copy &= ~dirty_mask(w, fc0, fc1);
+                stale->bits[row][w] &= ~mask;
+
+                // Runs of tiles within the word, one copy per run
+                while (copy) {
+                    uint32_t first = __builtin_ctz(copy);
+                    uint32_t bits = copy >> first;
+                    uint32_t run = ~bits ? __builtin_ctz(~bits) : 32;
+                    dirty_rect_t tile = {
+                        (int32_t)((w * 32 + first) << shift), (int32_t)(row << shift),
+                        (int32_t)((w * 32 + first + run) << shift), (int32_t)((row + 1) << shift)
+                    };
+                    dirty_clip(stale, &tile);
+                    tracker->copied_bytes += dirty_copy(target, tracker->front, &tile);
+                    copy &= ~dirty_mask(0, first, first + run - 1);
+                }
+            }
+        }
+    }
+
+    dirty_add(&tracker->drawn, &r);
+}
+
+void dirty_flush(dirty_tracker_t *tracker, const raster_target_t *target)
+{
+    dirty_rect_t rect;
+
+    if (!tracker->front)
+        return;
+    while (dirty_take_rect(&tracker->stale, &rect))
+        tracker->copied_bytes += dirty_copy(target, tracker->front, &rect);
+}
@@ -0,0 +1,83 @@
+#ifndef DIRTY_H
+#define DIRTY_H
+
+/*
+ * Dirty region tracking
+ *
+ * A dirty_map_t is a bitmap of screen tiles, 16x16 pixels unless the
+ * screen is too large for DIRTY_COLS_MAX x DIRTY_ROWS_MAX tiles, in which
+ * case the tiles grow. Rects are added in pixels and rounded out to
+ * tiles, overlapping rects merge for free. dirty_take_rect hands the map
+ * back as few rects as it can: horizontal runs of tiles, extended down
+ * while the rows below have the same run.
+ *
+ * A dirty_tracker_t keeps a back buffer in step with the front buffer
+ * without copying whole frames. Its stale map holds the tiles the front
+ * buffer changed since the back buffer was last shown. Every primitive
+ * reports the rect it is about to write (dirty_track): stale tiles in it
+ * are first copied from the front buffer, unless the primitive covers
+ * them, and the rect is added to the drawn map. dirty_flush copies the
+ * stale tiles nothing wrote to.
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "raster.h"
+
+#define DIRTY_TILE_SHIFT        4       // 16x16 pixel tiles
+#define DIRTY_COLS_MAX          64
+#define DIRTY_ROWS_MAX          64
+#define DIRTY_WORDS             (DIRTY_COLS_MAX / 32)
+
+typedef struct {
+    int32_t x0, y0;             // inclusive
+    int32_t x1, y1;             // exclusive
+} dirty_rect_t;
+
+typedef struct {
+    uint32_t shift;             // tile size, log2 pixels
+    uint32_t width, height;     // pixels
+    uint32_t cols, rows;        // tiles
+    uint32_t bits[DIRTY_ROWS_MAX][DIRTY_WORDS];
+} dirty_map_t;
+
+typedef struct {
+    dirty_map_t drawn;          // tiles written this frame
+    dirty_map_t stale;          // tiles behind the front buffer
+    const uint8_t *front;       // same layout as the target, NULL : nothing stale
+    uint32_t drawn_bytes;       // bytes in the rects of the primitives
+    uint32_t copied_bytes;      // bytes copied from the front buffer
+} dirty_tracker_t;
+
+// Empty map of a width*height screen
+void dirty_init(dirty_map_t *map, uint32_t width, uint32_t height);
+void dirty_clear(dirty_map_t *map);
+void dirty_fill(dirty_map_t *map);
+bool dirty_empty(const dirty_map_t *map);
+
+// Add the tiles of <rect>, clipped to the screen
+void dirty_add(dirty_map_t *map, const dirty_rect_t *rect);
+
+// <dst> |= <src>, both of the same screen
+void dirty_merge(dirty_map_t *dst, const dirty_map_t *src);
+
+// Remove a rect of dirty tiles from <map> into <rect>, in pixels clipped
+// to the screen. False once the map is empty.
+bool dirty_take_rect(dirty_map_t *map, dirty_rect_t *rect);
+
+// Start a frame on <target>: nothing drawn, <stale> (may be NULL) to be
+// copied from <front>
+void dirty_tracker_reset(dirty_tracker_t *tracker, const raster_target_t *target,
+                         const uint8_t *front, const dirty_map_t *stale);
+
+// <rect> of the target is about to be written, entirely if <covers>
+void dirty_track(dirty_tracker_t *tracker, const raster_target_t *target,
+                 const dirty_rect_t *rect, bool covers);
+
+// Copy the stale tiles left, the target then matches the front buffer
+// plus what was drawn
+void dirty_flush(dirty_tracker_t *tracker, const raster_target_t *target);
+
+#endif // DIRTY_H
@@ -0,0 +1,72 @@
+#include "dma.h"
+#include "io.h"
+#include "uart.h"
+#include "cache.h"
+#include "mailbox.h"
+
+#define DMA_CHANNEL(reg, n)     ((reg) + 0x100 * (n))
+
+// Control and status
+#define DMA_CS_ACTIVE           (1 << 0)
+#define DMA_CS_END              (1 << 1)
+#define DMA_CS_INT              (1 << 2)
+#define DMA_CS_WAIT_WRITES      (1 << 28)
+#define DMA_CS_RESET            (1u << 31)
+
+// Channels 11-14 share one interrupt, 15 is not in the block
+#define DMA_CHANNEL_LAST        10
+
+// VideoCore bus views of RAM and of the peripherals. The ARM of the
+// BCM2835 goes through the L2 cache, its alias keeps them coherent.
+#if BCM2835
+#define DMA_BUS_RAM             0x40000000
+#else
+#define DMA_BUS_RAM             0xC0000000
+#endif
+#define DMA_BUS_PERIPHERAL      0x7E000000
+
+static uint32_t dma_used;
+
+int32_t dma_channel_alloc(void)
+{
+    uint32_t free = mailbox_get(MAILBOX_TAG_GET_DMA_CHANNELS) & ~dma_used;
+
+    // The lite channels first, the top ones, enough for peripherals
+    for (int32_t channel = DMA_CHANNEL_LAST; channel >= 0; channel--) {
+        if (!(free & (1u << channel)))
+            continue;
+
+        dma_used |= 1u << channel;
+        mmio_write(DMA_ENABLE, mmio_read(DMA_ENABLE) | 1u << channel);
+        mmio_write(DMA_CHANNEL(DMA_CS, channel), DMA_CS_RESET);
+        return channel;
+    }
+    return -1;
+}
+
+uint32_t dma_bus_address(const void *p)
+{
+    return (uint32_t)(uintptr_t)p | DMA_BUS_RAM;
+}
+
+uint32_t dma_peripheral_address(uint32_t reg)
+{
+    return reg - PERIPHERAL_BASE + DMA_BUS_PERIPHERAL;
+}
+
+void dma_start(uint32_t channel, dma_cb_t *cb)
+{
+    dcache_clean_range(cb, sizeof(*cb));
+    mmio_write(DMA_CHANNEL(DMA_CONBLK_AD, channel), dma_bus_address(cb));
+    mmio_write(DMA_CHANNEL(DMA_CS, channel), DMA_CS_ACTIVE | DMA_CS_WAIT_WRITES);
+}
+
+bool dma_busy(uint32_t channel)
+{
+    return mmio_read(DMA_CHANNEL(DMA_CS, channel)) & DMA_CS_ACTIVE;
+}
+
+void dma_ack(uint32_t channel)
+{
+    mmio_write(DMA_CHANNEL(DMA_CS, channel), DMA_CS_END | DMA_CS_INT);
+}
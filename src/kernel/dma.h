@@ -0,0 +1,57 @@
+#ifndef DMA_H
+#define DMA_H
+
+/*
+ * DMA controller
+ *
+ * Channels are taken from the ones the firmware leaves to the ARM
+ * (GET_DMA_CHANNELS), each runs a chain of control blocks. The engine
+ * reads memory through the VideoCore bus, which does not see the ARM data
+ * cache: control blocks are cleaned by dma_start, the data by the caller.
+ * It is paced by a peripheral DREQ, and moves 32 bits at a time at least.
+ *
+ * References :
+ * BCM2835 ARM Peripherals, chapter 4
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Transfer information
+#define DMA_TI_INTEN            (1 << 0)
+#define DMA_TI_WAIT_RESP        (1 << 3)
+#define DMA_TI_DEST_DREQ        (1 << 6)
+#define DMA_TI_SRC_INC          (1 << 8)
+#define DMA_TI_PERMAP(dreq)     ((dreq) << 16)
+
+// Peripheral DREQ
+#define DMA_DREQ_UART_TX        12
+
+typedef struct {
+    uint32_t ti;
+    uint32_t source;            // bus addresses
+    uint32_t dest;
+    uint32_t length;            // bytes
+    uint32_t stride;
+    uint32_t next;              // next control block, 0 : last
+    uint32_t reserved[2];
+} __attribute__((aligned(32))) dma_cb_t;
+
+// A free channel with an interrupt of its own, enabled, -1 if none left.
+// Called during init, channels are never given back.
+int32_t dma_channel_alloc(void);
+
+// Bus address of RAM and of a peripheral register
+uint32_t dma_bus_address(const void *p);
+uint32_t dma_peripheral_address(uint32_t reg);
+
+// Run the chain from <cb> on an idle channel
+void dma_start(uint32_t channel, dma_cb_t *cb);
+
+bool dma_busy(uint32_t channel);
+
+// Clear the end and interrupt flags of a finished chain
+void dma_ack(uint32_t channel);
+
+#endif // DMA_H
@@ -0,0 +1,505 @@
+#include "draw.h"
+#include "raster.h"
+#include "dirty.h"
+#include "text.h"
+#include "k_libc/k_stdio.h"
+#include "spinlock.h"
+#include "cpu.h"
+#include "trace.h"
+#include <stddef.h>
+
+#define DRAW_TILES_MAX          1024
+
+static fb_info_t *draw_target;
+static raster_target_t draw_raster;
+static dirty_tracker_t draw_dirty;
+static spinlock_t draw_lock = SPINLOCK_INIT("draw");
+
+// Batch scratch, protected by draw_lock
+static uint16_t draw_order[DRAW_BATCH_MAX];
+static uint16_t draw_keys[DRAW_BATCH_MAX];
+static uint16_t draw_bins[DRAW_TILES_MAX + 1];
+
+bool draw_set_target(fb_info_t *fb)
+{
+    bool ok = true;
+
+    spin_lock(&draw_lock);
+    if (fb && !raster_target_init(&draw_raster, fb)) {
+        fb = NULL;
+        ok = false;
+    }
+    if (fb)
+        dirty_tracker_reset(&draw_dirty, &draw_raster, NULL, NULL);
+    draw_target = fb;
+    spin_unlock(&draw_lock);
+    return ok;
+}
+
+fb_info_t *draw_get_target(void)
+{
+    return draw_target;
+}
+
+void draw_begin_frame(const uint8_t *front, const dirty_map_t *stale)
+{
+    spin_lock(&draw_lock);
+    if (draw_target)
+        dirty_tracker_reset(&draw_dirty, &draw_raster, front, stale);
+    spin_unlock(&draw_lock);
+}
+
+bool draw_end_frame(dirty_map_t *drawn, uint32_t *drawn_bytes, uint32_t *copied_bytes)
+{
+    spin_lock(&draw_lock);
+    bool ok = draw_target != NULL;
+    if (ok) {
+        dirty_flush(&draw_dirty, &draw_raster);
+        *drawn = draw_dirty.drawn;
+        *drawn_bytes = draw_dirty.drawn_bytes;
+        *copied_bytes = draw_dirty.copied_bytes;
+    }
+    spin_unlock(&draw_lock);
+    return ok;
+}
+
+static inline int32_t min(int32_t a, int32_t b)
+{
+    return a < b ? a : b;
+}
+
+static inline int32_t max(int32_t a, int32_t b)
+{
+    return a > b ? a : b;
+}
+
+// Report the pixels x0,y0 to x1,y1 (exclusive) a primitive is about to
+// write to the tracker, <covers> if it writes all of them
+static void draw_mark(const raster_clip_t *clip, int32_t x0, int32_t y0, int32_t x1, int32_t y1,
+                      bool covers)
+{
+    dirty_rect_t rect = { max(x0, clip->x0), max(y0, clip->y0),
+                          min(x1, clip->x1), min(y1, clip->y1) };
+
+    if (rect.x0 < rect.x1 && rect.y0 < rect.y1)
+        dirty_track(&draw_dirty, &draw_raster, &rect, covers);
+}
+
+static inline bool draw_coord_ok(int32_t x, int32_t y)
+{
+    return x >= -DRAW_COORD_MAX && x <= DRAW_COORD_MAX && y >= -DRAW_COORD_MAX && y <= DRAW_COORD_MAX;
+}
+
+// Outcodes of a point against the pixels of the clip rect
+#define DRAW_OUT_LEFT           (1 << 0)
+#define DRAW_OUT_RIGHT          (1 << 1)
+#define DRAW_OUT_TOP            (1 << 2)
+#define DRAW_OUT_BOTTOM         (1 << 3)
+
+static uint32_t draw_outcode(const raster_clip_t *clip, int64_t x, int64_t y)
+{
+    uint32_t code = 0;
+
+    if (x < clip->x0)
+        code |= DRAW_OUT_LEFT;
+    else if (x >= clip->x1)
+        code |= DRAW_OUT_RIGHT;
+    if (y < clip->y0)
+        code |= DRAW_OUT_TOP;
+    else if (y >= clip->y1)
+        code |= DRAW_OUT_BOTTOM;
+    return code;
+}
+
+// Cohen-Sutherland : cut the segment down to the part inside <clip>, false
+// if none is. The cuts are rounded, the ends may be a pixel off the line.
+static bool draw_clip_line(const raster_clip_t *clip, int64_t *x0, int64_t *y0, int64_t *x1, int64_t *y1)
+{
+    uint32_t code0 = draw_outcode(clip, *x0, *y0);
+    uint32_t code1 = draw_outcode(clip, *x1, *y1);
+
+    while (code0 | code1) {
+        if (code0 & code1)
+            return false;
+
+        // Move the end outside onto the edge it is beyond
+        uint32_t code = code0 ? code0 : code1;
+        int64_t dx = *x1 - *x0, dy = *y1 - *y0;
+        int64_t x, y;
+
+        if (code & (DRAW_OUT_TOP | DRAW_OUT_BOTTOM)) {
+            y = code & DRAW_OUT_TOP ? clip->y0 : clip->y1 - 1;
+            x = *x0 + dx * (y - *y0) / dy;
+        } else {
+            x = code & DRAW_OUT_LEFT ? clip->x0 : clip->x1 - 1;
+            y = *y0 + dy * (x - *x0) / dx;
+        }
+
+        if (code == code0) {
+            *x0 = x;
+            *y0 = y;
+            code0 = draw_outcode(clip, x, y);
+        } else {
+            *x1 = x;
+            *y1 = y;
+            code1 = draw_outcode(clip, x, y);
+        }
+    }
+    return true;
+}
+
+// A line marks the bounds of its tile sized pieces inside the clip rect,
+// not of the whole line
+static void draw_mark_line(const raster_clip_t *clip, int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+{
+    int64_t ax0 = x0, ay0 = y0, ax1 = x1, ay1 = y1;
+
+    if (!draw_clip_line(clip, &ax0, &ay0, &ax1, &ay1))
+        return;
+
+    int64_t dx = ax1 - ax0, dy = ay1 - ay0;
+    int64_t adx = dx < 0 ? -dx : dx, ady = dy < 0 ? -dy : dy;
+    int64_t steps = ((adx > ady ? adx : ady) >> DIRTY_TILE_SHIFT) + 1;
+
+    for (int64_t i = 0; i < steps; i++) {
+        int32_t ax = ax0 + dx * i / steps, ay = ay0 + dy * i / steps;
+        int32_t bx = ax0 + dx * (i + 1) / steps, by = ay0 + dy * (i + 1) / steps;
+
+        // One pixel of margin for the rounding of the pieces and the cuts
+        draw_mark(clip, min(ax, bx) - 1, min(ay, by) - 1, max(ax, bx) + 2, max(ay, by) + 2, false);
+    }
+}
+
+static void draw_mark_rect(const raster_clip_t *clip, int32_t x, int32_t y, int32_t w, int32_t h)
+{
+    if (w <= 2 || h <= 2) {
+        draw_mark(clip, x, y, x + w, y + h, true);
+        return;
+    }
+
+    draw_mark(clip, x, y, x + w, y + 1, true);
+    draw_mark(clip, x, y + h - 1, x + w, y + h, true);
+    draw_mark(clip, x, y + 1, x + 1, y + h - 1, true);
+    draw_mark(clip, x + w - 1, y + 1, x + w, y + h - 1, true);
+}
+
+bool draw_point(int32_t x, int32_t y, uint32_t color)
+{
+    raster_clip_t clip;
+
+    if (!draw_coord_ok(x, y))
+        return false;
+
+    spin_lock(&draw_lock);
+    bool ok = draw_target != NULL;
+    if (ok) {
+        raster_clip_reset(&draw_raster, &clip);
+        draw_mark(&clip, x, y, x + 1, y + 1, true);
+        raster_point(&draw_raster, &clip, x, y, raster_color(draw_raster.bytes_pp, color));
+    }
+    spin_unlock(&draw_lock);
+    return ok;
+}
+
+bool draw_line(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t color)
+{
+    raster_clip_t clip;
+
+    if (!draw_coord_ok(x0, y0) || !draw_coord_ok(x1, y1))
+        return false;
+
+    spin_lock(&draw_lock);
+    bool ok = draw_target != NULL;
+    if (ok) {
+        raster_clip_reset(&draw_raster, &clip);
+        draw_mark_line(&clip, x0, y0, x1, y1);
+        raster_line(&draw_raster, &clip, x0, y0, x1, y1, raster_color(draw_raster.bytes_pp, color));
+    }
+    spin_unlock(&draw_lock);
+    return ok;
+}
+
+bool draw_clear(uint32_t color)
+{
+    spin_lock(&draw_lock);
+    bool ok = draw_target != NULL;
+    if (ok) {
+        raster_clip_t clip;
+        raster_clip_reset(&draw_raster, &clip);
+        draw_mark(&clip, clip.x0, clip.y0, clip.x1, clip.y1, true);
+        raster_clear(&draw_raster, raster_color(draw_raster.bytes_pp, color));
+    }
+    spin_unlock(&draw_lock);
+    return ok;
+}
+
+bool draw_text(int32_t x, int32_t y, const char *text, uint32_t length, uint32_t size,
+               uint32_t color)
+{
+    raster_clip_t clip;
+
+    spin_lock(&draw_lock);
+    bool ok = draw_target != NULL;
+    if (ok) {
+        raster_clip_reset(&draw_raster, &clip);
+        draw_mark(&clip, x, y, x + text_width(length, size), y + text_height(size), false);
+        text_draw(&draw_raster, &clip, x, y, text, length, size,
+                  raster_color(draw_raster.bytes_pp, color));
+    }
+    spin_unlock(&draw_lock);
+    return ok;
+}
+
+static inline int32_t clamp(int32_t v, int32_t lo, int32_t hi)
+{
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+static bool draw_validate(const draw_cmd_t *cmd)
+{
+    switch (cmd->op) {
+    case DRAW_OP_POINT:
+        return draw_coord_ok(cmd->x0, cmd->y0);
+    case DRAW_OP_LINE:
+        return draw_coord_ok(cmd->x0, cmd->y0) && draw_coord_ok(cmd->x1, cmd->y1);
+    case DRAW_OP_CLEAR:
+        return true;
+    case DRAW_OP_RECT:
+    case DRAW_OP_CLIP:
+        return cmd->x1 >= 0 && cmd->y1 >= 0;
+    case DRAW_OP_TEXT:
+        return cmd->data && cmd->length <= DRAW_TEXT_MAX && cmd->x1 > 0;
+    case DRAW_OP_BLIT:
+        return cmd->data && !(cmd->data & 3) && cmd->x1 >= 0 && cmd->y1 >= 0
+            && cmd->length >= cmd->x1;
+    default:
+        return false;
+    }
+}
+
+static void draw_execute(const raster_target_t *target, raster_clip_t *clip, const draw_cmd_t *cmd)
+{
+    uint32_t color = raster_color(target->bytes_pp, cmd->color);
+
+    switch (cmd->op) {
+    case DRAW_OP_POINT:
+        draw_mark(clip, cmd->x0, cmd->y0, cmd->x0 + 1, cmd->y0 + 1, true);
+        raster_point(target, clip, cmd->x0, cmd->y0, color);
+        break;
+    case DRAW_OP_LINE:
+        draw_mark_line(clip, cmd->x0, cmd->y0, cmd->x1, cmd->y1);
+        raster_line(target, clip, cmd->x0, cmd->y0, cmd->x1, cmd->y1, color);
+        break;
+    case DRAW_OP_RECT:
+        if (cmd->flags & DRAW_FLAG_FILL) {
+            draw_mark(clip, cmd->x0, cmd->y0, cmd->x0 + cmd->x1, cmd->y0 + cmd->y1, true);
+            raster_fill_rect(target, clip, cmd->x0, cmd->y0, cmd->x1, cmd->y1, color);
+        } else {
+            draw_mark_rect(clip, cmd->x0, cmd->y0, cmd->x1, cmd->y1);
+            raster_rect(target, clip, cmd->x0, cmd->y0, cmd->x1, cmd->y1, color);
+        }
+        break;
+    case DRAW_OP_TEXT:
+        draw_mark(clip, cmd->x0, cmd->y0, cmd->x0 + text_width(cmd->length, cmd->x1),
+                  cmd->y0 + text_height(cmd->x1), false);
+        text_draw(target, clip, cmd->x0, cmd->y0, (const char *)cmd->data,
+                  cmd->length, cmd->x1, color);
+        break;
+    case DRAW_OP_BLIT:
+        draw_mark(clip, cmd->x0, cmd->y0, cmd->x0 + cmd->x1, cmd->y0 + cmd->y1, true);
+        raster_blit(target, clip, cmd->x0, cmd->y0, cmd->x1, cmd->y1,
+                    (const void *)cmd->data, cmd->length);
+        break;
+    case DRAW_OP_CLIP:
+        if (cmd->x1 == 0 && cmd->y1 == 0)
+            raster_clip_reset(target, clip);
+        else
+            raster_clip_set(target, clip, cmd->x0, cmd->y0, cmd->x1, cmd->y1);
+        break;
+    case DRAW_OP_CLEAR:
+        draw_mark(clip, clip->x0, clip->y0, clip->x1, clip->y1, true);
+        raster_fill_rect(target, clip, clip->x0, clip->y0,
+                         clip->x1 - clip->x0, clip->y1 - clip->y0, color);
+        break;
+    }
+}
+
+static inline bool draw_is_barrier(const draw_cmd_t *cmd)
+{
+    return cmd->op == DRAW_OP_CLIP || cmd->op == DRAW_OP_CLEAR;
+}
+
+// Stable counting sort of [begin, end) by tile, into draw_order
+static void draw_sort_segment(const raster_target_t *target, const draw_cmd_t *cmds,
+                              uint32_t begin, uint32_t end)
+{
+    uint32_t tiles_x = (target->width + (1 << DRAW_TILE_SHIFT) - 1) >> DRAW_TILE_SHIFT;
+    uint32_t tiles_y = (target->height + (1 << DRAW_TILE_SHIFT) - 1) >> DRAW_TILE_SHIFT;
+    uint32_t tiles = tiles_x * tiles_y;
+
+    if (tiles > DRAW_TILES_MAX)
+        tiles = DRAW_TILES_MAX;
+
+    for (uint32_t t = 0; t <= tiles; t++)
+        draw_bins[t] = 0;
+
+    for (uint32_t i = begin; i < end; i++) {
+        uint32_t tx = clamp(cmds[i].x0, 0, target->width - 1) >> DRAW_TILE_SHIFT;
+        uint32_t ty = clamp(cmds[i].y0, 0, target->height - 1) >> DRAW_TILE_SHIFT;
+        uint32_t key = ty * tiles_x + tx;
+
+        draw_keys[i] = key < tiles ? key : tiles - 1;
+        draw_bins[draw_keys[i] + 1]++;
+    }
+
+    for (uint32_t t = 1; t <= tiles; t++)
+        draw_bins[t] += draw_bins[t - 1];
+
+    for (uint32_t i = begin; i < end; i++)
+        draw_order[begin + draw_bins[draw_keys[i]]++] = i;
+}
+
+static void draw_sort(const raster_target_t *target, const draw_cmd_t *cmds, uint32_t count)
+{
+    uint32_t begin = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (!draw_is_barrier(&cmds[i]))
+            continue;
+
+        draw_sort_segment(target, cmds, begin, i);
+        draw_order[i] = i;
+        begin = i + 1;
+    }
+    draw_sort_segment(target, cmds, begin, count);
+}
+
+int32_t draw_batch(const draw_cmd_t *cmds, uint32_t count, uint32_t flags,
+                   draw_batch_stats_t *stats)
+{
+    draw_batch_stats_t timing = { 0 };
+    uint32_t start = cpu_cycles();
+
+    if (!cmds || count > DRAW_BATCH_MAX)
+        return -1;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (!draw_validate(&cmds[i]))
+            return -1;
+    }
+
+    uint32_t now = cpu_cycles();
+    timing.validate_cycles = now - start;
+    start = now;
+
+    spin_lock(&draw_lock);
+
+    const raster_target_t *target = &draw_raster;
+    if (!draw_target) {
+        spin_unlock(&draw_lock);
+        return -1;
+    }
+
+    if (flags & DRAW_BATCH_SORT) {
+        draw_sort(target, cmds, count);
+    } else {
+        for (uint32_t i = 0; i < count; i++)
+            draw_order[i] = i;
+    }
+
+    now = cpu_cycles();
+    timing.sort_cycles = now - start;
+    start = now;
+
+    TRACE_BEGIN("draw_batch", "%u commands", count);
+    raster_clip_t clip;
+    raster_clip_reset(target, &clip);
+    for (uint32_t i = 0; i < count; i++)
+        draw_execute(target, &clip, &cmds[draw_order[i]]);
+    TRACE_END("draw_batch");
+
+    spin_unlock(&draw_lock);
+
+    timing.execute_cycles = cpu_cycles() - start;
+    timing.commands = count;
+    if (stats)
+        *stats = timing;
+    return count;
+}
+
+static void draw_benchmark_report(const char *name, uint32_t pixels, uint32_t cycles, uint32_t cpu_hz)
+{
+    uint32_t rate = cycles ? (uint64_t)pixels * cpu_hz / cycles / 1000 : 0;
+    k_printf("  %-10s %8u Kpixels/s (%u cycles)\r\n", name, rate, cycles);
+}
+
+void draw_benchmark(uint32_t cpu_hz)
+{
+    spin_lock(&draw_lock);
+    if (!draw_target) {
+        spin_unlock(&draw_lock);
+        return;
+    }
+
+    const raster_target_t *target = &draw_raster;
+    int32_t w = target->width, h = target->height;
+    uint32_t green = raster_color(target->bytes_pp, DRAW_DEFAULT_COLOR);
+    raster_clip_t clip;
+    uint32_t start, pixels;
+
+    raster_clip_reset(target, &clip);
+
+    // Every pixel is written, the whole target is left cleared
+    draw_mark(&clip, clip.x0, clip.y0, clip.x1, clip.y1, true);
+
+    start = cpu_cycles();
+    for (uint32_t i = 0; i < 4; i++)
+        raster_clear(target, i & 1 ? green : 0);
+    draw_benchmark_report("clear", 4 * w * h, cpu_cycles() - start, cpu_hz);
+
+    start = cpu_cycles();
+    pixels = 0;
+    for (int32_t i = 0; i < 64; i++) {
+        raster_fill_rect(target, &clip, (i * 37) % w, (i * 23) % h, 96, 64, green);
+        pixels += 96 * 64;
+    }
+    draw_benchmark_report("fill rect", pixels, cpu_cycles() - start, cpu_hz);
+
+    start = cpu_cycles();
+    for (int32_t y = 0; y < h; y++)
+        raster_hline(target, &clip, 0, y, w, y);
+    draw_benchmark_report("hline", w * h, cpu_cycles() - start, cpu_hz);
+
+    start = cpu_cycles();
+    for (int32_t x = 0; x < w; x++)
+        raster_vline(target, &clip, x, 0, h, x);
+    draw_benchmark_report("vline", w * h, cpu_cycles() - start, cpu_hz);
+
+    start = cpu_cycles();
+    pixels = 0;
+    for (int32_t x = 0; x < w; x += 4) {
+        int32_t dx = w - 1 - 2 * x;
+        raster_line(target, &clip, x, 0, w - 1 - x, h - 1, green);
+        dx = dx < 0 ? -dx : dx;
+        pixels += (dx > h - 1 ? dx : h - 1) + 1;
+    }
+    draw_benchmark_report("line", pixels, cpu_cycles() - start, cpu_hz);
+
+    start = cpu_cycles();
+    for (int32_t i = 0; i < 16384; i++)
+        raster_point(target, &clip, (i * 7919) % w, (i * 104729) % h, green);
+    draw_benchmark_report("point", 16384, cpu_cycles() - start, cpu_hz);
+
+    static const char line[] = "ROBCO INDUSTRIES UNIFIED OPERATING SYSTEM 0123456789";
+    uint32_t length = sizeof(line) - 1;
+    start = cpu_cycles();
+    pixels = 0;
+    for (int32_t y = 0; y + FONT_HEIGHT <= h; y += FONT_HEIGHT) {
+        text_draw(target, &clip, y % 8, y, line, length, 1, green);
+        pixels += text_width(length, 1) * FONT_HEIGHT;
+    }
+    draw_benchmark_report("text", pixels, cpu_cycles() - start, cpu_hz);
+
+    raster_clear(target, 0);
+    spin_unlock(&draw_lock);
+}
@@ -0,0 +1,115 @@
+#ifndef DRAW_H
+#define DRAW_H
+
+/*
+ * Batched drawing
+ *
+ * A batch is an array of draw_cmd_t executed in one pass on the draw
+ * target, the framebuffer set with draw_set_target. The whole batch is
+ * validated before anything is drawn : a bad command rejects the batch.
+ *
+ * Commands are clipped to a clip rect shared by the batch, the whole
+ * screen at the start, replaced by every DRAW_OP_CLIP. Points and line
+ * ends further than DRAW_COORD_MAX off the origin are rejected.
+ *
+ * With DRAW_BATCH_SORT the commands between two DRAW_OP_CLIP/CLEAR are
+ * reordered by the screen tile of their first point (stable), so the
+ * writes of a tile stay together. Only use it when the overlapping
+ * commands of a batch can be drawn in any order.
+ *
+ * Every primitive reports the pixels it writes to a dirty_tracker_t
+ * (dirty.h): the frame records which tiles it drew, and tiles left stale
+ * by draw_begin_frame are copied from the front buffer before the first
+ * write over them.
+ *
+ * Colors are 32 bpp (0xAABBGGRR, rgba_to_uint32) whatever the target
+ * depth, converted once per command with raster_color. Blit pixels are
+ * copied as they are, in the target format.
+ *
+ * Text is drawn by text.c from a cache of glyphs pre-expanded for the
+ * target format, a run at a time.
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "framebuffer.h"
+#include "dirty.h"
+
+#define DRAW_BATCH_MAX          1024
+#define DRAW_TEXT_MAX           256
+#define DRAW_TILE_SHIFT         6       // 64x64 pixel tiles
+#define DRAW_COORD_MAX          16383   // |x|, |y| of points and line ends
+
+// Operations
+#define DRAW_OP_POINT           0       // x0,y0
+#define DRAW_OP_LINE            1       // x0,y0 to x1,y1
+#define DRAW_OP_RECT            2       // x0,y0, x1 wide, y1 high, DRAW_FLAG_FILL
+#define DRAW_OP_TEXT            3       // x0,y0, size x1, data chars, length bytes
+#define DRAW_OP_BLIT            4       // x0,y0, x1 wide, y1 high, data pixels, length stride
+#define DRAW_OP_CLIP            5       // x0,y0, x1 wide, y1 high, 0x0 for the whole screen
+#define DRAW_OP_CLEAR           6       // the clip rect
+#define DRAW_OP_COUNT           7
+
+#define DRAW_FLAG_FILL          (1 << 0)
+
+// Batch flags
+#define DRAW_BATCH_SORT         (1 << 0)
+
+typedef struct {
+    uint8_t op;
+    uint8_t flags;
+    uint16_t length;            // text bytes, blit stride in pixels
+    int16_t x0, y0;
+    int16_t x1, y1;
+    uint32_t color;             // 32 bpp
+    uintptr_t data;             // address of the text or blit pixels
+} draw_cmd_t;
+
+typedef struct {
+    uint32_t commands;
+    uint32_t validate_cycles;
+    uint32_t sort_cycles;
+    uint32_t execute_cycles;
+} draw_batch_stats_t;
+
+// Pip-Boy green, 32bpp
+#define DRAW_DEFAULT_COLOR      0xFF80FF1A
+
+// Surface the commands draw on, NULL until the framebuffer is allocated.
+// False (and no target) if the depth of <fb> is not supported.
+bool draw_set_target(fb_info_t *fb);
+fb_info_t *draw_get_target(void);
+
+// Start a frame on the target: the <stale> tiles (NULL for none) are out
+// of date and copied from <front>, a buffer of the same layout, unless
+// drawn over whole. Nothing is tracked as drawn yet.
+void draw_begin_frame(const uint8_t *front, const dirty_map_t *stale);
+
+// Copy the stale tiles nothing was drawn on, return the tiles drawn since
+// draw_begin_frame, the bytes of the primitives and the bytes copied.
+// False if there is no target.
+bool draw_end_frame(dirty_map_t *drawn, uint32_t *drawn_bytes, uint32_t *copied_bytes);
+
+// Single primitives on the whole target, false if there is none or a
+// coordinate is beyond DRAW_COORD_MAX
+bool draw_point(int32_t x, int32_t y, uint32_t color);
+bool draw_line(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t color);
+bool draw_clear(uint32_t color);
+
+// <length> characters of <text> with the built-in font scaled by <size>
+// (1..TEXT_SIZE_MAX), transparent background
+bool draw_text(int32_t x, int32_t y, const char *text, uint32_t length, uint32_t size,
+               uint32_t color);
+
+// Validate and run <count> commands, returns the number of commands run
+// or -1 if the batch was rejected. <stats> may be NULL.
+int32_t draw_batch(const draw_cmd_t *cmds, uint32_t count, uint32_t flags,
+                   draw_batch_stats_t *stats);
+
+// Measure the primitives on the target and print their pixel rates,
+// <cpu_hz> converts the cycles. Leaves the target cleared.
+void draw_benchmark(uint32_t cpu_hz);
+
+#endif // DRAW_H
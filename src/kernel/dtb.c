@@ -0,0 +1,90 @@
+#include "dtb.h"
+#include "k_libc/k_string.h"
+
+#include <stddef.h>
+
+// The blob is big-endian
+static uint32_t be32(const void *p)
+{
+    const uint8_t *b = (const uint8_t *)p;
+    return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3];
+}
+
+static uint64_t read_cells(const uint8_t *p, uint32_t cells)
+{
+    uint64_t value = 0;
+    for (uint32_t i = 0; i < cells; i++)
+        value = (value << 32) | be32(p + i * 4);
+    return value;
+}
+
+bool dtb_valid(const void *blob)
+{
+    return blob != NULL && be32(&((const fdt_header_t *)blob)->magic) == FDT_MAGIC;
+}
+
+uint32_t dtb_size(const void *blob)
+{
+    return be32(&((const fdt_header_t *)blob)->totalsize);
+}
+
+int dtb_get_mem(const void *blob, uint64_t *start, uint64_t *size)
+{
+    const fdt_header_t *header = (const fdt_header_t *)blob;
+    const uint8_t *structs;
+    const char *strings;
+    uint32_t offset = 0;
+    uint32_t depth = 0;
+    uint32_t address_cells = 2, size_cells = 1;     // defaults from the spec
+    bool in_memory = false;
+
+    if (!dtb_valid(blob))
+        return -1;
+
+    structs = (const uint8_t *)blob + be32(&header->off_dt_struct);
+    strings = (const char *)blob + be32(&header->off_dt_strings);
+
+    while (1) {
+        uint32_t token = be32(structs + offset);
+        offset += 4;
+
+        switch (token) {
+            case FDT_BEGIN_NODE: {
+                const char *name = (const char *)(structs + offset);
+                depth++;
+                // /memory or /memory@<address>
+                in_memory = (depth == 2 && k_memcmp(name, "memory", 6) == 0 &&
+                             (name[6] == '\0' || name[6] == '@'));
+                offset += (k_strlen((char *)name) + 1 + 3) & ~3;
+                break;
+            }
+            case FDT_END_NODE:
+                depth--;
+                in_memory = false;
+                break;
+            case FDT_PROP: {
+                uint32_t len = be32(structs + offset);
+                const char *name = strings + be32(structs + offset + 4);
+                const uint8_t *value = structs + offset + 8;
+
+                if (depth == 1 && k_memcmp(name, "#address-cells", 15) == 0)
+                    address_cells = be32(value);
+                else if (depth == 1 && k_memcmp(name, "#size-cells", 12) == 0)
+                    size_cells = be32(value);
+                else if (in_memory && k_memcmp(name, "reg", 4) == 0 &&
+                         len >= (address_cells + size_cells) * 4) {
+                    *start = read_cells(value, address_cells);
+                    *size = read_cells(value + address_cells * 4, size_cells);
+                    return 0;
+                }
+                offset += (8 + len + 3) & ~3;
+                break;
+            }
+            case FDT_NOP:
+                break;
+            case FDT_END:
+            default:
+                return -1;
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef __DTB_H__
+#define __DTB_H__
+
+/*
+ * Flattened Device Tree
+ *
+ * Only the bits needed at boot are parsed : the blob header and the
+ * /memory node.
+ *
+ * References :
+ * https://devicetree-specification.readthedocs.io/en/stable/flattened-format.html
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FDT_MAGIC       0xD00DFEED
+
+#define FDT_BEGIN_NODE  0x00000001
+#define FDT_END_NODE    0x00000002
+#define FDT_PROP        0x00000003
+#define FDT_NOP         0x00000004
+#define FDT_END         0x00000009
+
+typedef struct {
+    uint32_t magic;
+    uint32_t totalsize;
+    uint32_t off_dt_struct;
+    uint32_t off_dt_strings;
+    uint32_t off_mem_rsvmap;
+    uint32_t version;
+    uint32_t last_comp_version;
+    uint32_t boot_cpuid_phys;
+    uint32_t size_dt_strings;
+    uint32_t size_dt_struct;
+} fdt_header_t;
+
+// True if <blob> starts with a valid FDT header
+bool dtb_valid(const void *blob);
+
+// Size in bytes of the whole blob
+uint32_t dtb_size(const void *blob);
+
+// Read the first range of the /memory node "reg" property
+int dtb_get_mem(const void *blob, uint64_t *start, uint64_t *size);
+
+#endif // __DTB_H__
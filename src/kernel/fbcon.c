@@ -0,0 +1,127 @@
+#include "fbcon.h"
+#include "framebuffer.h"
+#include "raster.h"
+#include "font.h"
+#include "draw.h"
+
+#define FBCON_TAB               8
+
+static raster_target_t fbcon_target;   // both console frames
+static raster_clip_t fbcon_clip;
+static uint32_t fbcon_cols, fbcon_rows;
+static uint32_t fbcon_ring;             // ring height in pixel rows, the second copy is that far down
+static uint32_t fbcon_top;              // ring line at the top of the screen
+static uint32_t fbcon_col, fbcon_row;   // cursor, on screen
+static uint32_t fbcon_fg;
+static bool fbcon_ready;
+
+// Ring line of screen row <row>
+static inline uint32_t fbcon_line(uint32_t row)
+{
+    return (fbcon_top + row) % fbcon_rows;
+}
+
+static void fbcon_clear_line(uint32_t line)
+{
+    raster_fill_rect(&fbcon_target, &fbcon_clip, 0, line * FONT_HEIGHT,
+                     fbcon_target.width, FONT_HEIGHT, 0);
+    raster_fill_rect(&fbcon_target, &fbcon_clip, 0, fbcon_ring + line * FONT_HEIGHT,
+                     fbcon_target.width, FONT_HEIGHT, 0);
+}
+
+static void fbcon_newline(void)
+{
+    fbcon_col = 0;
+    if (fbcon_row + 1 < fbcon_rows) {
+        fbcon_row++;
+        return;
+    }
+
+    // The old top line comes back at the bottom
+    fbcon_clear_line(fbcon_top);
+    fbcon_top = (fbcon_top + 1) % fbcon_rows;
+    fb_scroll_console(fbcon_top * FONT_HEIGHT);
+}
+
+static void fbcon_reset(void)
+{
+    raster_clear(&fbcon_target, 0);
+    fbcon_top = 0;
+    fbcon_col = 0;
+    fbcon_row = 0;
+}
+
+bool fbcon_init(void)
+{
+    fb_info_t console;
+
+    if (!fb_get_console(&console) || !raster_target_init(&fbcon_target, &console))
+        return false;
+
+    // Two rings of whole lines, rows past them stay blank
+    fbcon_target.height = console.vHeight;
+    raster_clip_reset(&fbcon_target, &fbcon_clip);
+    fbcon_cols = console.width / FONT_WIDTH;
+    fbcon_rows = console.height / FONT_HEIGHT;
+    fbcon_ring = fbcon_rows * FONT_HEIGHT;
+    fbcon_fg = raster_color(fbcon_target.bytes_pp, DRAW_DEFAULT_COLOR);
+    if (!fbcon_cols || !fbcon_rows)
+        return false;
+
+    fbcon_reset();
+    fbcon_ready = true;
+    fb_show_console(0);
+    return true;
+}
+
+void fbcon_putc(char c)
+{
+    if (!fbcon_ready)
+        return;
+
+    switch (c) {
+    case '\n':
+        fbcon_newline();
+        return;
+    case '\r':
+        fbcon_col = 0;
+        return;
+    case '\b':
+        if (fbcon_col)
+            fbcon_col--;
+        return;
+    case '\t':
+        fbcon_col = (fbcon_col + FBCON_TAB) & ~(FBCON_TAB - 1);
+        if (fbcon_col >= fbcon_cols)
+            fbcon_newline();
+        return;
+    }
+    if ((uint8_t)c < FONT_FIRST)
+        return;
+
+    if (fbcon_col == fbcon_cols)
+        fbcon_newline();
+
+    int32_t x = fbcon_col * FONT_WIDTH, y = fbcon_line(fbcon_row) * FONT_HEIGHT;
+    const uint8_t *glyph = font_glyph(c);
+
+    raster_cell(&fbcon_target, &fbcon_clip, x, y, glyph, FONT_HEIGHT, fbcon_fg, 0);
+    raster_cell(&fbcon_target, &fbcon_clip, x, fbcon_ring + y, glyph, FONT_HEIGHT, fbcon_fg, 0);
+    fbcon_col++;
+}
+
+void fbcon_show(void)
+{
+    if (fbcon_ready)
+        fb_show_console_locked(fbcon_top * FONT_HEIGHT);
+}
+
+void fbcon_panic(void)
+{
+    if (!fbcon_ready)
+        return;
+
+    // Drawn even if it cannot be shown, the UART gets the report anyway
+    fbcon_reset();
+    fb_panic_console(0);
+}
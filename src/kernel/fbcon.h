@@ -0,0 +1,35 @@
+#ifndef FBCON_H
+#define FBCON_H
+
+/*
+ * Framebuffer console
+ *
+ * Kernel text output on the console frames of the framebuffer
+ * (fb_get_console), the K_OUTPUT_FB sink of k_putchar. Lines of the 8x8
+ * font form a ring one screen high, and each line is written twice: in
+ * the first console frame and one ring further down. The lines on screen
+ * are then always contiguous in video memory, so scrolling by a line only
+ * moves the virtual offset (fb_scroll_console) and clears the line coming
+ * into view, nothing is moved.
+ *
+ * Callers serialize, k_printf holds its lock.
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Clear the console and show it, false without console frames
+bool fbcon_init(void);
+
+void fbcon_putc(char c);
+
+// Show the console again as it was, in place of a boot splash: between
+// fb_splash_begin and fb_splash_end
+void fbcon_show(void);
+
+// Take the screen back after a fatal exception: cleared, output from the
+// top. The screen stays as it was if the framebuffer or the mailbox is busy.
+void fbcon_panic(void);
+
+#endif // FBCON_H
@@ -0,0 +1,32 @@
+#ifndef FONT_H
+#define FONT_H
+
+/*
+ * Built-in terminal font
+ *
+ * Monospaced 8x8 glyphs of the printable ASCII characters, packed 1bpp :
+ * one byte per row, bit 0 is the leftmost pixel.
+ *
+ */
+
+#include <stdint.h>
+
+#define FONT_WIDTH              8
+#define FONT_HEIGHT             8
+#define FONT_FIRST              0x20
+#define FONT_LAST               0x7E
+#define FONT_GLYPHS             (FONT_LAST - FONT_FIRST + 1)
+#define FONT_MISSING            '?'     // drawn for the other characters
+
+extern const uint8_t font_8x8[FONT_GLYPHS][FONT_HEIGHT];
+
+static inline const uint8_t *font_glyph(char c)
+{
+    uint8_t code = (uint8_t)c;
+
+    if (code < FONT_FIRST || code > FONT_LAST)
+        code = FONT_MISSING;
+    return font_8x8[code - FONT_FIRST];
+}
+
+#endif // FONT_H
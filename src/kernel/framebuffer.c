@@ -1,5 +1,12 @@
 #include "framebuffer.h"
 #include "mailbox.h"
+#include "cache.h"
+#include "video.h"
+#include "draw.h"
+#include "spinlock.h"
+#include "cpu.h"
+#include "k_libc/k_stdio.h"
+#include "k_libc/k_string.h"
 
 void initializeFrameBuffer (fb_info_t * fbInfo, uint32_t width, uint32_t height, uint32_t depth)
 {
@@ -15,8 +22,9 @@ void initializeFrameBuffer (fb_info_t * fbInfo, uint32_t width, uint32_t height,
   fbInfo->fb = 0;
   
   /* write the fbInfo to mailbox 0, FRAMEBUFFER channel and await a response */
-  mailbox_write((uint32_t)fbInfo, MB_CHANNEL_FB);
-  mailbox_read(MB_CHANNEL_FB);
+  dcache_clean_invalidate_range(fbInfo, sizeof(*fbInfo));
+  mailbox_call((uint32_t)fbInfo, MB_CHANNEL_FB);
+  dcache_invalidate_range(fbInfo, sizeof(*fbInfo));
 }
 
 void drawSquareLoop (fb_info_t * fbInfo)
@@ -32,8 +40,448 @@ void drawSquareLoop (fb_info_t * fbInfo)
 
 void fbPutPixel (fb_info_t * fbInfo, uint32_t x, uint32_t y, uint32_t color)
 {
-  /* get the byte offset of the pixel and write in the color */
-  uint32_t offset = (y * fbInfo->pitch) + (x << 2);
-  uint32_t * pixel = (uint32_t *) (fbInfo->fb + offset);
-  *pixel = color;
-}
\ No newline at end of file
+  /* get the byte offset of the pixel and write in the color, a raw value of the frame depth */
+  uint32_t offset = (y * fbInfo->pitch) + x * (fbInfo->depth >> 3);
+  uint8_t * pixel = (uint8_t *) (uintptr_t) (fbInfo->fb + offset);
+
+  if (fbInfo->depth == 32)
+    *(uint32_t *) pixel = color;
+  else if (fbInfo->depth == 16)
+    *(uint16_t *) pixel = color;
+  else
+    *pixel = color;
+}
+
+typedef struct {
+  mailbox_tag_t tag;
+  uint32_t x;
+  uint32_t y;
+} fb_offset_tag_t;
+
+/* what the virtual offset points at until the next fb_present */
+#define FB_SHOWN_FRAME   0
+#define FB_SHOWN_CONSOLE 1
+#define FB_SHOWN_SPLASH  2
+
+static fb_info_t fb_alloc;            // every frame, as allocated
+static fb_info_t fb_frame;            // the back buffer, the draw target
+static uint32_t fb_buffers;
+static uint32_t fb_console_frames;    // after the buffers, FB_CONSOLE_FRAMES or 0
+static volatile uint32_t fb_shown;    // FB_SHOWN_*, besides the presented frames
+static bool fb_splash_stale;          // the splash drew over the front buffer
+static uint32_t fb_front;
+static int32_t fb_retiring = -1;      // previous front, until a vsync went by
+static uint32_t fb_flip_cycles;       // when the last flip was requested
+static uint32_t fb_present_cycles;
+static fb_frame_stats_t fb_stats;
+static dirty_map_t fb_history[FB_BUFFERS_MAX - 1];  // tiles drawn by the last frames, newest first
+static uint32_t fb_palette[FB_PALETTE_SIZE];        // 8 bpp, 0xAABBGGRR
+static uint32_t fb_palette_first = FB_PALETTE_SIZE; // entries changed since the last upload
+static uint32_t fb_palette_end;
+/* Lock order : fb_present_lock, then fb_lock, then draw_lock (taken by
+   draw_end_frame, draw_begin_frame and draw_set_target under fb_lock) and
+   the mailbox locks (fb_set_offset under fb_lock). */
+static spinlock_t fb_lock = SPINLOCK_INIT("fb");
+static spinlock_t fb_present_lock = SPINLOCK_INIT("fb present");  /* one fb_present at a time, held across its vsync waits */
+
+static void fb_set_offset (uint32_t y)
+{
+  fb_offset_tag_t cmd = { { MAILBOX_TAG_SET_VIRTUAL_OFFSET, 8, 8 }, 0, y };
+  mailbox_process(&cmd.tag, sizeof(cmd));
+}
+
+/* blocks until the next vertical sync, false if the firmware cannot. The
+   firmware answers at the sync, the wait sleeps with IRQs enabled : call
+   it without fb_lock. */
+static bool fb_wait_vsync (void)
+{
+  mailbox_batch_t batch;
+
+  mailbox_batch_init(&batch);
+  uint32_t *value = mailbox_batch_add(&batch, MAILBOX_TAG_SET_VSYNC, 1);
+  return mailbox_batch_process(&batch) && mailbox_batch_answered(value);
+}
+
+static uint8_t * fb_pixels (uint32_t index)
+{
+  return (uint8_t *)(uintptr_t)(fb_alloc.fb & ~MAIL_L2_BYPASS_MASK) + index * fb_alloc.height * fb_alloc.pitch;
+}
+
+/* point fb_frame and the draw target at frame <index>. It missed what the
+   frames drawn since it was last shown changed, the front buffer has it. */
+static void fb_set_back (uint32_t index)
+{
+  dirty_map_t stale;
+
+  fb_frame = fb_alloc;
+  fb_frame.vHeight = fb_alloc.height;
+  fb_frame.yOffset = index * fb_alloc.height;
+  fb_frame.fb = fb_alloc.fb + fb_frame.yOffset * fb_alloc.pitch;
+  fb_frame.fbSize = fb_alloc.height * fb_alloc.pitch;
+  draw_set_target(&fb_frame);
+
+  if (fb_buffers > 1) {
+    stale = fb_history[0];
+    for (uint32_t i = 1; i < fb_buffers - 1; i++)
+      dirty_merge(&stale, &fb_history[i]);
+    draw_begin_frame(fb_pixels(fb_front), &stale);
+  }
+}
+
+/* entries <first> to <end> - 1 changed, for the next fb_present */
+static void fb_palette_touch (uint32_t first, uint32_t end)
+{
+  if (first < fb_palette_first)
+    fb_palette_first = first;
+  if (end > fb_palette_end)
+    fb_palette_end = end;
+}
+
+static void fb_palette_upload (void)
+{
+  if (fb_palette_first < fb_palette_end)
+    video_set_palette(fb_palette_first, fb_palette_end - fb_palette_first,
+                      &fb_palette[fb_palette_first]);
+  fb_palette_first = FB_PALETTE_SIZE;
+  fb_palette_end = 0;
+}
+
+static void fb_palette_reverse (uint32_t first, uint32_t end)
+{
+  for (; first + 1 < end; first++, end--) {
+    uint32_t color = fb_palette[first];
+    fb_palette[first] = fb_palette[end - 1];
+    fb_palette[end - 1] = color;
+  }
+}
+
+static bool fb_palette_range (uint32_t first, uint32_t count)
+{
+  return fb_buffers && fb_alloc.depth == 8 && count
+    && first < FB_PALETTE_SIZE && count <= FB_PALETTE_SIZE - first;
+}
+
+/* <rgba> at <level>/255 of its brightness */
+static uint32_t fb_palette_level (uint32_t rgba, uint32_t level)
+{
+  uint32_t color = rgba & 0xFF000000;
+
+  for (uint32_t shift = 0; shift < 24; shift += 8)
+    color |= (((rgba >> shift) & 0xFF) * level / 255) << shift;
+  return color;
+}
+
+static uint32_t fb_next_back (void)
+{
+  for (uint32_t i = 0; i < fb_buffers; i++) {
+    if (i != fb_front && (int32_t)i != fb_retiring)
+      return i;
+  }
+  return fb_front;
+}
+
+bool fb_init (uint32_t width, uint32_t height, uint32_t depth, uint32_t buffers)
+{
+  if (buffers > FB_BUFFERS_MAX)
+    buffers = FB_BUFFERS_MAX;
+
+  /* fall back to fewer frames when the GPU is short of memory, the
+     console frames are given up first */
+  fb_console_frames = 0;
+  for (; buffers; buffers--) {
+    if (video_set_resolution(&fb_alloc, width, height, depth, buffers + FB_CONSOLE_FRAMES)) {
+      fb_console_frames = FB_CONSOLE_FRAMES;
+      break;
+    }
+    if (video_set_resolution(&fb_alloc, width, height, depth, buffers))
+      break;
+  }
+  if (!buffers)
+    return false;
+
+  fb_buffers = buffers;
+  fb_front = 0;
+  fb_retiring = -1;
+
+  /* all frames start out alike, only what is drawn differs from then on */
+  k_memset(fb_pixels(0), 0, (buffers + fb_console_frames) * height * fb_alloc.pitch);
+  for (uint32_t i = 0; i < FB_BUFFERS_MAX - 1; i++)
+    dirty_init(&fb_history[i], width, height);
+
+  /* 8 bpp : pixel values are levels of Pip-Boy green, see raster_color */
+  if (fb_alloc.depth == 8) {
+    for (uint32_t i = 0; i < FB_PALETTE_SIZE; i++)
+      fb_palette[i] = fb_palette_level(DRAW_DEFAULT_COLOR, i);
+    fb_palette_touch(0, FB_PALETTE_SIZE);
+    fb_palette_upload();
+  }
+
+  /* measure the refresh period, the first wait only syncs up. A firmware
+     answering at once (emulators) has no usable vsync. */
+  fb_stats.buffers = buffers;
+  fb_stats.min_cycles = 0xFFFFFFFF;
+  if (fb_wait_vsync()) {
+    uint32_t start = cpu_cycles();
+    fb_wait_vsync();
+    uint32_t period = cpu_cycles() - start;
+    if (period >= mailbox_get_id(MAILBOX_TAG_GET_CLOCK_RATE, MAIL_CLOCK_ARM) / 1000)
+      fb_stats.vsync_cycles = period;
+  }
+
+  fb_set_back(fb_next_back());
+  if (!draw_get_target()) {
+    fb_buffers = 0;
+    return false;
+  }
+  return true;
+}
+
+fb_info_t * fb_begin_frame (void)
+{
+  return fb_buffers ? &fb_frame : NULL;
+}
+
+void fb_present (void)
+{
+  spin_lock(&fb_present_lock);
+  if (!fb_buffers) {
+    spin_unlock(&fb_present_lock);
+    return;
+  }
+
+  uint32_t start = cpu_cycles();
+  uint32_t period = fb_stats.vsync_cycles;
+  uint32_t back = fb_frame.yOffset / fb_alloc.height;
+  uint32_t drawn_bytes = 0, copied_bytes = 0;
+  dirty_map_t drawn;
+
+  /* triple : the frame before must be on screen before its predecessor is reused */
+  if (fb_buffers > 2 && fb_retiring >= 0 && period && start - fb_flip_cycles < period)
+    fb_wait_vsync();
+
+  spin_lock(&fb_lock);
+
+  /* complete the back buffer with the stale tiles nothing was drawn on */
+  if (draw_end_frame(&drawn, &drawn_bytes, &copied_bytes)) {
+    for (uint32_t i = FB_BUFFERS_MAX - 2; i > 0; i--)
+      fb_history[i] = fb_history[i - 1];
+    fb_history[0] = drawn;
+  }
+
+  /* the frames drawn so far say nothing of what the splash left */
+  if (fb_splash_stale) {
+    for (uint32_t i = 0; i < FB_BUFFERS_MAX - 1; i++)
+      dirty_fill(&fb_history[i]);
+    fb_splash_stale = false;
+  }
+
+  if (fb_buffers > 1) {
+    fb_set_offset(fb_frame.yOffset);
+    fb_palette_upload();
+    fb_flip_cycles = cpu_cycles();
+    fb_retiring = fb_buffers > 2 ? (int32_t)fb_front : -1;
+    fb_front = back;
+  } else {
+    if (fb_shown != FB_SHOWN_FRAME)
+      fb_set_offset(fb_frame.yOffset);
+    fb_palette_upload();
+  }
+  fb_shown = FB_SHOWN_FRAME;
+  spin_unlock(&fb_lock);
+
+  /* double : the next back buffer is the frame just flipped away from,
+     still on screen until the sync */
+  if (fb_buffers == 2 && period)
+    fb_wait_vsync();
+
+  spin_lock(&fb_lock);
+  if (fb_buffers > 1)
+    fb_set_back(fb_next_back());
+
+  /* frame times start with the second frame */
+  uint32_t now = cpu_cycles();
+  uint32_t frame = now - fb_present_cycles;
+  fb_present_cycles = now;
+  fb_stats.present_cycles += now - start;
+  fb_stats.drawn_bytes = drawn_bytes;
+  fb_stats.copied_bytes = copied_bytes;
+  fb_stats.total_drawn_bytes += drawn_bytes;
+  fb_stats.total_copied_bytes += copied_bytes;
+
+  if (fb_stats.frames++) {
+    fb_stats.last_cycles = frame;
+    fb_stats.total_cycles += frame;
+    if (frame < fb_stats.min_cycles)
+      fb_stats.min_cycles = frame;
+    if (frame > fb_stats.max_cycles)
+      fb_stats.max_cycles = frame;
+    if (period && frame > period + period / 2)
+      fb_stats.missed++;
+  }
+  spin_unlock(&fb_lock);
+  spin_unlock(&fb_present_lock);
+}
+
+bool fb_get_console (fb_info_t * console)
+{
+  if (!fb_buffers || !fb_console_frames)
+    return false;
+
+  *console = fb_alloc;
+  console->vHeight = fb_console_frames * fb_alloc.height;
+  console->yOffset = fb_buffers * fb_alloc.height;
+  console->fb = fb_alloc.fb + console->yOffset * fb_alloc.pitch;
+  console->fbSize = console->vHeight * fb_alloc.pitch;
+  return true;
+}
+
+void fb_show_console (uint32_t y)
+{
+  spin_lock(&fb_lock);
+  fb_show_console_locked(y);
+  spin_unlock(&fb_lock);
+}
+
+void fb_show_console_locked (uint32_t y)
+{
+  if (fb_console_frames) {
+    fb_shown = FB_SHOWN_CONSOLE;
+    fb_set_offset(fb_buffers * fb_alloc.height + y);
+  }
+}
+
+bool fb_panic_console (uint32_t y)
+{
+  /* the fatal exception may have interrupted the holder of fb_lock or of
+     the property buffer : the screen stays as it is rather than wait */
+  if (!spin_trylock(&fb_lock))
+    return false;
+  fb_offset_tag_t cmd = { { MAILBOX_TAG_SET_VIRTUAL_OFFSET, 8, 8 }, 0, fb_buffers * fb_alloc.height + y };
+  bool shown = fb_console_frames && mailbox_try_process(&cmd.tag, sizeof(cmd));
+  if (shown)
+    fb_shown = FB_SHOWN_CONSOLE;
+  spin_unlock(&fb_lock);
+  return shown;
+}
+
+void fb_scroll_console (uint32_t y)
+{
+  /* busy : a fb_present is taking the screen */
+  if (!spin_trylock(&fb_lock))
+    return;
+  if (fb_shown == FB_SHOWN_CONSOLE)
+    fb_set_offset(fb_buffers * fb_alloc.height + y);
+  spin_unlock(&fb_lock);
+}
+
+bool fb_get_splash (fb_info_t * splash)
+{
+  spin_lock(&fb_lock);
+  bool spare = fb_buffers > 1 && !fb_stats.frames;
+  if (spare) {
+    *splash = fb_alloc;
+    splash->vHeight = fb_alloc.height;
+    splash->yOffset = fb_front * fb_alloc.height;
+    splash->fb = fb_alloc.fb + splash->yOffset * fb_alloc.pitch;
+    splash->fbSize = fb_alloc.height * fb_alloc.pitch;
+  }
+  spin_unlock(&fb_lock);
+  return spare;
+}
+
+void fb_show_splash (void)
+{
+  spin_lock(&fb_lock);
+  if (fb_buffers > 1 && !fb_stats.frames) {
+    fb_shown = FB_SHOWN_SPLASH;
+    fb_splash_stale = true;
+    fb_set_offset(fb_front * fb_alloc.height);
+  }
+  spin_unlock(&fb_lock);
+}
+
+bool fb_splash_shown (void)
+{
+  return fb_shown == FB_SHOWN_SPLASH;
+}
+
+bool fb_splash_begin (void)
+{
+  /* busy : a fb_present is taking the screen */
+  if (!spin_trylock(&fb_lock))
+    return false;
+  if (fb_shown == FB_SHOWN_SPLASH)
+    return true;
+  spin_unlock(&fb_lock);
+  return false;
+}
+
+void fb_splash_end (void)
+{
+  spin_unlock(&fb_lock);
+}
+
+bool fb_set_palette (uint32_t first, uint32_t count, const uint32_t * colors)
+{
+  spin_lock(&fb_lock);
+  bool ok = fb_palette_range(first, count);
+  if (ok) {
+    for (uint32_t i = 0; i < count; i++)
+      fb_palette[first + i] = colors[i];
+    fb_palette_touch(first, first + count);
+  }
+  spin_unlock(&fb_lock);
+  return ok;
+}
+
+bool fb_cycle_palette (uint32_t first, uint32_t count, int32_t step)
+{
+  spin_lock(&fb_lock);
+  bool ok = fb_palette_range(first, count);
+  if (ok) {
+    /* rotate in place with three reversals */
+    uint32_t shift = (uint32_t)(step % (int32_t)count + (int32_t)count) % count;
+    if (shift) {
+      fb_palette_reverse(first, first + count);
+      fb_palette_reverse(first, first + shift);
+      fb_palette_reverse(first + shift, first + count);
+      fb_palette_touch(first, first + count);
+    }
+  }
+  spin_unlock(&fb_lock);
+  return ok;
+}
+
+void fb_get_frame_stats (fb_frame_stats_t * stats)
+{
+  spin_lock(&fb_lock);
+  *stats = fb_stats;
+  spin_unlock(&fb_lock);
+}
+
+void fb_dump_frame_stats (uint32_t cpu_hz)
+{
+  fb_frame_stats_t stats;
+  uint32_t mhz = cpu_hz / 1000000;
+
+  fb_get_frame_stats(&stats);
+  if (!mhz)
+    mhz = 1;
+
+  k_printf("  %d buffers, vsync %s", stats.buffers, stats.vsync_cycles ? "on" : "off");
+  if (stats.vsync_cycles)
+    k_printf(" (%u us)", stats.vsync_cycles / mhz);
+  k_printf("\r\n");
+  if (!stats.frames)
+    return;
+
+  k_printf("  frames %u, missed %u, %u us per present\r\n", stats.frames, stats.missed,
+           (uint32_t)(stats.present_cycles / stats.frames) / mhz);
+  k_printf("  bytes touched : last %u (%u drawn, %u copied), avg %u\r\n",
+           stats.drawn_bytes + stats.copied_bytes, stats.drawn_bytes, stats.copied_bytes,
+           (uint32_t)((stats.total_drawn_bytes + stats.total_copied_bytes) / stats.frames));
+  if (stats.frames > 1)
+    k_printf("  frame time us : last %u  min %u  avg %u  max %u\r\n",
+             stats.last_cycles / mhz, stats.min_cycles / mhz,
+             (uint32_t)(stats.total_cycles / (stats.frames - 1)) / mhz, stats.max_cycles / mhz);
+}
@@ -1,7 +1,60 @@
 #ifndef __FRAMEBUFFER_H__
 #define __FRAMEBUFFER_H__
 
+/*
+ * Framebuffer and presentation
+ *
+ * fb_init allocates FB_BUFFERS frames stacked in one virtual framebuffer.
+ * The draw target is always a hidden back buffer: fb_present shows it by
+ * moving the virtual offset onto it (no copy) and moves the target to the
+ * next back buffer.
+ *
+ * Frames are retained: a back buffer is brought up to date with the
+ * front buffer by copying only the tiles the frames since it was last
+ * shown drew (dirty.h), lazily, before anything is drawn over them.
+ *
+ * Double buffering waits for the vsync after each flip, so the old front
+ * buffer is off screen before it is drawn again. Triple buffering returns
+ * right after the flip and only waits if the frame before has not reached
+ * the screen yet. The waits sleep with IRQs enabled, the console and the
+ * palette can be used meanwhile. Without firmware vsync support frames
+ * are flipped immediately and may tear. With a single frame, when the GPU has no
+ * memory for more, drawing goes straight to the screen.
+ *
+ * At 8 bpp the pixels index a palette of FB_PALETTE_SIZE colors, loaded
+ * with a ramp from black to Pip-Boy green. Palette changes are uploaded
+ * by the next fb_present along with the flip, rotating a range of it
+ * every frame (fb_cycle_palette) animates without redrawing.
+ *
+ * FB_CONSOLE_FRAMES more frames after the buffers hold the text console
+ * (fbcon.h), when the GPU has the memory. The console is shown from
+ * fb_show_console until the next fb_present.
+ *
+ * Before the first fb_present the front buffer is free, a boot splash can
+ * be drawn in it and shown (fb_show_splash) while the next frame is drawn
+ * in the back buffer. The first fb_present then refreshes every buffer
+ * whole from the presented one.
+ *
+ */
+
 #include <stdint.h>
+#include <stdbool.h>
+
+// Mode set at boot
+#define FB_WIDTH    640
+#define FB_HEIGHT   480
+
+#ifndef FB_DEPTH
+#define FB_DEPTH    32  // 8 (palette), 16 (RGB565) or 32
+#endif
+
+#ifndef FB_BUFFERS
+#define FB_BUFFERS  2   // 3 for triple buffering
+#endif
+#define FB_BUFFERS_MAX 3
+
+#define FB_PALETTE_SIZE 256
+#define FB_CONSOLE_FRAMES 2
 
 typedef struct {
     uint32_t width;   // frame width in pixels
@@ -16,8 +69,79 @@ typedef struct {
     uint32_t fbSize;  // size of the framebuffer, ^, in bytes
 } fb_info_t __attribute__((aligned(16)));
 
+typedef struct {
+    uint32_t frames;        // presented
+    uint32_t missed;        // took longer than one refresh
+    uint32_t last_cycles;   // present to present, from the second frame
+    uint32_t min_cycles;
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+    uint64_t present_cycles;  // in fb_present, copies, flips and vsync waits
+    uint32_t drawn_bytes;   // last frame, in the rects of the primitives
+    uint32_t copied_bytes;  // last frame, stale tiles from the front buffer
+    uint64_t total_drawn_bytes;
+    uint64_t total_copied_bytes;
+    uint32_t vsync_cycles;  // refresh period, 0 without vsync support
+    uint32_t buffers;
+} fb_frame_stats_t;
+
 void initializeFrameBuffer (fb_info_t * fbInfo, uint32_t width, uint32_t height, uint32_t depth);
 void drawSquareLoop (fb_info_t * fbInfo);
 void fbPutPixel (fb_info_t * fbInfo, uint32_t x, uint32_t y, uint32_t color);
 
-#endif // __FRAMEBUFFER_H__
\ No newline at end of file
+// Allocate up to <buffers> frames, fewer if the GPU is short of memory,
+// and make the first back buffer the draw target. False if not even a
+// single frame could be allocated.
+bool fb_init(uint32_t width, uint32_t height, uint32_t depth, uint32_t buffers);
+
+// The back buffer the next frame is drawn into, NULL before fb_init
+fb_info_t *fb_begin_frame(void);
+
+// Show the back buffer and retarget drawing at the next one
+void fb_present(void);
+
+// The console frames, stacked in <console> (vHeight rows from yOffset of
+// the virtual framebuffer). False without them.
+bool fb_get_console(fb_info_t *console);
+
+// Show the console from its row <y>
+void fb_show_console(uint32_t y);
+
+// Same with fb_lock held, between fb_splash_begin and fb_splash_end: the
+// splash hands the screen over to the console
+void fb_show_console_locked(uint32_t y);
+
+// Same for a fatal exception, without waiting for a lock: false and the
+// screen left as it is if fb_lock or the mailbox property buffer is busy
+bool fb_panic_console(uint32_t y);
+
+// Same, only if the console is on screen and no fb_present is under way
+void fb_scroll_console(uint32_t y);
+
+// The front buffer, for a boot splash. False with a single frame or once
+// a frame was presented.
+bool fb_get_splash(fb_info_t *splash);
+
+// Show it, until the next fb_present or fb_show_console
+void fb_show_splash(void);
+
+// Still on screen, no lock taken
+bool fb_splash_shown(void);
+
+// Draw on the splash: false if it is off screen or a fb_present is under
+// way, otherwise it stays on screen until fb_splash_end. Only tries the
+// lock, interrupt handlers can call it.
+bool fb_splash_begin(void);
+void fb_splash_end(void);
+
+// 8 bpp only, false otherwise or if the range is out of the palette.
+// Entries <first> to <first> + <count> - 1 become <colors>, 0xAABBGGRR.
+bool fb_set_palette(uint32_t first, uint32_t count, const uint32_t *colors);
+
+// Rotate those entries by <step>, towards the higher ones when positive
+bool fb_cycle_palette(uint32_t first, uint32_t count, int32_t step);
+
+void fb_get_frame_stats(fb_frame_stats_t *stats);
+void fb_dump_frame_stats(uint32_t cpu_hz);
+
+#endif // __FRAMEBUFFER_H__
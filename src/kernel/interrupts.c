@@ -0,0 +1,364 @@
+#include "interrupts.h"
+#include "cpu.h"
+#include "cache.h"
+#include "spinlock.h"
+#include "uart.h"
+#include "k_libc/k_stdio.h"
+#include "fbcon.h"
+
+// ARMCTRL basic pending : bits 0-7 are the ARM sources, the others say
+// something is pending in register 1 or 2
+#define ARMCTRL_BASIC_ARM_MASK  0xFF
+#define ARMCTRL_BASIC_GPU_MASK  0x1FFF00
+
+#define FIQ_CONTROL_ENABLE      (1 << 7)
+#define FIQ_STACK_SIZE          1024
+
+#if BCM2836 || BCM2837
+#define LOCAL_SOURCE_GPU        8
+#define LOCAL_SOURCE_MASK       0xFFF
+#endif
+
+#define IRQ_NONE                0xFFFFFFFF
+
+typedef struct {
+    irq_handler_t handler;
+    void *arg;
+} irq_vector_t;
+
+extern char exception_vectors[];
+
+static irq_vector_t irq_vectors[IRQ_COUNT];
+static irq_stats_t irq_stats[CORES][IRQ_COUNT];
+static volatile uint32_t fiq_irq = IRQ_NONE;
+static spinlock_t irq_lock = SPINLOCK_INIT("irq");
+
+// Enabled GPU sources, the pending registers also show masked ones
+static volatile uint32_t armctrl_enabled[2];
+
+#if __aarch32__
+static uint8_t fiq_stacks[CORES][FIQ_STACK_SIZE] __attribute__((aligned(16)));
+#endif
+
+static const char *exception_names[] = {
+    "Undefined instruction",
+    "Supervisor call",
+    "Prefetch abort",
+    "Data abort",
+    "Synchronous exception",
+    "SError",
+    "Unexpected exception",
+};
+
+static inline uint32_t highest_bit(uint32_t mask)
+{
+    return 31 - __builtin_clz(mask);
+}
+
+void interrupts_init(void)
+{
+    mmio_write(ARMCTRL_FIQ_CONTROL, 0);
+    mmio_write(ARMCTRL_DISABLE_IRQS_1, 0xFFFFFFFF);
+    mmio_write(ARMCTRL_DISABLE_IRQS_2, 0xFFFFFFFF);
+    mmio_write(ARMCTRL_DISABLE_BASIC_IRQS, 0xFFFFFFFF);
+    armctrl_enabled[0] = 0;
+    armctrl_enabled[1] = 0;
+
+#if BCM2836 || BCM2837
+    // GPU IRQ and FIQ both to core 0
+    mmio_write(LOCAL_GPU_ROUTING, 0);
+#endif
+
+    interrupts_init_cpu();
+}
+
+void interrupts_init_cpu(void)
+{
+#if __aarch64__
+    __asm__ volatile("msr vbar_el1, %0\n isb" :: "r"(exception_vectors) : "memory");
+#else
+    __asm__ volatile("mcr p15, 0, %0, c12, c0, 0" :: "r"(exception_vectors) : "memory");
+    isb();
+
+    // The FIQ mode has its own banked stack pointer
+    uint8_t *fiq_stack = fiq_stacks[core_id()] + FIQ_STACK_SIZE;
+    __asm__ volatile("cps #0x11\n"
+                     "mov sp, %0\n"
+                     "cps #0x13\n" :: "r"(fiq_stack) : "memory");
+#endif
+
+#if BCM2836 || BCM2837
+    uint32_t core = core_id();
+    mmio_write(LOCAL_TIMER_CONTROL0 + 4 * core, 0);
+    mmio_write(LOCAL_MAILBOX_CONTROL0 + 4 * core, 0);
+#endif
+}
+
+bool irq_register(uint32_t irq, irq_handler_t handler, void *arg)
+{
+    if (irq >= IRQ_COUNT)
+        return false;
+
+    irq_flags_t flags = spin_lock_irqsave(&irq_lock);
+    irq_vectors[irq].handler = NULL;
+    dmb();
+    irq_vectors[irq].arg = arg;
+    dmb();
+    irq_vectors[irq].handler = handler;
+    spin_unlock_irqrestore(&irq_lock, flags);
+    return true;
+}
+
+#if BCM2836 || BCM2837
+// Local sources : bit n routes to the IRQ, bit n + 4 to the FIQ
+static void local_route(uint32_t irq, bool enable, bool fiq)
+{
+    uint32_t core = core_id();
+    uint32_t source = irq - IRQ_LOCAL_BASE;
+    uint32_t reg;
+
+    if (source < 4) {
+        reg = LOCAL_TIMER_CONTROL0 + 4 * core;
+    } else if (source < 8) {
+        reg = LOCAL_MAILBOX_CONTROL0 + 4 * core;
+        source -= 4;
+    } else {
+        if (irq == IRQ_LOCAL_PMU)
+            mmio_write(enable ? LOCAL_PMU_ROUTING_SET : LOCAL_PMU_ROUTING_CLR,
+                       1 << (core + (fiq ? 4 : 0)));
+        return;
+    }
+
+    irq_flags_t flags = irq_save();
+    uint32_t control = mmio_read(reg) & ~((1 << source) | (1 << (source + 4)));
+    if (enable)
+        control |= 1 << (source + (fiq ? 4 : 0));
+    mmio_write(reg, control);
+    irq_restore(flags);
+}
+#endif
+
+void irq_enable(uint32_t irq)
+{
+    if (irq >= IRQ_COUNT)
+        return;
+
+#if BCM2836 || BCM2837
+    if (irq >= IRQ_LOCAL_BASE) {
+        local_route(irq, true, false);
+        return;
+    }
+#endif
+
+    if (irq >= IRQ_ARM_BASE) {
+        mmio_write(ARMCTRL_ENABLE_BASIC_IRQS, 1 << (irq - IRQ_ARM_BASE));
+    } else {
+        irq_flags_t flags = spin_lock_irqsave(&irq_lock);
+        armctrl_enabled[irq / 32] |= 1 << (irq % 32);
+        spin_unlock_irqrestore(&irq_lock, flags);
+        mmio_write(irq < 32 ? ARMCTRL_ENABLE_IRQS_1 : ARMCTRL_ENABLE_IRQS_2, 1 << (irq % 32));
+    }
+}
+
+void irq_disable(uint32_t irq)
+{
+    if (irq >= IRQ_COUNT)
+        return;
+
+#if BCM2836 || BCM2837
+    if (irq >= IRQ_LOCAL_BASE) {
+        local_route(irq, false, false);
+        return;
+    }
+#endif
+
+    if (irq >= IRQ_ARM_BASE) {
+        mmio_write(ARMCTRL_DISABLE_BASIC_IRQS, 1 << (irq - IRQ_ARM_BASE));
+    } else {
+        mmio_write(irq < 32 ? ARMCTRL_DISABLE_IRQS_1 : ARMCTRL_DISABLE_IRQS_2, 1 << (irq % 32));
+        irq_flags_t flags = spin_lock_irqsave(&irq_lock);
+        armctrl_enabled[irq / 32] &= ~(1 << (irq % 32));
+        spin_unlock_irqrestore(&irq_lock, flags);
+    }
+}
+
+bool fiq_register(uint32_t irq, irq_handler_t handler, void *arg)
+{
+    if (irq >= IRQ_COUNT || !irq_register(irq, handler, arg))
+        return false;
+
+    // A source must not be enabled as IRQ and FIQ at the same time
+    irq_disable(irq);
+    fiq_irq = irq;
+    dmb();
+
+#if BCM2836 || BCM2837
+    if (irq >= IRQ_LOCAL_BASE) {
+        mmio_write(ARMCTRL_FIQ_CONTROL, 0);
+        local_route(irq, true, true);
+        return true;
+    }
+#endif
+
+    mmio_write(ARMCTRL_FIQ_CONTROL, FIQ_CONTROL_ENABLE | irq);
+    return true;
+}
+
+static void irq_handle(uint32_t irq, irq_stats_t *stats, uint32_t entry)
+{
+    irq_vector_t *vector = &irq_vectors[irq];
+    irq_handler_t handler = vector->handler;
+    uint32_t start = cpu_cycles();
+
+    if (handler) {
+        handler(vector->arg);
+    } else {
+        // Nobody to acknowledge it, it would fire again right away
+        irq_disable(irq);
+    }
+
+    uint32_t end = cpu_cycles();
+    stats += irq;
+    stats->count++;
+    stats->total_cycles += end - start;
+    if (end - start > stats->max_cycles)
+        stats->max_cycles = end - start;
+    if (start - entry > stats->max_latency)
+        stats->max_latency = start - entry;
+}
+
+static void armctrl_dispatch(irq_stats_t *stats, uint32_t entry)
+{
+    uint32_t basic = mmio_read(ARMCTRL_IRQ_BASIC_PENDING);
+    uint32_t pending;
+
+    for (pending = basic & ARMCTRL_BASIC_ARM_MASK; pending; ) {
+        uint32_t bit = highest_bit(pending);
+        pending &= ~(1 << bit);
+        irq_handle(IRQ_ARM_BASE + bit, stats, entry);
+    }
+
+    if (!(basic & ARMCTRL_BASIC_GPU_MASK))
+        return;
+
+    for (pending = mmio_read(ARMCTRL_IRQ_PENDING_2) & armctrl_enabled[1]; pending; ) {
+        uint32_t bit = highest_bit(pending);
+        pending &= ~(1 << bit);
+        irq_handle(32 + bit, stats, entry);
+    }
+
+    for (pending = mmio_read(ARMCTRL_IRQ_PENDING_1) & armctrl_enabled[0]; pending; ) {
+        uint32_t bit = highest_bit(pending);
+        pending &= ~(1 << bit);
+        irq_handle(bit, stats, entry);
+    }
+}
+
+void irq_dispatch(void)
+{
+    uint32_t entry = cpu_cycles();
+    uint32_t core = core_id();
+    irq_stats_t *stats = irq_stats[core];
+
+#if BCM2836 || BCM2837
+    uint32_t source = mmio_read(LOCAL_IRQ_SOURCE0 + 4 * core) & LOCAL_SOURCE_MASK;
+
+    while (source) {
+        uint32_t bit = highest_bit(source);
+        source &= ~(1 << bit);
+
+        if (bit == LOCAL_SOURCE_GPU)
+            armctrl_dispatch(stats, entry);
+        else
+            irq_handle(IRQ_LOCAL_BASE + bit, stats, entry);
+    }
+#else
+    armctrl_dispatch(stats, entry);
+#endif
+}
+
+void fiq_dispatch(void)
+{
+    uint32_t entry = cpu_cycles();
+    uint32_t irq = fiq_irq;
+
+    if (irq != IRQ_NONE)
+        irq_handle(irq, irq_stats[core_id()], entry);
+}
+
+void irq_get_stats(uint32_t irq, irq_stats_t *stats)
+{
+    *stats = (irq_stats_t){ 0 };
+    if (irq >= IRQ_COUNT)
+        return;
+
+    for (uint32_t core = 0; core < CORES; core++) {
+        irq_stats_t *s = &irq_stats[core][irq];
+        stats->count += s->count;
+        stats->total_cycles += s->total_cycles;
+        if (s->max_cycles > stats->max_cycles)
+            stats->max_cycles = s->max_cycles;
+        if (s->max_latency > stats->max_latency)
+            stats->max_latency = s->max_latency;
+    }
+}
+
+void irq_dump_stats(void)
+{
+    k_printf("  irq     count  avg cycles  max cycles  max latency\r\n");
+    for (uint32_t irq = 0; irq < IRQ_COUNT; irq++) {
+        irq_stats_t stats;
+        irq_get_stats(irq, &stats);
+        if (!stats.count)
+            continue;
+
+        k_printf("  %3u  %8u  %10u  %10u  %11u\r\n", irq, stats.count,
+                 (uint32_t)(stats.total_cycles / stats.count),
+                 stats.max_cycles, stats.max_latency);
+    }
+}
+
+void exception_fatal(uint32_t type, uintptr_t *frame)
+{
+    const char *name = type < sizeof(exception_names) / sizeof(exception_names[0])
+                     ? exception_names[type] : "Exception";
+
+    // Queued output first, the interrupt that sends it will not come. The
+    // UART is polled from here on, without its lock
+    uart_drain();
+
+    // The report goes to the screen too, over whatever was shown
+    if (k_get_output() & K_OUTPUT_FB)
+        fbcon_panic();
+
+    k_printf_panic("\r\n*** %s on core %d ***\r\n", name, core_id());
+
+#if __aarch64__
+    uint64_t esr, far;
+    __asm__ volatile("mrs %0, esr_el1" : "=r"(esr));
+    __asm__ volatile("mrs %0, far_el1" : "=r"(far));
+
+    k_printf_panic("  ELR %X  SPSR %X  ESR %X  FAR %X\r\n",
+                   (uint32_t)frame[21], (uint32_t)frame[22], (uint32_t)esr, (uint32_t)far);
+    for (uint32_t i = 0; i < 19; i++)
+        k_printf_panic("  x%d%s %X%s", i, i < 10 ? " " : "", (uint32_t)frame[i], i % 4 == 3 ? "\r\n" : "");
+    k_printf_panic("\r\n  x29 %X  x30 %X\r\n", (uint32_t)frame[19], (uint32_t)frame[20]);
+#else
+    uint32_t fsr, far;
+    if (type == EXC_PREFETCH_ABORT) {
+        __asm__ volatile("mrc p15, 0, %0, c5, c0, 1" : "=r"(fsr));     // IFSR
+        __asm__ volatile("mrc p15, 0, %0, c6, c0, 2" : "=r"(far));     // IFAR
+    } else {
+        __asm__ volatile("mrc p15, 0, %0, c5, c0, 0" : "=r"(fsr));     // DFSR
+        __asm__ volatile("mrc p15, 0, %0, c6, c0, 0" : "=r"(far));     // DFAR
+    }
+
+    k_printf_panic("  PC %X  SPSR %X  FSR %X  FAR %X\r\n", frame[14], frame[15], fsr, far);
+    for (uint32_t i = 0; i < 13; i++)
+        k_printf_panic("  r%d%s %X%s", i, i < 10 ? " " : "", frame[i], i % 4 == 3 ? "\r\n" : "");
+    k_printf_panic("  lr  %X\r\n", frame[13]);
+#endif
+
+    for (;;)
+        cpu_wfe();
+}
@@ -1,4 +1,156 @@
 #ifndef __INTERRUPTS_H__
 #define __INTERRUPTS_H__
 
-#endif // __INTERRUPTS_H__
\ No newline at end of file
+/*
+ * Interrupts
+ *
+ * IRQ numbers follow the ARMCTRL layout : 0-63 are the GPU peripherals
+ * (pending registers 1 and 2), 64-71 the ARM basic sources. BCM2836/7 add
+ * the per-core sources of the local interrupt controller from 72, they are
+ * enabled on the core that calls irq_enable. GPU interrupts are routed to
+ * core 0.
+ *
+ * irq_dispatch finds the pending sources with clz, highest number first,
+ * and calls the registered handlers with IRQs masked. One source at a time
+ * can be routed to the FIQ instead, its handler preempts the IRQ handlers.
+ *
+ * Every core counts, per source, the interrupts handled, the handler run
+ * time and the longest wait between the exception entry and the handler
+ * call, all in CPU cycles.
+ *
+ * References :
+ * BCM2835 ARM Peripherals, chapter 7
+ * BCM2836 ARM-local peripherals (QA7), chapter 4
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// GPU peripherals
+#define IRQ_SYSTEM_TIMER_1      1
+#define IRQ_SYSTEM_TIMER_3      3
+#define IRQ_USB                 9
+#define IRQ_DMA(n)              (16 + (n))
+#define IRQ_AUX                 29
+#define IRQ_GPIO(bank)          (49 + (bank))
+#define IRQ_I2C                 53
+#define IRQ_SPI                 54
+#define IRQ_PCM                 55
+#define IRQ_UART                57
+
+// ARM basic sources
+#define IRQ_ARM_BASE            64
+#define IRQ_ARM_TIMER           64
+#define IRQ_ARM_MAILBOX         65
+#define IRQ_ARM_DOORBELL_0      66
+#define IRQ_ARM_DOORBELL_1      67
+
+#if BCM2836 || BCM2837
+// Local interrupt controller, per core
+#define IRQ_LOCAL_BASE          72
+#define IRQ_LOCAL_CNTPS         72
+#define IRQ_LOCAL_CNTPNS        73
+#define IRQ_LOCAL_CNTHP         74
+#define IRQ_LOCAL_CNTV          75
+#define IRQ_LOCAL_MAILBOX(n)    (76 + (n))
+#define IRQ_LOCAL_PMU           81
+#define IRQ_COUNT               84
+#else
+#define IRQ_COUNT               72
+#endif
+
+// Exception types reported by the vectors
+#define EXC_UNDEF               0
+#define EXC_SVC                 1
+#define EXC_PREFETCH_ABORT      2
+#define EXC_DATA_ABORT          3
+#define EXC_SYNC                4
+#define EXC_SERROR              5
+#define EXC_UNEXPECTED          6
+
+typedef void (*irq_handler_t)(void *arg);
+
+typedef struct {
+    uint32_t count;
+    uint32_t max_cycles;        // longest handler run
+    uint32_t max_latency;       // longest exception entry to handler call
+    uint64_t total_cycles;
+} irq_stats_t;
+
+// Saved IRQ mask state (CPSR on aarch32, DAIF on aarch64)
+typedef uintptr_t irq_flags_t;
+
+// Mask IRQs on the running core, returns the previous state
+static inline irq_flags_t irq_save(void)
+{
+    irq_flags_t flags;
+#if __aarch64__
+    __asm__ volatile("mrs %0, daif\n msr daifset, #2" : "=r"(flags) :: "memory");
+#else
+    __asm__ volatile("mrs %0, cpsr\n cpsid i" : "=r"(flags) :: "memory");
+#endif
+    return flags;
+}
+
+static inline void irq_restore(irq_flags_t flags)
+{
+#if __aarch64__
+    __asm__ volatile("msr daif, %0" :: "r"(flags) : "memory");
+#else
+    __asm__ volatile("msr cpsr_c, %0" :: "r"(flags) : "memory");
+#endif
+}
+
+// IRQs were masked when <flags> were saved, the I bit of CPSR and DAIF
+static inline bool irq_flags_masked(irq_flags_t flags)
+{
+    return (flags & 0x80) != 0;
+}
+
+// Unmask IRQs and FIQs on the running core
+static inline void interrupts_enable(void)
+{
+#if __aarch64__
+    __asm__ volatile("msr daifclr, #3" ::: "memory");
+#else
+    __asm__ volatile("cpsie if" ::: "memory");
+#endif
+}
+
+static inline void interrupts_disable(void)
+{
+#if __aarch64__
+    __asm__ volatile("msr daifset, #3" ::: "memory");
+#else
+    __asm__ volatile("cpsid if" ::: "memory");
+#endif
+}
+
+// Mask every source and install the vectors on core 0
+void interrupts_init(void);
+
+// Install the vectors on the running core, the secondaries call it once
+void interrupts_init_cpu(void);
+
+// Handler of an IRQ, false if the number is out of range
+bool irq_register(uint32_t irq, irq_handler_t handler, void *arg);
+void irq_enable(uint32_t irq);
+void irq_disable(uint32_t irq);
+
+// Route a source to the FIQ, replacing the previous one. Local sources
+// are routed on the running core only.
+bool fiq_register(uint32_t irq, irq_handler_t handler, void *arg);
+
+// Counters of a source, summed over the cores
+void irq_get_stats(uint32_t irq, irq_stats_t *stats);
+
+// Print the counters of every source that fired on the UART
+void irq_dump_stats(void);
+
+// Called by the vectors
+void irq_dispatch(void);
+void fiq_dispatch(void);
+void exception_fatal(uint32_t type, uintptr_t *frame);
+
+#endif // __INTERRUPTS_H__
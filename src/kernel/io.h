@@ -13,6 +13,57 @@ enum
     PERIPHERAL_BASE = 0x20000000, // 0x7E000000 in documentation ?
 #endif
 
+    // Size of the peripheral window (mapped as device memory by the MMU).
+    PERIPHERAL_SIZE = 0x01000000,
+
+#if BCM2836 || BCM2837
+    // ARM local peripherals (core timers, mailboxes, local interrupts).
+    LOCAL_PERIPHERAL_BASE = 0x40000000,
+    LOCAL_PERIPHERAL_SIZE = 0x00100000,
+
+    // Per-core mailbox 3, core N registers are at +0x10 * N.
+    // The firmware parks the secondary cores on it (BCM2836).
+    LOCAL_MAILBOX3_SET0 = (LOCAL_PERIPHERAL_BASE + 0x8C),
+    LOCAL_MAILBOX3_CLR0 = (LOCAL_PERIPHERAL_BASE + 0xCC),
+
+    // Local interrupt controller, per-core registers are at +4 * N.
+    LOCAL_GPU_ROUTING       = (LOCAL_PERIPHERAL_BASE + 0x0C),
+    LOCAL_PMU_ROUTING_SET   = (LOCAL_PERIPHERAL_BASE + 0x10),
+    LOCAL_PMU_ROUTING_CLR   = (LOCAL_PERIPHERAL_BASE + 0x14),
+    LOCAL_TIMER_CONTROL0    = (LOCAL_PERIPHERAL_BASE + 0x40),
+    LOCAL_MAILBOX_CONTROL0  = (LOCAL_PERIPHERAL_BASE + 0x50),
+    LOCAL_IRQ_SOURCE0       = (LOCAL_PERIPHERAL_BASE + 0x60),
+    LOCAL_FIQ_SOURCE0       = (LOCAL_PERIPHERAL_BASE + 0x70),
+#endif
+
+    // The system timer, a free running 1MHz counter and 4 compare
+    // channels. Channels 0 and 2 are used by the GPU.
+    SYSTEM_TIMER_BASE   = (PERIPHERAL_BASE + 0x3000),
+    SYSTEM_TIMER_CS     = (SYSTEM_TIMER_BASE + 0x00),
+    SYSTEM_TIMER_CLO    = (SYSTEM_TIMER_BASE + 0x04),
+    SYSTEM_TIMER_CHI    = (SYSTEM_TIMER_BASE + 0x08),
+    SYSTEM_TIMER_C1     = (SYSTEM_TIMER_BASE + 0x10),
+    SYSTEM_TIMER_C3     = (SYSTEM_TIMER_BASE + 0x18),
+
+    // The DMA controller, channel N registers are at +0x100 * N.
+    DMA_BASE            = (PERIPHERAL_BASE + 0x7000),
+    DMA_CS              = (DMA_BASE + 0x00),
+    DMA_CONBLK_AD       = (DMA_BASE + 0x04),
+    DMA_ENABLE          = (DMA_BASE + 0xFF0),
+
+    // The interrupt controller (ARMCTRL) registers.
+    ARMCTRL_BASE            = (PERIPHERAL_BASE + 0xB200),
+    ARMCTRL_IRQ_BASIC_PENDING = (ARMCTRL_BASE + 0x00),
+    ARMCTRL_IRQ_PENDING_1   = (ARMCTRL_BASE + 0x04),
+    ARMCTRL_IRQ_PENDING_2   = (ARMCTRL_BASE + 0x08),
+    ARMCTRL_FIQ_CONTROL     = (ARMCTRL_BASE + 0x0C),
+    ARMCTRL_ENABLE_IRQS_1   = (ARMCTRL_BASE + 0x10),
+    ARMCTRL_ENABLE_IRQS_2   = (ARMCTRL_BASE + 0x14),
+    ARMCTRL_ENABLE_BASIC_IRQS = (ARMCTRL_BASE + 0x18),
+    ARMCTRL_DISABLE_IRQS_1  = (ARMCTRL_BASE + 0x1C),
+    ARMCTRL_DISABLE_IRQS_2  = (ARMCTRL_BASE + 0x20),
+    ARMCTRL_DISABLE_BASIC_IRQS = (ARMCTRL_BASE + 0x24),
+
     // The mailbox base address.
     MAIL_BASE       = (PERIPHERAL_BASE + 0xB880),
 
@@ -20,6 +71,7 @@ enum
     MAIL_READ       = (MAIL_BASE + 0x00),
     MAIL_WRITE      = (MAIL_BASE + 0x20),
     MAIL_RSTATUS    = (MAIL_BASE + 0x18),
+    MAIL_CONFIG     = (MAIL_BASE + 0x1C),
     MAIL_WSTATUS    = (MAIL_BASE + 0x38),
 
     // Masks for the mailbox status register.
@@ -0,0 +1,145 @@
+#include "jobs.h"
+#include "cpu.h"
+#include "spinlock.h"
+
+// Upper bound of range jobs per kernel_parallel_for, a few per core so a
+// slow core does not hold everybody back
+#define JOBS_RANGE_CHUNKS   (CORES * 4)
+
+typedef struct {
+    job_fn_t fn;
+    void *arg;
+} job_t;
+
+typedef struct {
+    spinlock_t lock;
+    uint32_t top;               // oldest job, stolen first
+    uint32_t bottom;            // next free slot
+    job_t jobs[JOBS_QUEUE_SIZE];
+} __attribute__((aligned(64))) job_queue_t;
+
+typedef struct {
+    job_range_fn_t fn;
+    void *arg;
+    uint32_t begin;
+    uint32_t end;
+    atomic_t *remaining;
+} job_range_t;
+
+static job_queue_t queues[CORES];
+
+void jobs_init(void)
+{
+    for (uint32_t core = 0; core < CORES; core++)
+        spin_lock_init(&queues[core].lock, "jobs.queue");
+}
+
+// Owner side : newest job
+static bool queue_pop(job_queue_t *queue, job_t *job)
+{
+    bool found = false;
+
+    spin_lock(&queue->lock);
+    if (queue->bottom != queue->top) {
+        *job = queue->jobs[--queue->bottom & (JOBS_QUEUE_SIZE - 1)];
+        found = true;
+    }
+    spin_unlock(&queue->lock);
+    return found;
+}
+
+// Thief side : oldest job
+static bool queue_steal(job_queue_t *queue, job_t *job)
+{
+    bool found = false;
+
+    // Cheap unlocked peek, most queues are empty most of the time
+    if (*(volatile uint32_t *)&queue->bottom == *(volatile uint32_t *)&queue->top)
+        return false;
+
+    spin_lock(&queue->lock);
+    if (queue->bottom != queue->top) {
+        *job = queue->jobs[queue->top++ & (JOBS_QUEUE_SIZE - 1)];
+        found = true;
+    }
+    spin_unlock(&queue->lock);
+    return found;
+}
+
+bool kernel_submit(job_fn_t fn, void *arg)
+{
+    job_queue_t *queue = &queues[core_id()];
+    bool queued = false;
+
+    spin_lock(&queue->lock);
+    if (queue->bottom - queue->top < JOBS_QUEUE_SIZE) {
+        job_t *job = &queue->jobs[queue->bottom++ & (JOBS_QUEUE_SIZE - 1)];
+        job->fn = fn;
+        job->arg = arg;
+        queued = true;
+    }
+    spin_unlock(&queue->lock);
+
+    if (queued)
+        cpu_sev();
+    return queued;
+}
+
+bool jobs_run_one(void)
+{
+    uint32_t self = core_id();
+    job_t job;
+
+    if (!queue_pop(&queues[self], &job)) {
+        uint32_t i;
+        for (i = 1; i < CORES; i++) {
+            if (queue_steal(&queues[(self + i) % CORES], &job))
+                break;
+        }
+        if (i == CORES)
+            return false;
+    }
+
+    job.fn(job.arg);
+    return true;
+}
+
+static void job_range_run(void *arg)
+{
+    job_range_t *range = (job_range_t *)arg;
+
+    for (uint32_t i = range->begin; i < range->end; i++)
+        range->fn(i, range->arg);
+    atomic_fetch_sub(range->remaining, 1);
+}
+
+void kernel_parallel_for(uint32_t count, job_range_fn_t fn, void *arg)
+{
+    job_range_t ranges[JOBS_RANGE_CHUNKS];
+    uint32_t chunks = count < JOBS_RANGE_CHUNKS ? count : JOBS_RANGE_CHUNKS;
+    atomic_t remaining = ATOMIC_INIT(chunks);
+    uint32_t begin = 0;
+
+    // The first count % chunks ranges take one extra index
+    for (uint32_t c = 0; c < chunks; c++) {
+        ranges[c].fn = fn;
+        ranges[c].arg = arg;
+        ranges[c].begin = begin;
+        begin += count / chunks + (c < count % chunks ? 1 : 0);
+        ranges[c].end = begin;
+        ranges[c].remaining = &remaining;
+    }
+
+    // Queue all but the first chunk, which runs here right away
+    for (uint32_t c = 1; c < chunks; c++) {
+        if (!kernel_submit(job_range_run, &ranges[c]))
+            job_range_run(&ranges[c]);
+    }
+    if (chunks > 0)
+        job_range_run(&ranges[0]);
+
+    // Help with whatever is left rather than spinning idle
+    while (atomic_read(&remaining) != 0)
+        jobs_run_one();
+    dmb();
+}
@@ -0,0 +1,38 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+/*
+ * Kernel job system
+ *
+ * Every core owns a queue of pending jobs. The owner pushes and pops at the
+ * bottom (newest first, its data is still in cache), idle cores steal from
+ * the top of the other queues (oldest first). Secondary cores run jobs from
+ * their idle loop, core 0 runs them while it waits in kernel_parallel_for.
+ *
+ * Jobs run to completion on whichever core picks them up and must not
+ * block or wait on other jobs.
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define JOBS_QUEUE_SIZE     64      // per core, power of two
+
+typedef void (*job_fn_t)(void *arg);
+typedef void (*job_range_fn_t)(uint32_t index, void *arg);
+
+void jobs_init(void);
+
+// Queue fn(arg) on the running core, false if its queue is full
+bool kernel_submit(job_fn_t fn, void *arg);
+
+// Run fn(i, arg) for i in [0, count) across all online cores, returns
+// once every index has been processed
+void kernel_parallel_for(uint32_t count, job_range_fn_t fn, void *arg);
+
+// Run one pending job, stolen from another core if the local queue is
+// empty. False if there was nothing to run.
+bool jobs_run_one(void);
+
+#endif // JOBS_H
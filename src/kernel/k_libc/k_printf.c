@@ -20,9 +20,13 @@
 
 
 #include "k_stdio.h"
+#include "../spinlock.h"
 
 #include <stdarg.h>
 
+// Keeps messages from different cores from interleaving
+static spinlock_t printf_lock = SPINLOCK_INIT("printf");
+
 static void printchar(char **str, int c)
 {
 	if (str) {
@@ -136,7 +140,7 @@ static int print(char **out, const char *format, va_list args )
 				width += *format - '0';
 			}
 			if( *format == 's' ) {
-				register char *s = (char *)va_arg( args, int );
+				register char *s = va_arg( args, char * );
 				pc += prints (out, s?s:"(null)", width, pad);
 				continue;
 			}
@@ -178,9 +182,33 @@ static int print(char **out, const char *format, va_list args )
 int k_printf(const char *format, ...)
 {
         va_list args;
+        irq_flags_t flags;
+        int pc;
+
+        va_start( args, format );
+        flags = spin_lock_irqsave( &printf_lock );
+        pc = print( 0, format, args );
+        spin_unlock_irqrestore( &printf_lock, flags );
+        return pc;
+}
+
+int k_printf_panic(const char *format, ...)
+{
+        va_list args;
+        irq_flags_t flags;
+        bool locked;
+        int pc;
 
+        // The holder of printf_lock may be the code the fault interrupted,
+        // it will never release it : the message goes out without it
         va_start( args, format );
-        return print( 0, format, args );
+        flags = irq_save();
+        locked = spin_trylock( &printf_lock );
+        pc = print( 0, format, args );
+        if (locked)
+                spin_unlock( &printf_lock );
+        irq_restore( flags );
+        return pc;
 }
 
 int k_sprintf(char *out, const char *format, ...)
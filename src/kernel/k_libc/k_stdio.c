@@ -1,8 +1,24 @@
 #include "k_stdio.h"
 
 #include "../uart.h"
+#include "../fbcon.h"
+
+static uint32_t k_output = K_OUTPUT_UART;
+
+void k_set_output(uint32_t sinks)
+{
+    k_output = sinks;
+}
+
+uint32_t k_get_output(void)
+{
+    return k_output;
+}
 
 void k_putchar(char c)
 {
-    uart_putc(c);
-}
\ No newline at end of file
+    if (k_output & K_OUTPUT_UART)
+        uart_putc(c);
+    if (k_output & K_OUTPUT_FB)
+        fbcon_putc(c);
+}
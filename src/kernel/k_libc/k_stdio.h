@@ -1,9 +1,21 @@
 #ifndef __K_STDIO_H__
 #define __K_STDIO_H__
 
+#include <stdint.h>
+
+// Sinks of k_putchar, and so of k_printf
+#define K_OUTPUT_UART   (1 << 0)
+#define K_OUTPUT_FB     (1 << 1)    // framebuffer console (fbcon.h)
+
+void k_set_output(uint32_t sinks);
+uint32_t k_get_output(void);
+
 void k_putchar(char c);
 
 int k_printf(const char *format, ...);
+// k_printf for fatal errors: never waits for another k_printf, prints over
+// it instead. The sinks must not wait either, call uart_drain first
+int k_printf_panic(const char *format, ...);
 int k_sprintf(char *out, const char *format, ...);
 
-#endif // __K_STDIO_H__
\ No newline at end of file
+#endif // __K_STDIO_H__
@@ -1,6 +1,8 @@
 #include "k_stdlib.h"
 #include "k_string.h"
 
+#include "../slab.h"
+
 static void strrev(char * s)
 {
     uint32_t i, j;
@@ -27,4 +29,29 @@ void k_itoa(int n, char * s)
         s[i++] = '-';
     s[i] = '\0';
     strrev(s);
+}
+
+void *k_malloc(size_t size)
+{
+    return kmem_alloc(size);
+}
+
+void *k_calloc(size_t count, size_t size)
+{
+    uint8_t *ptr;
+
+    if (size != 0 && count > KMEM_MAX_SIZE / size)
+        return NULL;
+
+    ptr = kmem_alloc(count * size);
+    if (ptr) {
+        for (size_t i = 0; i < count * size; i++)
+            ptr[i] = 0;
+    }
+    return ptr;
+}
+
+void k_free(void *ptr)
+{
+    kmem_free(ptr);
 }
\ No newline at end of file
@@ -1,6 +1,12 @@
 #ifndef __K_STDLIB_H__
 #define __K_STDLIB_H__
 
+#include <stddef.h>
+
 void k_itoa(int n, char * s);
 
+void *k_malloc(size_t size);
+void *k_calloc(size_t count, size_t size);
+void k_free(void *ptr);
+
 #endif // __K_STDLIB_H__
\ No newline at end of file
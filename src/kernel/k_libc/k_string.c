@@ -1,24 +1,241 @@
 #include "k_string.h"
 
+/*
+ * Word-at-a-time string and memory functions.
+ *
+ * Bulk transfers of aligned data go through a 64 byte block loop tuned per
+ * architecture : ldm/stm bursts on ARMv6, NEON on ARMv7, ldp/stp of SIMD
+ * registers on AArch64. Everything else (heads, tails, host builds) uses
+ * machine words, with unaligned word loads when source and destination
+ * alignments differ.
+ */
+
+typedef uintptr_t __attribute__((may_alias)) word_t;
+typedef word_t __attribute__((aligned(1))) uword_t;
+
+#define WORD_SIZE       sizeof(word_t)
+#define WORD_MASK       (WORD_SIZE - 1)
+#define BLOCK_SIZE      64
+
+#define ONES            ((word_t)-1 / 0xFF)     // 0x0101...
+#define HIGHS           (ONES * 0x80)           // 0x8080...
+#define HAS_ZERO(w)     (((w) - ONES) & ~(w) & HIGHS)
+
+// Copy <blocks> 64 byte blocks, both pointers word aligned
+static inline void copy_blocks(uint8_t **dest, const uint8_t **src, size_t blocks)
+{
+    uint8_t *d = *dest;
+    const uint8_t *s = *src;
+
+#if __aarch64__
+    __asm__ volatile(
+        "1: ldp q0, q1, [%[s]], #32     \n"
+        "   ldp q2, q3, [%[s]], #32     \n"
+        "   subs %[n], %[n], #1         \n"
+        "   stp q0, q1, [%[d]], #32     \n"
+        "   stp q2, q3, [%[d]], #32     \n"
+        "   b.ne 1b                     \n"
+        : [d]"+r"(d), [s]"+r"(s), [n]"+r"(blocks)
+        :
+        : "v0", "v1", "v2", "v3", "cc", "memory");
+#elif defined(__ARM_NEON)
+    __asm__ volatile(
+        "1: pld [%[s], #192]            \n"
+        "   vld1.8 {d0-d3}, [%[s]]!     \n"
+        "   vld1.8 {d4-d7}, [%[s]]!     \n"
+        "   subs %[n], %[n], #1         \n"
+        "   vst1.8 {d0-d3}, [%[d]]!     \n"
+        "   vst1.8 {d4-d7}, [%[d]]!     \n"
+        "   bne 1b                      \n"
+        : [d]"+r"(d), [s]"+r"(s), [n]"+r"(blocks)
+        :
+        : "d0", "d1", "d2", "d3", "d4", "d5", "d6", "d7", "cc", "memory");
+#elif defined(__arm__)
+    __asm__ volatile(
+        "1: pld [%[s], #96]             \n"
+        "   ldmia %[s]!, {r3-r10}       \n"
+        "   stmia %[d]!, {r3-r10}       \n"
+        "   ldmia %[s]!, {r3-r10}       \n"
+        "   subs %[n], %[n], #1         \n"
+        "   stmia %[d]!, {r3-r10}       \n"
+        "   bne 1b                      \n"
+        : [d]"+r"(d), [s]"+r"(s), [n]"+r"(blocks)
+        :
+        : "r3", "r4", "r5", "r6", "r7", "r8", "r9", "r10", "cc", "memory");
+#else
+    for (; blocks > 0; blocks--) {
+        for (size_t i = 0; i < BLOCK_SIZE / WORD_SIZE; i++)
+            ((word_t *)d)[i] = ((const word_t *)s)[i];
+        d += BLOCK_SIZE;
+        s += BLOCK_SIZE;
+    }
+#endif
+
+    *dest = d;
+    *src = s;
+}
+
+// Fill <blocks> 64 byte blocks with <pattern>, pointer word aligned
+static inline void set_blocks(uint8_t **dest, word_t pattern, size_t blocks)
+{
+    uint8_t *d = *dest;
+
+#if __aarch64__
+    __asm__ volatile(
+        "   dup v0.2d, %[v]             \n"
+        "   mov v1.16b, v0.16b          \n"
+        "1: subs %[n], %[n], #1         \n"
+        "   stp q0, q1, [%[d]], #32     \n"
+        "   stp q0, q1, [%[d]], #32     \n"
+        "   b.ne 1b                     \n"
+        : [d]"+r"(d), [n]"+r"(blocks)
+        : [v]"r"(pattern)
+        : "v0", "v1", "cc", "memory");
+#elif defined(__ARM_NEON)
+    __asm__ volatile(
+        "   vdup.32 q0, %[v]            \n"
+        "   vmov q1, q0                 \n"
+        "1: subs %[n], %[n], #1         \n"
+        "   vst1.8 {d0-d3}, [%[d]]!     \n"
+        "   vst1.8 {d0-d3}, [%[d]]!     \n"
+        "   bne 1b                      \n"
+        : [d]"+r"(d), [n]"+r"(blocks)
+        : [v]"r"(pattern)
+        : "d0", "d1", "d2", "d3", "cc", "memory");
+#elif defined(__arm__)
+    __asm__ volatile(
+        "   mov r3, %[v]                \n"
+        "   mov r4, %[v]                \n"
+        "   mov r5, %[v]                \n"
+        "   mov r6, %[v]                \n"
+        "   mov r7, %[v]                \n"
+        "   mov r8, %[v]                \n"
+        "   mov r9, %[v]                \n"
+        "   mov r10, %[v]               \n"
+        "1: subs %[n], %[n], #1         \n"
+        "   stmia %[d]!, {r3-r10}       \n"
+        "   stmia %[d]!, {r3-r10}       \n"
+        "   bne 1b                      \n"
+        : [d]"+r"(d), [n]"+r"(blocks)
+        : [v]"r"(pattern)
+        : "r3", "r4", "r5", "r6", "r7", "r8", "r9", "r10", "cc", "memory");
+#else
+    for (; blocks > 0; blocks--) {
+        for (size_t i = 0; i < BLOCK_SIZE / WORD_SIZE; i++)
+            ((word_t *)d)[i] = pattern;
+        d += BLOCK_SIZE;
+    }
+#endif
+
+    *dest = d;
+}
+
 uint32_t k_strlen(char * s)
 {
-    uint32_t n = 0;
-    while (s[n] != '\0')
-    {
-        n++;
+    const char *p = s;
+    const word_t *w;
+
+    // Reach a word boundary, then test a whole word per iteration.
+    // Aligned words never cross a page, reading past the end is safe.
+    while ((uintptr_t)p & WORD_MASK) {
+        if (*p == '\0')
+            return p - s;
+        p++;
     }
-    return n;
+
+    w = (const word_t *)p;
+    while (!HAS_ZERO(*w))
+        w++;
+
+    p = (const char *)w;
+    while (*p != '\0')
+        p++;
+
+    return p - s;
 }
 
 void *k_memcpy(void *dest, const void * src, size_t n)
 {
-    uint8_t * bdest = (uint8_t*)dest;
-    uint8_t * bsrc = (uint8_t*)src;
+    uint8_t *d = (uint8_t *)dest;
+    const uint8_t *s = (const uint8_t *)src;
 
-    for (size_t i = 0; i < n; i++) {
-        bdest[i] = bsrc[i];
+    if (n >= WORD_SIZE * 2) {
+        while ((uintptr_t)d & WORD_MASK) {
+            *d++ = *s++;
+            n--;
+        }
+
+        if (((uintptr_t)s & WORD_MASK) == 0) {
+            if (n >= BLOCK_SIZE) {
+                copy_blocks(&d, &s, n / BLOCK_SIZE);
+                n &= BLOCK_SIZE - 1;
+            }
+            for (; n >= WORD_SIZE; n -= WORD_SIZE, d += WORD_SIZE, s += WORD_SIZE)
+                *(word_t *)d = *(const word_t *)s;
+        } else {
+            // Source misaligned relative to the destination
+            for (; n >= WORD_SIZE; n -= WORD_SIZE, d += WORD_SIZE, s += WORD_SIZE)
+                *(word_t *)d = *(const uword_t *)s;
+        }
     }
 
+    while (n--)
+        *d++ = *s++;
+
+    return dest;
+}
+
+void *k_memmove(void *dest, const void *src, size_t n)
+{
+    uint8_t *d = (uint8_t *)dest;
+    const uint8_t *s = (const uint8_t *)src;
+
+    // Forward copy is safe unless the destination starts inside the source
+    if (d <= s || d >= s + n)
+        return k_memcpy(dest, src, n);
+
+    d += n;
+    s += n;
+
+    if (n >= WORD_SIZE * 2) {
+        while ((uintptr_t)d & WORD_MASK) {
+            *--d = *--s;
+            n--;
+        }
+        for (; n >= WORD_SIZE; n -= WORD_SIZE) {
+            d -= WORD_SIZE;
+            s -= WORD_SIZE;
+            *(word_t *)d = *(const uword_t *)s;
+        }
+    }
+
+    while (n--)
+        *--d = *--s;
+
+    return dest;
+}
+
+void *k_memset(void *dest, int c, size_t n)
+{
+    uint8_t *d = (uint8_t *)dest;
+    word_t pattern = ONES * (uint8_t)c;
+
+    if (n >= WORD_SIZE * 2) {
+        while ((uintptr_t)d & WORD_MASK) {
+            *d++ = (uint8_t)c;
+            n--;
+        }
+        if (n >= BLOCK_SIZE) {
+            set_blocks(&d, pattern, n / BLOCK_SIZE);
+            n &= BLOCK_SIZE - 1;
+        }
+        for (; n >= WORD_SIZE; n -= WORD_SIZE, d += WORD_SIZE)
+            *(word_t *)d = pattern;
+    }
+
+    while (n--)
+        *d++ = (uint8_t)c;
+
     return dest;
 }
 
@@ -27,6 +244,15 @@ int k_memcmp(const void *s1, const void *s2, size_t n)
     const uint8_t *p1 = (const uint8_t *)s1;
     const uint8_t *p2 = (const uint8_t *)s2;
 
+    // Skip identical words, the differing one is resolved bytewise
+    if ((((uintptr_t)p1 | (uintptr_t)p2) & WORD_MASK) == 0) {
+        while (n >= WORD_SIZE && *(const word_t *)p1 == *(const word_t *)p2) {
+            p1 += WORD_SIZE;
+            p2 += WORD_SIZE;
+            n -= WORD_SIZE;
+        }
+    }
+
     for (size_t i = 0; i < n; i++) {
         if (p1[i] != p2[i]) {
             return (int)(p1[i] - p2[i]);
@@ -34,4 +260,4 @@ int k_memcmp(const void *s1, const void *s2, size_t n)
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -8,6 +8,10 @@ uint32_t k_strlen(char * s);
 
 void *k_memcpy(void *dest, const void * src, size_t n);
 
+void *k_memmove(void *dest, const void *src, size_t n);
+
+void *k_memset(void *dest, int c, size_t n);
+
 int k_memcmp(const void *s1, const void *s2, size_t n);
 
 #endif // __K_STRING_H__
\ No newline at end of file
@@ -3,34 +3,50 @@
 #include <stdarg.h>
 
 #include "k_libc/k_string.h"
-
-#define MAIL0_READ (((uint32_t *)(MAIL_READ)))
-#define MAIL0_STATUS (((uint32_t *)(MAIL_RSTATUS)))
-#define MAIL0_WRITE (((uint32_t *)(MAIL_WRITE)))
+#include "k_libc/k_stdio.h"
+#include "uart.h"
+#include "cache.h"
+#include "clock.h"
+#include "cpu.h"
+#include "interrupts.h"
+#include "spinlock.h"
+#include "trace.h"
 
 #define CHANNEL_MASK 0x0000000F  // channels: lower 4 bits
 #define DATA_MASK    0xFFFFFFF0  // data: remaining bits
 
+#define MAILBOX_CHANNELS 16
 #define MAILBOX_END_TAG 0x00000000
+#define MAILBOX_TAG_RESPONSE 0x80000000	// value_length : answered by the firmware
+#define MAIL_CONFIG_IRQ_DATA 0x00000001	// interrupt while the VC to ARM FIFO holds data
+
+// Requests in order, linked through their next field
+typedef struct {
+	mailbox_request_t *head;
+	mailbox_request_t *tail;
+} mailbox_queue_t;
+
+// Cache line aligned so that maintenance never touches neighbouring data
+static uint32_t property_data[8192] __attribute__((aligned(64)));
+
+// Owns property_data, held until its answer
+static spinlock_t mailbox_property_lock = SPINLOCK_INIT("mailbox property");
+
+// Owns the mailbox registers, the queues and the statistics
+static spinlock_t mailbox_lock = SPINLOCK_INIT("mailbox");
+
+// Written and waiting for their answer, per channel, and waiting for room
+// in the ARM to VC FIFO
+static mailbox_queue_t mailbox_pending[MAILBOX_CHANNELS];
+static mailbox_queue_t mailbox_unsent;
+static volatile bool mailbox_irq_on;
 
-struct __attribute__((__packed__, aligned(4))) MailBoxRegisters {
-	const uint32_t Read0;											// 0x00         Read data from VC to ARM
-	uint32_t Unused[3];												// 0x04-0x0F
-	uint32_t Peek0;													// 0x10
-	uint32_t Sender0;												// 0x14
-	uint32_t Status0;												// 0x18         Status of VC to ARM
-	uint32_t Config0;												// 0x1C        
-	uint32_t Write1;												// 0x20         Write data from ARM to VC
-	uint32_t Unused2[3];											// 0x24-0x2F
-	uint32_t Peek1;													// 0x30
-	uint32_t Sender1;												// 0x34
-	uint32_t Status1;												// 0x38         Status of ARM to VC
-	uint32_t Config1;												// 0x3C 
-};
-
-#define MAILBOX ((volatile __attribute__((aligned(4))) struct MailBoxRegisters*)(uintptr_t)(MAIL_BASE))
-
-static uint32_t property_data[8192] __attribute__((aligned(16)));
+static mailbox_stats_t mailbox_stats;
+static uint64_t mailbox_total_ticks;
+static uint64_t mailbox_max_ticks;
+
+static mailbox_board_t mailbox_board_cache;
+static volatile bool mailbox_board_ready;
 
 uint32_t mailbox_read(MAILBOX_CHANNEL channel) {
     uint32_t value;													
@@ -38,9 +54,9 @@ uint32_t mailbox_read(MAILBOX_CHANNEL channel) {
         return 0xFEEDDEAD;				
 	do {
 		do {
-			value = MAILBOX->Status0;								
+			value = mmio_read(MAIL_RSTATUS);
 		} while ((value & MAIL_EMPTY) != 0);						
-		value = MAILBOX->Read0;										
+		value = mmio_read(MAIL_READ);
 	} while ((value & CHANNEL_MASK) != channel);			    	
 	return (value & DATA_MASK);
 }
@@ -48,14 +64,169 @@ uint32_t mailbox_read(MAILBOX_CHANNEL channel) {
 void mailbox_write(uint32_t message, MAILBOX_CHANNEL channel) {
     uint32_t value;
 	do {
-		value = MAILBOX->Status1;
+		value = mmio_read(MAIL_WSTATUS);
 	} while ((value & MAIL_FULL) != 0);
-	MAILBOX->Write1 = (message & DATA_MASK | (channel & CHANNEL_MASK));
+	mmio_write(MAIL_WRITE, (message & DATA_MASK) | (channel & CHANNEL_MASK));
+}
+
+static void mailbox_queue_push(mailbox_queue_t *queue, mailbox_request_t *request) {
+	request->next = NULL;
+	if (queue->tail)
+		queue->tail->next = request;
+	else
+		queue->head = request;
+	queue->tail = request;
+}
+
+static mailbox_request_t *mailbox_queue_pop(mailbox_queue_t *queue) {
+	mailbox_request_t *request = queue->head;
+	if (request) {
+		queue->head = request->next;
+		if (!queue->head)
+			queue->tail = NULL;
+	}
+	return request;
+}
+
+// Write the unsent requests while the FIFO has room, with the lock held
+static void mailbox_flush(void) {
+	while (mailbox_unsent.head && !(mmio_read(MAIL_WSTATUS) & MAIL_FULL)) {
+		mailbox_request_t *request = mailbox_queue_pop(&mailbox_unsent);
+		mailbox_queue_push(&mailbox_pending[request->channel], request);
+		request->start = clock_ticks();
+		mmio_write(MAIL_WRITE, (request->message & DATA_MASK) | request->channel);
+	}
+}
+
+// Match the answers in the FIFO with their requests, and complete them
+// once the lock is dropped
+static void mailbox_poll(void) {
+	mailbox_queue_t done = { NULL, NULL };
+	mailbox_request_t *request;
+
+	irq_flags_t flags = spin_lock_irqsave(&mailbox_lock);
+	while (!(mmio_read(MAIL_RSTATUS) & MAIL_EMPTY)) {
+		uint32_t value = mmio_read(MAIL_READ);
+		request = mailbox_queue_pop(&mailbox_pending[value & CHANNEL_MASK]);
+		if (!request) {
+			mailbox_stats.stray++;
+			continue;
+		}
+
+		uint64_t ticks = clock_ticks() - request->start;
+		mailbox_stats.transactions++;
+		mailbox_total_ticks += ticks;
+		if (ticks > mailbox_max_ticks)
+			mailbox_max_ticks = ticks;
+		request->answer = value & DATA_MASK;
+		mailbox_queue_push(&done, request);
+	}
+	// Room for the next ones
+	mailbox_flush();
+	spin_unlock_irqrestore(&mailbox_lock, flags);
+
+	while ((request = done.head)) {
+		done.head = request->next;
+		mailbox_callback_t callback = request->callback;
+		void *arg = request->arg;
+		uint32_t answer = request->answer;
+
+		// The VideoCore wrote the buffer behind the data cache
+		if (request->buffer)
+			dcache_invalidate_range(request->buffer, request->size);
+
+		// The request may be reused or gone from here on
+		dmb();
+		request->done = true;
+		if (callback)
+			callback(answer, arg);
+	}
+}
+
+static void mailbox_irq(void *arg) {
+	(void)arg;
+
+	// Reading the FIFO empty clears the interrupt
+	mailbox_poll();
+}
+
+void mailbox_irq_init(void) {
+	irq_register(IRQ_ARM_MAILBOX, mailbox_irq, NULL);
+	irq_flags_t flags = spin_lock_irqsave(&mailbox_lock);
+	mmio_write(MAIL_CONFIG, MAIL_CONFIG_IRQ_DATA);
+	mailbox_irq_on = true;
+	spin_unlock_irqrestore(&mailbox_lock, flags);
+	irq_enable(IRQ_ARM_MAILBOX);
+}
+
+// Queue <request>, counting the property tags it carries
+static void mailbox_submit(mailbox_request_t *request, uint32_t message, uint32_t channel,
+						   mailbox_callback_t callback, void *arg, uint32_t tags) {
+	request->message = message;
+	request->channel = channel & CHANNEL_MASK;
+	request->callback = callback;
+	request->arg = arg;
+	request->done = false;
+
+	irq_flags_t flags = spin_lock_irqsave(&mailbox_lock);
+	mailbox_stats.tags += tags;
+	mailbox_queue_push(&mailbox_unsent, request);
+	mailbox_flush();
+	spin_unlock_irqrestore(&mailbox_lock, flags);
+}
+
+void mailbox_send(mailbox_request_t *request, uint32_t message, MAILBOX_CHANNEL channel,
+				  mailbox_callback_t callback, void *arg) {
+	request->buffer = NULL;
+	mailbox_submit(request, message, channel, callback, arg, 0);
+}
+
+// Send the property <buffer>, sized by its first word
+static void mailbox_property_send(mailbox_request_t *request, uint32_t *buffer,
+								  mailbox_callback_t callback, void *arg) {
+	uint32_t size = buffer[0], tags = 0;
+
+	// Tags up to the end tag, by their buffer sizes
+	for (uint32_t i = 2; i < size / 4 && buffer[i] != MAILBOX_END_TAG; i += 3 + buffer[i + 1] / 4)
+		tags++;
+
+	// The VideoCore does not see the ARM data cache
+	dcache_clean_invalidate_range(buffer, size);
+	request->buffer = buffer;
+	request->size = size;
+	mailbox_submit(request, (uint32_t)(uintptr_t)buffer, MB_CHANNEL_TAGS, callback, arg, tags);
+}
+
+uint32_t mailbox_wait(mailbox_request_t *request) {
+	while (!request->done) {
+		irq_flags_t flags = irq_save();
+		// The interrupt goes to core 0, and runs once IRQs are unmasked :
+		// wfi wakes up for it even masked
+		if (mailbox_irq_on && core_id() == 0 && !irq_flags_masked(flags)) {
+			if (!request->done)
+				cpu_wfi();
+		} else {
+			mailbox_poll();
+		}
+		irq_restore(flags);
+	}
+	dmb();
+	return request->answer;
+}
+
+uint32_t mailbox_call(uint32_t message, MAILBOX_CHANNEL channel) {
+	mailbox_request_t request;
+
+	TRACE_BEGIN("mailbox", "channel %u", channel);
+	mailbox_send(&request, message, channel, NULL, NULL);
+	uint32_t answer = mailbox_wait(&request);
+	TRACE_END("mailbox");
+	return answer;
 }
 
 bool mailbox_tag_message(uint32_t* response_buf, uint8_t data_count, ...)
 {
-	uint32_t __attribute__((aligned(16))) message[32];
+	uint32_t __attribute__((aligned(64))) message[32];
 	va_list list;
 	va_start(list, data_count);
 	message[0] = (data_count + 3) * 4;
@@ -66,8 +237,9 @@ bool mailbox_tag_message(uint32_t* response_buf, uint8_t data_count, ...)
 		message[2 + i] = va_arg(list, uint32_t);
 	}
 	va_end(list);							
-	mailbox_write((uint32_t)(void*)message, MB_CHANNEL_TAGS);
-	mailbox_read(MB_CHANNEL_TAGS);
+	dcache_clean_invalidate_range(message, sizeof(message));
+	mailbox_call((uint32_t)(void*)message, MB_CHANNEL_TAGS);
+	dcache_invalidate_range(message, sizeof(message));
 	if (message[1] == RPI_FIRMWARE_STATUS_SUCCESS) 
 	{
 		if (response_buf) 
@@ -82,21 +254,49 @@ bool mailbox_tag_message(uint32_t* response_buf, uint8_t data_count, ...)
 	return false;
 }
 
-void mailbox_process(mailbox_tag_t *tag, uint32_t tag_size) {
+// Runs <tag> through property_data, mailbox_property_lock held
+static void mailbox_property_run(mailbox_tag_t *tag, uint32_t tag_size) {
 
 	// https://github.com/raspberrypi/firmware/wiki/Mailbox-property-interface
     uint32_t buffer_size = tag_size + 4 /*uint32_t size*/ + 4 /*uint32_t code*/ + 4 /*uint32_t end tag*/;
+	mailbox_request_t request;
 
 	property_data[0] = buffer_size;                           // size
 	property_data[1] = RPI_FIRMWARE_STATUS_REQUEST;           // code
     k_memcpy(&property_data[2], tag, tag_size);               // tags
 	property_data[buffer_size / 4 - 1] = MAILBOX_END_TAG;     // End tag
 
-    mailbox_write((uint32_t)(void *)property_data, MB_CHANNEL_TAGS);
-	mailbox_read(MB_CHANNEL_TAGS);
+	mailbox_property_send(&request, property_data, NULL, NULL);
+	mailbox_wait(&request);
 	k_memcpy(tag, &property_data[2], tag_size);
 }
 
+void mailbox_process(mailbox_tag_t *tag, uint32_t tag_size) {
+
+	TRACE_BEGIN("mailbox", "tag %x", tag->id);
+	// IRQs stay masked while property_data is held, interrupt handlers use
+	// it too : the wait polls
+	irq_flags_t flags = spin_lock_irqsave(&mailbox_property_lock);
+	mailbox_property_run(tag, tag_size);
+	spin_unlock_irqrestore(&mailbox_property_lock, flags);
+	TRACE_END("mailbox");
+}
+
+bool mailbox_try_process(mailbox_tag_t *tag, uint32_t tag_size) {
+
+	// The holder may be the code a fatal exception interrupted, it will
+	// never release property_data
+	irq_flags_t flags = irq_save();
+	if (!spin_trylock(&mailbox_property_lock))
+	{
+		irq_restore(flags);
+		return false;
+	}
+	mailbox_property_run(tag, tag_size);
+	spin_unlock_irqrestore(&mailbox_property_lock, flags);
+	return true;
+}
+
 void mailbox_generic_cmd_id(uint32_t tag_id, uint32_t id, uint32_t *value)
 {
 	typedef struct {
@@ -145,6 +345,145 @@ uint32_t mailbox_get_id(uint32_t tag_id, uint32_t id)
 uint32_t mailbox_get(uint32_t tag_id)
 {
 	uint32_t val = 0;
+	const mailbox_board_t *board;
+
+	// Fixed properties from the cache
+	switch (tag_id) {
+	case MAILBOX_TAG_GET_VERSION:
+	case MAILBOX_TAG_GET_BOARD_MODEL:
+	case MAILBOX_TAG_GET_BOARD_REVISION:
+		board = mailbox_board();
+		if (board) {
+			irq_flags_t flags = spin_lock_irqsave(&mailbox_lock);
+			mailbox_stats.cached++;
+			spin_unlock_irqrestore(&mailbox_lock, flags);
+			if (tag_id == MAILBOX_TAG_GET_VERSION)
+				return board->firmware;
+			return tag_id == MAILBOX_TAG_GET_BOARD_MODEL ? board->model : board->revision;
+		}
+		break;
+	}
+
 	mailbox_generic_cmd(tag_id, &val);
 	return val;
+}
+
+void mailbox_batch_init(mailbox_batch_t *batch)
+{
+	batch->length = 2;		// size and code
+	batch->tags = 0;
+	batch->overflow = false;
+}
+
+uint32_t *mailbox_batch_add(mailbox_batch_t *batch, uint32_t tag_id, uint32_t words)
+{
+	// Room for the tag header, its values and the end tag
+	if (batch->length + 3 + words + 1 > MAILBOX_BATCH_WORDS) {
+		batch->overflow = true;
+		return NULL;
+	}
+
+	uint32_t *tag = &batch->buffer[batch->length];
+	tag[0] = tag_id;
+	tag[1] = words * 4;		// buffer size
+	tag[2] = 0;				// request
+	k_memset(&tag[3], 0, words * 4);
+	batch->length += 3 + words;
+	batch->tags++;
+	return &tag[3];
+}
+
+bool mailbox_batch_send(mailbox_batch_t *batch, mailbox_callback_t callback, void *arg)
+{
+	if (batch->overflow)
+		return false;
+
+	batch->buffer[0] = (batch->length + 1) * 4;
+	batch->buffer[1] = RPI_FIRMWARE_STATUS_REQUEST;
+	batch->buffer[batch->length] = MAILBOX_END_TAG;
+	mailbox_property_send(&batch->request, batch->buffer, callback, arg);
+	return true;
+}
+
+bool mailbox_batch_wait(mailbox_batch_t *batch)
+{
+	if (batch->overflow)
+		return false;
+
+	mailbox_wait(&batch->request);
+	return batch->buffer[1] == RPI_FIRMWARE_STATUS_SUCCESS;
+}
+
+bool mailbox_batch_process(mailbox_batch_t *batch)
+{
+	TRACE_BEGIN("mailbox", "batch of %u tags", batch->tags);
+	bool done = mailbox_batch_send(batch, NULL, NULL) && mailbox_batch_wait(batch);
+	TRACE_END("mailbox");
+	return done;
+}
+
+bool mailbox_batch_answered(const uint32_t *value)
+{
+	// value_length, just before the values
+	return (value[-1] & MAILBOX_TAG_RESPONSE) != 0;
+}
+
+const mailbox_board_t *mailbox_board(void)
+{
+	// The flag is set once the cache is filled : the barriers order the
+	// fields before it for the other cores
+	if (mailbox_board_ready) {
+		dmb();
+		return &mailbox_board_cache;
+	}
+
+	mailbox_batch_t batch;
+	mailbox_batch_init(&batch);
+	uint32_t *firmware = mailbox_batch_add(&batch, MAILBOX_TAG_GET_VERSION, 1);
+	uint32_t *model = mailbox_batch_add(&batch, MAILBOX_TAG_GET_BOARD_MODEL, 1);
+	uint32_t *revision = mailbox_batch_add(&batch, MAILBOX_TAG_GET_BOARD_REVISION, 1);
+	uint32_t *serial = mailbox_batch_add(&batch, MAILBOX_TAG_GET_BOARD_SERIAL, 2);
+	uint32_t *mac = mailbox_batch_add(&batch, MAILBOX_TAG_GET_BOARD_MAC_ADDRESS, 2);
+	uint32_t *arm = mailbox_batch_add(&batch, MAILBOX_TAG_GET_ARM_MEMORY, 2);
+	uint32_t *vc = mailbox_batch_add(&batch, MAILBOX_TAG_GET_VC_MEMORY, 2);
+	if (!mailbox_batch_process(&batch))
+		return NULL;
+
+	// Tags the firmware does not know stay 0
+	mailbox_board_t *board = &mailbox_board_cache;
+	board->firmware = firmware[0];
+	board->model = model[0];
+	board->revision = revision[0];
+	board->serial = (uint64_t)serial[1] << 32 | serial[0];
+	k_memcpy(board->mac, mac, sizeof(board->mac));
+	board->arm_base = arm[0];
+	board->arm_size = arm[1];
+	board->vc_base = vc[0];
+	board->vc_size = vc[1];
+	dmb();
+	mailbox_board_ready = true;
+	return board;
+}
+
+void mailbox_get_stats(mailbox_stats_t *stats)
+{
+	irq_flags_t flags = spin_lock_irqsave(&mailbox_lock);
+	*stats = mailbox_stats;
+	uint64_t total = mailbox_total_ticks, max = mailbox_max_ticks;
+	spin_unlock_irqrestore(&mailbox_lock, flags);
+
+	stats->total_ns = clock_ticks_to_ns(total);
+	stats->max_ns = (uint32_t)clock_ticks_to_ns(max);
+}
+
+void mailbox_dump_stats(void)
+{
+	mailbox_stats_t stats;
+	mailbox_get_stats(&stats);
+
+	k_printf("  transactions  tags  cached  stray  avg us  max us\r\n");
+	k_printf("  %12u  %4u  %6u  %5u  %6u  %6u\r\n", stats.transactions, stats.tags,
+			 stats.cached, stats.stray,
+			 stats.transactions ? (uint32_t)(stats.total_ns / stats.transactions / 1000) : 0,
+			 stats.max_ns / 1000);
 }
\ No newline at end of file
@@ -156,10 +156,121 @@ typedef struct {
     uint32_t value_length;
 } mailbox_tag_t;
 
+// Called with the answer to a request, from the mailbox interrupt or a
+// core polling the mailbox, IRQs masked. It must not wait for the mailbox.
+typedef void (*mailbox_callback_t)(uint32_t answer, void *arg);
+
+// A message to the VideoCore and its answer, owned by the caller until done
+typedef struct mailbox_request {
+    struct mailbox_request *next;
+    uint32_t message;
+    uint32_t channel;
+    void *buffer;                   // property buffer, read back from RAM when answered
+    uint32_t size;
+    uint64_t start;                 // clocksource ticks at the write
+    mailbox_callback_t callback;
+    void *arg;
+    uint32_t answer;
+    volatile bool done;
+} mailbox_request_t;
+
+// Property tags sent together in one transaction, see mailbox_batch_add()
+#define MAILBOX_BATCH_WORDS 128
+
+typedef struct {
+    uint32_t buffer[MAILBOX_BATCH_WORDS] __attribute__((aligned(64)));
+    uint32_t length;                // words used in buffer
+    uint32_t tags;
+    bool overflow;                  // a tag did not fit
+    mailbox_request_t request;
+} mailbox_batch_t;
+
+// Properties fixed until reset
+typedef struct {
+    uint32_t firmware;
+    uint32_t model;
+    uint32_t revision;
+    uint64_t serial;
+    uint8_t mac[6];
+    uint32_t arm_base;
+    uint32_t arm_size;
+    uint32_t vc_base;
+    uint32_t vc_size;
+} mailbox_board_t;
+
+typedef struct {
+    uint32_t transactions;          // round trips to the VideoCore
+    uint32_t tags;                  // property tags they carried
+    uint32_t cached;                // properties answered from the board cache
+    uint32_t stray;                 // answers no request was waiting for
+    uint64_t total_ns;
+    uint32_t max_ns;
+} mailbox_stats_t;
+
+// Raw register access, polled. No request is matched : answers to other
+// channels read meanwhile are lost.
 uint32_t mailbox_read(MAILBOX_CHANNEL channel);
 void mailbox_write(uint32_t data, MAILBOX_CHANNEL channel);
+
+// From here on answers are taken by the ARM mailbox interrupt, waits on
+// core 0 sleep in wfi until it comes. Before, and with IRQs masked or on
+// the other cores, waits poll the mailbox. Call once the interrupt
+// controller is set up.
+void mailbox_irq_init(void);
+
+// Queue <message> for <channel> and return. Requests are written as the
+// ARM to VideoCore FIFO has room, and matched with the answers of their
+// channel in order. <callback> may be NULL.
+void mailbox_send(mailbox_request_t *request, uint32_t message, MAILBOX_CHANNEL channel,
+                  mailbox_callback_t callback, void *arg);
+
+// The answer to <request>, waiting for it if needed
+uint32_t mailbox_wait(mailbox_request_t *request);
+
+static inline bool mailbox_done(const mailbox_request_t *request)
+{
+    return request->done;
+}
+
+// Write <message> and wait for the answer
+uint32_t mailbox_call(uint32_t message, MAILBOX_CHANNEL channel);
 void mailbox_process(mailbox_tag_t *tag, uint32_t tag_size);
+// Same, false without waiting if the property buffer is busy : for the
+// fatal exception path
+bool mailbox_try_process(mailbox_tag_t *tag, uint32_t tag_size);
 uint32_t mailbox_get(uint32_t tag_id);
 uint32_t mailbox_get_id(uint32_t tag_id, uint32_t id);
 
+// Batches : any number of tags in one round trip.
+//
+//   mailbox_batch_t batch;
+//   mailbox_batch_init(&batch);
+//   uint32_t *core = mailbox_batch_add(&batch, MAILBOX_TAG_GET_CLOCK_RATE, 2);
+//   uint32_t *arm = mailbox_batch_add(&batch, MAILBOX_TAG_GET_CLOCK_RATE, 2);
+//   core[0] = MAIL_CLOCK_CORE;
+//   arm[0] = MAIL_CLOCK_ARM;
+//   if (mailbox_batch_process(&batch))
+//       ... core[1], arm[1]
+void mailbox_batch_init(mailbox_batch_t *batch);
+// The <words> value words of a new tag, zeroed : the request is written
+// there, the answer read back from there. NULL when the batch is full.
+uint32_t *mailbox_batch_add(mailbox_batch_t *batch, uint32_t tag_id, uint32_t words);
+// Send the batch and wait. False if a tag did not fit or the firmware
+// failed it.
+bool mailbox_batch_process(mailbox_batch_t *batch);
+// Send the batch and return, <callback> may be NULL. The answers are in
+// place once mailbox_batch_wait() returns. False if a tag did not fit,
+// nothing is sent then.
+bool mailbox_batch_send(mailbox_batch_t *batch, mailbox_callback_t callback, void *arg);
+bool mailbox_batch_wait(mailbox_batch_t *batch);
+// The firmware answered the tag of <value>
+bool mailbox_batch_answered(const uint32_t *value);
+
+// Board properties, read in one batch by the first call and kept. NULL
+// if the firmware failed it, read again at the next call.
+const mailbox_board_t *mailbox_board(void);
+
+void mailbox_get_stats(mailbox_stats_t *stats);
+void mailbox_dump_stats(void);
+
 #endif // __MAILBOX_H__
\ No newline at end of file
@@ -12,15 +12,35 @@
 #include "syscall.h"
 #include "power.h"
 #include "audio.h"
+#include "pmm.h"
+#include "slab.h"
+#include "crc32.h"
+#include "smp.h"
+#include "jobs.h"
+#include "mm.h"
+#include "cpu.h"
+#include "spinlock.h"
+#include "interrupts.h"
+#include "draw.h"
+#include "text.h"
+#include "fbcon.h"
+#include "trace.h"
+#include "clock.h"
+#include "timer.h"
+#include "boot_stage.h"
 
 void kernel_main(uint32_t r0, uint32_t r1, uint32_t atags)
 {
     (void) r0;
     (void) r1;
-    (void) atags;
+
+    // Everything from here on is timed, see the boot stage table
+    clock_init();
+    boot_stage_init();
 
     // Initialize UART for debug output
-    uart_init();
+    BOOT_STAGE("UART", uart_init());
+    cpu_cycles_init();
 
     // Display header
     k_printf("\r\n");
@@ -31,34 +51,101 @@ void kernel_main(uint32_t r0, uint32_t r1, uint32_t atags)
 
     // Initialize subsystems
     k_printf("Initializing subsystems...\r\n");
+
+    k_printf("  [OK] Clock (%s, %u Hz)\r\n", clock_name(), clock_hz());
+
+    // Discover RAM and seed the page allocator
+    BOOT_STAGE("Memory manager", pmm_init(atags));
+    pmm_stats_t mem;
+    pmm_get_stats(&mem);
+    k_printf("  [OK] Memory manager (%d KB free)\r\n", mem.free_pages * (PAGE_SIZE / 1024));
+
+    BOOT_STAGE("Kernel object allocator", kmem_init());
+    k_printf("  [OK] Kernel object allocator\r\n");
+
+    BOOT_STAGE("CRC32 engine", crc32_init());
+    k_printf("  [OK] CRC32 engine\r\n");
+
+    // Vectors first, every source stays masked until a driver enables it
+    BOOT_STAGE("Interrupt controller", interrupts_init(); interrupts_enable());
+    k_printf("  [OK] Interrupt controller\r\n");
+
+    // Timers run from here on, before anything paces itself on them
+    BOOT_STAGE("Timers", timer_init());
+    k_printf("  [OK] Timers (%d us ticks)\r\n", TIMER_TICK_US);
+
+    // Mailbox answers come by interrupt from here on
+    BOOT_STAGE("Mailbox interrupt", mailbox_irq_init());
+    k_printf("  [OK] Mailbox\r\n");
+
+    // The clocks, answered while the boot goes on
+    mailbox_batch_t clocks;
+    mailbox_batch_init(&clocks);
+    uint32_t *core_clock = mailbox_batch_add(&clocks, MAILBOX_TAG_GET_CLOCK_RATE, 2);
+    uint32_t *arm_clock = mailbox_batch_add(&clocks, MAILBOX_TAG_GET_CLOCK_RATE, 2);
+    core_clock[0] = MAIL_CLOCK_CORE;
+    arm_clock[0] = MAIL_CLOCK_ARM;
+    mailbox_batch_send(&clocks, NULL, NULL);
+
+    // Output no longer waits for the UART from here on
+    BOOT_STAGE("UART interrupts", uart_irq_init());
+    k_printf("  [OK] UART (%d baud%s)\r\n", uart_get_baud(), uart_dma_enabled() ? ", DMA" : "");
+#if TRACE
+    k_printf("  [%s] Trace\r\n", trace_init() ? "OK" : "--");
+#endif
+
+    // Wake the secondary cores, they wait for jobs from here on
+    uint32_t cores;
+    BOOT_STAGE("SMP", jobs_init(); cores = smp_init());
+    k_printf("  [OK] SMP (%d of %d cores online)\r\n", cores, CORES);
     
     // Initialize power management
-    power_init();
+    BOOT_STAGE("Power management", power_init());
     k_printf("  [OK] Power management\r\n");
     
     // Initialize audio system
-    audio_init();
+    BOOT_STAGE("Audio system", audio_init());
     k_printf("  [OK] Audio system\r\n");
     
     // Initialize system call interface
-    syscall_init();
-    k_printf("  [OK] System call interface\r\n");
+    uint32_t trap_cycles;
+    BOOT_STAGE("System call interface", syscall_init(); trap_cycles = syscall_measure_trap(1000));
+    k_printf("  [OK] System call interface (%d cycles per trap)\r\n", trap_cycles);
+
+    // Allocate the framebuffer, the draw system calls render into its back
+    // buffer. The matrix rain, then the console, show the boot until a ROM
+    // presents a frame.
+    bool fb, console = false;
+    BOOT_STAGE("Framebuffer", fb = fb_init(FB_WIDTH, FB_HEIGHT, FB_DEPTH, FB_BUFFERS));
+    if (fb) {
+        fb_info_t *frame = fb_begin_frame();
+        BOOT_STAGE("Console", console = fbcon_init());
+        if (console)
+            k_set_output(K_OUTPUT_UART | K_OUTPUT_FB);
+        k_printf("  [OK] Framebuffer (%dx%dx%d)\r\n", frame->width, frame->height, frame->depth);
+        k_printf("  [%s] Console\r\n", k_get_output() & K_OUTPUT_FB ? "OK" : "--");
+
+        // The matrix rain runs from the timer interrupt while the boot goes on
+        bool matrix;
+        BOOT_STAGE("Matrix display", matrix_display_init(); matrix = matrix_display_start(3000));
+        k_printf("  [%s] Matrix display\r\n", matrix ? "OK" : "--");
+        mailbox_batch_wait(&clocks);
+        fb_dump_frame_stats(arm_clock[1]);
+        BOOT_STAGE("Draw benchmark", draw_benchmark(arm_clock[1]));
+    } else {
+        k_printf("  [--] No framebuffer\r\n");
+    }
 
     // Display boot sequence
     k_printf("\r\n");
     k_printf("Starting boot sequence...\r\n");
     k_printf("\r\n");
 
-    // Run matrix display animation (simplified for UART)
-    matrix_display_init();
-    k_printf("Matrix display initialization...\r\n");
-    // matrix_display_run(3000); // 3 seconds - commented out for faster boot
-    
     // Play boot audio sequence (stub for now)
     // audio_boot_sequence(); // Commented out until PWM audio is implemented
     
     // Display boot messages
-    boot_messages_display();
+    BOOT_STAGE("Boot messages", boot_messages_display());
     
     k_printf("\r\n");
     k_printf("**************************************************\r\n");
@@ -68,9 +155,13 @@ void kernel_main(uint32_t r0, uint32_t r1, uint32_t atags)
 
     // Check for holotape
     k_printf("Checking for holotape...\r\n");
-    if (holotape_detect()) {
+    bool holotape;
+    BOOT_STAGE("Holotape detection", holotape = holotape_detect());
+    if (holotape) {
         k_printf("  Holotape detected!\r\n");
-        if (holotape_load()) {
+        bool loaded;
+        BOOT_STAGE("Holotape load", loaded = holotape_load());
+        if (loaded) {
             k_printf("  Holotape loaded successfully\r\n");
             // Execution would transfer to holotape
         }
@@ -82,9 +173,13 @@ void kernel_main(uint32_t r0, uint32_t r1, uint32_t atags)
 
     // Check for ROM
     k_printf("Checking for ROM...\r\n");
-    if (rom_detect()) {
+    bool rom;
+    BOOT_STAGE("ROM detection", rom = rom_detect());
+    if (rom) {
         k_printf("  ROM detected!\r\n");
-        if (rom_load()) {
+        bool loaded;
+        BOOT_STAGE("ROM load", loaded = rom_load());
+        if (loaded) {
             k_printf("  ROM loaded successfully\r\n");
             // Execution would transfer to ROM
         }
@@ -100,12 +195,57 @@ void kernel_main(uint32_t r0, uint32_t r1, uint32_t atags)
     k_printf("\r\n");
 
     // System information
+    k_printf("Boot time (%s):\r\n", clock_name());
+    boot_stage_report();
+    k_printf("\r\n");
+
+    mailbox_batch_wait(&clocks);
+    const mailbox_board_t *board = mailbox_board();
+
     k_printf("Hardware Information:\r\n");
-    k_printf("  Core clock : %d Hz\r\n", mailbox_get_id(MAILBOX_TAG_GET_CLOCK_RATE, MAIL_CLOCK_CORE));
-    k_printf("  ARM  clock : %d Hz\r\n", mailbox_get_id(MAILBOX_TAG_GET_CLOCK_RATE, MAIL_CLOCK_ARM));
-    k_printf("  Board model: %d\r\n", mailbox_get(MAILBOX_TAG_GET_BOARD_MODEL));
-    k_printf("  Board rev  : %d\r\n", mailbox_get(MAILBOX_TAG_GET_BOARD_REVISION));
+    k_printf("  Core clock : %d Hz\r\n", core_clock[1]);
+    k_printf("  ARM  clock : %d Hz\r\n", arm_clock[1]);
+    if (board) {
+        k_printf("  Board model: %d\r\n", board->model);
+        k_printf("  Board rev  : %x\r\n", board->revision);
+        k_printf("  Serial     : %08x%08x\r\n", (uint32_t)(board->serial >> 32), (uint32_t)board->serial);
+        k_printf("  MAC        : %02x:%02x:%02x:%02x:%02x:%02x\r\n", board->mac[0], board->mac[1],
+                 board->mac[2], board->mac[3], board->mac[4], board->mac[5]);
+        k_printf("  Firmware   : %x\r\n", board->firmware);
+    }
+    k_printf("\r\n");
+
+    k_printf("System call statistics:\r\n");
+    syscall_dump_stats();
+    k_printf("\r\n");
+
+    k_printf("Interrupt statistics:\r\n");
+    irq_dump_stats();
+    k_printf("\r\n");
+
+    k_printf("Mailbox statistics:\r\n");
+    mailbox_dump_stats();
+    k_printf("\r\n");
+
+    if (fb_begin_frame()) {
+        k_printf("Frame statistics:\r\n");
+        fb_dump_frame_stats(arm_clock[1]);
+        k_printf("\r\n");
+
+        k_printf("Glyph cache statistics:\r\n");
+        text_dump_stats();
+        k_printf("\r\n");
+
+        k_printf("Matrix display statistics:\r\n");
+        matrix_display_dump_stats();
+        k_printf("\r\n");
+    }
+
+#if LOCK_STATS
+    k_printf("Lock statistics:\r\n");
+    lock_dump_stats();
     k_printf("\r\n");
+#endif
 
     // Main loop - echo UART input
     k_printf("Entering main loop (UART echo mode)...\r\n");
@@ -1,11 +1,64 @@
 #if USE_MINI_UART
 #include "uart.h"
+#include "spinlock.h"
+#include "atomic.h"
+#include "interrupts.h"
+#include "ring.h"
+#include "mailbox.h"
 
 #include <stddef.h>
 #include <stdint.h>
 
 // More info on OSDev wiki : https://wiki.osdev.org/Raspberry_Pi_Bare_Bones
 
+// Line status register
+#define MU_LSR_DATA_READY	(1 << 0)
+#define MU_LSR_TX_EMPTY		(1 << 5)	// room for a byte
+
+// Interrupt enable register. RX and TX are swapped in the datasheet, and
+// bits 2-3 are needed for any interrupt to come.
+#define MU_IER_RX		(1 << 0)
+#define MU_IER_TX		(1 << 1)
+#define MU_IER_ON		(3 << 2)
+
+// Mini UART pending in AUX_IRQ
+#define AUX_IRQ_MU		(1 << 0)
+
+// Core clock when the firmware does not tell, the mini UART runs from it
+#define MU_CLOCK_DEFAULT	250000000
+
+// Keeps the transmit ring to one writer at a time
+static spinlock_t uart_lock = SPINLOCK_INIT("uart");
+
+static uint8_t uart_tx_data[UART_TX_RING];
+static uint8_t uart_rx_data[UART_RX_RING];
+static ring_t uart_tx, uart_rx;
+
+// The one reader of the transmit ring, a writer or the interrupt handler
+static atomic_t uart_tx_owner = ATOMIC_INIT(0);
+
+static volatile bool uart_irq_on;	// rings in use
+static volatile bool uart_polled;	// drained, no more rings
+static uint32_t uart_baud;
+
+// Divisor of the core clock for UART_BAUD : clock / (8 * (reg + 1)). The
+// core clock must not change afterwards (core_freq in config.txt).
+static void uart_set_divisor(void)
+{
+	uint32_t clock = mailbox_get_id(MAILBOX_TAG_GET_CLOCK_RATE, MAIL_CLOCK_CORE);
+	if (!clock)
+		clock = MU_CLOCK_DEFAULT;
+
+	uint32_t divisor = (clock + 4 * UART_BAUD) / (8 * UART_BAUD);
+	if (divisor < 1)
+		divisor = 1;
+	if (divisor > 0x10000)
+		divisor = 0x10000;
+
+	mmio_write(AUX_MU_BAUD_REG, divisor - 1);
+	uart_baud = clock / (8 * divisor);
+}
+
 void uart_init()
 {
 	uint32_t selector;
@@ -28,8 +81,8 @@ void uart_init()
 	// Disable interrupts
 	mmio_write(AUX_MU_IIR_REG, 0xc6);
 
-	//Set baud rate to 115200
-	mmio_write(AUX_MU_BAUD_REG, 270);
+	//Set baud rate from the core clock
+	uart_set_divisor();
 	
 	// Setup the GPIO pin 14 && 15.
 	selector = mmio_read(GPFSEL1);
@@ -52,36 +105,164 @@ void uart_init()
 	mmio_write(AUX_MU_CNTL_REG, 3);
 }
 
-void uart_putc(char byte)
+static void uart_send(char byte)
 {
 	// Wait for mini UART to become ready to transmit.
-	while(1) {
-		if(mmio_read(AUX_MU_LSR_REG) & 0x20) 
+	while (!(mmio_read(AUX_MU_LSR_REG) & MU_LSR_TX_EMPTY)) { }
+	mmio_write(AUX_MU_IO_REG, byte);
+}
+
+// Move bytes from the ring to the TX FIFO until one of them is full, and
+// leave the TX interrupt on if bytes are left. Only the owner calls it.
+static bool uart_tx_fill(void)
+{
+	const uint8_t *data;
+	uint32_t size;
+
+	while ((size = ring_peek(&uart_tx, &data)) != 0) {
+		uint32_t sent = 0;
+		while (sent < size && (mmio_read(AUX_MU_LSR_REG) & MU_LSR_TX_EMPTY))
+			mmio_write(AUX_MU_IO_REG, data[sent++]);
+		ring_consume(&uart_tx, sent);
+		if (sent < size)
 			break;
 	}
-	mmio_write(AUX_MU_IO_REG, byte);
+
+	bool more = !ring_empty(&uart_tx);
+	mmio_write(AUX_MU_IER_REG, MU_IER_ON | MU_IER_RX | (more ? MU_IER_TX : 0));
+	return more;
+}
+
+// Refill the TX FIFO unless someone else is at it
+static void uart_tx_kick(void)
+{
+	bool armed;
+
+	do {
+		if (atomic_xchg(&uart_tx_owner, 1))
+			return;
+		armed = uart_tx_fill();
+		dmb();
+		atomic_set(&uart_tx_owner, 0);
+		// Bytes queued by a writer that found the ring owned, after the
+		// fill saw it empty : nobody else will send them
+	} while (!armed && !ring_empty(&uart_tx));
+}
+
+static void uart_irq(void *arg)
+{
+	(void)arg;
+
+	// The SPI masters share the interrupt
+	if (!(mmio_read(AUX_IRQ) & AUX_IRQ_MU))
+		return;
+
+	// Dropped when the reader is behind
+	while (mmio_read(AUX_MU_LSR_REG) & MU_LSR_DATA_READY) {
+		uint8_t byte = mmio_read(AUX_MU_IO_REG);
+		ring_put(&uart_rx, &byte, 1);
+	}
+
+	// The TX interrupt stays up while the FIFO is empty, there is no
+	// threshold to refill at
+	uart_tx_kick();
+}
+
+void uart_irq_init()
+{
+	ring_init(&uart_tx, uart_tx_data, sizeof(uart_tx_data));
+	ring_init(&uart_rx, uart_rx_data, sizeof(uart_rx_data));
+
+	irq_register(IRQ_AUX, uart_irq, NULL);
+	mmio_write(AUX_MU_IER_REG, MU_IER_ON | MU_IER_RX);
+	irq_enable(IRQ_AUX);
+	uart_irq_on = true;
+}
+
+void uart_putc(char byte)
+{
+	uart_write(&byte, 1);
 }
 
 char uart_getc()
 {
-    // Wait for mini UART to have recieved something.
-    while(1) {
-		if(mmio_read(AUX_MU_LSR_REG) & 0x01) 
-			break;
+	if (uart_irq_on && !uart_polled) {
+		uint8_t byte;
+		while (!ring_get(&uart_rx, &byte, 1)) { }
+		return byte;
 	}
-    return (mmio_read(AUX_MU_IO_REG) & 0xFF);
+
+	// Wait for mini UART to have recieved something.
+	while (!(mmio_read(AUX_MU_LSR_REG) & MU_LSR_DATA_READY)) { }
+	return (mmio_read(AUX_MU_IO_REG) & 0xFF);
 }
 
 void uart_write(const char *buffer, size_t size)
 {
-	for (size_t i = 0; i < size; i++)
-		uart_putc(buffer[i]);
+	// No lock once drained, its holder may never release it
+	if (uart_polled) {
+		for (size_t i = 0; i < size; i++)
+			uart_send(buffer[i]);
+		return;
+	}
+
+	irq_flags_t flags = spin_lock_irqsave(&uart_lock);
+	if (!uart_irq_on) {
+		for (size_t i = 0; i < size; i++)
+			uart_send(buffer[i]);
+	} else {
+		// A full ring is sent by this writer as the FIFO empties,
+		// the interrupt handler may not run on this core
+		while (size) {
+			uint32_t queued = ring_put(&uart_tx, buffer, size);
+			buffer += queued;
+			size -= queued;
+			uart_tx_kick();
+		}
+	}
+	spin_unlock_irqrestore(&uart_lock, flags);
 }
 
 void uart_puts(const char *str)
 {
-    while (*str != 0)
-        uart_putc(*str++);
+	size_t size = 0;
+
+	while (str[size] != 0)
+		size++;
+	uart_write(str, size);
+}
+
+void uart_drain()
+{
+	const uint8_t *data;
+	uint32_t size;
+
+	uart_polled = true;
+	mmio_write(AUX_MU_IER_REG, 0);
+	if (!uart_irq_on)
+		return;
+
+	while ((size = ring_peek(&uart_tx, &data)) != 0) {
+		for (uint32_t i = 0; i < size; i++)
+			uart_send(data[i]);
+		ring_consume(&uart_tx, size);
+	}
+}
+
+size_t uart_tx_room()
+{
+	return uart_irq_on && !uart_polled ? ring_space(&uart_tx) : 0;
+}
+
+uint32_t uart_get_baud()
+{
+	return uart_baud;
+}
+
+// The mini UART has no DREQ
+bool uart_dma_enabled()
+{
+	return false;
 }
 
 #endif // USE_MINI_UART
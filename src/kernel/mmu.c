@@ -0,0 +1,398 @@
+#include "mmu.h"
+#include "cache.h"
+#include "io.h"
+
+// End of the kernel RAM region, provided by linker.ld
+extern char __ram_end[];
+
+#if __aarch64__
+
+/*
+ * 4KB granule, 32 bit virtual address space (T0SZ = 32), lookup starts at
+ * level 1. The first gigabyte goes through a level 2 table of 2MB blocks,
+ * the other three are 1GB blocks. Blocks mapped in part are split into a
+ * level 3 table of pages.
+ */
+
+#define DESC_VALID          (1UL << 0)
+#define DESC_BLOCK          (1UL << 0)
+#define DESC_TABLE          (3UL << 0)
+#define DESC_PAGE           (3UL << 0)
+#define DESC_TYPE_MASK      (3UL << 0)
+#define DESC_ADDR_MASK      0x0000FFFFFFFFF000UL
+#define DESC_ATTR(idx)      ((uint64_t)(idx) << 2)
+#define DESC_SH_INNER       (3UL << 8)
+#define DESC_AF             (1UL << 10)
+#define DESC_PXN            (1UL << 53)
+#define DESC_UXN            (1UL << 54)
+
+// MAIR_EL1 attribute indexes, must match mmu_attr_t
+#define MAIR_VALUE          ((0xFFUL << (8 * MMU_NORMAL)) |     /* Normal, WB RW-allocate */ \
+                             (0x44UL << (8 * MMU_NORMAL_NC)) |  /* Normal, non-cacheable */ \
+                             (0x00UL << (8 * MMU_DEVICE)))      /* Device-nGnRnE */
+
+#define TCR_T0SZ            (32UL << 0)
+#define TCR_IRGN0_WBWA      (1UL << 8)
+#define TCR_ORGN0_WBWA      (1UL << 10)
+#define TCR_SH0_INNER       (3UL << 12)
+#define TCR_TG0_4K          (0UL << 14)
+#define TCR_EPD1            (1UL << 23)
+#define TCR_IPS_4GB         (0UL << 32)
+
+#define SCTLR_M             (1UL << 0)
+#define SCTLR_A             (1UL << 1)
+#define SCTLR_C             (1UL << 2)
+#define SCTLR_I             (1UL << 12)
+
+#define L1_BLOCK_SIZE       0x40000000UL
+
+static uint64_t mmu_l1_table[512] __attribute__((aligned(4096)));
+static uint64_t mmu_l2_table[512] __attribute__((aligned(4096)));
+static uint64_t mmu_l3_tables[MMU_PAGE_TABLES][512] __attribute__((aligned(4096)));
+static uint32_t mmu_l3_used;
+
+static uint64_t mmu_block_attr(mmu_attr_t attr)
+{
+    switch (attr) {
+        case MMU_NORMAL:
+            return DESC_AF | DESC_SH_INNER | DESC_ATTR(MMU_NORMAL);
+        case MMU_NORMAL_NC:
+            return DESC_AF | DESC_SH_INNER | DESC_ATTR(MMU_NORMAL_NC);
+        case MMU_DEVICE:
+        default:
+            return DESC_AF | DESC_ATTR(MMU_DEVICE) | DESC_PXN | DESC_UXN;
+    }
+}
+
+// Write <value> to the descriptor of <va>. A live valid descriptor is
+// broken first: invalid, its TLB entries gone on every core, then the
+// new one.
+static void mmu_set_desc(uint64_t *desc, uint64_t value, uintptr_t va, bool live)
+{
+    if (*desc == value)
+        return;
+    if (live && (*desc & DESC_VALID)) {
+        *desc = 0;
+        dsb();
+        __asm__ volatile("tlbi vaae1is, %0" :: "r"(va >> 12) : "memory");
+        dsb();
+    }
+    *desc = value;
+}
+
+// The level 3 table of the 2MB block of <addr>, split out of the block
+// with its attributes. NULL once the tables are all used.
+static uint64_t *mmu_page_table(uintptr_t addr, bool live)
+{
+    uint64_t *desc = &mmu_l2_table[addr / MMU_BLOCK_SIZE];
+
+    if ((*desc & DESC_TYPE_MASK) == DESC_TABLE)
+        return (uint64_t *)(uintptr_t)(*desc & DESC_ADDR_MASK);
+    if (mmu_l3_used == MMU_PAGE_TABLES)
+        return NULL;
+
+    uint64_t *table = mmu_l3_tables[mmu_l3_used++];
+    for (uint32_t i = 0; i < 512; i++)
+        table[i] = (*desc & DESC_VALID) ? ((*desc & ~DESC_TYPE_MASK) | DESC_PAGE) + i * MMU_PAGE_SIZE : 0;
+    dsb();
+    mmu_set_desc(desc, (uintptr_t)table | DESC_TABLE, addr, live);
+    return table;
+}
+
+void mmu_map_region(uintptr_t base, size_t size, mmu_attr_t attr)
+{
+    uint64_t bits = mmu_block_attr(attr);
+    uintptr_t addr = base & ~(uintptr_t)(MMU_PAGE_SIZE - 1);
+    uintptr_t end = base + size;
+    bool live = mmu_enabled();
+
+    while (addr < end && addr < 4 * L1_BLOCK_SIZE) {
+        if (addr >= L1_BLOCK_SIZE) {
+            addr &= ~(L1_BLOCK_SIZE - 1);
+            mmu_set_desc(&mmu_l1_table[addr / L1_BLOCK_SIZE], addr | bits | DESC_BLOCK, addr, live);
+            addr += L1_BLOCK_SIZE;
+            continue;
+        }
+
+        uint64_t *desc = &mmu_l2_table[addr / MMU_BLOCK_SIZE];
+        uintptr_t next = (addr | (MMU_BLOCK_SIZE - 1)) + 1;
+        uint64_t *pages = NULL;
+
+        // A block, unless mapped in part or already split
+        if ((addr & (MMU_BLOCK_SIZE - 1)) || end < next || (*desc & DESC_TYPE_MASK) == DESC_TABLE)
+            pages = mmu_page_table(addr, live);
+        if (!pages) {
+            addr &= ~(uintptr_t)(MMU_BLOCK_SIZE - 1);
+            mmu_set_desc(desc, addr | bits | DESC_BLOCK, addr, live);
+        } else {
+            for (; addr < end && addr < next; addr += MMU_PAGE_SIZE)
+                mmu_set_desc(&pages[(addr & (MMU_BLOCK_SIZE - 1)) / MMU_PAGE_SIZE],
+                             addr | bits | DESC_PAGE, addr, live);
+        }
+        addr = next;
+    }
+
+    if (live) {
+        dsb();
+        isb();
+    }
+}
+
+bool mmu_enabled(void)
+{
+    uint64_t sctlr;
+    __asm__ volatile("mrs %0, sctlr_el1" : "=r"(sctlr));
+    return sctlr & SCTLR_M;
+}
+
+static void mmu_enable(void)
+{
+    uint64_t sctlr;
+
+    __asm__ volatile("msr mair_el1, %0" :: "r"(MAIR_VALUE));
+    __asm__ volatile("msr tcr_el1, %0" :: "r"(TCR_T0SZ | TCR_IRGN0_WBWA | TCR_ORGN0_WBWA |
+                                              TCR_SH0_INNER | TCR_TG0_4K | TCR_EPD1 | TCR_IPS_4GB));
+    __asm__ volatile("msr ttbr0_el1, %0" :: "r"((uintptr_t)mmu_l1_table));
+    __asm__ volatile("tlbi vmalle1" ::: "memory");
+    dsb();
+    isb();
+
+    __asm__ volatile("mrs %0, sctlr_el1" : "=r"(sctlr));
+    sctlr |= SCTLR_M | SCTLR_C | SCTLR_I;
+    sctlr &= ~SCTLR_A;
+    __asm__ volatile("msr sctlr_el1, %0" :: "r"(sctlr) : "memory");
+    isb();
+}
+
+#else // __aarch32__
+
+/*
+ * Short-descriptor format, 1MB sections, domain 0 only. Sections mapped in
+ * part are split into a coarse table of 4KB small pages.
+ */
+
+#define SECT_SECTION        (2 << 0)
+#define SECT_B              (1 << 2)
+#define SECT_C              (1 << 3)
+#define SECT_XN             (1 << 4)
+#define SECT_AP_RW          (3 << 10)
+#define SECT_TEX(n)         ((n) << 12)
+#define SECT_S              (1 << 16)
+#define SECT_TYPE_MASK      (3 << 0)
+#define SECT_COARSE         (1 << 0)    // second level table, domain 0
+
+// Small page descriptors of ARMv7, and ARMv6 with SCTLR.XP set. B and C
+// are where they are in a section.
+#define PAGE_XN             (1 << 0)
+#define PAGE_SMALL          (2 << 0)
+#define PAGE_AP_RW          (3 << 4)
+#define PAGE_TEX(n)         ((n) << 6)
+#define PAGE_S              (1 << 10)
+
+// ARM1176 treats shareable normal memory as non-cacheable, only mark
+// memory as shareable on the multi-core parts
+#if BCM2835
+    #define SECT_SHARED     0
+#else
+    #define SECT_SHARED     SECT_S
+#endif
+
+#define SCTLR_M             (1 << 0)
+#define SCTLR_A             (1 << 1)
+#define SCTLR_C             (1 << 2)
+#define SCTLR_Z             (1 << 11)
+#define SCTLR_I             (1 << 12)
+#define SCTLR_U             (1 << 22)
+#define SCTLR_XP            (1 << 23)
+
+#define ACTLR_SMP           (1 << 6)
+
+#define DACR_ALL_CLIENT     0x55555555
+
+static uint32_t mmu_l1_table[4096] __attribute__((aligned(16384)));
+static uint32_t mmu_l2_tables[MMU_PAGE_TABLES][256] __attribute__((aligned(1024)));
+static uint32_t mmu_l2_used;
+
+static uint32_t mmu_section_attr(mmu_attr_t attr)
+{
+    switch (attr) {
+        case MMU_NORMAL:
+            return SECT_AP_RW | SECT_TEX(1) | SECT_C | SECT_B | SECT_SHARED;
+        case MMU_NORMAL_NC:
+            return SECT_AP_RW | SECT_TEX(1) | SECT_SHARED;
+        case MMU_DEVICE:
+        default:
+            return SECT_AP_RW | SECT_B | SECT_XN;   // shareable device
+    }
+}
+
+// The small page bits of a section
+static uint32_t mmu_page_attr(uint32_t section)
+{
+    uint32_t bits = section & (SECT_B | SECT_C);
+
+    bits |= (section & SECT_XN) ? PAGE_XN : 0;
+    bits |= (section & SECT_AP_RW) == SECT_AP_RW ? PAGE_AP_RW : 0;
+    bits |= PAGE_TEX((section >> 12) & 7);
+    bits |= (section & SECT_S) ? PAGE_S : 0;
+    return bits;
+}
+
+// Write <value> to the descriptor of <va>. The table walk does not look
+// in the data cache : the line is cleaned. A live valid descriptor is
+// broken first, invalid and its TLB entries gone, then the new one.
+static void mmu_set_desc(uint32_t *desc, uint32_t value, uintptr_t va, bool live)
+{
+    if (*desc == value)
+        return;
+    if (live && (*desc & SECT_TYPE_MASK)) {
+        *desc = 0;
+        dcache_clean_range(desc, sizeof(*desc));
+        dsb();
+#if BCM2835
+        __asm__ volatile("mcr p15, 0, %0, c8, c7, 1" :: "r"(va & ~0xFFFu) : "memory");  // TLBIMVA
+#else
+        __asm__ volatile("mcr p15, 0, %0, c8, c3, 3" :: "r"(va & ~0xFFFu) : "memory");  // TLBIMVAAIS
+#endif
+        dsb();
+    }
+    *desc = value;
+    if (live)
+        dcache_clean_range(desc, sizeof(*desc));
+}
+
+// The coarse table of the 1MB section of <addr>, split out of the section
+// with its attributes. NULL once the tables are all used.
+static uint32_t *mmu_page_table(uintptr_t addr, bool live)
+{
+    uint32_t *desc = &mmu_l1_table[addr / MMU_BLOCK_SIZE];
+
+    if ((*desc & SECT_TYPE_MASK) == SECT_COARSE)
+        return (uint32_t *)(uintptr_t)(*desc & ~0x3FFu);
+    if (mmu_l2_used == MMU_PAGE_TABLES)
+        return NULL;
+
+    uint32_t *table = mmu_l2_tables[mmu_l2_used++];
+    uint32_t bits = mmu_page_attr(*desc) | PAGE_SMALL;
+    for (uint32_t i = 0; i < 256; i++)
+        table[i] = (*desc & SECT_TYPE_MASK) ? ((*desc & ~(MMU_BLOCK_SIZE - 1)) + i * MMU_PAGE_SIZE) | bits : 0;
+    if (live)
+        dcache_clean_range(table, sizeof(mmu_l2_tables[0]));
+    dsb();
+    mmu_set_desc(desc, (uintptr_t)table | SECT_COARSE, addr, live);
+    return table;
+}
+
+void mmu_map_region(uintptr_t base, size_t size, mmu_attr_t attr)
+{
+    uint32_t bits = mmu_section_attr(attr);
+    uintptr_t addr = base & ~(uintptr_t)(MMU_PAGE_SIZE - 1);
+    uintptr_t last = base + (size - 1);
+    bool live = mmu_enabled();
+
+    if (size == 0)
+        return;
+    // Clamp ranges wrapping past the top of the address space
+    if (last < base)
+        last = UINTPTR_MAX;
+
+    for (;;) {
+        uint32_t *desc = &mmu_l1_table[addr / MMU_BLOCK_SIZE];
+        uintptr_t block_last = addr | (MMU_BLOCK_SIZE - 1);
+        uint32_t *pages = NULL;
+
+        // A section, unless mapped in part or already split
+        if ((addr & (MMU_BLOCK_SIZE - 1)) || last < block_last ||
+            (*desc & SECT_TYPE_MASK) == SECT_COARSE)
+            pages = mmu_page_table(addr, live);
+        if (!pages) {
+            addr &= ~(uintptr_t)(MMU_BLOCK_SIZE - 1);
+            mmu_set_desc(desc, addr | bits | SECT_SECTION, addr, live);
+        } else {
+            // By index, the last page of the address space has no end
+            uintptr_t section = addr & ~(uintptr_t)(MMU_BLOCK_SIZE - 1);
+            uint32_t page_bits = mmu_page_attr(bits) | PAGE_SMALL;
+            uint32_t stop = ((last < block_last ? last : block_last) - section) / MMU_PAGE_SIZE;
+            for (uint32_t i = (addr - section) / MMU_PAGE_SIZE; i <= stop; i++)
+                mmu_set_desc(&pages[i], (section + i * MMU_PAGE_SIZE) | page_bits,
+                             section + i * MMU_PAGE_SIZE, live);
+        }
+        if (block_last >= last)
+            break;
+        addr = block_last + 1;
+    }
+
+    if (live) {
+        __asm__ volatile("mcr p15, 0, %0, c7, c5, 6" :: "r"(0) : "memory");   // BPIALL
+        dsb();
+        isb();
+    }
+}
+
+bool mmu_enabled(void)
+{
+    uint32_t sctlr;
+    __asm__ volatile("mrc p15, 0, %0, c1, c0, 0" : "=r"(sctlr));
+    return sctlr & SCTLR_M;
+}
+
+static void mmu_enable(void)
+{
+    uint32_t reg;
+
+#if !BCM2835
+    // Join the coherency domain before the caches are turned on
+    __asm__ volatile("mrc p15, 0, %0, c1, c0, 1" : "=r"(reg));
+    reg |= ACTLR_SMP;
+    __asm__ volatile("mcr p15, 0, %0, c1, c0, 1" :: "r"(reg));
+#endif
+
+    __asm__ volatile("mcr p15, 0, %0, c2, c0, 2" :: "r"(0));                       // TTBCR: TTBR0 only
+    __asm__ volatile("mcr p15, 0, %0, c2, c0, 0" :: "r"((uint32_t)mmu_l1_table));  // TTBR0
+    __asm__ volatile("mcr p15, 0, %0, c3, c0, 0" :: "r"(DACR_ALL_CLIENT));         // DACR
+    __asm__ volatile("mcr p15, 0, %0, c8, c7, 0" :: "r"(0) : "memory");            // TLBIALL
+    dsb();
+    isb();
+
+    __asm__ volatile("mrc p15, 0, %0, c1, c0, 0" : "=r"(reg));
+    reg |= SCTLR_M | SCTLR_C | SCTLR_Z | SCTLR_I;
+    reg &= ~SCTLR_A;
+#if BCM2835
+    // ARMv6 extended page tables and unaligned access support
+    reg |= SCTLR_XP | SCTLR_U;
+#endif
+    __asm__ volatile("mcr p15, 0, %0, c1, c0, 0" :: "r"(reg) : "memory");
+    isb();
+}
+
+#endif // __aarch64__
+
+void mmu_init(void)
+{
+    uintptr_t ram_end = (uintptr_t)__ram_end;
+
+    // Caches hold garbage out of reset
+    dcache_invalidate_all();
+    icache_invalidate_all();
+
+#if __aarch64__
+    mmu_l1_table[0] = (uintptr_t)mmu_l2_table | DESC_TABLE;
+#endif
+    mmu_map_region(0, ram_end, MMU_NORMAL);
+    mmu_map_region(ram_end, PERIPHERAL_BASE - ram_end, MMU_NORMAL_NC);
+    mmu_map_region(PERIPHERAL_BASE, PERIPHERAL_SIZE, MMU_DEVICE);
+#if BCM2836 || BCM2837
+    mmu_map_region(LOCAL_PERIPHERAL_BASE, LOCAL_PERIPHERAL_SIZE, MMU_DEVICE);
+#endif
+
+    mmu_enable();
+}
+
+void mmu_init_secondary(void)
+{
+    // Only the local L1 caches are invalidated, L2 is shared with core 0
+    dcache_invalidate_all();
+    icache_invalidate_all();
+
+    mmu_enable();
+}
@@ -0,0 +1,55 @@
+#ifndef MMU_H
+#define MMU_H
+
+/*
+ * MMU bring-up
+ *
+ * The whole address space is identity mapped :
+ *  - kernel RAM (linker.ld RAM region) as normal write-back cacheable memory
+ *  - the rest of the memory below the peripherals (VideoCore memory,
+ *    framebuffer) as normal non-cacheable memory
+ *  - PERIPHERAL_BASE and the ARM local peripherals as device memory
+ *
+ * aarch32 uses 1MB short-descriptor sections, aarch64 uses 2MB blocks
+ * (1GB blocks above the first gigabyte). A block mapped in part is split
+ * into 4KB pages, which keep the attributes of the rest of the block.
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    MMU_NORMAL = 0,         // Normal memory, write-back write-allocate cacheable
+    MMU_NORMAL_NC = 1,      // Normal memory, non-cacheable
+    MMU_DEVICE = 2,         // Device memory, never executable
+} mmu_attr_t;
+
+#if __aarch64__
+    #define MMU_BLOCK_SIZE      0x200000
+#else
+    #define MMU_BLOCK_SIZE      0x100000
+#endif
+#define MMU_PAGE_SIZE           0x1000
+#define MMU_PAGE_TABLES         4       // blocks that can be split into pages
+
+// Build the page tables, enable the caches, branch prediction and the MMU.
+// Called from boot.S once the BSS is cleared, before kernel_main.
+void mmu_init(void);
+
+// Turn on the MMU and caches of a secondary core with the tables built
+// by mmu_init. Called from boot.S before smp_secondary_main.
+void mmu_init_secondary(void);
+
+// (Re)map [base, base + size) with the given attributes, rounded out to
+// MMU_PAGE_SIZE: blocks where they fit, pages at the partial ends. Once
+// the MMU_PAGE_TABLES are used (and above 1GB on aarch64) the ends are
+// rounded out to the block. Safe to call with the MMU running: changed
+// descriptors go through break-before-make, so the range must not hold
+// the running code or its stack.
+void mmu_map_region(uintptr_t base, size_t size, mmu_attr_t attr);
+
+bool mmu_enabled(void);
+
+#endif // MMU_H
@@ -0,0 +1,279 @@
+#include "pmm.h"
+#include "atags.h"
+#include "dtb.h"
+#include "mailbox.h"
+#include "mmu.h"
+#include "io.h"
+#include "spinlock.h"
+
+#include <stdbool.h>
+
+// Provided by linker.ld
+extern char _start[];
+extern char __bss_end[];
+extern char __stack0_start[];
+extern char __stack3_end[];
+extern char _end[];
+
+#define PMM_MAX_RESERVED    8
+
+// page_info[] flag, the low bits hold the order of the block
+#define PAGE_FREE           0x80
+
+typedef struct pmm_block {
+    struct pmm_block *next;
+    struct pmm_block *prev;
+} pmm_block_t;
+
+typedef struct {
+    uintptr_t start;
+    uintptr_t end;
+} pmm_range_t;
+
+static uintptr_t ram_start;
+static uintptr_t ram_end;
+static uint32_t page_count;
+static uint8_t *page_info;          // one byte per page, lives in RAM after the kernel
+
+// Free lists and counters, protected by pmm_lock
+static spinlock_t pmm_lock = SPINLOCK_INIT("pmm");
+static pmm_block_t *free_lists[PMM_MAX_ORDER + 1];
+static uint32_t free_blocks[PMM_MAX_ORDER + 1];
+static uint32_t total_pages;
+static uint32_t free_pages;
+
+static pmm_range_t reserved[PMM_MAX_RESERVED];
+static uint32_t reserved_count;
+
+static void pmm_reserve(uintptr_t start, uintptr_t end)
+{
+    if (reserved_count < PMM_MAX_RESERVED && end > start) {
+        reserved[reserved_count].start = start & ~(uintptr_t)(PAGE_SIZE - 1);
+        reserved[reserved_count].end = (end + PAGE_SIZE - 1) & ~(uintptr_t)(PAGE_SIZE - 1);
+        reserved_count++;
+    }
+}
+
+static bool pmm_is_reserved(uintptr_t start, uintptr_t end)
+{
+    for (uint32_t i = 0; i < reserved_count; i++) {
+        if (start < reserved[i].end && end > reserved[i].start)
+            return true;
+    }
+    return false;
+}
+
+// End of the reserved range holding <addr>
+static uintptr_t pmm_reserved_end(uintptr_t addr)
+{
+    for (uint32_t i = 0; i < reserved_count; i++) {
+        if (addr >= reserved[i].start && addr < reserved[i].end)
+            return reserved[i].end;
+    }
+    return addr + PAGE_SIZE;
+}
+
+// Find the ARM usable memory, in order : device tree, ATAGS, mailbox
+static void pmm_discover(uintptr_t boot_params)
+{
+    const void *params = (const void *)boot_params;
+    const mailbox_board_t *board = mailbox_board();
+
+    // Only trust pointers into RAM
+    if (boot_params >= PERIPHERAL_BASE)
+        params = NULL;
+
+    if (dtb_valid(params)) {
+        uint64_t start64, size64;
+        if (dtb_get_mem(params, &start64, &size64) == 0) {
+            ram_start = (uintptr_t)start64;
+            ram_end = (uintptr_t)(start64 + size64);
+        }
+        pmm_reserve(boot_params, boot_params + dtb_size(params));
+    }
+#if !__aarch64__
+    else if (params != NULL && ((atag_t *)params)->header.tag == ATAG_CORE) {
+        atag_mem_t mem;
+        if (get_mem((atag_t *)params, &mem) == 0) {
+            ram_start = mem.start;
+            ram_end = mem.start + mem.size;
+        }
+    }
+#endif
+
+    if (ram_end <= ram_start && board && board->arm_size) {
+        ram_start = board->arm_base;
+        ram_end = (uintptr_t)board->arm_base + board->arm_size;
+    }
+
+    // Never hand out anything past the peripherals
+    if (ram_end > PERIPHERAL_BASE)
+        ram_end = PERIPHERAL_BASE;
+
+    // Memory shared with the GPU belongs to the VideoCore
+    if (board && board->vc_size)
+        pmm_reserve(board->vc_base, (uintptr_t)board->vc_base + board->vc_size);
+}
+
+static void list_push(uint32_t order, uintptr_t addr)
+{
+    pmm_block_t *block = (pmm_block_t *)addr;
+
+    block->prev = NULL;
+    block->next = free_lists[order];
+    if (block->next)
+        block->next->prev = block;
+    free_lists[order] = block;
+    free_blocks[order]++;
+
+    page_info[(addr - ram_start) >> PAGE_SHIFT] = PAGE_FREE | order;
+}
+
+static void list_remove(uint32_t order, pmm_block_t *block)
+{
+    if (block->prev)
+        block->prev->next = block->next;
+    else
+        free_lists[order] = block->next;
+    if (block->next)
+        block->next->prev = block->prev;
+    free_blocks[order]--;
+
+    page_info[((uintptr_t)block - ram_start) >> PAGE_SHIFT] = 0;
+}
+
+void pmm_init(uintptr_t boot_params)
+{
+    uintptr_t addr;
+
+    // Everything up to the end of the last core stack : exception vectors,
+    // ATAGS, boot stack, kernel image and BSS
+    pmm_reserve(0, (uintptr_t)_start);
+    pmm_reserve((uintptr_t)_start, (uintptr_t)__bss_end);
+    pmm_reserve((uintptr_t)__stack0_start, (uintptr_t)__stack3_end);
+
+    pmm_discover(boot_params);
+
+    ram_start = (ram_start + PAGE_SIZE - 1) & ~(uintptr_t)(PAGE_SIZE - 1);
+    ram_end &= ~(uintptr_t)(PAGE_SIZE - 1);
+    if (ram_end <= ram_start)
+        return;
+
+    // RAM found past the linker region gets the same cacheable mapping
+    mmu_map_region(ram_start, ram_end - ram_start, MMU_NORMAL);
+
+    // Page metadata sits right after the kernel
+    page_count = (ram_end - ram_start) >> PAGE_SHIFT;
+    page_info = (uint8_t *)(((uintptr_t)_end + PAGE_SIZE - 1) & ~(uintptr_t)(PAGE_SIZE - 1));
+    for (uint32_t i = 0; i < page_count; i++)
+        page_info[i] = 0;
+    pmm_reserve((uintptr_t)page_info, (uintptr_t)page_info + page_count);
+
+    // Hand out every free page in the largest aligned blocks possible
+    addr = ram_start;
+    while (addr < ram_end) {
+        uint32_t order = PMM_MAX_ORDER;
+
+        while (order > 0) {
+            uintptr_t block = (uintptr_t)PAGE_SIZE << order;
+            if (((addr - ram_start) & (block - 1)) == 0 && addr + block <= ram_end &&
+                !pmm_is_reserved(addr, addr + block))
+                break;
+            order--;
+        }
+
+        if (order == 0 && pmm_is_reserved(addr, addr + PAGE_SIZE)) {
+            addr = pmm_reserved_end(addr);
+            continue;
+        }
+
+        list_push(order, addr);
+        total_pages += 1 << order;
+        free_pages += 1 << order;
+        addr += (uintptr_t)PAGE_SIZE << order;
+    }
+}
+
+void *pmm_alloc_pages(uint32_t order)
+{
+    uint32_t current = order;
+    pmm_block_t *block;
+    irq_flags_t flags;
+
+    if (order > PMM_MAX_ORDER)
+        return NULL;
+
+    flags = spin_lock_irqsave(&pmm_lock);
+    while (current <= PMM_MAX_ORDER && free_lists[current] == NULL)
+        current++;
+    if (current > PMM_MAX_ORDER) {
+        spin_unlock_irqrestore(&pmm_lock, flags);
+        return NULL;
+    }
+
+    block = free_lists[current];
+    list_remove(current, block);
+
+    // Split down to the requested size, giving back the upper halves
+    while (current > order) {
+        current--;
+        list_push(current, (uintptr_t)block + ((uintptr_t)PAGE_SIZE << current));
+    }
+
+    page_info[((uintptr_t)block - ram_start) >> PAGE_SHIFT] = order;
+    free_pages -= 1 << order;
+    spin_unlock_irqrestore(&pmm_lock, flags);
+    return block;
+}
+
+void pmm_free_pages(void *addr, uint32_t order)
+{
+    uint32_t index = ((uintptr_t)addr - ram_start) >> PAGE_SHIFT;
+    irq_flags_t flags;
+
+    if (addr == NULL || index >= page_count || order > PMM_MAX_ORDER)
+        return;
+
+    flags = spin_lock_irqsave(&pmm_lock);
+    free_pages += 1 << order;
+
+    // Merge with the buddy as long as it is a free block of the same order
+    while (order < PMM_MAX_ORDER) {
+        uint32_t buddy = index ^ (1 << order);
+        if (buddy >= page_count || page_info[buddy] != (PAGE_FREE | order))
+            break;
+        list_remove(order, (pmm_block_t *)(ram_start + ((uintptr_t)buddy << PAGE_SHIFT)));
+        index &= ~(1 << order);
+        order++;
+    }
+
+    list_push(order, ram_start + ((uintptr_t)index << PAGE_SHIFT));
+    spin_unlock_irqrestore(&pmm_lock, flags);
+}
+
+void *pmm_block_base(const void *addr, uint32_t order)
+{
+    uintptr_t mask = ((uintptr_t)PAGE_SIZE << order) - 1;
+    return (void *)(ram_start + (((uintptr_t)addr - ram_start) & ~mask));
+}
+
+uint32_t pmm_order_for(size_t size)
+{
+    uint32_t order = 0;
+    while (((size_t)PAGE_SIZE << order) < size)
+        order++;
+    return order;
+}
+
+void pmm_get_stats(pmm_stats_t *stats)
+{
+    irq_flags_t flags = spin_lock_irqsave(&pmm_lock);
+
+    stats->ram_start = ram_start;
+    stats->ram_end = ram_end;
+    stats->total_pages = total_pages;
+    stats->free_pages = free_pages;
+    for (uint32_t i = 0; i <= PMM_MAX_ORDER; i++)
+        stats->free_blocks[i] = free_blocks[i];
+    spin_unlock_irqrestore(&pmm_lock, flags);
+}
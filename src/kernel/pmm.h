@@ -0,0 +1,48 @@
+#ifndef PMM_H
+#define PMM_H
+
+/*
+ * Physical page-frame allocator
+ *
+ * Usable RAM is discovered from the ATAGS or the device tree handed over by
+ * the firmware (falling back to the ARM memory mailbox property), minus the
+ * kernel image, the per-core stacks and the VideoCore-owned memory.
+ * Pages are handed out by a binary buddy allocator : blocks of 2^order pages,
+ * allocation and release are O(log n). The free lists are shared by every
+ * core under an IRQ-safe lock, pages can be allocated and released from
+ * interrupt handlers.
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define PAGE_SHIFT          12
+#define PAGE_SIZE           (1 << PAGE_SHIFT)
+#define PMM_MAX_ORDER       10      // largest block is 4MB
+
+typedef struct {
+    uintptr_t ram_start;            // first byte of the managed RAM
+    uintptr_t ram_end;              // first byte after the managed RAM
+    uint32_t total_pages;           // pages available to the allocator
+    uint32_t free_pages;            // pages currently free
+    uint32_t free_blocks[PMM_MAX_ORDER + 1];    // free blocks per order
+} pmm_stats_t;
+
+// Discover memory and seed the allocator. <boot_params> is the ATAGS or DTB
+// address passed by the firmware (0 if unknown).
+void pmm_init(uintptr_t boot_params);
+
+// Allocate 2^order physically contiguous pages, NULL if none
+void *pmm_alloc_pages(uint32_t order);
+void pmm_free_pages(void *addr, uint32_t order);
+
+// Start of the 2^order block holding <addr>
+void *pmm_block_base(const void *addr, uint32_t order);
+
+// Smallest order holding <size> bytes
+uint32_t pmm_order_for(size_t size);
+
+void pmm_get_stats(pmm_stats_t *stats);
+
+#endif // PMM_H
@@ -1,8 +1,11 @@
 #include "power.h"
 #include <stddef.h>
 #include <stdbool.h>
+#include "spinlock.h"
+#include "cpu.h"
 
 static power_mode_t current_mode = POWER_MODE_ACTIVE;
+static spinlock_t power_lock = SPINLOCK_INIT("power");
 
 void power_init(void) {
     // Initialize power management
@@ -33,6 +36,7 @@ bool power_is_battery_low(void) {
 }
 
 void power_set_mode(power_mode_t mode) {
+    irq_flags_t flags = spin_lock_irqsave(&power_lock);
     current_mode = mode;
     
     switch (mode) {
@@ -49,6 +53,7 @@ void power_set_mode(power_mode_t mode) {
             // Minimal power, RTC only
             break;
     }
+    spin_unlock_irqrestore(&power_lock, flags);
 }
 
 power_mode_t power_get_mode(void) {
@@ -59,14 +64,5 @@ void power_enter_sleep(void) {
     power_set_mode(POWER_MODE_SLEEP);
     
     // Wait for interrupt (WFI)
-    // ARMv6 (BCM2835) doesn't support WFI, use busy wait instead
-#ifdef BCM2835
-    // For ARMv6, just loop (WFI not supported)
-    while (power_get_mode() == POWER_MODE_SLEEP) {
-        // Busy wait until mode changes
-    }
-#else
-    // For ARMv7+ use WFI instruction
-    __asm__ volatile("wfi");
-#endif
+    cpu_wfi();
 }
@@ -0,0 +1,376 @@
+#include "raster.h"
+#include "k_libc/k_string.h"
+#include <stddef.h>
+
+// Bus address alias bits of the framebuffer pointer, see mailbox.h
+#define RASTER_BUS_MASK         0x40000000
+
+// Outcodes of a point against the clip rect
+#define OUT_LEFT                (1 << 0)
+#define OUT_RIGHT               (1 << 1)
+#define OUT_TOP                 (1 << 2)
+#define OUT_BOTTOM              (1 << 3)
+
+static inline int32_t clamp(int32_t v, int32_t lo, int32_t hi)
+{
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+static inline int64_t max64(int64_t a, int64_t b)
+{
+    return a > b ? a : b;
+}
+
+static inline int64_t min64(int64_t a, int64_t b)
+{
+    return a < b ? a : b;
+}
+
+// <n> / <d> rounded up, <d> > 0
+static inline int64_t div_ceil64(int64_t n, int64_t d)
+{
+    return n >= 0 ? (n + d - 1) / d : -(-n / d);
+}
+
+// Bodies taking <bytes_pp> last are instantiated once per depth by
+// RASTER_DISPATCH. With a constant depth the pixel stores and pointer steps
+// of each format compile to their own inner loops, the depth is tested once
+// per primitive instead of once per pixel.
+#define RASTER_INLINE           static inline __attribute__((always_inline))
+
+#define RASTER_DISPATCH(bytes_pp, fn, ...)      \
+    do {                                        \
+        if ((bytes_pp) == 4)                    \
+            fn(__VA_ARGS__, 4);                 \
+        else if ((bytes_pp) == 2)               \
+            fn(__VA_ARGS__, 2);                 \
+        else                                    \
+            fn(__VA_ARGS__, 1);                 \
+    } while (0)
+
+static inline uint8_t *raster_at(const raster_target_t *target, int32_t x, int32_t y)
+{
+    return target->pixels + (uint32_t)y * target->pitch + (uint32_t)x * target->bytes_pp;
+}
+
+RASTER_INLINE void raster_store(uint8_t *p, uint32_t bytes_pp, uint32_t color)
+{
+    if (bytes_pp == 4)
+        *(uint32_t *)p = color;
+    else if (bytes_pp == 2)
+        *(uint16_t *)p = color;
+    else
+        *p = color;
+}
+
+// Fill <count> pixels from <dst>, the span path of every primitive
+RASTER_INLINE void raster_span(uint8_t *dst, uint32_t count, uint32_t pattern,
+                               const uint32_t bytes_pp)
+{
+    // 8 and 16 bpp : single pixels up to the first word
+    while (count && ((uintptr_t)dst & 3)) {
+        raster_store(dst, bytes_pp, pattern);
+        dst += bytes_pp;
+        count--;
+    }
+
+    uint32_t bytes = count * bytes_pp;
+    uint32_t *word = (uint32_t *)dst;
+    uint32_t words = bytes >> 2;
+
+    for (; words >= 8; words -= 8, word += 8) {
+        word[0] = pattern; word[1] = pattern; word[2] = pattern; word[3] = pattern;
+        word[4] = pattern; word[5] = pattern; word[6] = pattern; word[7] = pattern;
+    }
+    while (words--)
+        *word++ = pattern;
+
+    // 8 and 16 bpp : what is left of the last word
+    dst = (uint8_t *)word;
+    for (count = (bytes & 3) / bytes_pp; count; count--) {
+        raster_store(dst, bytes_pp, pattern);
+        dst += bytes_pp;
+    }
+}
+
+// <rows> spans of <count> pixels, <pitch> bytes apart
+RASTER_INLINE void raster_span_rows(uint8_t *dst, uint32_t pitch, uint32_t rows, uint32_t count,
+                                    uint32_t pattern, const uint32_t bytes_pp)
+{
+    for (; rows; rows--, dst += pitch)
+        raster_span(dst, count, pattern, bytes_pp);
+}
+
+RASTER_INLINE void raster_column(uint8_t *p, uint32_t pitch, uint32_t rows, uint32_t color,
+                                 const uint32_t bytes_pp)
+{
+    for (; rows; rows--, p += pitch)
+        raster_store(p, bytes_pp, color);
+}
+
+// <count> pixels of Bresenham from <p> and <err>, dx >= 0, dy <= 0 as in
+// raster_line, all inside the clip rect
+RASTER_INLINE void raster_bresenham(uint8_t *p, int32_t dx, int32_t dy, int32_t sx, int32_t step_y,
+                                    int32_t err, int32_t count, uint32_t color,
+                                    const uint32_t bytes_pp)
+{
+    int32_t step_x = sx * (int32_t)bytes_pp;
+
+    for (; count; count--) {
+        raster_store(p, bytes_pp, color);
+        int32_t e2 = 2 * err;
+        if (e2 >= dy) {
+            err += dy;
+            p += step_x;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            p += step_y;
+        }
+    }
+}
+
+// <rows> rows of a cell from column <shift> of its bitmap, <width> pixels
+RASTER_INLINE void raster_cell_rows(uint8_t *p, uint32_t pitch, const uint8_t *bits, uint32_t rows,
+                                    uint32_t shift, uint32_t width, uint32_t fg, uint32_t bg,
+                                    const uint32_t bytes_pp)
+{
+    for (; rows; rows--, p += pitch) {
+        uint32_t row = *bits++ >> shift;
+        uint8_t *q = p;
+
+        for (uint32_t px = width; px; px--, row >>= 1, q += bytes_pp)
+            raster_store(q, bytes_pp, row & 1 ? fg : bg);
+    }
+}
+
+bool raster_target_init(raster_target_t *target, const fb_info_t *fb)
+{
+    if (!fb->fb || !fb->pitch)
+        return false;
+    if (fb->depth != 8 && fb->depth != 16 && fb->depth != 32)
+        return false;
+
+    target->pixels = (uint8_t *)(uintptr_t)(fb->fb & ~RASTER_BUS_MASK);
+    target->width = fb->width;
+    target->height = fb->height;
+    target->pitch = fb->pitch;
+    target->bytes_pp = fb->depth / 8;
+    return true;
+}
+
+void raster_clip_reset(const raster_target_t *target, raster_clip_t *clip)
+{
+    clip->x0 = 0;
+    clip->y0 = 0;
+    clip->x1 = target->width;
+    clip->y1 = target->height;
+}
+
+void raster_clip_set(const raster_target_t *target, raster_clip_t *clip,
+                     int32_t x, int32_t y, int32_t w, int32_t h)
+{
+    int32_t width = target->width, height = target->height;
+
+    clip->x0 = clamp(x, 0, width);
+    clip->y0 = clamp(y, 0, height);
+    clip->x1 = clamp(x + w, clip->x0, width);
+    clip->y1 = clamp(y + h, clip->y0, height);
+}
+
+void raster_point(const raster_target_t *target, const raster_clip_t *clip,
+                  int32_t x, int32_t y, uint32_t color)
+{
+    if (x < clip->x0 || x >= clip->x1 || y < clip->y0 || y >= clip->y1)
+        return;
+    raster_store(raster_at(target, x, y), target->bytes_pp, color);
+}
+
+void raster_hline(const raster_target_t *target, const raster_clip_t *clip,
+                  int32_t x, int32_t y, int32_t w, uint32_t color)
+{
+    if (y < clip->y0 || y >= clip->y1)
+        return;
+
+    int32_t x0 = clamp(x, clip->x0, clip->x1);
+    int32_t x1 = clamp(x + w, clip->x0, clip->x1);
+    if (x0 < x1)
+        RASTER_DISPATCH(target->bytes_pp, raster_span_rows, raster_at(target, x0, y), 0, 1,
+                        x1 - x0, raster_pattern(target->bytes_pp, color));
+}
+
+void raster_vline(const raster_target_t *target, const raster_clip_t *clip,
+                  int32_t x, int32_t y, int32_t h, uint32_t color)
+{
+    if (x < clip->x0 || x >= clip->x1)
+        return;
+
+    int32_t y0 = clamp(y, clip->y0, clip->y1);
+    int32_t y1 = clamp(y + h, clip->y0, clip->y1);
+
+    if (y0 < y1)
+        RASTER_DISPATCH(target->bytes_pp, raster_column, raster_at(target, x, y0),
+                        target->pitch, y1 - y0, color);
+}
+
+static inline uint32_t raster_outcode(const raster_clip_t *clip, int32_t x, int32_t y)
+{
+    uint32_t code = 0;
+
+    if (x < clip->x0)
+        code |= OUT_LEFT;
+    else if (x >= clip->x1)
+        code |= OUT_RIGHT;
+    if (y < clip->y0)
+        code |= OUT_TOP;
+    else if (y >= clip->y1)
+        code |= OUT_BOTTOM;
+    return code;
+}
+
+void raster_line(const raster_target_t *target, const raster_clip_t *clip,
+                 int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t color)
+{
+    if (x0 < -RASTER_COORD_MAX || x0 > RASTER_COORD_MAX || y0 < -RASTER_COORD_MAX ||
+        y0 > RASTER_COORD_MAX || x1 < -RASTER_COORD_MAX || x1 > RASTER_COORD_MAX ||
+        y1 < -RASTER_COORD_MAX || y1 > RASTER_COORD_MAX)
+        return;
+
+    if (y0 == y1) {
+        int32_t x = x0 < x1 ? x0 : x1;
+        raster_hline(target, clip, x, y0, (x0 < x1 ? x1 - x0 : x0 - x1) + 1, color);
+        return;
+    }
+    if (x0 == x1) {
+        int32_t y = y0 < y1 ? y0 : y1;
+        raster_vline(target, clip, x0, y, (y0 < y1 ? y1 - y0 : y0 - y1) + 1, color);
+        return;
+    }
+
+    uint32_t code0 = raster_outcode(clip, x0, y0);
+    uint32_t code1 = raster_outcode(clip, x1, y1);
+
+    // Both ends on the same outer side
+    if (code0 & code1)
+        return;
+
+    int32_t dx = x1 > x0 ? x1 - x0 : x0 - x1;
+    int32_t dy = y1 > y0 ? y0 - y1 : y1 - y0;
+    int32_t sx = x1 > x0 ? 1 : -1;
+    int32_t sy = y1 > y0 ? 1 : -1;
+    int32_t step_y = sy * (int32_t)target->pitch;
+
+    if (!(code0 | code1)) {
+        // Fully inside : step the pixel pointer, no bounds checks
+        RASTER_DISPATCH(target->bytes_pp, raster_bresenham, raster_at(target, x0, y0),
+                        dx, dy, sx, step_y, dx + dy, (dx > -dy ? dx : -dy) + 1, color);
+        return;
+    }
+
+    // Crosses the clip rect edge : start at the first pixel inside it. The
+    // Bresenham below puts pixel i of the major axis at
+    // (2 * minor * i + major) / (2 * major) on the minor one, the pixels
+    // inside are those with both offsets in the ranges of the clip rect.
+    int64_t lo_x = sx > 0 ? (int64_t)clip->x0 - x0 : (int64_t)x0 - (clip->x1 - 1);
+    int64_t hi_x = sx > 0 ? (int64_t)clip->x1 - 1 - x0 : (int64_t)x0 - clip->x0;
+    int64_t lo_y = sy > 0 ? (int64_t)clip->y0 - y0 : (int64_t)y0 - (clip->y1 - 1);
+    int64_t hi_y = sy > 0 ? (int64_t)clip->y1 - 1 - y0 : (int64_t)y0 - clip->y0;
+    bool steep = -dy > dx;
+    int64_t major = steep ? -dy : dx, minor = steep ? dx : -dy;
+    int64_t lo_major = max64(steep ? lo_y : lo_x, 0), hi_major = min64(steep ? hi_y : hi_x, major);
+    int64_t lo_minor = max64(steep ? lo_x : lo_y, 0), hi_minor = min64(steep ? hi_x : hi_y, minor);
+
+    if (lo_minor > hi_minor)
+        return;
+
+    int64_t first = max64(lo_major, div_ceil64(2 * major * lo_minor - major, 2 * minor));
+    int64_t last = min64(hi_major, div_ceil64(2 * major * hi_minor + major, 2 * minor) - 1);
+
+    if (first > last)
+        return;
+
+    int64_t at = (2 * minor * first + major) / (2 * major);
+    int32_t u = steep ? at : first, v = steep ? first : at;
+
+    // The error term of that pixel, as left by the steps before it
+    int32_t err = (int64_t)dx * (v + 1) + (int64_t)dy * (u + 1);
+
+    RASTER_DISPATCH(target->bytes_pp, raster_bresenham, raster_at(target, x0 + sx * u, y0 + sy * v),
+                    dx, dy, sx, step_y, err, last - first + 1, color);
+}
+
+void raster_fill_rect(const raster_target_t *target, const raster_clip_t *clip,
+                      int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
+{
+    int32_t x0 = clamp(x, clip->x0, clip->x1), x1 = clamp(x + w, clip->x0, clip->x1);
+    int32_t y0 = clamp(y, clip->y0, clip->y1), y1 = clamp(y + h, clip->y0, clip->y1);
+
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    RASTER_DISPATCH(target->bytes_pp, raster_span_rows, raster_at(target, x0, y0), target->pitch,
+                    y1 - y0, x1 - x0, raster_pattern(target->bytes_pp, color));
+}
+
+void raster_rect(const raster_target_t *target, const raster_clip_t *clip,
+                 int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
+{
+    if (w <= 2 || h <= 2) {
+        raster_fill_rect(target, clip, x, y, w, h, color);
+        return;
+    }
+
+    raster_hline(target, clip, x, y, w, color);
+    raster_hline(target, clip, x, y + h - 1, w, color);
+    raster_vline(target, clip, x, y + 1, h - 2, color);
+    raster_vline(target, clip, x + w - 1, y + 1, h - 2, color);
+}
+
+void raster_blit(const raster_target_t *target, const raster_clip_t *clip,
+                 int32_t x, int32_t y, int32_t w, int32_t h,
+                 const void *src, uint32_t stride)
+{
+    int32_t x0 = clamp(x, clip->x0, clip->x1), x1 = clamp(x + w, clip->x0, clip->x1);
+    int32_t y0 = clamp(y, clip->y0, clip->y1), y1 = clamp(y + h, clip->y0, clip->y1);
+
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    uint32_t bytes_pp = target->bytes_pp;
+    const uint8_t *line = (const uint8_t *)src
+                        + ((uint32_t)(y0 - y) * stride + (uint32_t)(x0 - x)) * bytes_pp;
+    uint8_t *p = raster_at(target, x0, y0);
+
+    for (int32_t row = y0; row < y1; row++) {
+        k_memcpy(p, line, (x1 - x0) * bytes_pp);
+        p += target->pitch;
+        line += stride * bytes_pp;
+    }
+}
+
+void raster_cell(const raster_target_t *target, const raster_clip_t *clip,
+                 int32_t x, int32_t y, const uint8_t *bits, uint32_t height,
+                 uint32_t fg, uint32_t bg)
+{
+    int32_t x0 = clamp(x, clip->x0, clip->x1), x1 = clamp(x + 8, clip->x0, clip->x1);
+    int32_t y0 = clamp(y, clip->y0, clip->y1), y1 = clamp(y + (int32_t)height, clip->y0, clip->y1);
+
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    RASTER_DISPATCH(target->bytes_pp, raster_cell_rows, raster_at(target, x0, y0), target->pitch,
+                    bits + (y0 - y), y1 - y0, x0 - x, x1 - x0, fg, bg);
+}
+
+void raster_clear(const raster_target_t *target, uint32_t color)
+{
+    uint32_t pattern = raster_pattern(target->bytes_pp, color);
+
+    // No padding between the rows : a single span
+    if (target->pitch == target->width * target->bytes_pp)
+        RASTER_DISPATCH(target->bytes_pp, raster_span_rows, target->pixels, 0, 1,
+                        target->width * target->height, pattern);
+    else
+        RASTER_DISPATCH(target->bytes_pp, raster_span_rows, target->pixels, target->pitch,
+                        target->height, target->width, pattern);
+}
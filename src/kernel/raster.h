@@ -0,0 +1,106 @@
+#ifndef RASTER_H
+#define RASTER_H
+
+/*
+ * 2D rasterizer
+ *
+ * Draws on a raster_target_t, the pixels, size, pitch and depth of a
+ * framebuffer as allocated by the firmware. 8 bpp (palette), 16 bpp
+ * (RGB565) and 32 bpp targets are supported, colors are raw pixel values
+ * of the target depth, raster_color converts from 32 bpp. The inner loops
+ * are compiled once per depth.
+ *
+ * Rows are filled as spans : pixel stores up to the first aligned word,
+ * then 32 byte blocks of word stores. Lines take the span path when
+ * horizontal, a pitch stepping loop when vertical, and Bresenham
+ * otherwise. A line crossing the clip rect edge starts Bresenham at its
+ * first pixel inside, with the error term it would have there, and stops
+ * at its last : the pixels are those of the whole line, only the visible
+ * ones are stepped over. Line ends must be within RASTER_COORD_MAX of the
+ * origin, lines beyond are not drawn.
+ *
+ * Every primitive is clipped to a raster_clip_t, itself inside the target.
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "framebuffer.h"
+
+#define RASTER_COORD_MAX        (1 << 28)
+
+typedef struct {
+    uint8_t *pixels;
+    uint32_t width;
+    uint32_t height;
+    uint32_t pitch;             // bytes per row
+    uint32_t bytes_pp;          // 1, 2 or 4
+} raster_target_t;
+
+typedef struct {
+    int32_t x0, y0;             // inclusive
+    int32_t x1, y1;             // exclusive
+} raster_clip_t;
+
+// <color> replicated over a word of pixels
+static inline uint32_t raster_pattern(uint32_t bytes_pp, uint32_t color)
+{
+    if (bytes_pp == 1)
+        return (color & 0xFF) * 0x01010101;
+    if (bytes_pp == 2)
+        return (color & 0xFFFF) * 0x00010001;
+    return color;
+}
+
+// Pixel value of <rgba>, a 32 bpp color as built by rgba_to_uint32
+// (0xAABBGGRR): RGB565 at 16 bpp, at 8 bpp the palette level of its
+// brightest channel (fb_init loads a ramp of 256 levels)
+static inline uint32_t raster_color(uint32_t bytes_pp, uint32_t rgba)
+{
+    uint32_t r = rgba & 0xFF, g = (rgba >> 8) & 0xFF, b = (rgba >> 16) & 0xFF;
+
+    if (bytes_pp == 1)
+        return r > g ? (r > b ? r : b) : (g > b ? g : b);
+    if (bytes_pp == 2)
+        return (r >> 3) << 11 | (g >> 2) << 5 | b >> 3;
+    return rgba;
+}
+
+// Target of an allocated framebuffer, false if it has none or its depth
+// is not supported
+bool raster_target_init(raster_target_t *target, const fb_info_t *fb);
+
+// Whole target, or the part of x,y w*h inside it
+void raster_clip_reset(const raster_target_t *target, raster_clip_t *clip);
+void raster_clip_set(const raster_target_t *target, raster_clip_t *clip,
+                     int32_t x, int32_t y, int32_t w, int32_t h);
+
+void raster_point(const raster_target_t *target, const raster_clip_t *clip,
+                  int32_t x, int32_t y, uint32_t color);
+void raster_hline(const raster_target_t *target, const raster_clip_t *clip,
+                  int32_t x, int32_t y, int32_t w, uint32_t color);
+void raster_vline(const raster_target_t *target, const raster_clip_t *clip,
+                  int32_t x, int32_t y, int32_t h, uint32_t color);
+void raster_line(const raster_target_t *target, const raster_clip_t *clip,
+                 int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t color);
+void raster_fill_rect(const raster_target_t *target, const raster_clip_t *clip,
+                      int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+void raster_rect(const raster_target_t *target, const raster_clip_t *clip,
+                 int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+
+// Copy w*h pixels of the target depth, <stride> pixels apart
+void raster_blit(const raster_target_t *target, const raster_clip_t *clip,
+                 int32_t x, int32_t y, int32_t w, int32_t h,
+                 const void *src, uint32_t stride);
+
+// Opaque 8 pixel wide cell of a 1 bit bitmap, <height> bytes, one per
+// row, bit 0 leftmost: <fg> where bits are set, <bg> elsewhere
+void raster_cell(const raster_target_t *target, const raster_clip_t *clip,
+                 int32_t x, int32_t y, const uint8_t *bits, uint32_t height,
+                 uint32_t fg, uint32_t bg);
+
+// Whole target, ignores the clip rect
+void raster_clear(const raster_target_t *target, uint32_t color);
+
+#endif // RASTER_H
@@ -0,0 +1,71 @@
+#include "ring.h"
+#include "cache.h"
+
+void ring_init(ring_t *ring, void *data, uint32_t size)
+{
+    ring->data = data;
+    ring->mask = size - 1;
+    ring->head = ring->tail = 0;
+}
+
+uint32_t ring_put(ring_t *ring, const void *data, uint32_t size)
+{
+    const uint8_t *src = data;
+    uint32_t head = ring->head;
+
+    // The consumer is done reading the bytes before tail
+    uint32_t space = ring_space(ring);
+    dmb();
+    if (size > space)
+        size = space;
+
+    for (uint32_t i = 0; i < size; i++)
+        ring->data[(head + i) & ring->mask] = src[i];
+
+    // The bytes are there before the consumer sees them
+    dmb();
+    ring->head = head + size;
+    return size;
+}
+
+uint32_t ring_peek(ring_t *ring, const uint8_t **data)
+{
+    uint32_t tail = ring->tail;
+    uint32_t used = ring->head - tail;
+
+    // The bytes before head were written
+    dmb();
+    uint32_t start = tail & ring->mask;
+    uint32_t end = ring->mask + 1 - start;
+
+    *data = ring->data + start;
+    return used < end ? used : end;
+}
+
+void ring_consume(ring_t *ring, uint32_t size)
+{
+    // The bytes were read before the producer may write over them
+    dmb();
+    ring->tail += size;
+}
+
+uint32_t ring_get(ring_t *ring, void *data, uint32_t size)
+{
+    uint8_t *dst = data;
+    uint32_t count = 0;
+
+    // Two peeks when the data wraps
+    while (count < size) {
+        const uint8_t *src;
+        uint32_t n = ring_peek(ring, &src);
+        if (!n)
+            break;
+        if (n > size - count)
+            n = size - count;
+        for (uint32_t i = 0; i < n; i++)
+            dst[count + i] = src[i];
+        ring_consume(ring, n);
+        count += n;
+    }
+    return count;
+}
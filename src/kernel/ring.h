@@ -0,0 +1,54 @@
+#ifndef RING_H
+#define RING_H
+
+/*
+ * Single producer, single consumer byte ring
+ *
+ * The producer only writes head, the consumer only writes tail, both run
+ * freely and wrap at 2^32, the ring size is a power of two. Neither side
+ * takes a lock: a barrier orders the data before the index that publishes
+ * it, so the two sides may run on different cores or one in an interrupt
+ * handler. Several producers or consumers serialize among themselves.
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+    uint8_t *data;
+    uint32_t mask;              // size - 1
+    volatile uint32_t head;     // next byte written
+    volatile uint32_t tail;     // next byte read
+} ring_t;
+
+// <size> bytes at <data>, a power of two
+void ring_init(ring_t *ring, void *data, uint32_t size);
+
+static inline uint32_t ring_used(const ring_t *ring)
+{
+    return ring->head - ring->tail;
+}
+
+static inline uint32_t ring_space(const ring_t *ring)
+{
+    return ring->mask + 1 - (ring->head - ring->tail);
+}
+
+static inline bool ring_empty(const ring_t *ring)
+{
+    return ring->head == ring->tail;
+}
+
+// Producer : copy at most <size> bytes in, returns how many fit
+uint32_t ring_put(ring_t *ring, const void *data, uint32_t size);
+
+// Consumer : the bytes up to the end of the ring or of the data in
+// <*data>, returns how many. They stay in until ring_consume.
+uint32_t ring_peek(ring_t *ring, const uint8_t **data);
+void ring_consume(ring_t *ring, uint32_t size);
+
+// Consumer : copy at most <size> bytes out, returns how many
+uint32_t ring_get(ring_t *ring, void *data, uint32_t size);
+
+#endif // RING_H
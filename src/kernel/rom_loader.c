@@ -1,6 +1,8 @@
 #include "rom_loader.h"
 #include "k_libc/k_stdio.h"
 #include "k_libc/k_string.h"
+#include "crc32.h"
+#include "jobs.h"
 #include <stddef.h>
 
 // Memory addresses for ROM space (from development plan)
@@ -8,22 +10,39 @@
 #define ROM_SPACE_END     0x0001FFFF
 #define ROM_SPACE_SIZE    (ROM_SPACE_END - ROM_SPACE_START + 1)
 
-// Simple CRC32 implementation
-static uint32_t crc32_calculate(const uint8_t* data, uint32_t length) {
-    uint32_t crc = 0xFFFFFFFF;
-    
-    for (uint32_t i = 0; i < length; i++) {
-        crc ^= data[i];
-        for (uint32_t j = 0; j < 8; j++) {
-            if (crc & 1) {
-                crc = (crc >> 1) ^ 0xEDB88320;
-            } else {
-                crc = crc >> 1;
-            }
-        }
+// The checksum is computed in chunks spread over the cores, then combined
+#define ROM_CRC_CHUNK     0x4000
+#define ROM_CRC_CHUNKS    (ROM_SPACE_SIZE / ROM_CRC_CHUNK)
+
+typedef struct {
+    const uint8_t* data;
+    uint32_t size;
+    uint32_t crc[ROM_CRC_CHUNKS];
+} rom_crc_t;
+
+static void rom_crc_chunk(uint32_t index, void* arg) {
+    rom_crc_t* job = (rom_crc_t*)arg;
+    uint32_t offset = index * ROM_CRC_CHUNK;
+    uint32_t length = job->size - offset;
+
+    if (length > ROM_CRC_CHUNK) {
+        length = ROM_CRC_CHUNK;
     }
-    
-    return ~crc;
+    job->crc[index] = crc32(job->data + offset, length);
+}
+
+static uint32_t rom_checksum(const uint8_t* data, uint32_t size) {
+    rom_crc_t job = { .data = data, .size = size };
+    uint32_t chunks = (size + ROM_CRC_CHUNK - 1) / ROM_CRC_CHUNK;
+    uint32_t crc = 0;
+
+    kernel_parallel_for(chunks, rom_crc_chunk, &job);
+
+    for (uint32_t i = 0; i < chunks; i++) {
+        uint32_t length = (i == chunks - 1) ? size - i * ROM_CRC_CHUNK : ROM_CRC_CHUNK;
+        crc = crc32_combine(crc, job.crc[i], length);
+    }
+    return crc;
 }
 
 bool rom_detect(void) {
@@ -44,8 +63,8 @@ bool rom_verify(const rom_header_t* header) {
     }
     
     // Check size bounds
-    if (header->size > ROM_SPACE_SIZE) {
-        k_printf("ROM: Size too large (%u bytes)\r\n", header->size);
+    if (header->size < sizeof(rom_header_t) || header->size > ROM_SPACE_SIZE) {
+        k_printf("ROM: Invalid size (%u bytes)\r\n", header->size);
         return false;
     }
     
@@ -56,10 +75,15 @@ bool rom_verify(const rom_header_t* header) {
         return false;
     }
     
-    // Verify checksum
-    // In a full implementation, we'd calculate CRC of the ROM data
-    // For now, we'll skip detailed verification
-    
+    // Verify checksum of the image following the header
+    uint32_t checksum = rom_checksum((const uint8_t*)(header + 1),
+                                     header->size - sizeof(rom_header_t));
+    if (checksum != header->checksum) {
+        k_printf("ROM: Checksum mismatch (0x%08X, expected 0x%08X)\r\n",
+                 checksum, header->checksum);
+        return false;
+    }
+
     return true;
 }
 
@@ -16,12 +16,13 @@ typedef struct {
     char version[ROM_VERSION_SIZE];       // e.g., "303"
     uint32_t load_address;                // Where to load in memory
     uint32_t entry_point;                 // Where to start execution
-    uint32_t size;                        // Size of ROM in bytes
-    uint32_t checksum;                    // CRC32 checksum
+    uint32_t size;                        // Size of ROM in bytes, header included
+    uint32_t checksum;                    // CRC32 of the bytes following the header
 } __attribute__((packed)) rom_header_t;
 
 // ROM detection and loading
 bool rom_detect(void);
+// <header> must be followed in memory by the rest of the ROM image
 bool rom_verify(const rom_header_t* header);
 bool rom_load(void);
 void rom_chainload(uint32_t entry_point);
@@ -0,0 +1,276 @@
+#include "slab.h"
+#include "pmm.h"
+#include "cpu.h"
+#include "interrupts.h"
+#include "spinlock.h"
+#include "k_libc/k_stdio.h"
+
+#include <stdbool.h>
+
+#define SLAB_SIZE           (PAGE_SIZE << KMEM_SLAB_ORDER)
+#define SLAB_MAGIC          0x51AB51AB
+
+typedef struct kmem_object {
+    struct kmem_object *next;
+} kmem_object_t;
+
+struct kmem_class;
+
+// Lives at the start of every slab
+typedef struct slab {
+    struct slab *next;
+    struct slab *prev;
+    struct kmem_class *cls;
+    kmem_object_t *free;
+    uint32_t in_use;
+    uint32_t magic;
+} slab_t;
+
+// Only touched by its core, with IRQs masked
+typedef struct {
+    uint32_t count;
+    void *objects[KMEM_MAG_SIZE];
+    uint32_t allocs;
+    int32_t in_use;             // allocated minus released on this core
+} kmem_magazine_t;
+
+typedef struct kmem_class {
+    uint32_t size;
+    uint32_t offset;            // first object, past the slab header
+    uint32_t per_slab;
+    spinlock_t lock;            // the slabs and the counters below
+    slab_t *partial;            // slabs with at least one free object
+    uint32_t slabs;
+    uint32_t taken;             // objects out of the slabs
+    uint32_t high_water;
+    uint32_t failures;
+    kmem_magazine_t magazines[CORES];
+} kmem_class_t;
+
+static kmem_class_t classes[KMEM_CLASSES];
+
+static uint32_t kmem_class_index(size_t size)
+{
+    uint32_t index = 0;
+    while (((size_t)1 << (index + KMEM_MIN_SHIFT)) < size)
+        index++;
+    return index;
+}
+
+static void slab_link(kmem_class_t *cls, slab_t *slab)
+{
+    slab->prev = NULL;
+    slab->next = cls->partial;
+    if (slab->next)
+        slab->next->prev = slab;
+    cls->partial = slab;
+}
+
+static void slab_unlink(kmem_class_t *cls, slab_t *slab)
+{
+    if (slab->prev)
+        slab->prev->next = slab->next;
+    else
+        cls->partial = slab->next;
+    if (slab->next)
+        slab->next->prev = slab->prev;
+}
+
+static slab_t *slab_create(kmem_class_t *cls)
+{
+    slab_t *slab = (slab_t *)pmm_alloc_pages(KMEM_SLAB_ORDER);
+    uint8_t *object;
+
+    if (slab == NULL)
+        return NULL;
+
+    slab->cls = cls;
+    slab->in_use = 0;
+    slab->magic = SLAB_MAGIC;
+    slab->free = NULL;
+
+    // Thread the objects last to first so they are handed out in order
+    object = (uint8_t *)slab + cls->offset + (cls->per_slab - 1) * cls->size;
+    for (uint32_t i = 0; i < cls->per_slab; i++, object -= cls->size) {
+        ((kmem_object_t *)object)->next = slab->free;
+        slab->free = (kmem_object_t *)object;
+    }
+
+    slab_link(cls, slab);
+    cls->slabs++;
+    return slab;
+}
+
+// Slow path : take up to <count> objects from the slabs
+static uint32_t slab_take(kmem_class_t *cls, void **out, uint32_t count)
+{
+    uint32_t taken = 0;
+    irq_flags_t flags = spin_lock_irqsave(&cls->lock);
+
+    while (taken < count) {
+        slab_t *slab = cls->partial;
+        if (slab == NULL && (slab = slab_create(cls)) == NULL)
+            break;
+
+        while (taken < count && slab->free) {
+            out[taken++] = slab->free;
+            slab->free = slab->free->next;
+            slab->in_use++;
+        }
+        if (slab->free == NULL)
+            slab_unlink(cls, slab);
+    }
+
+    cls->taken += taken;
+    if (cls->taken > cls->high_water)
+        cls->high_water = cls->taken;
+    if (taken == 0)
+        cls->failures++;
+    spin_unlock_irqrestore(&cls->lock, flags);
+    return taken;
+}
+
+// Slow path : give <count> objects back to their slabs
+static void slab_put(kmem_class_t *cls, void **objects, uint32_t count)
+{
+    irq_flags_t flags = spin_lock_irqsave(&cls->lock);
+
+    for (uint32_t i = 0; i < count; i++) {
+        slab_t *slab = (slab_t *)pmm_block_base(objects[i], KMEM_SLAB_ORDER);
+        kmem_object_t *object = (kmem_object_t *)objects[i];
+
+        if (slab->free == NULL)
+            slab_link(cls, slab);
+        object->next = slab->free;
+        slab->free = object;
+        slab->in_use--;
+
+        // Keep one empty slab around to absorb alloc/free bursts
+        if (slab->in_use == 0 && (slab->next || slab->prev)) {
+            slab_unlink(cls, slab);
+            slab->magic = 0;
+            pmm_free_pages(slab, KMEM_SLAB_ORDER);
+            cls->slabs--;
+        }
+    }
+
+    cls->taken -= count;
+    spin_unlock_irqrestore(&cls->lock, flags);
+}
+
+void kmem_init(void)
+{
+    for (uint32_t i = 0; i < KMEM_CLASSES; i++) {
+        kmem_class_t *cls = &classes[i];
+
+        cls->size = 1 << (i + KMEM_MIN_SHIFT);
+        // Objects are aligned on their own size
+        cls->offset = (sizeof(slab_t) + cls->size - 1) & ~(cls->size - 1);
+        cls->per_slab = (SLAB_SIZE - cls->offset) / cls->size;
+        spin_lock_init(&cls->lock, "kmem");
+        cls->partial = NULL;
+        cls->slabs = 0;
+        cls->taken = 0;
+        cls->high_water = 0;
+        cls->failures = 0;
+        for (uint32_t core = 0; core < CORES; core++) {
+            cls->magazines[core].count = 0;
+            cls->magazines[core].allocs = 0;
+            cls->magazines[core].in_use = 0;
+        }
+    }
+}
+
+void *kmem_alloc(size_t size)
+{
+    kmem_class_t *cls;
+    kmem_magazine_t *mag;
+    irq_flags_t flags;
+    void *ptr = NULL;
+
+    if (size == 0 || size > KMEM_MAX_SIZE)
+        return NULL;
+
+    cls = &classes[kmem_class_index(size)];
+    flags = irq_save();
+    mag = &cls->magazines[core_id()];
+
+    // Refill half a magazine at once to amortise the slab walk
+    if (mag->count == 0)
+        mag->count = slab_take(cls, mag->objects, KMEM_MAG_SIZE / 2);
+    if (mag->count) {
+        mag->allocs++;
+        mag->in_use++;
+        ptr = mag->objects[--mag->count];
+    }
+    irq_restore(flags);
+    return ptr;
+}
+
+void kmem_free(void *ptr)
+{
+    slab_t *slab;
+    kmem_class_t *cls;
+    kmem_magazine_t *mag;
+    irq_flags_t flags;
+
+    if (ptr == NULL)
+        return;
+
+    slab = (slab_t *)pmm_block_base(ptr, KMEM_SLAB_ORDER);
+    if (slab->magic != SLAB_MAGIC)
+        return;
+
+    cls = slab->cls;
+    flags = irq_save();
+    mag = &cls->magazines[core_id()];
+    mag->in_use--;
+
+    // Full magazine : spill half of it back to the slabs
+    if (mag->count == KMEM_MAG_SIZE) {
+        mag->count = KMEM_MAG_SIZE / 2;
+        slab_put(cls, &mag->objects[KMEM_MAG_SIZE / 2], KMEM_MAG_SIZE / 2);
+    }
+    mag->objects[mag->count++] = ptr;
+    irq_restore(flags);
+}
+
+void kmem_get_stats(uint32_t class_index, kmem_class_stats_t *stats)
+{
+    kmem_class_t *cls = &classes[class_index];
+    int32_t in_use = 0;
+
+    // The magazines of the other cores are read as they are, the sums
+    // may be off by the objects moving meanwhile
+    irq_flags_t flags = spin_lock_irqsave(&cls->lock);
+    uint32_t capacity = cls->slabs * cls->per_slab;
+
+    stats->size = cls->size;
+    stats->slabs = cls->slabs;
+    stats->cached = 0;
+    stats->allocs = 0;
+    for (uint32_t core = 0; core < CORES; core++) {
+        stats->cached += cls->magazines[core].count;
+        stats->allocs += cls->magazines[core].allocs;
+        in_use += cls->magazines[core].in_use;
+    }
+    stats->in_use = in_use > 0 ? in_use : 0;
+    stats->high_water = cls->high_water;
+    stats->failures = cls->failures;
+    stats->fragmentation = capacity && stats->in_use <= capacity
+                         ? (capacity - stats->in_use) * 100 / capacity : 0;
+    spin_unlock_irqrestore(&cls->lock, flags);
+}
+
+void kmem_dump_stats(void)
+{
+    kmem_class_stats_t stats;
+
+    k_printf("  size  slabs  in use  cached  peak  allocs  fail  frag\r\n");
+    for (uint32_t i = 0; i < KMEM_CLASSES; i++) {
+        kmem_get_stats(i, &stats);
+        k_printf("  %4d  %5d  %6d  %6d  %4d  %6d  %4d  %3d%%\r\n",
+                 stats.size, stats.slabs, stats.in_use, stats.cached,
+                 stats.high_water, stats.allocs, stats.failures, stats.fragmentation);
+    }
+}
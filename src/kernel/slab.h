@@ -0,0 +1,48 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+/*
+ * Kernel object allocator
+ *
+ * Small objects are served from power-of-two size classes (16 to 2048
+ * bytes). Each class carves 16KB slabs taken from the page allocator and
+ * keeps a per-core magazine of ready objects in front of them, so the
+ * common allocation and release paths are O(1) and never touch shared
+ * state : they only mask IRQs on the local core. Refills and spills take
+ * the lock of the class. Larger requests must go to the page allocator
+ * directly.
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define KMEM_MIN_SHIFT      4
+#define KMEM_MAX_SHIFT      11
+#define KMEM_CLASSES        (KMEM_MAX_SHIFT - KMEM_MIN_SHIFT + 1)
+#define KMEM_MAX_SIZE       (1 << KMEM_MAX_SHIFT)
+
+#define KMEM_SLAB_ORDER     2           // 16KB slabs
+#define KMEM_MAG_SIZE       16          // objects per core magazine
+
+typedef struct {
+    uint32_t size;              // object size of the class
+    uint32_t slabs;             // slabs currently owned
+    uint32_t in_use;            // objects held by callers
+    uint32_t cached;            // objects parked in the core magazines
+    uint32_t high_water;        // peak of in_use + cached
+    uint32_t allocs;            // successful allocations
+    uint32_t failures;          // allocations that found no memory
+    uint32_t fragmentation;     // free share of the slab space, in percent
+} kmem_class_stats_t;
+
+void kmem_init(void);
+
+// Allocate <size> bytes (at most KMEM_MAX_SIZE), aligned to the class size
+void *kmem_alloc(size_t size);
+void kmem_free(void *ptr);
+
+void kmem_get_stats(uint32_t class_index, kmem_class_stats_t *stats);
+void kmem_dump_stats(void);
+
+#endif // SLAB_H
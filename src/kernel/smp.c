@@ -0,0 +1,71 @@
+#include "smp.h"
+#include "cpu.h"
+#include "cache.h"
+#include "jobs.h"
+#include "atomic.h"
+#include "interrupts.h"
+#include "timer.h"
+#include "uart.h"
+
+#if __aarch64__
+// Firmware spin table, core N jumps to the address stored at 0xd8 + 8 * N
+#define SPIN_TABLE_BASE     0xD8
+#endif
+
+// Time given to a core to come up, in microseconds
+#define SMP_BOOT_TIMEOUT_US 100000
+
+// Entry point of the secondary cores, boot.S
+extern char _secondary_start[];
+
+static atomic_t smp_online_mask = ATOMIC_INIT(1);
+
+static void smp_release(uint32_t core)
+{
+#if __aarch64__
+    volatile uint64_t *slot = (volatile uint64_t *)(uintptr_t)(SPIN_TABLE_BASE + 8 * core);
+
+    *slot = (uintptr_t)_secondary_start;
+    // The parked core runs with its caches off
+    dcache_clean_range((const void *)slot, sizeof(*slot));
+    cpu_sev();
+#elif !BCM2835
+    mmio_write(LOCAL_MAILBOX3_SET0 + 0x10 * core, (uint32_t)_secondary_start);
+    cpu_sev();
+#else
+    (void)core;
+#endif
+}
+
+uint32_t smp_init(void)
+{
+    for (uint32_t core = 1; core < CORES; core++) {
+        smp_release(core);
+
+        // timer_init has run, the counter ticks at a fixed rate
+        uint64_t deadline = timer_now() + SMP_BOOT_TIMEOUT_US;
+        while (!(atomic_read(&smp_online_mask) & (1 << core)) && timer_now() < deadline) { }
+    }
+
+    return smp_cores_online();
+}
+
+uint32_t smp_cores_online(void)
+{
+    return __builtin_popcount(atomic_read(&smp_online_mask));
+}
+
+void smp_secondary_main(uint32_t core)
+{
+    cpu_cycles_init();
+    interrupts_init_cpu();
+    interrupts_enable();
+    atomic_fetch_or(&smp_online_mask, 1 << core);
+
+    // Idle loop : run jobs, sleep until kernel_submit signals new work
+    // or an interrupt comes in
+    for (;;) {
+        if (!jobs_run_one())
+            cpu_wfe();
+    }
+}
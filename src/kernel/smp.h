@@ -0,0 +1,29 @@
+#ifndef SMP_H
+#define SMP_H
+
+/*
+ * Secondary core bring-up
+ *
+ * The firmware parks cores 1-3 before the kernel runs : on BCM2836 they
+ * wait for an entry address in their local mailbox 3, on BCM2837 they
+ * poll the spin table at 0xd8. boot.S parks them the same way when they
+ * enter the kernel directly. smp_init() releases them to _secondary_start,
+ * where they pick their stack, turn on the MMU and settle in the idle loop
+ * of the job system.
+ *
+ * BCM2835 is single core, smp_init() does nothing there.
+ *
+ */
+
+#include <stdint.h>
+
+// Release the secondary cores, returns the number of cores online. Waits
+// 100ms at most for each core : call it after timer_init()
+uint32_t smp_init(void);
+
+uint32_t smp_cores_online(void);
+
+// C entry of the secondary cores, called by boot.S
+void smp_secondary_main(uint32_t core);
+
+#endif // SMP_H
@@ -0,0 +1,206 @@
+#include "spinlock.h"
+#include "cpu.h"
+#include "k_libc/k_stdio.h"
+
+#define RWLOCK_WRITER       0x80000000
+
+#if LOCK_STATS
+
+// Locks are registered the first time they are taken
+#define LOCK_STATS_MAX      64
+
+static lock_stats_t *lock_registry[LOCK_STATS_MAX];
+static atomic_t lock_registry_count = ATOMIC_INIT(0);
+
+static void lock_stats_acquired(lock_stats_t *stats, uint32_t spins)
+{
+    if (atomic_read(&stats->registered) == 0 && atomic_xchg(&stats->registered, 1) == 0) {
+        uint32_t slot = atomic_fetch_add(&lock_registry_count, 1);
+        if (slot < LOCK_STATS_MAX)
+            lock_registry[slot] = stats;
+    }
+
+    atomic_fetch_add(&stats->acquisitions, 1);
+    if (spins) {
+        atomic_fetch_add(&stats->contended, 1);
+        atomic_fetch_add(&stats->spins, spins);
+    }
+}
+
+// Exclusive holders only, the fields are protected by the lock itself
+static inline void lock_stats_hold(lock_stats_t *stats)
+{
+    stats->acquired_at = cpu_cycles();
+}
+
+static inline void lock_stats_release(lock_stats_t *stats)
+{
+    uint32_t held = cpu_cycles() - stats->acquired_at;
+    if (held > stats->max_hold)
+        stats->max_hold = held;
+}
+
+#define STATS_ACQUIRED(lock, spins)     lock_stats_acquired(&(lock)->stats, (spins))
+#define STATS_HOLD(lock)                lock_stats_hold(&(lock)->stats)
+#define STATS_RELEASE(lock)             lock_stats_release(&(lock)->stats)
+
+#else
+
+#define STATS_ACQUIRED(lock, spins)     ((void)(spins))
+#define STATS_HOLD(lock)
+#define STATS_RELEASE(lock)
+
+#endif // LOCK_STATS
+
+void spin_lock_init(spinlock_t *lock, const char *name)
+{
+    atomic_set(&lock->next, 0);
+    lock->owner = 0;
+#if LOCK_STATS
+    lock->stats = (lock_stats_t){ .name = name };
+#else
+    (void)name;
+#endif
+}
+
+void spin_lock(spinlock_t *lock)
+{
+    uint32_t ticket = atomic_fetch_add(&lock->next, 1);
+    uint32_t spins = 0;
+
+    while (lock->owner != ticket) {
+        cpu_wfe();
+        spins++;
+    }
+    dmb();
+
+    STATS_ACQUIRED(lock, spins);
+    STATS_HOLD(lock);
+}
+
+bool spin_trylock(spinlock_t *lock)
+{
+    uint32_t owner = lock->owner;
+
+    // Only take a ticket if it is served right away
+    if (atomic_cmpxchg(&lock->next, owner, owner + 1) != owner)
+        return false;
+
+    STATS_ACQUIRED(lock, 0);
+    STATS_HOLD(lock);
+    return true;
+}
+
+void spin_unlock(spinlock_t *lock)
+{
+    STATS_RELEASE(lock);
+
+    dmb();
+    lock->owner = lock->owner + 1;
+    cpu_sev();
+}
+
+irq_flags_t spin_lock_irqsave(spinlock_t *lock)
+{
+    irq_flags_t flags = irq_save();
+    spin_lock(lock);
+    return flags;
+}
+
+void spin_unlock_irqrestore(spinlock_t *lock, irq_flags_t flags)
+{
+    spin_unlock(lock);
+    irq_restore(flags);
+}
+
+void rwlock_init(rwlock_t *lock, const char *name)
+{
+    atomic_set(&lock->state, 0);
+#if LOCK_STATS
+    lock->stats = (lock_stats_t){ .name = name };
+#else
+    (void)name;
+#endif
+}
+
+void read_lock(rwlock_t *lock)
+{
+    uint32_t spins = 0;
+
+    for (;;) {
+        uint32_t state = atomic_read(&lock->state);
+
+        if (!(state & RWLOCK_WRITER)) {
+            if (atomic_cmpxchg(&lock->state, state, state + 1) == state)
+                break;
+        } else {
+            // Only a writer leaving sends an event
+            cpu_wfe();
+        }
+        spins++;
+    }
+
+    STATS_ACQUIRED(lock, spins);
+}
+
+void read_unlock(rwlock_t *lock)
+{
+    atomic_fetch_sub(&lock->state, 1);
+    cpu_sev();
+}
+
+void write_lock(rwlock_t *lock)
+{
+    uint32_t spins = 0;
+
+    while (atomic_cmpxchg(&lock->state, 0, RWLOCK_WRITER) != 0) {
+        cpu_wfe();
+        spins++;
+    }
+
+    STATS_ACQUIRED(lock, spins);
+    STATS_HOLD(lock);
+}
+
+void write_unlock(rwlock_t *lock)
+{
+    STATS_RELEASE(lock);
+
+    dmb();
+    atomic_set(&lock->state, 0);
+    cpu_sev();
+}
+
+irq_flags_t write_lock_irqsave(rwlock_t *lock)
+{
+    irq_flags_t flags = irq_save();
+    write_lock(lock);
+    return flags;
+}
+
+void write_unlock_irqrestore(rwlock_t *lock, irq_flags_t flags)
+{
+    write_unlock(lock);
+    irq_restore(flags);
+}
+
+void lock_dump_stats(void)
+{
+#if LOCK_STATS
+    uint32_t count = atomic_read(&lock_registry_count);
+
+    if (count > LOCK_STATS_MAX)
+        count = LOCK_STATS_MAX;
+
+    k_printf("  lock              acquired  contended     spins  max hold\r\n");
+    for (uint32_t i = 0; i < count; i++) {
+        lock_stats_t *stats = lock_registry[i];
+        k_printf("  %-16s  %8u  %9u  %8u  %8u\r\n",
+                 stats->name ? stats->name : "?",
+                 atomic_read(&stats->acquisitions), atomic_read(&stats->contended),
+                 atomic_read(&stats->spins), stats->max_hold);
+    }
+#else
+    k_printf("  Lock statistics disabled (build with LOCK_STATS=1)\r\n");
+#endif
+}
@@ -0,0 +1,82 @@
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+/*
+ * Spinlocks
+ *
+ * spinlock_t is a ticket lock : waiters are served in arrival order, so a
+ * busy core cannot starve the others. rwlock_t lets in any number of
+ * readers or a single writer, readers are favoured. Waiters sleep in wfe
+ * and are woken by the sev of the unlock.
+ *
+ * The _irqsave variants also mask IRQs on the local core, use them for any
+ * data an interrupt handler may touch : on BCM2835 they are the only thing
+ * a lock protects against.
+ *
+ * Building with LOCK_STATS=1 counts, per lock, the acquisitions, the
+ * contended acquisitions, the wait iterations and the longest hold time in
+ * CPU cycles. lock_dump_stats() prints them on the UART.
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "atomic.h"
+#include "interrupts.h"
+
+#if LOCK_STATS
+typedef struct {
+    const char *name;
+    atomic_t acquisitions;
+    atomic_t contended;         // acquisitions that had to wait
+    atomic_t spins;             // wait iterations
+    uint32_t max_hold;          // cycles, exclusive holders only
+    uint32_t acquired_at;
+    atomic_t registered;
+} lock_stats_t;
+
+#define LOCK_STATS_INIT(lock_name)  , .stats = { .name = (lock_name) }
+#else
+#define LOCK_STATS_INIT(lock_name)
+#endif
+
+typedef struct {
+    atomic_t next;              // next ticket handed out
+    volatile uint32_t owner;    // ticket being served
+#if LOCK_STATS
+    lock_stats_t stats;
+#endif
+} spinlock_t;
+
+typedef struct {
+    atomic_t state;             // writer bit | reader count
+#if LOCK_STATS
+    lock_stats_t stats;
+#endif
+} rwlock_t;
+
+#define SPINLOCK_INIT(name)     { .next = ATOMIC_INIT(0), .owner = 0 LOCK_STATS_INIT(name) }
+#define RWLOCK_INIT(name)       { .state = ATOMIC_INIT(0) LOCK_STATS_INIT(name) }
+
+void spin_lock_init(spinlock_t *lock, const char *name);
+void spin_lock(spinlock_t *lock);
+bool spin_trylock(spinlock_t *lock);
+void spin_unlock(spinlock_t *lock);
+
+irq_flags_t spin_lock_irqsave(spinlock_t *lock);
+void spin_unlock_irqrestore(spinlock_t *lock, irq_flags_t flags);
+
+void rwlock_init(rwlock_t *lock, const char *name);
+void read_lock(rwlock_t *lock);
+void read_unlock(rwlock_t *lock);
+void write_lock(rwlock_t *lock);
+void write_unlock(rwlock_t *lock);
+
+irq_flags_t write_lock_irqsave(rwlock_t *lock);
+void write_unlock_irqrestore(rwlock_t *lock, irq_flags_t flags);
+
+// Print the statistics of every lock taken so far (LOCK_STATS=1 only)
+void lock_dump_stats(void);
+
+#endif // SPINLOCK_H
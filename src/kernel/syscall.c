@@ -1,13 +1,24 @@
 #include "syscall.h"
 #include "k_libc/k_stdio.h"
+#include "spinlock.h"
+#include "cpu.h"
+#include "trace.h"
+#include "clock.h"
 #include <stddef.h>
 
-// System call table
-static syscall_handler_t syscall_table[256];
+// System call table. Readers load a single pointer, which is atomic, so
+// only the writers take the lock.
+static syscall_handler_t syscall_table[SYSCALL_COUNT];
+static spinlock_t syscall_table_lock = SPINLOCK_INIT("syscall_table");
+
+// Per core, a core only updates its own counters
+static syscall_stats_t syscall_stats[CORES][SYSCALL_COUNT];
 
 void syscall_init(void) {
+    irq_flags_t flags = spin_lock_irqsave(&syscall_table_lock);
+
     // Initialize all syscalls to NULL
-    for (int i = 0; i < 256; i++) {
+    for (int i = 0; i < SYSCALL_COUNT; i++) {
         syscall_table[i] = NULL;
     }
     
@@ -17,6 +28,10 @@ void syscall_init(void) {
     syscall_table[SYSCALL_DRAW_POINT] = (syscall_handler_t)sys_draw_point;
     syscall_table[SYSCALL_DRAW_TEXT] = (syscall_handler_t)sys_draw_text;
     syscall_table[SYSCALL_CLEAR_SCREEN] = (syscall_handler_t)sys_clear_screen;
+    syscall_table[SYSCALL_DRAW_BATCH] = (syscall_handler_t)sys_draw_batch;
+    syscall_table[SYSCALL_PRESENT] = (syscall_handler_t)sys_present;
+    syscall_table[SYSCALL_SET_PALETTE] = (syscall_handler_t)sys_set_palette;
+    syscall_table[SYSCALL_CYCLE_PALETTE] = (syscall_handler_t)sys_cycle_palette;
     
     // Input
     syscall_table[SYSCALL_READ_BUTTONS] = (syscall_handler_t)sys_read_buttons;
@@ -36,33 +51,164 @@ void syscall_init(void) {
     // Storage
     syscall_table[SYSCALL_READ_SAVE] = (syscall_handler_t)sys_read_save;
     syscall_table[SYSCALL_WRITE_SAVE] = (syscall_handler_t)sys_write_save;
+
+    spin_unlock_irqrestore(&syscall_table_lock, flags);
+}
+
+bool syscall_register(uint32_t number, syscall_handler_t handler) {
+    if (number >= SYSCALL_COUNT) {
+        return false;
+    }
+
+    irq_flags_t flags = spin_lock_irqsave(&syscall_table_lock);
+    syscall_table[number] = handler;
+    spin_unlock_irqrestore(&syscall_table_lock, flags);
+    return true;
+}
+
+int32_t syscall_dispatch(uint32_t number, uintptr_t arg0, uintptr_t arg1,
+                         uintptr_t arg2, uintptr_t arg3) {
+    if (number >= SYSCALL_COUNT) {
+        return -1;
+    }
+
+    syscall_handler_t handler = syscall_table[number];
+    if (!handler) {
+        return -1;
+    }
+
+    TRACE_BEGIN("syscall", "number %u", number);
+    int32_t result = handler(arg0, arg1, arg2, arg3);
+    TRACE_END("syscall");
+    return result;
+}
+
+int32_t syscall_trap(uintptr_t arg0, uintptr_t arg1, uintptr_t arg2,
+                     uintptr_t arg3, uint32_t number) {
+    if (number >= SYSCALL_COUNT) {
+        return -1;
+    }
+
+    syscall_handler_t handler = syscall_table[number];
+    if (!handler) {
+        return -1;
+    }
+
+    TRACE_BEGIN("syscall", "number %u", number);
+    uint32_t start = cpu_cycles();
+    int32_t result = handler(arg0, arg1, arg2, arg3);
+    uint32_t cycles = cpu_cycles() - start;
+    TRACE_END("syscall");
+
+    syscall_stats_t *stats = &syscall_stats[core_id()][number];
+    stats->calls++;
+    stats->cycles += cycles;
+    return result;
+}
+
+void syscall_get_stats(uint32_t number, syscall_stats_t *stats) {
+    *stats = (syscall_stats_t){ 0 };
+    if (number >= SYSCALL_COUNT) {
+        return;
+    }
+
+    for (uint32_t core = 0; core < CORES; core++) {
+        stats->calls += syscall_stats[core][number].calls;
+        stats->cycles += syscall_stats[core][number].cycles;
+    }
+}
+
+void syscall_dump_stats(void) {
+    k_printf("  syscall     calls  avg cycles\r\n");
+    for (uint32_t number = 0; number < SYSCALL_COUNT; number++) {
+        syscall_stats_t stats;
+        syscall_get_stats(number, &stats);
+        if (!stats.calls) {
+            continue;
+        }
+        k_printf("  0x%02x   %10u  %10u\r\n", number, stats.calls,
+                 (uint32_t)(stats.cycles / stats.calls));
+    }
+}
+
+// Same sequence as the ROM stubs, see docs/API.md
+static inline int32_t syscall_invoke(uint32_t number, uint32_t arg0) {
+#if __aarch64__
+    register uint64_t x0 __asm__("x0") = arg0;
+    register uint64_t x8 __asm__("x8") = number;
+    __asm__ volatile("svc #0" : "+r"(x0) : "r"(x8) : "memory");
+    return (int32_t)x0;
+#else
+    register uint32_t r0 __asm__("r0") = arg0;
+    register uint32_t r7 __asm__("r7") = number;
+    // The kernel runs in SVC mode, the exception overwrites its lr
+    __asm__ volatile("svc #0" : "+r"(r0) : "r"(r7) : "lr", "memory");
+    return (int32_t)r0;
+#endif
+}
+
+uint32_t syscall_measure_trap(uint32_t iterations) {
+    if (!iterations) {
+        return 0;
+    }
+
+    uint32_t start = cpu_cycles();
+    for (uint32_t i = 0; i < iterations; i++) {
+        syscall_invoke(SYSCALL_GET_BATTERY, 0);
+    }
+    return (cpu_cycles() - start) / iterations;
 }
 
 // Display operations
 int32_t sys_draw_line(int32_t x1, int32_t y1, int32_t x2, int32_t y2) {
-    // TODO: Implement Bresenham line drawing
-    (void)x1; (void)y1; (void)x2; (void)y2;
-    return 0;
+    return draw_line(x1, y1, x2, y2, DRAW_DEFAULT_COLOR) ? 0 : -1;
 }
 
 int32_t sys_draw_point(int32_t x, int32_t y, uint32_t color) {
-    // TODO: Implement point drawing
-    (void)x; (void)y; (void)color;
-    return 0;
+    return draw_point(x, y, color) ? 0 : -1;
 }
 
 int32_t sys_draw_text(int32_t x, int32_t y, const char* text, uint32_t size) {
-    // TODO: Implement text rendering
-    (void)x; (void)y; (void)text; (void)size;
-    return 0;
+    uint32_t length = 0;
+
+    if (!text) {
+        return -1;
+    }
+
+    // At most DRAW_TEXT_MAX characters, the rest of the string is ignored
+    while (length < DRAW_TEXT_MAX && text[length]) {
+        length++;
+    }
+    return draw_text(x, y, text, length, size, DRAW_DEFAULT_COLOR) ? 0 : -1;
 }
 
 int32_t sys_clear_screen(uint32_t color) {
-    // TODO: Implement screen clearing
-    (void)color;
+    return draw_clear(color) ? 0 : -1;
+}
+
+int32_t sys_draw_batch(const draw_cmd_t* cmds, uint32_t count, uint32_t flags,
+                       draw_batch_stats_t* stats) {
+    return draw_batch(cmds, count, flags, stats);
+}
+
+int32_t sys_present(void) {
+    if (!fb_begin_frame())
+        return -1;
+    fb_present();
     return 0;
 }
 
+int32_t sys_set_palette(uint32_t first, uint32_t count, const uint32_t* colors) {
+    if (!colors) {
+        return -1;
+    }
+    return fb_set_palette(first, count, colors) ? 0 : -1;
+}
+
+int32_t sys_cycle_palette(uint32_t first, uint32_t count, int32_t step) {
+    return fb_cycle_palette(first, count, step) ? 0 : -1;
+}
+
 // Input operations
 uint32_t sys_read_buttons(void) {
     // TODO: Read button states from GPIO
@@ -123,10 +269,10 @@ bool sys_sensor_available(sensor_type_t sensor) {
 }
 
 // System operations
-int32_t sys_get_time(uint32_t* time_ptr) {
-    // TODO: Get time from RTC
+int32_t sys_get_time(uint64_t* time_ptr) {
+    // Monotonic, the RTC would be wall clock time
     if (!time_ptr) return -1;
-    *time_ptr = 0; // Placeholder
+    *time_ptr = clock_ns();
     return 0;
 }
 
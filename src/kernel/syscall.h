@@ -4,11 +4,17 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "draw.h"
+
 // System Call Numbers (from development plan)
 #define SYSCALL_DRAW_LINE           0x01
 #define SYSCALL_DRAW_POINT          0x02
 #define SYSCALL_DRAW_TEXT           0x03
 #define SYSCALL_CLEAR_SCREEN        0x04
+#define SYSCALL_DRAW_BATCH          0x05
+#define SYSCALL_PRESENT             0x06
+#define SYSCALL_SET_PALETTE         0x07
+#define SYSCALL_CYCLE_PALETTE       0x08
 #define SYSCALL_READ_BUTTONS        0x10
 #define SYSCALL_READ_DIAL           0x11
 #define SYSCALL_PLAY_TONE           0x20
@@ -40,13 +46,43 @@ typedef enum {
     SENSOR_HEARTRATE = 6
 } sensor_type_t;
 
-// System call handler
-typedef int32_t (*syscall_handler_t)(uint32_t arg0, uint32_t arg1, 
-                                     uint32_t arg2, uint32_t arg3);
+#define SYSCALL_COUNT               256
+
+// System call handler. Arguments are register wide, pointers among them
+// keep their upper half on aarch64.
+typedef int32_t (*syscall_handler_t)(uintptr_t arg0, uintptr_t arg1,
+                                     uintptr_t arg2, uintptr_t arg3);
 
 // Initialize system call interface
 void syscall_init(void);
 
+// Install <handler> for <number>, returns false if out of range
+bool syscall_register(uint32_t number, syscall_handler_t handler);
+
+// Call the handler of <number>, -1 if none is registered
+int32_t syscall_dispatch(uint32_t number, uintptr_t arg0, uintptr_t arg1,
+                         uintptr_t arg2, uintptr_t arg3);
+
+// Counters of the calls made through svc
+typedef struct {
+    uint32_t calls;
+    uint64_t cycles;            // in the handler, summed
+} syscall_stats_t;
+
+// svc entry point : number in r7/x8, arguments in r0-r3/x0-x3, counts
+// the call. Called by the vectors only.
+int32_t syscall_trap(uintptr_t arg0, uintptr_t arg1, uintptr_t arg2,
+                     uintptr_t arg3, uint32_t number);
+
+// Counters of <number>, summed over the cores
+void syscall_get_stats(uint32_t number, syscall_stats_t *stats);
+
+// Print the counters of every system call made on the UART
+void syscall_dump_stats(void);
+
+// Average round trip of a trivial svc, in CPU cycles
+uint32_t syscall_measure_trap(uint32_t iterations);
+
 // System call implementations
 
 // Display operations
@@ -54,6 +90,11 @@ int32_t sys_draw_line(int32_t x1, int32_t y1, int32_t x2, int32_t y2);
 int32_t sys_draw_point(int32_t x, int32_t y, uint32_t color);
 int32_t sys_draw_text(int32_t x, int32_t y, const char* text, uint32_t size);
 int32_t sys_clear_screen(uint32_t color);
+int32_t sys_draw_batch(const draw_cmd_t* cmds, uint32_t count, uint32_t flags,
+                       draw_batch_stats_t* stats);
+int32_t sys_present(void);
+int32_t sys_set_palette(uint32_t first, uint32_t count, const uint32_t* colors);
+int32_t sys_cycle_palette(uint32_t first, uint32_t count, int32_t step);
 
 // Input operations
 uint32_t sys_read_buttons(void);
@@ -69,7 +110,7 @@ int32_t sys_read_sensor(sensor_type_t sensor, uint32_t* value);
 bool sys_sensor_available(sensor_type_t sensor);
 
 // System operations
-int32_t sys_get_time(uint32_t* time_ptr);
+int32_t sys_get_time(uint64_t* time_ptr);
 uint32_t sys_get_battery_level(void);
 
 // Storage operations
@@ -0,0 +1,309 @@
+#include "term.h"
+#include "uart.h"
+
+// Longest sequence for one cell: CUP, a full SGR and the character
+#define TERM_SEQ_MAX            32
+
+// The unchanged cells are sent again to move right by at most that many,
+// CUF is never longer
+#define TERM_RESEND_MAX         4
+
+// Changed cells at the end of a blank row from which EL is shorter
+#define TERM_EL_MIN             3
+
+typedef struct {
+    char data[TERM_SEQ_MAX];
+    uint32_t length;
+} term_seq_t;
+
+static const term_cell_t term_blank = { ' ', 0 };
+
+static inline bool term_same(term_cell_t a, term_cell_t b)
+{
+    return a.ch == b.ch && a.attr == b.attr;
+}
+
+static void term_put(term_seq_t *seq, const char *s)
+{
+    while (*s)
+        seq->data[seq->length++] = *s++;
+}
+
+static void term_put_number(term_seq_t *seq, uint32_t n)
+{
+    if (n >= 10)
+        term_put_number(seq, n / 10);
+    seq->data[seq->length++] = '0' + n % 10;
+}
+
+// ESC [ <n> <op>, <n> left out when 1
+static void term_put_csi(term_seq_t *seq, uint32_t n, char op)
+{
+    term_put(seq, "\033[");
+    if (n != 1)
+        term_put_number(seq, n);
+    seq->data[seq->length++] = op;
+}
+
+static void term_cup(term_seq_t *seq, uint32_t row, uint32_t col)
+{
+    term_put(seq, "\033[");
+    if (row || col)
+        term_put_number(seq, row + 1);
+    if (col) {
+        seq->data[seq->length++] = ';';
+        term_put_number(seq, col + 1);
+    }
+    seq->data[seq->length++] = 'H';
+}
+
+// Right from <from> to <to> on <row>, whose cells before <to> are shown
+// as wanted
+static void term_right(const term_t *term, term_seq_t *seq, uint32_t row,
+                       uint32_t from, uint32_t to)
+{
+    uint32_t count = to - from;
+
+    if (!count)
+        return;
+    if (count <= TERM_RESEND_MAX) {
+        uint32_t col = from;
+        while (col < to && term->shown[row][col].attr == term->attr)
+            col++;
+        if (col == to) {
+            for (col = from; col < to; col++)
+                seq->data[seq->length++] = term->shown[row][col].ch;
+            return;
+        }
+    }
+    term_put_csi(seq, count, 'C');
+}
+
+// Cheapest way from the terminal cursor to row, col
+static void term_motion(const term_t *term, term_seq_t *seq, uint32_t row, uint32_t col)
+{
+    term_seq_t rel = { .length = 0 };
+
+    term_cup(seq, row, col);
+    if (term->col < 0)
+        return;
+
+    int32_t down = (int32_t)row - term->row;
+    if (down < 0) {
+        term_put_csi(&rel, -down, 'A');
+    } else if (down > 0 && down < 4) {
+        // LF is shorter than CUD for a few rows
+        for (int32_t i = 0; i < down; i++)
+            rel.data[rel.length++] = '\n';
+    } else if (down > 0) {
+        term_put_csi(&rel, down, 'B');
+    }
+
+    uint32_t from = term->col;
+    if (col > from) {
+        term_right(term, &rel, row, from, col);
+    } else if (col < from) {
+        // Back to the start of the row, then right, or straight back
+        term_seq_t back = { .length = 0 };
+        if (from - col == 1)
+            back.data[back.length++] = '\b';
+        else
+            term_put_csi(&back, from - col, 'D');
+
+        term_seq_t cr = { .data = { '\r' }, .length = 1 };
+        term_right(term, &cr, row, 0, col);
+
+        const term_seq_t *best = cr.length <= back.length ? &cr : &back;
+        for (uint32_t i = 0; i < best->length; i++)
+            rel.data[rel.length++] = best->data[i];
+    }
+
+    if (rel.length < seq->length)
+        *seq = rel;
+}
+
+static void term_sgr(const term_t *term, term_seq_t *seq, uint8_t attr)
+{
+    if (attr == term->attr)
+        return;
+
+    // The empty first parameter resets, the attributes are then set
+    term_put(seq, "\033[");
+    if (attr & TERM_BOLD)
+        term_put(seq, ";1");
+    if (attr & TERM_UNDERLINE)
+        term_put(seq, ";4");
+    if (attr & TERM_BLINK)
+        term_put(seq, ";5");
+    if (attr & TERM_REVERSE)
+        term_put(seq, ";7");
+    if (attr >> 4) {
+        term_put(seq, ";3");
+        seq->data[seq->length++] = '0' + ((attr >> 4) & 7);
+    }
+    seq->data[seq->length++] = 'm';
+}
+
+static void term_touch(term_t *term, uint32_t row)
+{
+    term->dirty |= 1u << row;
+}
+
+void term_init(term_t *term)
+{
+    term->ready = false;
+    term->next_row = 0;
+    term->stats = (term_stats_t){ 0 };
+    term_clear(term);
+}
+
+void term_clear(term_t *term)
+{
+    for (uint32_t row = 0; row < TERM_ROWS; row++) {
+        for (uint32_t col = 0; col < TERM_COLS; col++)
+            term->cells[row][col] = term_blank;
+        term_touch(term, row);
+    }
+}
+
+void term_set(term_t *term, uint32_t row, uint32_t col, char c, uint8_t attr)
+{
+    if (row >= TERM_ROWS || col >= TERM_COLS)
+        return;
+
+    // Control characters would move the terminal cursor
+    if ((uint8_t)c < ' ' || (uint8_t)c > '~')
+        c = ' ';
+    term->cells[row][col] = (term_cell_t){ (uint8_t)c, attr };
+    term_touch(term, row);
+}
+
+void term_write(term_t *term, uint32_t row, uint32_t col,
+                const char *text, uint32_t length, uint8_t attr)
+{
+    for (uint32_t i = 0; i < length && col + i < TERM_COLS; i++)
+        term_set(term, row, col + i, text[i], attr);
+}
+
+// Append <seq> if it fits
+static bool term_emit(char *out, uint32_t size, uint32_t *length, const term_seq_t *seq)
+{
+    if (*length + seq->length > size)
+        return false;
+    for (uint32_t i = 0; i < seq->length; i++)
+        out[(*length)++] = seq->data[i];
+    return true;
+}
+
+// The changed cells of <row> from its start, false when out of budget
+static bool term_render_row(term_t *term, uint32_t row, char *out, uint32_t size,
+                            uint32_t *length)
+{
+    term_cell_t *cells = term->cells[row], *shown = term->shown[row];
+    uint32_t end = TERM_COLS, tail = 0;
+
+    // Blank from <end>, <tail> of those cells to clear
+    while (end && term_same(cells[end - 1], term_blank))
+        end--;
+    for (uint32_t col = end; col < TERM_COLS; col++)
+        tail += !term_same(shown[col], term_blank);
+
+    for (uint32_t col = 0; col < TERM_COLS; col++) {
+        if (term_same(cells[col], shown[col]))
+            continue;
+
+        term_seq_t seq = { .length = 0 };
+        term_motion(term, &seq, row, col);
+        term_sgr(term, &seq, col >= end && tail >= TERM_EL_MIN ? 0 : cells[col].attr);
+
+        if (col >= end && tail >= TERM_EL_MIN) {
+            term_put(&seq, "\033[K");
+            if (!term_emit(out, size, length, &seq))
+                return false;
+            // EL leaves the cursor where it was
+            term->attr = 0;
+            term->row = row;
+            term->col = col;
+            for (; col < TERM_COLS; col++) {
+                if (!term_same(shown[col], term_blank))
+                    term->stats.cells++;
+                shown[col] = term_blank;
+            }
+            break;
+        }
+
+        seq.data[seq.length++] = cells[col].ch;
+        if (!term_emit(out, size, length, &seq))
+            return false;
+
+        shown[col] = cells[col];
+        term->attr = cells[col].attr;
+        term->row = row;
+        // The last column : wrapping differs between terminals
+        term->col = col + 1 < TERM_COLS ? (int32_t)col + 1 : -1;
+        term->stats.cells++;
+    }
+    return true;
+}
+
+uint32_t term_render(term_t *term, char *out, uint32_t size)
+{
+    uint32_t length = 0;
+
+    if (!term->ready) {
+        static const term_seq_t reset = { "\033[0m\033[2J\033[H", 11 };
+
+        if (!term_emit(out, size, &length, &reset))
+            return 0;
+        for (uint32_t row = 0; row < TERM_ROWS; row++) {
+            for (uint32_t col = 0; col < TERM_COLS; col++)
+                term->shown[row][col] = term_blank;
+            term_touch(term, row);
+        }
+        term->row = term->col = 0;
+        term->attr = 0;
+        term->ready = true;
+    }
+
+    for (uint32_t i = 0; i < TERM_ROWS; i++) {
+        uint32_t row = (term->next_row + i) % TERM_ROWS;
+
+        if (!(term->dirty & (1u << row)))
+            continue;
+        if (!term_render_row(term, row, out, size, &length)) {
+            // Start with this row next time
+            term->next_row = row;
+            term->stats.deferred++;
+            break;
+        }
+        term->dirty &= ~(1u << row);
+    }
+
+    term->stats.renders++;
+    term->stats.bytes += length;
+    return length;
+}
+
+void term_present(term_t *term, uint32_t budget)
+{
+    static char buffer[TERM_PRESENT_MAX];
+
+    uint32_t length = term_render(term, buffer, budget < sizeof(buffer) ? budget : sizeof(buffer));
+    if (length)
+        uart_write(buffer, length);
+}
+
+void term_release(term_t *term)
+{
+    term_seq_t seq = { .length = 0 };
+
+    term_put(&seq, "\033[0m");
+    term_cup(&seq, TERM_ROWS - 1, 0);
+    uart_write(seq.data, seq.length);
+    term->ready = false;
+}
+
+void term_get_stats(const term_t *term, term_stats_t *stats)
+{
+    *stats = term->stats;
+}
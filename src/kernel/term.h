@@ -0,0 +1,92 @@
+#ifndef TERM_H
+#define TERM_H
+
+/*
+ * Serial terminal screen model
+ *
+ * A TERM_COLS x TERM_ROWS grid of cells, a character and its attributes
+ * each, as the kernel wants the terminal at the other end of the UART to
+ * look, and the grid as the terminal shows it. term_render sends only the
+ * difference: the changed cells in row order, each run reached with the
+ * cheapest cursor motion (CR, LF, BS, the relative CUU/CUD/CUF/CUB, an
+ * absolute CUP, or the unchanged cells in between sent again), an SGR only
+ * when the attributes change, and EL for rows blank to their end.
+ *
+ * A render stops at a byte budget, a frame of the link (TERM_FRAME_BYTES).
+ * The cells it did not reach keep their difference and go first in the
+ * next one, so a busy screen skips the intermediate states of its cells
+ * instead of falling behind the link.
+ *
+ * The terminal is expected to handle the VT100 sequences and to keep the
+ * column on LF. The first render resets and clears it. Callers serialize.
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TERM_COLS               80
+#define TERM_ROWS               24
+
+// Attributes, and the foreground color (ANSI 0-7) in the high bits
+#define TERM_BOLD               (1 << 0)
+#define TERM_UNDERLINE          (1 << 1)
+#define TERM_BLINK              (1 << 2)
+#define TERM_REVERSE            (1 << 3)
+#define TERM_FG(color)          ((8 | (color)) << 4)
+
+#define TERM_GREEN              2
+
+// Bytes a link of <baud> (8N1) carries in one of <fps> frames a second
+#define TERM_FRAME_BYTES(baud, fps) ((baud) / 10 / (fps))
+
+// Largest budget of term_present
+#define TERM_PRESENT_MAX        1024
+
+typedef struct {
+    uint8_t ch;
+    uint8_t attr;
+} term_cell_t;
+
+typedef struct {
+    uint32_t renders;
+    uint32_t bytes;             // sent
+    uint32_t cells;             // sent, EL cleared cells included
+    uint32_t deferred;          // renders that ran out of budget
+} term_stats_t;
+
+typedef struct {
+    term_cell_t cells[TERM_ROWS][TERM_COLS];    // wanted
+    term_cell_t shown[TERM_ROWS][TERM_COLS];    // on the terminal
+    uint32_t dirty;             // rows that may differ, a bit each
+    uint32_t next_row;          // first row of the next render
+    int32_t row, col;           // terminal cursor, col -1 : unknown
+    uint8_t attr;               // terminal attributes
+    bool ready;                 // terminal reset, shown is valid
+    term_stats_t stats;
+} term_t;
+
+// Blank screen, the terminal is reset by the first render
+void term_init(term_t *term);
+
+void term_clear(term_t *term);
+void term_set(term_t *term, uint32_t row, uint32_t col, char c, uint8_t attr);
+
+// <length> characters from row, col, cut at the end of the row
+void term_write(term_t *term, uint32_t row, uint32_t col,
+                const char *text, uint32_t length, uint8_t attr);
+
+// Sequences bringing the terminal closer to the model, at most <size>
+// bytes in <out>, returns their length
+uint32_t term_render(term_t *term, char *out, uint32_t size);
+
+// Render at most <budget> bytes to the UART
+void term_present(term_t *term, uint32_t budget);
+
+// Leave the screen as it is and the cursor at the start of its last row,
+// for text output to go on below
+void term_release(term_t *term);
+
+void term_get_stats(const term_t *term, term_stats_t *stats);
+
+#endif // TERM_H
@@ -0,0 +1,215 @@
+#include "text.h"
+#include "arena.h"
+#include "k_libc/k_stdio.h"
+#include "k_libc/k_string.h"
+
+// Glyphs looked up at once. The cache is only emptied between chunks, so
+// the glyphs of a chunk stay valid while its rows are drawn.
+#define TEXT_CHUNK              32
+
+typedef struct {
+    uint16_t key;               // 0 : free slot
+    uint16_t words;             // mask words per row
+    const uint32_t *masks;      // FONT_HEIGHT rows of <words>
+} text_glyph_t;
+
+static uint32_t text_memory[TEXT_CACHE_BYTES / 4];
+static arena_t text_arena;
+static text_glyph_t text_slots[TEXT_CACHE_SLOTS];
+static uint32_t text_bytes_pp;          // depth of the cached glyphs, 0 : none yet
+static text_cache_stats_t text_stats;
+
+static inline uint32_t text_clamp_size(uint32_t size)
+{
+    return size < 1 ? 1 : (size > TEXT_SIZE_MAX ? TEXT_SIZE_MAX : size);
+}
+
+uint32_t text_width(uint32_t length, uint32_t size)
+{
+    return length * FONT_WIDTH * text_clamp_size(size);
+}
+
+uint32_t text_height(uint32_t size)
+{
+    return FONT_HEIGHT * text_clamp_size(size);
+}
+
+// Mask words per row of a glyph, at its worst alignment
+static inline uint32_t text_words_max(uint32_t size, uint32_t bytes_pp)
+{
+    uint32_t per_word = 4 / bytes_pp;
+    return (2 * (per_word - 1) + FONT_WIDTH * size) / per_word;
+}
+
+static void text_flush(uint32_t bytes_pp)
+{
+    if (!text_arena.base)
+        arena_init(&text_arena, text_memory, sizeof(text_memory));
+    else
+        text_stats.flushes++;
+
+    arena_reset(&text_arena);
+    k_memset(text_slots, 0, sizeof(text_slots));
+    text_stats.glyphs = 0;
+    text_bytes_pp = bytes_pp;
+}
+
+// Room for a chunk of new glyphs, or an empty cache
+static void text_reserve(uint32_t size, uint32_t bytes_pp)
+{
+    uint32_t bytes = TEXT_CHUNK * FONT_HEIGHT * text_words_max(size, bytes_pp) * 4;
+
+    if (bytes_pp != text_bytes_pp
+        || text_stats.glyphs + TEXT_CHUNK > TEXT_CACHE_SLOTS * 3 / 4
+        || text_arena.size - text_arena.used < bytes)
+        text_flush(bytes_pp);
+}
+
+static const text_glyph_t *text_expand(text_glyph_t *slot, uint16_t key, char c, uint32_t size,
+                                       uint32_t phase, uint32_t bytes_pp)
+{
+    uint32_t per_word = 4 / bytes_pp;
+    uint32_t width = FONT_WIDTH * size;
+    uint32_t words = (phase + width + per_word - 1) / per_word;
+    uint32_t pixel = bytes_pp == 4 ? 0xFFFFFFFF : (1u << (8 * bytes_pp)) - 1;
+    uint32_t *masks = arena_alloc(&text_arena, FONT_HEIGHT * words * 4, 4);
+    const uint8_t *glyph = font_glyph(c);
+
+    for (uint32_t row = 0; row < FONT_HEIGHT; row++) {
+        uint32_t *mask = masks + row * words;
+
+        for (uint32_t w = 0; w < words; w++)
+            mask[w] = 0;
+        for (uint32_t px = 0; px < width; px++) {
+            if (!(glyph[row] & (1 << (px / size))))
+                continue;
+            uint32_t at = phase + px;
+            mask[at / per_word] |= pixel << (8 * bytes_pp * (at % per_word));
+        }
+    }
+
+    slot->key = key;
+    slot->words = words;
+    slot->masks = masks;
+    text_stats.glyphs++;
+    return slot;
+}
+
+static const text_glyph_t *text_lookup(char c, uint32_t size, uint32_t phase, uint32_t bytes_pp)
+{
+    uint8_t code = (uint8_t)c;
+
+    if (code < FONT_FIRST || code > FONT_LAST)
+        code = FONT_MISSING;
+
+    uint16_t key = code | phase << 7 | size << 9;
+    uint32_t slot = ((key * 2654435761u) >> 16) & (TEXT_CACHE_SLOTS - 1);
+
+    // Open addressing, text_reserve keeps free slots around
+    for (; text_slots[slot].key; slot = (slot + 1) & (TEXT_CACHE_SLOTS - 1)) {
+        if (text_slots[slot].key == key) {
+            text_stats.hits++;
+            return &text_slots[slot];
+        }
+    }
+
+    text_stats.misses++;
+    return text_expand(&text_slots[slot], key, code, size, phase, bytes_pp);
+}
+
+// Glyph partly outside the clip rect, or a target without word rows
+static void text_draw_clipped(const raster_target_t *target, const raster_clip_t *clip,
+                              int32_t x, int32_t y, char c, uint32_t size, uint32_t color)
+{
+    const uint8_t *glyph = font_glyph(c);
+
+    for (uint32_t row = 0; row < FONT_HEIGHT * size; row++) {
+        uint8_t bits = glyph[row / size];
+        for (uint32_t px = 0; bits && px < FONT_WIDTH * size; px++) {
+            if (bits & (1 << (px / size)))
+                raster_point(target, clip, x + px, y + row, color);
+        }
+    }
+}
+
+void text_draw(const raster_target_t *target, const raster_clip_t *clip,
+               int32_t x, int32_t y, const char *text, uint32_t length,
+               uint32_t size, uint32_t color)
+{
+    size = text_clamp_size(size);
+
+    int32_t width = FONT_WIDTH * size, height = FONT_HEIGHT * size;
+    int32_t y0 = y > clip->y0 ? y : clip->y0;
+    int32_t y1 = y + height < clip->y1 ? y + height : clip->y1;
+
+    if (y0 >= y1)
+        return;
+
+    uint32_t bytes_pp = target->bytes_pp, pitch = target->pitch;
+    uint32_t pattern = raster_pattern(bytes_pp, color);
+    bool words = !(pitch & 3) && !((uintptr_t)target->pixels & (bytes_pp - 1));
+
+    for (uint32_t first = 0; first < length; first += TEXT_CHUNK) {
+        const text_glyph_t *glyphs[TEXT_CHUNK];
+        uint32_t *dst[TEXT_CHUNK];
+        uint32_t count = length - first < TEXT_CHUNK ? length - first : TEXT_CHUNK;
+        uint32_t n = 0;
+
+        text_reserve(size, bytes_pp);
+        for (uint32_t i = 0; i < count; i++) {
+            int32_t gx = x + (int32_t)(first + i) * width;
+            char c = text[first + i];
+
+            if (gx >= clip->x1)
+                break;
+            if (gx + width <= clip->x0)
+                continue;
+            if (!words || gx < clip->x0 || gx + width > clip->x1) {
+                text_draw_clipped(target, clip, gx, y, c, size, color);
+                continue;
+            }
+
+            uint8_t *at = target->pixels + (uint32_t)y0 * pitch + (uint32_t)gx * bytes_pp;
+            uint32_t phase = ((uintptr_t)at & 3) / bytes_pp;
+
+            glyphs[n] = text_lookup(c, size, phase, bytes_pp);
+            dst[n++] = (uint32_t *)(at - phase * bytes_pp);
+        }
+
+        // Row by row across the run: whole words stored, the others merged
+        for (int32_t row = y0; row < y1; row++) {
+            uint32_t font_row = (row - y) / size;
+
+            for (uint32_t g = 0; g < n; g++) {
+                const uint32_t *mask = glyphs[g]->masks + font_row * glyphs[g]->words;
+                uint32_t *d = dst[g];
+
+                for (uint32_t w = 0; w < glyphs[g]->words; w++) {
+                    if (mask[w] == 0xFFFFFFFF)
+                        d[w] = pattern;
+                    else if (mask[w])
+                        d[w] = (d[w] & ~mask[w]) | (pattern & mask[w]);
+                }
+                dst[g] = (uint32_t *)((uint8_t *)d + pitch);
+            }
+        }
+
+        if (x + (int32_t)(first + count) * width >= clip->x1)
+            break;
+    }
+}
+
+void text_get_stats(text_cache_stats_t *stats)
+{
+    *stats = text_stats;
+    stats->bytes = text_arena.used;
+}
+
+void text_dump_stats(void)
+{
+    text_cache_stats_t stats;
+
+    text_get_stats(&stats);
+    k_printf("  hits %u, misses %u, flushes %u, %u glyphs in %u bytes\r\n",
+             stats.hits, stats.misses, stats.flushes, stats.glyphs, stats.bytes);
+}
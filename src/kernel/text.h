@@ -0,0 +1,54 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+/*
+ * Text runs
+ *
+ * Glyphs of the built-in font (font.h) scaled by an integer <size>. Each
+ * glyph is expanded once per size and pixel format into word masks in the
+ * target layout: one mask word per framebuffer word of a glyph row, for
+ * each alignment of the glyph inside the first word (8 and 16 bpp). A
+ * glyph is then drawn a word at a time, whole words stored directly,
+ * partial ones merged under their mask.
+ *
+ * A run is drawn row by row across all its glyphs, so the framebuffer is
+ * written in address order. Glyphs cut by the clip rect fall back to
+ * per-pixel drawing.
+ *
+ * The expanded glyphs live in a fixed cache, emptied when full or when
+ * the target depth changes. Callers serialize (draw.c holds draw_lock).
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "raster.h"
+#include "font.h"
+
+#define TEXT_SIZE_MAX           4       // 32x32 pixel glyphs
+#define TEXT_CACHE_BYTES        (64 * 1024)
+#define TEXT_CACHE_SLOTS        512     // power of two
+
+typedef struct {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t flushes;           // cache emptied
+    uint32_t glyphs;            // expanded glyphs cached
+    uint32_t bytes;             // of the cache memory in use
+} text_cache_stats_t;
+
+// Draw <length> characters of <text> at x,y, the top left corner of the
+// first glyph. <size> is clamped to 1..TEXT_SIZE_MAX.
+void text_draw(const raster_target_t *target, const raster_clip_t *clip,
+               int32_t x, int32_t y, const char *text, uint32_t length,
+               uint32_t size, uint32_t color);
+
+// Pixel width and height of a run, after clamping <size>
+uint32_t text_width(uint32_t length, uint32_t size);
+uint32_t text_height(uint32_t size);
+
+void text_get_stats(text_cache_stats_t *stats);
+void text_dump_stats(void);
+
+#endif // TEXT_H
@@ -0,0 +1,310 @@
+#include "timer.h"
+#include "io.h"
+#include "uart.h"
+#include "cpu.h"
+#include "spinlock.h"
+#include <stddef.h>
+
+#define TIMER_MATCH             (1 << IRQ_SYSTEM_TIMER_1)
+
+// No next event
+#define TIMER_NEVER             UINT64_MAX
+
+// Shortest wait programmed in the compare channel, so that it is not
+// passed before it is written, and the longest, under half the 32-bit
+// range for the signed compare against the counter
+#define TIMER_MIN_US            8
+#define TIMER_MAX_US            0x7FFFFFFFu
+
+// Slots of the levels, and a bit per slot in use
+static timer_event_t *timer_wheel[TIMER_LEVELS][TIMER_SLOTS];
+static uint64_t timer_used[TIMER_LEVELS];
+
+// Next tick to run, the ones before were
+static uint64_t timer_base;
+
+// Tick the compare channel is set for
+static uint64_t timer_programmed = TIMER_NEVER;
+
+static bool timer_ready;
+static spinlock_t timer_lock = SPINLOCK_INIT("timer");
+
+uint64_t timer_now(void)
+{
+    uint32_t hi, lo;
+
+    // CLO wrapped between the two reads of CHI : read again
+    do {
+        hi = mmio_read(SYSTEM_TIMER_CHI);
+        lo = mmio_read(SYSTEM_TIMER_CLO);
+    } while (hi != mmio_read(SYSTEM_TIMER_CHI));
+
+    return (uint64_t)hi << 32 | lo;
+}
+
+// First tick at or after the deadline
+static inline uint64_t timer_tick(uint64_t us)
+{
+    return (us + TIMER_TICK_US - 1) >> TIMER_TICK_SHIFT;
+}
+
+static void timer_link(timer_event_t *timer, uint32_t level, uint32_t slot)
+{
+    timer_event_t **head = &timer_wheel[level][slot];
+
+    timer->next = *head;
+    if (timer->next)
+        timer->next->pprev = &timer->next;
+    timer->pprev = head;
+    *head = timer;
+    timer->slot = level * TIMER_SLOTS + slot;
+    timer_used[level] |= 1ull << slot;
+}
+
+static void timer_unlink(timer_event_t *timer)
+{
+    uint32_t level = timer->slot / TIMER_SLOTS, slot = timer->slot % TIMER_SLOTS;
+
+    *timer->pprev = timer->next;
+    if (timer->next)
+        timer->next->pprev = timer->pprev;
+    timer->pprev = NULL;
+    if (!timer_wheel[level][slot])
+        timer_used[level] &= ~(1ull << slot);
+}
+
+// The slot of the first level whose range holds the deadline : the
+// bottom level for the next TIMER_SLOTS ticks, the one above for the
+// TIMER_SLOTS slots after, and so on. Slots above the bottom are never
+// the one of the base, already moved down.
+static void timer_insert(timer_event_t *timer)
+{
+    uint64_t tick = timer_tick(timer->deadline);
+    uint32_t level = 0;
+
+    if (tick < timer_base)
+        tick = timer_base;
+    while (level < TIMER_LEVELS &&
+           tick - timer_base >= 1ull << (TIMER_LEVEL_SHIFT * (level + 1)))
+        level++;
+
+    // Further than the wheel : parked at its end, inserted again from there
+    if (level == TIMER_LEVELS) {
+        level = TIMER_LEVELS - 1;
+        tick = timer_base + (1ull << (TIMER_LEVEL_SHIFT * TIMER_LEVELS)) - 1;
+    }
+
+    timer_link(timer, level, (tick >> (TIMER_LEVEL_SHIFT * level)) & (TIMER_SLOTS - 1));
+}
+
+// Tick of the next slot to run or move down, from the base on
+static uint64_t timer_next(void)
+{
+    uint64_t next = TIMER_NEVER;
+
+    for (uint32_t level = 0; level < TIMER_LEVELS; level++) {
+        if (!timer_used[level])
+            continue;
+
+        // The slots in turn from the first one starting at the base or
+        // after, a bitmap rotated to start there
+        uint32_t shift = TIMER_LEVEL_SHIFT * level;
+        uint64_t start = (timer_base + (1ull << shift) - 1) >> shift;
+        uint32_t first = start & (TIMER_SLOTS - 1);
+        uint64_t used = timer_used[level] >> first;
+        if (first)
+            used |= timer_used[level] << (TIMER_SLOTS - first);
+
+        uint64_t tick = (start + __builtin_ctzll(used)) << shift;
+        if (tick < next)
+            next = tick;
+    }
+    return next;
+}
+
+// The timers of a slot down to the levels below, its start reached
+static void timer_cascade(uint32_t level, uint32_t slot)
+{
+    timer_event_t *timer = timer_wheel[level][slot];
+
+    timer_wheel[level][slot] = NULL;
+    timer_used[level] &= ~(1ull << slot);
+    while (timer) {
+        timer_event_t *next = timer->next;
+        timer_insert(timer);
+        timer = next;
+    }
+}
+
+// Run the slots due by <now>, the handlers with the lock dropped
+static void timer_run(uint64_t now)
+{
+    uint64_t tick;
+
+    while ((tick = timer_next()) <= now >> TIMER_TICK_SHIFT) {
+        timer_base = tick;
+
+        // Higher levels first, their timers may land in the ones below
+        for (uint32_t level = TIMER_LEVELS - 1; level > 0; level--) {
+            uint32_t shift = TIMER_LEVEL_SHIFT * level;
+            if (!(tick & ((1ull << shift) - 1)))
+                timer_cascade(level, (tick >> shift) & (TIMER_SLOTS - 1));
+        }
+
+        // Timers added from here on are due from the next tick, the slot is
+        // taken out first : the one of the tick TIMER_SLOTS - 1 later
+        uint32_t slot = tick & (TIMER_SLOTS - 1);
+        timer_event_t *due = timer_wheel[0][slot], *timer;
+        timer_base = tick + 1;
+        timer_wheel[0][slot] = NULL;
+        timer_used[0] &= ~(1ull << slot);
+        if (due)
+            due->pprev = &due;
+
+        while ((timer = due)) {
+            timer_unlink(timer);
+            if (timer->period) {
+                timer->deadline += timer->period;
+                if (timer->deadline <= now)
+                    timer->deadline = now + timer->period;
+                timer_insert(timer);
+            }
+
+            irq_handler_t handler = timer->handler;
+            void *arg = timer->arg;
+            spin_unlock(&timer_lock);
+            handler(arg);
+            spin_lock(&timer_lock);
+        }
+    }
+}
+
+// Compare channel for the next slot, TIMER_MIN_US away at least
+static void timer_program(void)
+{
+    uint64_t next = timer_next();
+    uint64_t now = timer_now();
+    uint64_t at = next == TIMER_NEVER ? now + TIMER_MAX_US : next << TIMER_TICK_SHIFT;
+    uint32_t wait = TIMER_MAX_US;
+
+    if (at < now + TIMER_MIN_US)
+        wait = TIMER_MIN_US;
+    else if (at - now < TIMER_MAX_US)
+        wait = at - now;
+
+    uint32_t compare = (uint32_t)now + wait;
+    mmio_write(SYSTEM_TIMER_C1, compare);
+    // Passed while it was written : again from the counter
+    while ((int32_t)(compare - mmio_read(SYSTEM_TIMER_CLO)) <= 0) {
+        compare = mmio_read(SYSTEM_TIMER_CLO) + TIMER_MIN_US;
+        mmio_write(SYSTEM_TIMER_C1, compare);
+    }
+    timer_programmed = next;
+}
+
+static void timer_irq(void *arg)
+{
+    (void)arg;
+
+    mmio_write(SYSTEM_TIMER_CS, TIMER_MATCH);
+    spin_lock(&timer_lock);
+    timer_run(timer_now());
+    timer_program();
+    spin_unlock(&timer_lock);
+}
+
+void timer_init(void)
+{
+    irq_flags_t flags = spin_lock_irqsave(&timer_lock);
+    timer_base = timer_tick(timer_now());
+    timer_ready = true;
+    timer_program();
+    spin_unlock_irqrestore(&timer_lock, flags);
+
+    mmio_write(SYSTEM_TIMER_CS, TIMER_MATCH);
+    irq_register(IRQ_SYSTEM_TIMER_1, timer_irq, NULL);
+    irq_enable(IRQ_SYSTEM_TIMER_1);
+}
+
+// (Re)start <timer> at <deadline>, with the lock held
+static void timer_add(timer_event_t *timer, uint64_t deadline, uint32_t period,
+                      irq_handler_t handler, void *arg)
+{
+    if (timer->pprev)
+        timer_unlink(timer);
+    timer->deadline = deadline;
+    timer->period = period;
+    timer->handler = handler;
+    timer->arg = arg;
+    timer_insert(timer);
+
+    // Earlier than the channel is set for
+    if (timer_ready && timer_next() < timer_programmed)
+        timer_program();
+}
+
+void timer_after(timer_event_t *timer, uint32_t ms, irq_handler_t handler, void *arg)
+{
+    irq_flags_t flags = spin_lock_irqsave(&timer_lock);
+    timer_add(timer, timer_now() + (uint64_t)ms * 1000, 0, handler, arg);
+    spin_unlock_irqrestore(&timer_lock, flags);
+}
+
+bool timer_every(timer_event_t *timer, uint32_t period_us,
+                 irq_handler_t handler, void *arg)
+{
+    if (!period_us)
+        return false;
+
+    irq_flags_t flags = spin_lock_irqsave(&timer_lock);
+    timer_add(timer, timer_now() + period_us, period_us, handler, arg);
+    spin_unlock_irqrestore(&timer_lock, flags);
+    return true;
+}
+
+void timer_cancel(timer_event_t *timer)
+{
+    // A periodic timer is out of the wheel for a moment while it runs, the
+    // lock covers that
+    irq_flags_t flags = spin_lock_irqsave(&timer_lock);
+    if (timer->pprev)
+        timer_unlink(timer);
+    spin_unlock_irqrestore(&timer_lock, flags);
+}
+
+static void timer_wake(void *arg)
+{
+    *(volatile bool *)arg = true;
+    cpu_sev();
+}
+
+void timer_sleep(uint32_t ms)
+{
+    irq_flags_t flags = irq_save();
+    irq_restore(flags);
+
+    // Masked on core 0 the timer interrupt never runs : spin instead
+    if (!timer_ready || (core_id() == 0 && irq_flags_masked(flags))) {
+        uint64_t end = timer_now() + (uint64_t)ms * 1000;
+        while (timer_now() < end)
+            ;
+        return;
+    }
+
+    timer_event_t timer = { .pprev = NULL };
+    volatile bool done = false;
+
+    timer_after(&timer, ms, timer_wake, (void *)&done);
+    while (!done) {
+        if (core_id() == 0) {
+            // The interrupt wakes wfi even masked, then runs once unmasked
+            flags = irq_save();
+            if (!done)
+                cpu_wfi();
+            irq_restore(flags);
+        } else {
+            // Core 0 runs the timers, and sends the event
+            cpu_wfe();
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+/*
+ * System timer
+ *
+ * The 64-bit free running counter of the BCM system timer, 1MHz on all
+ * targets, and a timer wheel on its compare channel 1, one of the two the
+ * GPU leaves to the ARM, raising IRQ_SYSTEM_TIMER_1 on core 0.
+ *
+ * The wheel counts ticks of TIMER_TICK_US (1024us, a shift of the
+ * counter). Its TIMER_LEVELS levels have TIMER_SLOTS slots each, the
+ * slots of a level TIMER_SLOTS times as long as the ones below : a timer
+ * is added to the slot of its deadline in O(1), and moves down a level
+ * when the wheel reaches the start of its slot, until the bottom level
+ * calls it. A bitmap of the slots in use per level finds the next slot
+ * to run or move down, the compare channel is programmed for that one
+ * only : no interrupt while nothing is due.
+ *
+ * Timers are owned by the caller, and run from the timer interrupt, at
+ * most a tick late. Periodic timers are scheduled from their previous
+ * deadline so the period does not drift with the interrupt latency;
+ * deadlines missed while IRQs were masked are dropped, not replayed.
+ * A handler can add, restart or cancel timers, itself included.
+ *
+ * References :
+ * BCM2835 ARM Peripherals, chapter 12
+ * G. Varghese, T. Lauck, Hashed and Hierarchical Timing Wheels, 1987
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "interrupts.h"
+
+#define TIMER_TICK_SHIFT        10
+#define TIMER_TICK_US           (1 << TIMER_TICK_SHIFT)
+#define TIMER_LEVEL_SHIFT       6
+#define TIMER_SLOTS             (1 << TIMER_LEVEL_SHIFT)
+#define TIMER_LEVELS            4       // 4.8 hours, later deadlines wait at the top
+
+typedef struct timer_event {
+    struct timer_event *next;
+    struct timer_event **pprev;         // NULL while not pending
+    uint64_t deadline;                  // microseconds
+    uint32_t period;                    // microseconds, 0 for a one-shot
+    uint32_t slot;                      // level * TIMER_SLOTS + slot
+    irq_handler_t handler;
+    void *arg;
+} timer_event_t;
+
+// Microseconds since the counter started, at power on
+uint64_t timer_now(void);
+
+// Take the compare channel, timers run once IRQs are enabled
+void timer_init(void);
+
+// Call <handler> once in <ms> milliseconds. A pending timer is moved.
+void timer_after(timer_event_t *timer, uint32_t ms, irq_handler_t handler, void *arg);
+
+// Call <handler> every <period_us> microseconds, from one period from
+// now. False if the period is 0.
+bool timer_every(timer_event_t *timer, uint32_t period_us,
+                 irq_handler_t handler, void *arg);
+
+// No more calls, also from the handler itself. A handler already running
+// on core 0 finishes.
+void timer_cancel(timer_event_t *timer);
+
+static inline bool timer_pending(const timer_event_t *timer)
+{
+    return timer->pprev != 0;
+}
+
+// Sleep for <ms> milliseconds in wfi/wfe, interrupts are served meanwhile.
+// Spins on the counter before timer_init, and on core 0 with IRQs masked
+// as the timer interrupt would never run.
+void timer_sleep(uint32_t ms);
+
+#endif // TIMER_H
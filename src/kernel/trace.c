@@ -0,0 +1,138 @@
+#include "trace.h"
+#include "interrupts.h"
+#include "spinlock.h"
+#include "cache.h"
+#include "cpu.h"
+#include "timer.h"
+#include "clock.h"
+#include "crc32.h"
+#include "uart.h"
+
+typedef struct {
+    trace_record_t records[TRACE_RECORDS];
+    volatile uint32_t head;     // written by the core
+    volatile uint32_t tail;     // written by the drain
+    uint32_t dropped;
+} __attribute__((aligned(64))) trace_ring_t;
+
+typedef struct {
+    trace_frame_t header;
+    trace_record_t records[TRACE_FRAME_RECORDS];
+    uint32_t crc;               // moved after the last record
+} trace_buffer_t;
+
+// Start of the event section, 0 in the kernel where it is not loaded
+extern const char __start_trace_events[];
+
+static trace_ring_t trace_rings[CORES];
+static trace_buffer_t trace_buffer;
+static timer_event_t trace_timer;
+static uint32_t trace_next_core;
+
+// One drain at a time, the timer interrupt or an explicit call
+static spinlock_t trace_lock = SPINLOCK_INIT("trace");
+
+void trace_emit(const char *event, uint32_t a0, uint32_t a1, uint32_t a2,
+                uint32_t a3, uint32_t a4)
+{
+    // Interrupt handlers trace too, the core is the only producer while
+    // they are masked
+    irq_flags_t flags = irq_save();
+    trace_ring_t *ring = &trace_rings[core_id()];
+    uint32_t head = ring->head;
+
+    if (head - ring->tail >= TRACE_RECORDS) {
+        ring->dropped++;
+        irq_restore(flags);
+        return;
+    }
+
+    trace_record_t *record = &ring->records[head & (TRACE_RECORDS - 1)];
+    record->time = clock_ticks();
+    record->event = event - __start_trace_events;
+    record->args[0] = a0;
+    record->args[1] = a1;
+    record->args[2] = a2;
+    record->args[3] = a3;
+    record->args[4] = a4;
+
+    // The record is written before the drain sees it
+    dmb();
+    ring->head = head + 1;
+    irq_restore(flags);
+}
+
+// Frame of up to TRACE_FRAME_RECORDS records of <core>, 0 if none
+static uint32_t trace_frame(uint32_t core)
+{
+    trace_ring_t *ring = &trace_rings[core];
+    uint32_t tail = ring->tail;
+    uint32_t count = ring->head - tail;
+
+    if (!count)
+        return 0;
+    if (count > TRACE_FRAME_RECORDS)
+        count = TRACE_FRAME_RECORDS;
+
+    // The records before head were written
+    dmb();
+    for (uint32_t i = 0; i < count; i++)
+        trace_buffer.records[i] = ring->records[(tail + i) & (TRACE_RECORDS - 1)];
+
+    // Read before the core may write over them
+    dmb();
+    ring->tail = tail + count;
+
+    trace_buffer.header = (trace_frame_t){
+        .magic = TRACE_MAGIC,
+        .core = core,
+        .count = count,
+        .clock_hz = clock_hz(),
+        .dropped = ring->dropped,
+    };
+
+    uint32_t size = sizeof(trace_frame_t) + count * sizeof(trace_record_t);
+    uint32_t crc = crc32(&trace_buffer, size);
+    uint8_t *end = (uint8_t *)&trace_buffer + size;
+    for (uint32_t i = 0; i < 4; i++)
+        end[i] = crc >> (8 * i);
+    return size + 4;
+}
+
+uint32_t trace_drain(void)
+{
+    uint32_t sent = 0, idle = 0;
+
+    if (!spin_trylock(&trace_lock))
+        return 0;
+
+    // Cores in turn, so that a busy one does not hold back the others
+    while (idle < CORES && uart_tx_room() >= sizeof(trace_buffer)) {
+        uint32_t core = trace_next_core;
+        trace_next_core = (core + 1) % CORES;
+
+        uint32_t size = trace_frame(core);
+        if (!size) {
+            idle++;
+            continue;
+        }
+        idle = 0;
+        uart_write((const char *)&trace_buffer, size);
+        sent += trace_buffer.header.count;
+    }
+
+    spin_unlock(&trace_lock);
+    return sent;
+}
+
+static void trace_tick(void *arg)
+{
+    (void)arg;
+
+    trace_drain();
+}
+
+bool trace_init(void)
+{
+    return timer_every(&trace_timer, TRACE_DRAIN_US, trace_tick, NULL);
+}
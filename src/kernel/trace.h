@@ -0,0 +1,87 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/*
+ * Event tracing
+ *
+ * TRACE_INSTANT, TRACE_BEGIN and TRACE_END append a record to a ring of
+ * the running core: a 64-bit timestamp, the event and TRACE_ARGS 32-bit
+ * arguments, 32 bytes stored with IRQs masked and nothing formatted. The
+ * event is a string, its phase, name and the printf format of its
+ * arguments, placed in the trace_events section. The linker keeps that
+ * section out of the kernel image, records carry offsets into it.
+ *
+ * A periodic timer (timer.h) drains the rings every TRACE_DRAIN_US, as
+ * frames queued on the UART when it has room for them. tools/trace_decode.py
+ * picks the frames out of a capture of the serial output and turns them
+ * into Chrome trace JSON (chrome://tracing, Perfetto), reading the
+ * events back from kernel.elf. A core whose ring is full drops its new
+ * records, the frames count them.
+ *
+ * Built with TRACE=1, the macros are empty otherwise. Arguments are cast
+ * to uint32_t, pointers included.
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TRACE_ARGS              5
+#define TRACE_RECORDS           512     // per core, power of two
+#define TRACE_FRAME_RECORDS     16      // most records in a frame
+#define TRACE_DRAIN_US          10000
+
+// "PTRC" as a little endian word
+#define TRACE_MAGIC             0x43525450
+
+typedef struct {
+    uint64_t time;              // clocksource ticks (clock.h)
+    uint32_t event;             // offset in trace_events
+    uint32_t args[TRACE_ARGS];
+} trace_record_t;
+
+// Followed by <count> records and the CRC32 of the header and records
+typedef struct {
+    uint32_t magic;
+    uint16_t core;
+    uint16_t count;
+    uint32_t clock_hz;
+    uint32_t dropped;           // by the core since boot
+} trace_frame_t;
+
+#if TRACE
+
+#define TRACE_ARGS_(_, a, b, c, d, e, ...)                                     \
+    (uint32_t)(uintptr_t)(a), (uint32_t)(uintptr_t)(b),                        \
+    (uint32_t)(uintptr_t)(c), (uint32_t)(uintptr_t)(d), (uint32_t)(uintptr_t)(e)
+
+#define TRACE_EVENT_(phase, name, format, ...)                                 \
+    do {                                                                       \
+        static const char trace_event_[]                                       \
+            __attribute__((section("trace_events"), used)) =                   \
+            phase name "\0" format;                                            \
+        trace_emit(trace_event_, TRACE_ARGS_(0, ##__VA_ARGS__, 0, 0, 0, 0, 0));\
+    } while (0)
+
+#else
+
+#define TRACE_EVENT_(phase, name, format, ...) do { } while (0)
+
+#endif
+
+// An event at one point in time, and the two ends of a span on a core
+#define TRACE_INSTANT(name, format, ...) TRACE_EVENT_("i", name, format, ##__VA_ARGS__)
+#define TRACE_BEGIN(name, format, ...)   TRACE_EVENT_("B", name, format, ##__VA_ARGS__)
+#define TRACE_END(name)                  TRACE_EVENT_("E", name, "")
+
+// Start the periodic drain, once the UART has its interrupt, crc32 its
+// tables and the timers their channel
+bool trace_init(void);
+
+void trace_emit(const char *event, uint32_t a0, uint32_t a1, uint32_t a2,
+                uint32_t a3, uint32_t a4);
+
+// Queue what fits on the UART, returns the records sent
+uint32_t trace_drain(void);
+
+#endif // TRACE_H
@@ -1,11 +1,101 @@
 #if USE_MINI_UART == 0 || !defined USE_MINI_UART
 #include "uart.h"
+#include "spinlock.h"
+#include "atomic.h"
+#include "interrupts.h"
+#include "ring.h"
+#include "mailbox.h"
+#include "cache.h"
+#include "dma.h"
 
 #include <stddef.h>
 #include <stdint.h>
 
 // More info on OSDev wiki : https://wiki.osdev.org/Raspberry_Pi_Bare_Bones
 
+// Flag register
+#define UART_FR_RXFE		(1 << 4)
+#define UART_FR_TXFF		(1 << 5)
+
+// Interrupt mask, status and clear registers
+#define UART_INT_RX		(1 << 4)
+#define UART_INT_TX		(1 << 5)
+#define UART_INT_RT		(1 << 6)
+
+// FIFO levels : TX interrupt at 1/4 full, RX at 1/2 full
+#define UART_IFLS_TX_1_4	(1 << 0)
+#define UART_IFLS_RX_1_2	(2 << 3)
+
+// DMA control : TX DREQ on
+#define UART_DMACR_TX		(1 << 1)
+
+// Reference clock when the firmware does not tell, the one of its older
+// releases, and the one asked for when the line is too fast for it
+#define UART_CLOCK_DEFAULT	3000000
+#define UART_CLOCK_FAST		48000000
+
+// Bytes sent by the DMA engine rather than the TX interrupt from that
+// many queued, and at most in one transfer
+#define UART_DMA_MIN		64
+#define UART_DMA_MAX		1024
+
+// Keeps the transmit ring to one writer at a time
+static spinlock_t uart_lock = SPINLOCK_INIT("uart");
+
+static uint8_t uart_tx_data[UART_TX_RING];
+static uint8_t uart_rx_data[UART_RX_RING];
+static ring_t uart_tx, uart_rx;
+
+// The one reader of the transmit ring, a writer or the interrupt handler
+static atomic_t uart_tx_owner = ATOMIC_INIT(0);
+
+static volatile bool uart_irq_on;	// rings in use
+static volatile bool uart_polled;	// drained, no more rings
+static uint32_t uart_baud;
+
+// The DR takes one character per 32-bit write, the narrowest the DMA
+// engine makes
+static uint32_t uart_dma_data[UART_DMA_MAX] __attribute__((aligned(64)));
+static dma_cb_t uart_dma_cb;
+static int32_t uart_dma_channel = -1;
+static volatile bool uart_dma_active;
+
+// Divisor of the reference clock for UART_BAUD, in 1/64ths :
+// clock / (16 * baud), the fraction in FBRD
+static void uart_set_divisor(void)
+{
+	uint32_t clock = mailbox_get_id(MAILBOX_TAG_GET_CLOCK_RATE, MAIL_CLOCK_UART);
+
+	// 16 clocks per bit at least
+	if (clock && clock < 16 * UART_BAUD) {
+		struct {
+			mailbox_tag_t tag;
+			uint32_t id;
+			uint32_t rate;
+			uint32_t skip_turbo;
+		} cmd = {
+			.tag = { MAILBOX_TAG_SET_CLOCK_RATE, 12, 0 },
+			.id = MAIL_CLOCK_UART,
+			.rate = UART_CLOCK_FAST,
+		};
+		mailbox_process(&cmd.tag, sizeof(cmd));
+		if (cmd.rate)
+			clock = cmd.rate;
+	}
+	if (!clock)
+		clock = UART_CLOCK_DEFAULT;
+
+	uint32_t divisor = (clock * 4 + UART_BAUD / 2) / UART_BAUD;
+	if (divisor < 64)
+		divisor = 64;
+	if (divisor > 0xFFFF * 64 + 63)
+		divisor = 0xFFFF * 64 + 63;
+
+	mmio_write(UART0_IBRD, divisor >> 6);
+	mmio_write(UART0_FBRD, divisor & 63);
+	uart_baud = clock * 4 / divisor;
+}
+
 void uart_init()
 {
 	// Disable UART0.
@@ -25,50 +115,247 @@ void uart_init()
 	// Clear pending interrupts.
 	mmio_write(UART0_ICR, 0x7FF);
 
-	// Set integer & fractional part of baud rate.
-	// Divider = UART_CLOCK/(16 * Baud)
-	// Fraction part register = (Fractional part * 64) + 0.5
-	// UART_CLOCK = 3000000; Baud = 115200.
-
-	// Divider = 3000000 / (16 * 115200) = 1.627 = ~1.
-	// Fractional part register = (.627 * 64) + 0.5 = 40.6 = ~40.
-	mmio_write(UART0_IBRD, 1);
-	mmio_write(UART0_FBRD, 40);
+	// Set integer & fractional part of baud rate, from the clock the
+	// firmware gave the UART. LCRH latches them.
+	uart_set_divisor();
 
 	// Enable FIFO & 8 bit data transmissio (1 stop bit, no parity).
 	mmio_write(UART0_LCRH, (1 << 4) | (1 << 5) | (1 << 6));
 
-	// Mask all interrupts.
-	mmio_write(UART0_IMSC, (1 << 1) | (1 << 4) | (1 << 5) | (1 << 6) |
-	                       (1 << 7) | (1 << 8) | (1 << 9) | (1 << 10));
+	// Interrupt at 1/4 full TX FIFO, 1/2 full RX FIFO.
+	mmio_write(UART0_IFLS, UART_IFLS_TX_1_4 | UART_IFLS_RX_1_2);
+
+	// Mask all interrupts, uart_irq_init unmasks them.
+	mmio_write(UART0_IMSC, 0);
 
 	// Enable UART0, receive & transfer part of UART.
 	mmio_write(UART0_CR, (1 << 0) | (1 << 8) | (1 << 9));
 }
 
-void uart_putc(char byte)
+static void uart_send(char byte)
 {
 	// Wait for UART to become ready to transmit.
-	while (mmio_read(UART0_FR) & (1 << 5)) { }
+	while (mmio_read(UART0_FR) & UART_FR_TXFF) { }
 	mmio_write(UART0_DR, byte);
 }
 
+// Hand up to UART_DMA_MAX bytes of the ring to the DMA engine
+static void uart_dma_start(void)
+{
+	const uint8_t *data;
+	uint32_t size, count = 0;
+
+	while (count < UART_DMA_MAX && (size = ring_peek(&uart_tx, &data)) != 0) {
+		if (size > UART_DMA_MAX - count)
+			size = UART_DMA_MAX - count;
+		for (uint32_t i = 0; i < size; i++)
+			uart_dma_data[count + i] = data[i];
+		ring_consume(&uart_tx, size);
+		count += size;
+	}
+	dcache_clean_range(uart_dma_data, count * sizeof(uint32_t));
+
+	uart_dma_cb.ti = DMA_TI_INTEN | DMA_TI_WAIT_RESP | DMA_TI_DEST_DREQ |
+	                 DMA_TI_SRC_INC | DMA_TI_PERMAP(DMA_DREQ_UART_TX);
+	uart_dma_cb.source = dma_bus_address(uart_dma_data);
+	uart_dma_cb.dest = dma_peripheral_address(UART0_DR);
+	uart_dma_cb.length = count * sizeof(uint32_t);
+	uart_dma_cb.stride = 0;
+	uart_dma_cb.next = 0;
+
+	uart_dma_active = true;
+	dma_start(uart_dma_channel, &uart_dma_cb);
+}
+
+// Move bytes from the ring to the TX FIFO until one of them is full, and
+// leave the TX interrupt on if bytes are left, or to the DMA engine when
+// there are enough of them. True when an interrupt will ask for more.
+// Only the owner calls it.
+static bool uart_tx_fill(void)
+{
+	const uint8_t *data;
+	uint32_t size;
+
+	// A finished transfer is taken here too, its interrupt may be masked
+	// on this core by a writer waiting for room
+	if (uart_dma_active) {
+		if (dma_busy(uart_dma_channel))
+			return true;
+		dma_ack(uart_dma_channel);
+		uart_dma_active = false;
+	}
+
+	if (uart_dma_channel >= 0 && ring_used(&uart_tx) >= UART_DMA_MIN) {
+		uart_dma_start();
+		mmio_write(UART0_IMSC, UART_INT_RX | UART_INT_RT);
+		return true;
+	}
+
+	while ((size = ring_peek(&uart_tx, &data)) != 0) {
+		uint32_t sent = 0;
+		while (sent < size && !(mmio_read(UART0_FR) & UART_FR_TXFF))
+			mmio_write(UART0_DR, data[sent++]);
+		ring_consume(&uart_tx, sent);
+		if (sent < size)
+			break;
+	}
+
+	bool more = !ring_empty(&uart_tx);
+	mmio_write(UART0_IMSC, UART_INT_RX | UART_INT_RT | (more ? UART_INT_TX : 0));
+	return more;
+}
+
+// Refill the TX FIFO unless someone else is at it
+static void uart_tx_kick(void)
+{
+	bool armed;
+
+	do {
+		if (atomic_xchg(&uart_tx_owner, 1))
+			return;
+		armed = uart_tx_fill();
+		dmb();
+		atomic_set(&uart_tx_owner, 0);
+		// Bytes queued by a writer that found the ring owned, after the
+		// fill saw it empty : nobody else will send them
+	} while (!armed && !ring_empty(&uart_tx));
+}
+
+static void uart_irq(void *arg)
+{
+	(void)arg;
+
+	uint32_t status = mmio_read(UART0_MIS);
+
+	if (status & (UART_INT_RX | UART_INT_RT)) {
+		// Reading the FIFO empty clears both
+		while (!(mmio_read(UART0_FR) & UART_FR_RXFE)) {
+			// Dropped when the reader is behind
+			uint8_t byte = mmio_read(UART0_DR);
+			ring_put(&uart_rx, &byte, 1);
+		}
+	}
+
+	if (status & UART_INT_TX) {
+		mmio_write(UART0_ICR, UART_INT_TX);
+		uart_tx_kick();
+	}
+}
+
+// End of a transfer, taken by the next fill
+static void uart_dma_irq(void *arg)
+{
+	(void)arg;
+
+	uart_tx_kick();
+}
+
+void uart_irq_init()
+{
+	ring_init(&uart_tx, uart_tx_data, sizeof(uart_tx_data));
+	ring_init(&uart_rx, uart_rx_data, sizeof(uart_rx_data));
+
+	uart_dma_channel = dma_channel_alloc();
+	if (uart_dma_channel >= 0) {
+		irq_register(IRQ_DMA(uart_dma_channel), uart_dma_irq, NULL);
+		irq_enable(IRQ_DMA(uart_dma_channel));
+		mmio_write(UART0_DMACR, UART_DMACR_TX);
+	}
+
+	irq_register(IRQ_UART, uart_irq, NULL);
+	mmio_write(UART0_ICR, 0x7FF);
+	mmio_write(UART0_IMSC, UART_INT_RX | UART_INT_RT);
+	irq_enable(IRQ_UART);
+	uart_irq_on = true;
+}
+
+void uart_putc(char byte)
+{
+	uart_write(&byte, 1);
+}
+
 char uart_getc()
 {
-    // Wait for UART to have recieved something.
-    while (mmio_read(UART0_FR) & (1 << 4)) { }
-    return mmio_read(UART0_DR);
+	if (uart_irq_on && !uart_polled) {
+		uint8_t byte;
+		while (!ring_get(&uart_rx, &byte, 1)) { }
+		return byte;
+	}
+
+	// Wait for UART to have recieved something.
+	while (mmio_read(UART0_FR) & UART_FR_RXFE) { }
+	return mmio_read(UART0_DR);
 }
 
 void uart_write(const char *buffer, size_t size)
 {
-	for (size_t i = 0; i < size; i++)
-		uart_putc(buffer[i]);
+	// No lock once drained, its holder may never release it
+	if (uart_polled) {
+		for (size_t i = 0; i < size; i++)
+			uart_send(buffer[i]);
+		return;
+	}
+
+	irq_flags_t flags = spin_lock_irqsave(&uart_lock);
+	if (!uart_irq_on) {
+		for (size_t i = 0; i < size; i++)
+			uart_send(buffer[i]);
+	} else {
+		// A full ring is sent by this writer as the FIFO empties,
+		// the interrupt handler may not run on this core
+		while (size) {
+			uint32_t queued = ring_put(&uart_tx, buffer, size);
+			buffer += queued;
+			size -= queued;
+			uart_tx_kick();
+		}
+	}
+	spin_unlock_irqrestore(&uart_lock, flags);
 }
 
 void uart_puts(const char *str)
 {
-    while (*str != 0)
-        uart_putc(*str++);
+	size_t size = 0;
+
+	while (str[size] != 0)
+		size++;
+	uart_write(str, size);
+}
+
+void uart_drain()
+{
+	const uint8_t *data;
+	uint32_t size;
+
+	uart_polled = true;
+	mmio_write(UART0_IMSC, 0);
+	if (!uart_irq_on)
+		return;
+
+	// The transfer under way goes out first
+	if (uart_dma_active)
+		while (dma_busy(uart_dma_channel)) { }
+
+	while ((size = ring_peek(&uart_tx, &data)) != 0) {
+		for (uint32_t i = 0; i < size; i++)
+			uart_send(data[i]);
+		ring_consume(&uart_tx, size);
+	}
 }
-#endif // USE_MINI_UART == 0 || !defined USE_MINI_UART
\ No newline at end of file
+
+size_t uart_tx_room()
+{
+	return uart_irq_on && !uart_polled ? ring_space(&uart_tx) : 0;
+}
+
+uint32_t uart_get_baud()
+{
+	return uart_baud;
+}
+
+bool uart_dma_enabled()
+{
+	return uart_dma_channel >= 0;
+}
+
+#endif // USE_MINI_UART == 0 || !defined USE_MINI_UART
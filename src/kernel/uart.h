@@ -5,6 +5,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 // Memory-Mapped I/O output
 static inline void mmio_write(uint32_t reg, uint32_t data)
@@ -25,10 +26,44 @@ static inline void delay(int32_t count)
 		 : "=r"(count): [count]"0"(count) : "cc");
 }
 
+// Line speed set by uart_init, 8N1. The PL011 divides a clock the
+// firmware is asked to raise to 48MHz for lines over 1/16th of it, up to
+// 3000000 baud, the mini UART divides the core clock by 8 at least.
+#ifndef UART_BAUD
+#define UART_BAUD 115200
+#endif
+
+// Bytes queued for sending, and received but not read yet
+#define UART_TX_RING 4096
+#define UART_RX_RING 256
+
 void uart_init();
+
+// From here on writes are queued in a ring and sent by the UART interrupt
+// as the TX FIFO empties, reads come from a ring it fills. Before, both
+// poll. Call once the interrupt controller is set up.
+void uart_irq_init();
+
+// Return once the bytes are queued, or sent when the UART still polls.
+// A writer finding the ring full sends what it needs room for itself.
 void uart_putc(char byte);
-char uart_getc();
 void uart_write(const char *buffer, size_t size);
 void uart_puts(const char *str);
 
+// Bytes uart_write queues without waiting, 0 while it polls
+size_t uart_tx_room();
+
+// Wait for a byte, one reader at a time
+char uart_getc();
+
+// Send the queued bytes, and every later one, by polling and without
+// taking a lock, for fatal exception reports
+void uart_drain();
+
+// Line speed the divisors give, closest to UART_BAUD
+uint32_t uart_get_baud();
+
+// The queue is sent by a DMA channel when long enough (PL011 only)
+bool uart_dma_enabled();
+
 #endif // __UART_H__
@@ -1,6 +1,8 @@
 #include "video.h"
 #include "mailbox.h"
-#include "k_libc/k_stdio.h"
+
+// Set by the firmware in value_length once it handled a tag
+#define VIDEO_TAG_RESPONSE      0x80000000
 
 typedef struct {
     mailbox_tag_t tag;
@@ -24,16 +26,28 @@ typedef struct {
     uint32_t value;
 } mailbox_fb_pitch_t;
 
+typedef struct {
+    mailbox_tag_t tag;
+    uint32_t x;
+    uint32_t y;
+} mailbox_fb_offset_t;
+
+typedef struct {
+    mailbox_tag_t tag;
+    uint32_t offset;            // response : 0 valid, 1 invalid
+    uint32_t length;
+    uint32_t colors[FB_PALETTE_SIZE];
+} mailbox_fb_palette_t;
+
 typedef struct {
     mailbox_fb_size_t native_res;
     mailbox_fb_size_t virtual_res;
     mailbox_fb_depth_t depth;
+    mailbox_fb_offset_t offset;
     mailbox_fb_buffer_t buffer;
     mailbox_fb_pitch_t pitch;
 } mailbox_fb_request_t;
 
-static mailbox_fb_request_t fb_req;
-
 uint32_t rgba_to_uint32(uint8_t r, uint8_t g, uint8_t b, uint8_t a)
 {
     uint32_t col = r;
@@ -53,9 +67,10 @@ void uint32_to_rgba(uint32_t rgb, uint8_t *r, uint8_t *g, uint8_t *b, uint8_t *a
     *a = (rgb & 0xFF000000) >> 24;
 }
 
-void video_set_resolution(uint32_t width, uint32_t height, uint32_t depth)
+bool video_set_resolution(fb_info_t *fb, uint32_t width, uint32_t height, uint32_t depth,
+                          uint32_t buffers)
 {
-    mailbox_fb_request_t req;
+    mailbox_fb_request_t fb_req;
 
     fb_req.native_res.tag.id = MAILBOX_TAG_SET_PHYSICAL_WIDTH_HEIGHT;
     fb_req.native_res.tag.buffer_size = 8;
@@ -63,17 +78,24 @@ void video_set_resolution(uint32_t width, uint32_t height, uint32_t depth)
     fb_req.native_res.width = width;
     fb_req.native_res.height = height;
 
+    // The buffers are stacked vertically, shown with the virtual offset
     fb_req.virtual_res.tag.id = MAILBOX_TAG_SET_VIRTUAL_WIDTH_HEIGHT;
     fb_req.virtual_res.tag.buffer_size = 8;
     fb_req.virtual_res.tag.value_length = 8;
     fb_req.virtual_res.width = width;
-    fb_req.virtual_res.height = height;
+    fb_req.virtual_res.height = height * buffers;
 
     fb_req.depth.tag.id = MAILBOX_TAG_SET_COLOUR_DEPTH;
     fb_req.depth.tag.buffer_size = 4;
     fb_req.depth.tag.value_length = 4;
     fb_req.depth.value = depth;
 
+    fb_req.offset.tag.id = MAILBOX_TAG_SET_VIRTUAL_OFFSET;
+    fb_req.offset.tag.buffer_size = 8;
+    fb_req.offset.tag.value_length = 8;
+    fb_req.offset.x = 0;
+    fb_req.offset.y = 0;
+
     fb_req.buffer.tag.id = MAILBOX_TAG_ALLOCATE_FRAMEBUFFER;
     fb_req.buffer.tag.buffer_size = 8;
     fb_req.buffer.tag.value_length = 4;
@@ -86,5 +108,41 @@ void video_set_resolution(uint32_t width, uint32_t height, uint32_t depth)
     fb_req.pitch.value = 0;
 
     mailbox_process((mailbox_tag_t *)&fb_req, sizeof(fb_req));
-    k_printf("Allocated buffer : %X - %d\n", fb_req.buffer.base, fb_req.buffer.screen_size);
-}
\ No newline at end of file
+
+    // The firmware may settle for a smaller virtual size when short of memory
+    if (!fb_req.buffer.base || !fb_req.pitch.value
+        || fb_req.virtual_res.height < height * buffers)
+        return false;
+
+    fb->width = fb_req.native_res.width;
+    fb->height = fb_req.native_res.height;
+    fb->vWidth = fb_req.virtual_res.width;
+    fb->vHeight = fb_req.virtual_res.height;
+    fb->pitch = fb_req.pitch.value;
+    fb->depth = fb_req.depth.value;
+    fb->xOffset = 0;
+    fb->yOffset = 0;
+    fb->fb = fb_req.buffer.base;
+    fb->fbSize = fb_req.buffer.screen_size;
+    return true;
+}
+
+bool video_set_palette(uint32_t first, uint32_t count, const uint32_t *colors)
+{
+    mailbox_fb_palette_t cmd;
+
+    if (!count || first >= FB_PALETTE_SIZE || count > FB_PALETTE_SIZE - first)
+        return false;
+
+    cmd.tag.id = MAILBOX_TAG_SET_PALETTE;
+    cmd.tag.buffer_size = 8 + count * 4;
+    cmd.tag.value_length = 8 + count * 4;
+    cmd.offset = first;
+    cmd.length = count;
+    for (uint32_t i = 0; i < count; i++)
+        cmd.colors[i] = colors[i];
+
+    // Only the entries sent
+    mailbox_process(&cmd.tag, sizeof(cmd.tag) + 8 + count * 4);
+    return (cmd.tag.value_length & VIDEO_TAG_RESPONSE) && cmd.offset == 0;
+}
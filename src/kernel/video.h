@@ -2,6 +2,9 @@
 #define __VIDEO__
 
 #include <stdint.h>
+#include <stdbool.h>
+
+#include "framebuffer.h"
 
 #define RED_CHANNEL    0x000000FF
 #define GREEN_CHANNEL  0x0000FF00
@@ -10,6 +13,14 @@
 
 uint32_t rgba_to_uint32(uint8_t r, uint8_t g, uint8_t b, uint8_t a);
 void uint32_to_rgba(uint32_t rgb, uint8_t *r, uint8_t *g, uint8_t *b, uint8_t *a);
-void video_set_resolution(uint32_t width, uint32_t height, uint32_t depth);
+
+// Allocate <buffers> frames of width*height stacked in one virtual
+// framebuffer, the first one shown. False if the firmware refused.
+bool video_set_resolution(fb_info_t *fb, uint32_t width, uint32_t height, uint32_t depth,
+                          uint32_t buffers);
+
+// Load palette entries <first> to <first> + <count> - 1 (8 bpp modes),
+// <colors> as rgba_to_uint32 builds them. False if the firmware refused.
+bool video_set_palette(uint32_t first, uint32_t count, const uint32_t *colors);
 
 #endif // __VIDEO__
\ No newline at end of file
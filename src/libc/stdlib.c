@@ -4,4 +4,19 @@
 void itoa(int n, char * s)
 {
     return k_itoa(n, s);
+}
+
+void *malloc(size_t size)
+{
+    return k_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    return k_calloc(count, size);
+}
+
+void free(void *ptr)
+{
+    k_free(ptr);
 }
\ No newline at end of file
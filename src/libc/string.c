@@ -8,5 +8,20 @@ uint32_t strlen(char * s)
 
 void *memcpy(void *dest, const void * src, size_t n)
 {
-    k_memcpy(dest, src, n);
+    return k_memcpy(dest, src, n);
+}
+
+void *memmove(void *dest, const void *src, size_t n)
+{
+    return k_memmove(dest, src, n);
+}
+
+void *memset(void *dest, int c, size_t n)
+{
+    return k_memset(dest, c, n);
+}
+
+int memcmp(const void *s1, const void *s2, size_t n)
+{
+    return k_memcmp(s1, s2, n);
 }
\ No newline at end of file
@@ -0,0 +1,353 @@
+#!/usr/bin/env python3
+"""
+PIP-OS Boot Display Unit Tests
+
+This script compiles the kernel's matrix rain together with the real
+framebuffer.c and fbcon.c in a host environment, with the frames in host
+memory, and runs the rain from its timer handler up to the hand over to
+the console. The locks count their holders : taking one already held,
+which hangs the kernel, is reported instead.
+"""
+
+import subprocess
+import sys
+import os
+import tempfile
+import ctypes
+
+# Color codes for output
+GREEN = '\033[0;32m'
+RED = '\033[0;31m'
+YELLOW = '\033[1;33m'
+NC = '\033[0m'  # No Color
+
+def print_result(passed, test_name):
+    """Print test result with color"""
+    if passed:
+        print(f"{GREEN}✓{NC} {test_name}")
+        return True
+    else:
+        print(f"{RED}✗{NC} {test_name}")
+        return False
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+KERNEL_DIR = os.path.join(SCRIPT_DIR, '..', 'src', 'kernel')
+SOURCES = [os.path.join(KERNEL_DIR, name) for name in
+           ('font.c', 'raster.c', 'dirty.c', os.path.join('k_libc', 'k_string.c'))]
+
+# Everything below the framebuffer: the mailbox keeps the virtual offset,
+# video_set_resolution maps the frames below 1GB (fb_info_t holds 32-bit
+# addresses), the timer runs when the test says so.
+STUBS = r'''
+#define _GNU_SOURCE
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/mman.h>
+
+#define __INTERRUPTS_H__
+typedef uintptr_t irq_flags_t;
+typedef void (*irq_handler_t)(void *arg);
+
+#define SPINLOCK_H
+typedef struct { int held; const char *name; } spinlock_t;
+#define SPINLOCK_INIT(lock_name) { 0, lock_name }
+uint32_t test_deadlocks;    // a lock taken by its holder, the core would hang there
+uint32_t test_lock_errors;
+static void spin_lock(spinlock_t *lock)
+{
+    if (lock->held)
+        test_deadlocks++;
+    lock->held++;
+}
+static bool spin_trylock(spinlock_t *lock)
+{
+    if (lock->held)
+        return false;
+    lock->held = 1;
+    return true;
+}
+static void spin_unlock(spinlock_t *lock)
+{
+    test_lock_errors += lock->held-- != 1;
+}
+
+#define CPU_H
+uint32_t test_cycles;
+static inline uint32_t cpu_cycles(void) { return test_cycles += 100; }
+
+#define CACHE_H
+static inline void dcache_clean_invalidate_range(const void *start, size_t size) { (void)start; (void)size; }
+static inline void dcache_invalidate_range(const void *start, size_t size) { (void)start; (void)size; }
+
+#include "mailbox.h"
+#include "video.h"
+#include "draw.h"
+#include "timer.h"
+#include "k_libc/k_stdio.h"
+
+int32_t test_offset = -1;
+
+void mailbox_process(mailbox_tag_t *tag, uint32_t tag_size)
+{
+    (void)tag_size;
+    if (tag->id == MAILBOX_TAG_SET_VIRTUAL_OFFSET)
+        test_offset = ((uint32_t *)tag)[4];
+}
+bool mailbox_try_process(mailbox_tag_t *tag, uint32_t tag_size)
+{
+    mailbox_process(tag, tag_size);
+    return true;
+}
+uint32_t mailbox_call(uint32_t message, MAILBOX_CHANNEL channel) { (void)message; (void)channel; return 0; }
+uint32_t mailbox_get_id(uint32_t tag_id, uint32_t id) { (void)tag_id; (void)id; return 0; }
+// No vsync, as on emulators
+void mailbox_batch_init(mailbox_batch_t *batch) { batch->length = 2; batch->overflow = false; }
+uint32_t *mailbox_batch_add(mailbox_batch_t *batch, uint32_t tag_id, uint32_t words)
+{
+    (void)tag_id; (void)words;
+    return &batch->buffer[5];
+}
+bool mailbox_batch_process(mailbox_batch_t *batch) { (void)batch; return false; }
+bool mailbox_batch_answered(const uint32_t *value) { (void)value; return false; }
+
+bool video_set_resolution(fb_info_t *fb, uint32_t width, uint32_t height, uint32_t depth,
+                          uint32_t frames)
+{
+    uint32_t pitch = width * depth / 8;
+    void *p = mmap((void *)0x30000000, pitch * height * frames, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (p == MAP_FAILED)
+        return false;
+    fb->width = fb->vWidth = width;
+    fb->height = height;
+    fb->vHeight = height * frames;
+    fb->depth = depth;
+    fb->pitch = pitch;
+    fb->xOffset = fb->yOffset = 0;
+    fb->fb = (uint32_t)(uintptr_t)p;
+    fb->fbSize = pitch * height * frames;
+    return true;
+}
+bool video_set_palette(uint32_t first, uint32_t count, const uint32_t *colors)
+{
+    (void)first; (void)count; (void)colors;
+    return true;
+}
+
+static fb_info_t *test_draw_target;
+bool draw_set_target(fb_info_t *fb) { test_draw_target = fb; return true; }
+fb_info_t *draw_get_target(void) { return test_draw_target; }
+void draw_begin_frame(const uint8_t *front, const dirty_map_t *stale) { (void)front; (void)stale; }
+bool draw_end_frame(dirty_map_t *drawn, uint32_t *drawn_bytes, uint32_t *copied_bytes)
+{
+    (void)drawn; (void)drawn_bytes; (void)copied_bytes;
+    return false;
+}
+
+uint64_t test_now;
+static irq_handler_t test_timer_handler;
+static timer_event_t *test_timer;
+uint64_t timer_now(void) { return test_now; }
+bool timer_every(timer_event_t *timer, uint32_t period_us, irq_handler_t handler, void *arg)
+{
+    (void)period_us; (void)arg;
+    timer->pprev = (timer_event_t **)timer;
+    test_timer = timer;
+    test_timer_handler = handler;
+    return true;
+}
+void timer_cancel(timer_event_t *timer) { timer->pprev = NULL; }
+void timer_sleep(uint32_t ms) { (void)ms; }
+
+int k_printf(const char *format, ...) { (void)format; return 0; }
+static uint32_t test_output = K_OUTPUT_UART | K_OUTPUT_FB;
+uint32_t k_get_output(void) { return test_output; }
+void k_set_output(uint32_t sinks) { test_output = sinks; }
+
+#include "framebuffer.c"
+#include "fbcon.c"
+#include "boot_display.c"
+
+// One timer interrupt, false once the timer is cancelled
+bool test_tick(void)
+{
+    if (!test_timer || !test_timer->pprev)
+        return false;
+    test_timer_handler(NULL);
+    return true;
+}
+
+bool test_fb_lock_held(void)
+{
+    return fb_lock.held != 0;
+}
+
+// Another core in fb_present
+void test_fb_lock_hold(bool held)
+{
+    fb_lock.held = held;
+}
+'''
+
+WIDTH = 64
+HEIGHT = 32
+BUFFERS = 2
+CONSOLE_FRAMES = 2
+DURATION_MS = 3000
+
+def compile_test_module():
+    """Compile the kernel boot_display.c, framebuffer.c and fbcon.c for
+    host testing"""
+    print("Compiling boot display for testing...")
+
+    test_so_file = None
+    stubs_file = None
+    try:
+        fd, test_so_file = tempfile.mkstemp(suffix='.so')
+        os.close(fd)
+        fd, stubs_file = tempfile.mkstemp(suffix='.c')
+        with os.fdopen(fd, 'w') as f:
+            f.write(STUBS)
+
+        result = subprocess.run(
+            ['gcc', '-shared', '-fPIC', '-O2', '-ffreestanding',
+             '-fno-tree-loop-distribute-patterns', '-I', KERNEL_DIR,
+             '-o', test_so_file] + SOURCES + [stubs_file],
+            capture_output=True,
+            text=True
+        )
+
+        if result.returncode != 0:
+            print(f"{RED}Compilation failed:{NC}")
+            print(result.stderr)
+            os.unlink(test_so_file)
+            return None
+
+        print(f"{GREEN}Compilation successful{NC}")
+        return test_so_file
+
+    except Exception as e:
+        print(f"{RED}Error during compilation: {e}{NC}")
+        if test_so_file and os.path.exists(test_so_file):
+            os.unlink(test_so_file)
+        return None
+
+    finally:
+        if stubs_file and os.path.exists(stubs_file):
+            os.unlink(stubs_file)
+
+def setup(lib):
+    u32 = ctypes.c_uint32
+    lib.fb_init.argtypes = [u32, u32, u32, u32]
+    lib.fb_init.restype = ctypes.c_bool
+    lib.fbcon_init.argtypes = []
+    lib.fbcon_init.restype = ctypes.c_bool
+    lib.matrix_display_start.argtypes = [u32]
+    lib.matrix_display_start.restype = ctypes.c_bool
+    lib.fb_splash_shown.argtypes = []
+    lib.fb_splash_shown.restype = ctypes.c_bool
+    lib.test_tick.argtypes = []
+    lib.test_tick.restype = ctypes.c_bool
+    lib.test_fb_lock_held.argtypes = []
+    lib.test_fb_lock_held.restype = ctypes.c_bool
+    lib.test_fb_lock_hold.argtypes = [ctypes.c_bool]
+    lib.test_fb_lock_hold.restype = None
+
+class Board:
+    """The counters of the stubs"""
+
+    def __init__(self, lib):
+        self.lib = lib
+        self.now = ctypes.c_uint64.in_dll(lib, 'test_now')
+        self.offset = ctypes.c_int32.in_dll(lib, 'test_offset')
+        self.deadlocks = ctypes.c_uint32.in_dll(lib, 'test_deadlocks')
+        self.lock_errors = ctypes.c_uint32.in_dll(lib, 'test_lock_errors')
+
+    def locks_ok(self):
+        return (self.deadlocks.value == 0 and self.lock_errors.value == 0
+                and not self.lib.test_fb_lock_held())
+
+def test_rain(lib, board):
+    """The rain is shown over the console, drawn from the timer"""
+    passed = lib.fb_init(WIDTH, HEIGHT, 32, BUFFERS) and lib.fbcon_init()
+    passed = passed and board.offset.value == BUFFERS * HEIGHT
+
+    passed = passed and lib.matrix_display_start(DURATION_MS)
+    passed = passed and lib.fb_splash_shown() and board.offset.value == 0
+
+    for frame in range(10):
+        board.now.value += 1000000 // 30
+        passed = passed and lib.test_tick() and lib.fb_splash_shown()
+    passed = passed and board.offset.value == 0 and board.locks_ok()
+    return print_result(passed, "Rain drawn on the splash from the timer")
+
+def test_time_up(lib, board):
+    """Time up: the console is shown again from the timer handler, with
+    the framebuffer lock taken once"""
+    # Busy framebuffer : the hand over waits for the next tick
+    board.now.value += DURATION_MS * 1000
+    lib.test_fb_lock_hold(True)
+    passed = lib.test_tick() and lib.fb_splash_shown() and board.offset.value == 0
+    lib.test_fb_lock_hold(False)
+
+    passed = passed and lib.test_tick()
+    passed = passed and not lib.fb_splash_shown()
+    passed = passed and board.offset.value == BUFFERS * HEIGHT
+    if board.deadlocks.value:
+        print(f"  {RED}Failed:{NC} fb_lock taken again by its holder")
+    passed = passed and board.locks_ok()
+
+    # The timer is cancelled
+    passed = passed and not lib.test_tick()
+    return print_result(passed, "Console shown when the time is up")
+
+def main():
+    """Main test function"""
+    print("=" * 40)
+    print("PIP-OS Boot Display Unit Tests")
+    print("=" * 40)
+    print()
+
+    # Compile test module
+    lib_path = compile_test_module()
+    if not lib_path:
+        print(f"{RED}Failed to compile test module{NC}")
+        return 1
+
+    try:
+        # Load shared library
+        lib = ctypes.CDLL(lib_path)
+        setup(lib)
+        board = Board(lib)
+
+        # Run tests
+        print("\nRunning tests...")
+        results = []
+        results.append(test_rain(lib, board))
+        results.append(test_time_up(lib, board))
+
+        # Summary
+        print("\n" + "=" * 40)
+        print("Test Summary")
+        print("=" * 40)
+        passed = sum(results)
+        total = len(results)
+        print(f"{GREEN}Passed:{NC} {passed}/{total}")
+        print(f"{RED}Failed:{NC} {total - passed}/{total}")
+        print()
+
+        if passed == total:
+            print(f"{GREEN}All tests passed!{NC}")
+            return 0
+        else:
+            print(f"{RED}Some tests failed.{NC}")
+            return 1
+
+    finally:
+        # Cleanup
+        if os.path.exists(lib_path):
+            os.unlink(lib_path)
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,319 @@
+#!/usr/bin/env python3
+"""
+PIP-OS Clocksource and Boot Stage Unit Tests
+
+This script compiles the kernel's clocksource and boot stage timing in a
+host environment, with the generic timer and system timer counters set
+by the test. It checks the tick to nanosecond conversion against exact
+arithmetic for the counter frequencies of the targets, the fallback to
+the system timer, and the boot stage table against the stages timed.
+"""
+
+import subprocess
+import sys
+import os
+import tempfile
+import ctypes
+import random
+import re
+
+# Color codes for output
+GREEN = '\033[0;32m'
+RED = '\033[0;31m'
+YELLOW = '\033[1;33m'
+NC = '\033[0m'  # No Color
+
+def print_result(passed, test_name):
+    """Print test result with color"""
+    if passed:
+        print(f"{GREEN}✓{NC} {test_name}")
+        return True
+    else:
+        print(f"{RED}✗{NC} {test_name}")
+        return False
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+KERNEL_DIR = os.path.join(SCRIPT_DIR, '..', 'src', 'kernel')
+
+# The counters are variables of the test, k_printf prints into a buffer.
+STUBS = r'''
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#define CPU_H
+uint64_t test_counter;
+uint32_t test_counter_hz;
+static inline uint64_t cpu_counter(void) { return test_counter; }
+static inline uint32_t cpu_counter_hz(void) { return test_counter_hz; }
+
+#define TIMER_H
+uint64_t test_timer;
+static uint64_t timer_now(void) { return test_timer; }
+
+#define __K_STDIO_H__
+char test_output[8192];
+size_t test_output_length;
+
+int k_printf(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(test_output + test_output_length,
+                           sizeof(test_output) - test_output_length, format, args);
+    va_end(args);
+    test_output_length += length;
+    return length;
+}
+
+#include "clock.c"
+#include "boot_stage.c"
+'''
+
+FUZZ_SEED = 0xC10C
+
+def compile_test_module():
+    """Compile the kernel clock.c and boot_stage.c for host testing"""
+    print("Compiling clocksource for testing...")
+
+    test_so_file = None
+    stubs_file = None
+    try:
+        fd, test_so_file = tempfile.mkstemp(suffix='.so')
+        os.close(fd)
+        fd, stubs_file = tempfile.mkstemp(suffix='.c')
+        with os.fdopen(fd, 'w') as f:
+            f.write(STUBS)
+
+        result = subprocess.run(
+            ['gcc', '-shared', '-fPIC', '-O2', '-DBCM2836=1',
+             '-I', KERNEL_DIR, '-o', test_so_file, stubs_file],
+            capture_output=True,
+            text=True
+        )
+
+        if result.returncode != 0:
+            print(f"{RED}Compilation failed:{NC}")
+            print(result.stderr)
+            os.unlink(test_so_file)
+            return None
+
+        print(f"{GREEN}Compilation successful{NC}")
+        return test_so_file
+
+    except Exception as e:
+        print(f"{RED}Error during compilation: {e}{NC}")
+        if test_so_file and os.path.exists(test_so_file):
+            os.unlink(test_so_file)
+        return None
+    finally:
+        if stubs_file and os.path.exists(stubs_file):
+            os.unlink(stubs_file)
+
+class Clock:
+    """The counters of the library"""
+
+    def __init__(self, lib):
+        self.lib = lib
+        self.counter = ctypes.c_uint64.in_dll(lib, 'test_counter')
+        self.counter_hz = ctypes.c_uint32.in_dll(lib, 'test_counter_hz')
+        self.timer = ctypes.c_uint64.in_dll(lib, 'test_timer')
+        self.output = (ctypes.c_char * 8192).in_dll(lib, 'test_output')
+        self.output_length = ctypes.c_size_t.in_dll(lib, 'test_output_length')
+
+    def init(self, hz):
+        self.counter_hz.value = hz
+        self.lib.clock_init()
+
+    def printed(self):
+        text = self.output.raw[:self.output_length.value].decode()
+        self.output_length.value = 0
+        return text
+
+def setup(lib):
+    lib.clock_init.argtypes = []
+    lib.clock_init.restype = None
+    lib.clock_ticks.argtypes = []
+    lib.clock_ticks.restype = ctypes.c_uint64
+    lib.clock_hz.argtypes = []
+    lib.clock_hz.restype = ctypes.c_uint32
+    lib.clock_name.argtypes = []
+    lib.clock_name.restype = ctypes.c_char_p
+    lib.clock_ticks_to_ns.argtypes = [ctypes.c_uint64]
+    lib.clock_ticks_to_ns.restype = ctypes.c_uint64
+    lib.boot_stage_init.argtypes = []
+    lib.boot_stage_init.restype = None
+    lib.boot_stage_begin.argtypes = [ctypes.c_char_p]
+    lib.boot_stage_begin.restype = ctypes.c_uint32
+    lib.boot_stage_end.argtypes = [ctypes.c_uint32]
+    lib.boot_stage_end.restype = None
+    lib.boot_stage_report.argtypes = []
+    lib.boot_stage_report.restype = None
+
+def close_enough(lib, ticks, hz):
+    """Within 2^-30 of the exact time, plus rounding"""
+    exact = ticks * 10**9 // hz
+    got = lib.clock_ticks_to_ns(ticks)
+    return abs(got - exact) <= exact / 2**30 + 2
+
+def test_conversion(lib):
+    """Ticks to nanoseconds for the counter frequencies of the targets"""
+    rng = random.Random(FUZZ_SEED)
+    clock = Clock(lib)
+    passed = True
+
+    # System timer, generic timer of the BCM2836/7 and BCM2711, QEMU's
+    for hz in (1000000, 19200000, 54000000, 62500000, rng.randrange(1, 10**9)):
+        clock.init(hz)
+        ticks = [0, 1, hz, 2**32 - 1, 2**32, 2**32 + 1, 2**40 + 12345]
+        ticks += [rng.randrange(2**k) for k in range(1, 52) for _ in range(20)]
+        passed = passed and all(close_enough(lib, t, hz) for t in ticks)
+
+        # Never backwards, across the word boundary too
+        around = [2**32 + d for d in range(-64, 64)] + sorted(ticks)
+        ns = [lib.clock_ticks_to_ns(t) for t in sorted(around)]
+        passed = passed and all(a <= b for a, b in zip(ns, ns[1:]))
+    return print_result(passed, "Ticks converted to nanoseconds")
+
+def test_sources(lib):
+    """Generic timer when the firmware set its frequency, else system timer"""
+    clock = Clock(lib)
+    clock.counter.value = 123456789
+    clock.timer.value = 42
+
+    clock.init(19200000)
+    passed = lib.clock_name() == b'generic timer' and lib.clock_hz() == 19200000
+    passed = passed and lib.clock_ticks() == 123456789
+
+    clock.init(0)
+    passed = passed and lib.clock_name() == b'system timer' and lib.clock_hz() == 1000000
+    passed = passed and lib.clock_ticks() == 42
+    passed = passed and lib.clock_ticks_to_ns(1500000) == 1500000000
+    return print_result(passed, "Clocksource picked at init")
+
+def report(clock):
+    """Rows of the boot stage table, name to (us, permille)"""
+    clock.lib.boot_stage_report()
+    rows = {}
+    for line in clock.printed().splitlines():
+        match = re.match(r'  (\s*\S.*?)\s+(\d+)\s+(\d+)\.(\d)$', line)
+        firmware = re.match(r'  firmware\s+(\d+)\s+-$', line)
+        if firmware:
+            rows['firmware'] = (int(firmware.group(1)), None)
+        elif match:
+            rows[match.group(1)] = (int(match.group(2)),
+                                    int(match.group(3)) * 10 + int(match.group(4)))
+    return rows
+
+def test_stages(lib):
+    """Times and shares of nested stages"""
+    clock = Clock(lib)
+    clock.init(19200000)
+    clock.timer.value = 1500000
+    clock.counter.value = 10**9
+
+    def at(us):
+        clock.counter.value = 10**9 + us * 192 // 10
+
+    # us : UART 0-100, SMP 250-1250 with Audio 300-800 in it, Boot 1300-9000
+    lib.boot_stage_init()
+    uart = lib.boot_stage_begin(b'UART')
+    at(100)
+    lib.boot_stage_end(uart)
+    at(250)
+    smp = lib.boot_stage_begin(b'SMP')
+    at(300)
+    audio = lib.boot_stage_begin(b'Audio')
+    at(800)
+    lib.boot_stage_end(audio)
+    at(1250)
+    lib.boot_stage_end(smp)
+    at(1300)
+    boot = lib.boot_stage_begin(b'Boot')
+    at(9000)
+    lib.boot_stage_end(boot)
+    at(10000)
+
+    rows = report(clock)
+    passed = rows.get('UART') == (100, 10)
+    passed = passed and rows.get('SMP') == (1000, 100)
+    passed = passed and rows.get('  Audio') == (500, 50)
+    passed = passed and rows.get('Boot') == (7700, 770)
+    passed = passed and rows.get('between stages') == (1200, 120)
+    passed = passed and rows.get('total') == (10000, 1000)
+    passed = passed and 'firmware' in rows and rows['firmware'][0] == 1500000
+
+    # A stage still running is counted up to the report
+    running = lib.boot_stage_begin(b'Running')
+    at(12000)
+    rows = report(clock)
+    passed = passed and rows.get('Running') == (2000, 166)
+    lib.boot_stage_end(running)
+    return print_result(passed, "Boot stage table")
+
+def test_stage_limit(lib):
+    """Stages past the table run untimed"""
+    clock = Clock(lib)
+    first = lib.boot_stage_begin(b'extra')
+    stages = [first]
+    while stages[-1] < 32:
+        stages.append(lib.boot_stage_begin(b'extra'))
+    for stage in reversed(stages):
+        lib.boot_stage_end(stage)
+
+    rows = report(clock)
+    passed = stages[-1] == 32 and stages[-2] == 31 and 'total' in rows
+    # Stages after the full table, at depth 0 again
+    passed = passed and lib.boot_stage_begin(b'late') == 32
+    return print_result(passed, "Stages past the table untimed")
+
+def main():
+    """Main test function"""
+    print("=" * 40)
+    print("PIP-OS Clocksource Unit Tests")
+    print("=" * 40)
+    print()
+
+    # Compile test module
+    lib_path = compile_test_module()
+    if not lib_path:
+        print(f"{RED}Failed to compile test module{NC}")
+        return 1
+
+    try:
+        # Load shared library
+        lib = ctypes.CDLL(lib_path)
+        setup(lib)
+
+        # Run tests
+        print("\nRunning tests...")
+        results = []
+        results.append(test_conversion(lib))
+        results.append(test_sources(lib))
+        results.append(test_stages(lib))
+        results.append(test_stage_limit(lib))
+
+        # Summary
+        print("\n" + "=" * 40)
+        print("Test Summary")
+        print("=" * 40)
+        passed = sum(results)
+        total = len(results)
+        print(f"{GREEN}Passed:{NC} {passed}/{total}")
+        print(f"{RED}Failed:{NC} {total - passed}/{total}")
+        print()
+
+        if passed == total:
+            print(f"{GREEN}All tests passed!{NC}")
+            return 0
+        else:
+            print(f"{RED}Some tests failed.{NC}")
+            return 1
+
+    finally:
+        # Cleanup
+        if os.path.exists(lib_path):
+            os.unlink(lib_path)
+
+if __name__ == "__main__":
+    sys.exit(main())
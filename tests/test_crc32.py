@@ -0,0 +1,197 @@
+#!/usr/bin/env python3
+"""
+PIP-OS CRC32 Engine Unit Tests
+
+This script compiles the kernel's CRC32 engine in a host environment and
+checks it against Python's zlib, which implements the same polynomial.
+"""
+
+import subprocess
+import sys
+import os
+import tempfile
+import ctypes
+import random
+import zlib
+
+# Color codes for output
+GREEN = '\033[0;32m'
+RED = '\033[0;31m'
+YELLOW = '\033[1;33m'
+NC = '\033[0m'  # No Color
+
+def print_result(passed, test_name):
+    """Print test result with color"""
+    if passed:
+        print(f"{GREEN}✓{NC} {test_name}")
+        return True
+    else:
+        print(f"{RED}✗{NC} {test_name}")
+        return False
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+CRC32_SRC = os.path.join(SCRIPT_DIR, '..', 'src', 'kernel', 'crc32.c')
+
+FUZZ_ITERATIONS = 500
+FUZZ_SEED = 0xC3C32
+
+def compile_test_module():
+    """Compile the kernel crc32.c for host testing"""
+    print("Compiling CRC32 engine for testing...")
+
+    test_so_file = None
+    try:
+        fd, test_so_file = tempfile.mkstemp(suffix='.so')
+        os.close(fd)
+
+        # The host takes the slicing-by-8 backend
+        result = subprocess.run(
+            ['gcc', '-shared', '-fPIC', '-O2', '-ffreestanding',
+             '-o', test_so_file, CRC32_SRC],
+            capture_output=True,
+            text=True
+        )
+
+        if result.returncode != 0:
+            print(f"{RED}Compilation failed:{NC}")
+            print(result.stderr)
+            os.unlink(test_so_file)
+            return None
+
+        print(f"{GREEN}Compilation successful{NC}")
+        return test_so_file
+
+    except Exception as e:
+        print(f"{RED}Error during compilation: {e}{NC}")
+        if test_so_file and os.path.exists(test_so_file):
+            os.unlink(test_so_file)
+        return None
+
+def setup(lib):
+    lib.crc32_update.argtypes = [ctypes.c_uint32, ctypes.c_void_p, ctypes.c_size_t]
+    lib.crc32_update.restype = ctypes.c_uint32
+    lib.crc32_combine.argtypes = [ctypes.c_uint32, ctypes.c_uint32, ctypes.c_size_t]
+    lib.crc32_combine.restype = ctypes.c_uint32
+    lib.crc32_init()
+
+def crc(lib, data, start=0, offset=0):
+    """CRC of <data> placed <offset> bytes into a buffer"""
+    buffer = ctypes.create_string_buffer(bytes(offset) + data)
+    return lib.crc32_update(start, ctypes.addressof(buffer) + offset, len(data))
+
+def test_known_vectors(lib):
+    """Test the standard check values"""
+    tests = [
+        (b"", 0x00000000),
+        (b"a", 0xE8B7BE43),
+        (b"123456789", 0xCBF43926),
+        (b"The quick brown fox jumps over the lazy dog", 0x414FA339),
+    ]
+
+    passed = True
+    for data, expected in tests:
+        result = crc(lib, data)
+        if result != expected:
+            print(f"  {RED}Failed:{NC} crc32({data!r}) = 0x{result:08X}, expected 0x{expected:08X}")
+            passed = False
+
+    return print_result(passed, "known check values")
+
+def test_fuzz_against_zlib(lib):
+    """Compare one-shot and chunked CRCs against zlib"""
+    rng = random.Random(FUZZ_SEED)
+    failures = []
+
+    for i in range(FUZZ_ITERATIONS):
+        data = bytes(rng.getrandbits(8) for _ in range(rng.randrange(0, 600)))
+        offset = rng.randrange(0, 8)
+        expected = zlib.crc32(data)
+
+        if crc(lib, data, offset=offset) != expected:
+            failures.append(f"one-shot (len={len(data)}, offset={offset})")
+            continue
+
+        # Streamed in random chunks
+        value, pos = 0, 0
+        while pos < len(data):
+            step = rng.randrange(1, 64)
+            value = crc(lib, data[pos:pos + step], start=value, offset=rng.randrange(0, 8))
+            pos += step
+        if value != expected:
+            failures.append(f"chunked (len={len(data)})")
+
+    for failure in failures[:10]:
+        print(f"  {RED}Failed:{NC} {failure}")
+
+    return print_result(not failures, f"fuzzing against zlib ({FUZZ_ITERATIONS} cases)")
+
+def test_combine(lib):
+    """Test crc32_combine on random splits"""
+    rng = random.Random(FUZZ_SEED + 1)
+    passed = True
+
+    for i in range(200):
+        a = bytes(rng.getrandbits(8) for _ in range(rng.randrange(0, 300)))
+        b = bytes(rng.getrandbits(8) for _ in range(rng.randrange(0, 300)))
+        result = lib.crc32_combine(zlib.crc32(a), zlib.crc32(b), len(b))
+        if result != zlib.crc32(a + b):
+            print(f"  {RED}Failed:{NC} combine (len_a={len(a)}, len_b={len(b)})")
+            passed = False
+            break
+
+    # Lengths past what fits in a test buffer
+    if passed:
+        a, b = b"PIP-OS", bytes(1 << 20)
+        passed = lib.crc32_combine(zlib.crc32(a), zlib.crc32(b), len(b)) == zlib.crc32(a + b)
+
+    return print_result(passed, "crc32_combine")
+
+def main():
+    """Main test function"""
+    print("=" * 40)
+    print("PIP-OS CRC32 Engine Unit Tests")
+    print("=" * 40)
+    print()
+
+    # Compile test module
+    lib_path = compile_test_module()
+    if not lib_path:
+        print(f"{RED}Failed to compile test module{NC}")
+        return 1
+
+    try:
+        # Load shared library
+        lib = ctypes.CDLL(lib_path)
+        setup(lib)
+
+        # Run tests
+        print("\nRunning tests...")
+        results = []
+        results.append(test_known_vectors(lib))
+        results.append(test_fuzz_against_zlib(lib))
+        results.append(test_combine(lib))
+
+        # Summary
+        print("\n" + "=" * 40)
+        print("Test Summary")
+        print("=" * 40)
+        passed = sum(results)
+        total = len(results)
+        print(f"{GREEN}Passed:{NC} {passed}/{total}")
+        print(f"{RED}Failed:{NC} {total - passed}/{total}")
+        print()
+
+        if passed == total:
+            print(f"{GREEN}All tests passed!{NC}")
+            return 0
+        else:
+            print(f"{RED}Some tests failed.{NC}")
+            return 1
+
+    finally:
+        # Cleanup
+        if os.path.exists(lib_path):
+            os.unlink(lib_path)
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,338 @@
+#!/usr/bin/env python3
+"""
+PIP-OS Dirty Region Unit Tests
+
+This script compiles the kernel's dirty region tracker in a host
+environment and checks the tile maps, their merging into rects, and the
+copy of stale tiles from a front buffer against a Python model.
+"""
+
+import subprocess
+import sys
+import os
+import tempfile
+import ctypes
+import random
+
+# Color codes for output
+GREEN = '\033[0;32m'
+RED = '\033[0;31m'
+YELLOW = '\033[1;33m'
+NC = '\033[0m'  # No Color
+
+def print_result(passed, test_name):
+    """Print test result with color"""
+    if passed:
+        print(f"{GREEN}✓{NC} {test_name}")
+        return True
+    else:
+        print(f"{RED}✗{NC} {test_name}")
+        return False
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+KERNEL_DIR = os.path.join(SCRIPT_DIR, '..', 'src', 'kernel')
+DIRTY_SRC = os.path.join(KERNEL_DIR, 'dirty.c')
+K_STRING_SRC = os.path.join(KERNEL_DIR, 'k_libc', 'k_string.c')
+
+FUZZ_ITERATIONS = 200
+FUZZ_SEED = 0xD127
+
+DIRTY_ROWS_MAX = 64
+DIRTY_WORDS = 2
+
+class DirtyRect(ctypes.Structure):
+    _fields_ = [('x0', ctypes.c_int32), ('y0', ctypes.c_int32),
+                ('x1', ctypes.c_int32), ('y1', ctypes.c_int32)]
+
+class DirtyMap(ctypes.Structure):
+    _fields_ = [('shift', ctypes.c_uint32),
+                ('width', ctypes.c_uint32), ('height', ctypes.c_uint32),
+                ('cols', ctypes.c_uint32), ('rows', ctypes.c_uint32),
+                ('bits', (ctypes.c_uint32 * DIRTY_WORDS) * DIRTY_ROWS_MAX)]
+
+class DirtyTracker(ctypes.Structure):
+    _fields_ = [('drawn', DirtyMap), ('stale', DirtyMap),
+                ('front', ctypes.c_void_p),
+                ('drawn_bytes', ctypes.c_uint32),
+                ('copied_bytes', ctypes.c_uint32)]
+
+class RasterTarget(ctypes.Structure):
+    _fields_ = [('pixels', ctypes.c_void_p),
+                ('width', ctypes.c_uint32),
+                ('height', ctypes.c_uint32),
+                ('pitch', ctypes.c_uint32),
+                ('bytes_pp', ctypes.c_uint32)]
+
+def compile_test_module():
+    """Compile the kernel dirty.c for host testing"""
+    print("Compiling dirty region tracker for testing...")
+
+    test_so_file = None
+    try:
+        fd, test_so_file = tempfile.mkstemp(suffix='.so')
+        os.close(fd)
+
+        result = subprocess.run(
+            ['gcc', '-shared', '-fPIC', '-O2', '-ffreestanding',
+             '-fno-tree-loop-distribute-patterns', '-I', KERNEL_DIR,
+             '-o', test_so_file, DIRTY_SRC, K_STRING_SRC],
+            capture_output=True,
+            text=True
+        )
+
+        if result.returncode != 0:
+            print(f"{RED}Compilation failed:{NC}")
+            print(result.stderr)
+            os.unlink(test_so_file)
+            return None
+
+        print(f"{GREEN}Compilation successful{NC}")
+        return test_so_file
+
+    except Exception as e:
+        print(f"{RED}Error during compilation: {e}{NC}")
+        if test_so_file and os.path.exists(test_so_file):
+            os.unlink(test_so_file)
+        return None
+
+def setup(lib):
+    p = ctypes.POINTER
+    lib.dirty_init.argtypes = [p(DirtyMap), ctypes.c_uint32, ctypes.c_uint32]
+    lib.dirty_add.argtypes = [p(DirtyMap), p(DirtyRect)]
+    lib.dirty_merge.argtypes = [p(DirtyMap), p(DirtyMap)]
+    lib.dirty_take_rect.argtypes = [p(DirtyMap), p(DirtyRect)]
+    lib.dirty_take_rect.restype = ctypes.c_bool
+    lib.dirty_empty.argtypes = [p(DirtyMap)]
+    lib.dirty_empty.restype = ctypes.c_bool
+    lib.dirty_tracker_reset.argtypes = [p(DirtyTracker), p(RasterTarget), ctypes.c_void_p, p(DirtyMap)]
+    lib.dirty_track.argtypes = [p(DirtyTracker), p(RasterTarget), p(DirtyRect), ctypes.c_bool]
+    lib.dirty_flush.argtypes = [p(DirtyTracker), p(RasterTarget)]
+
+def map_tiles(m):
+    """Set of (col, row) tiles of a map"""
+    tiles = set()
+    for row in range(m.rows):
+        for col in range(m.cols):
+            if m.bits[row][col // 32] & (1 << (col % 32)):
+                tiles.add((col, row))
+    return tiles
+
+def rect_tiles(shift, width, height, x0, y0, x1, y1):
+    """Tiles of a pixel rect clipped to the screen"""
+    x0, y0 = max(x0, 0), max(y0, 0)
+    x1, y1 = min(x1, width), min(y1, height)
+    if x0 >= x1 or y0 >= y1:
+        return set()
+    return {(c, r) for c in range(x0 >> shift, ((x1 - 1) >> shift) + 1)
+                   for r in range(y0 >> shift, ((y1 - 1) >> shift) + 1)}
+
+def random_rect(rng, width, height):
+    x, y = rng.randrange(-20, width + 10), rng.randrange(-20, height + 10)
+    return DirtyRect(x, y, x + rng.randrange(0, width // 2), y + rng.randrange(0, height // 2))
+
+def test_tile_size(lib):
+    """Large screens get larger tiles"""
+    passed = True
+    for width, height, shift in [(640, 480, 4), (1024, 1024, 4), (1025, 600, 5), (1920, 1080, 5)]:
+        m = DirtyMap()
+        lib.dirty_init(ctypes.byref(m), width, height)
+        if m.shift != shift or m.cols > 64 or m.rows > 64 or not lib.dirty_empty(ctypes.byref(m)):
+            print(f"  {RED}Failed:{NC} {width}x{height} shift {m.shift}")
+            passed = False
+    return print_result(passed, "dirty_init tile size")
+
+def test_take_rects(lib):
+    """Rects taken back cover exactly the tiles added, without overlap"""
+    rng = random.Random(FUZZ_SEED)
+    for i in range(FUZZ_ITERATIONS):
+        width, height = rng.choice([(640, 480), (200, 150), (1920, 1080), (33, 17)])
+        m = DirtyMap()
+        lib.dirty_init(ctypes.byref(m), width, height)
+        expected = set()
+        for _ in range(rng.randrange(0, 12)):
+            r = random_rect(rng, width, height)
+            lib.dirty_add(ctypes.byref(m), ctypes.byref(r))
+            expected |= rect_tiles(m.shift, width, height, r.x0, r.y0, r.x1, r.y1)
+        if map_tiles(m) != expected:
+            print(f"  {RED}Failed:{NC} dirty_add, case {i}")
+            return print_result(False, f"dirty_take_rect ({FUZZ_ITERATIONS} cases)")
+
+        covered = set()
+        rect = DirtyRect()
+        count = 0
+        while lib.dirty_take_rect(ctypes.byref(m), ctypes.byref(rect)):
+            count += 1
+            inside = 0 <= rect.x0 < rect.x1 <= width and 0 <= rect.y0 < rect.y1 <= height
+            tiles = rect_tiles(m.shift, width, height, rect.x0, rect.y0, rect.x1, rect.y1)
+            if not inside or tiles & covered or count > len(expected):
+                print(f"  {RED}Failed:{NC} bad rect {rect.x0},{rect.y0} {rect.x1},{rect.y1}, case {i}")
+                return print_result(False, f"dirty_take_rect ({FUZZ_ITERATIONS} cases)")
+            covered |= tiles
+        if covered != expected or not lib.dirty_empty(ctypes.byref(m)):
+            print(f"  {RED}Failed:{NC} coverage, case {i}")
+            return print_result(False, f"dirty_take_rect ({FUZZ_ITERATIONS} cases)")
+    return print_result(True, f"dirty_take_rect ({FUZZ_ITERATIONS} cases)")
+
+def test_merge(lib):
+    """A full row of tiles comes back as one rect, merged maps as their union"""
+    a, b = DirtyMap(), DirtyMap()
+    lib.dirty_init(ctypes.byref(a), 640, 480)
+    lib.dirty_init(ctypes.byref(b), 640, 480)
+    lib.dirty_add(ctypes.byref(a), ctypes.byref(DirtyRect(0, 0, 320, 48)))
+    lib.dirty_add(ctypes.byref(b), ctypes.byref(DirtyRect(320, 0, 640, 48)))
+    lib.dirty_merge(ctypes.byref(a), ctypes.byref(b))
+    rect = DirtyRect()
+    rects = []
+    while lib.dirty_take_rect(ctypes.byref(a), ctypes.byref(rect)):
+        rects.append((rect.x0, rect.y0, rect.x1, rect.y1))
+    return print_result(rects == [(0, 0, 640, 48)], "dirty_merge into a single rect")
+
+class Frame:
+    """Front and back buffers of a bytes_pp screen, padded rows"""
+
+    def __init__(self, rng, width, height, bytes_pp):
+        self.width, self.height, self.bytes_pp = width, height, bytes_pp
+        self.pitch = (width + 3) * bytes_pp
+        size = self.pitch * height
+        self.front_init = bytes(rng.getrandbits(8) for _ in range(size))
+        back_init = bytes(rng.getrandbits(8) for _ in range(size))
+        self.front = ctypes.create_string_buffer(self.front_init, size)
+        self.back = ctypes.create_string_buffer(back_init, size)
+        self.model = bytearray(back_init)
+        self.target = RasterTarget(ctypes.addressof(self.back), width, height, self.pitch, bytes_pp)
+
+    def span(self, x0, x1, y):
+        at = y * self.pitch + x0 * self.bytes_pp
+        return at, at + (x1 - x0) * self.bytes_pp
+
+    def write(self, x0, y0, x1, y1, value):
+        """Write the clipped rect in the back buffer and the model"""
+        x0, y0 = max(x0, 0), max(y0, 0)
+        x1, y1 = min(x1, self.width), min(y1, self.height)
+        if x0 >= x1:
+            return
+        for y in range(y0, y1):
+            lo, hi = self.span(x0, x1, y)
+            data = bytes([value]) * (hi - lo)
+            ctypes.memmove(ctypes.addressof(self.back) + lo, data, hi - lo)
+            self.model[lo:hi] = data
+
+    def refresh(self, shift, tiles):
+        """Model of the stale tiles brought from the front buffer"""
+        for col, row in tiles:
+            x0, x1 = col << shift, min((col + 1) << shift, self.width)
+            for y in range(row << shift, min((row + 1) << shift, self.height)):
+                lo, hi = self.span(x0, x1, y)
+                self.model[lo:hi] = self.front_init[lo:hi]
+
+def test_tracker(lib):
+    """Stale tiles are copied before partial writes and at flush, skipped under covering ones"""
+    rng = random.Random(FUZZ_SEED + 1)
+    for i in range(FUZZ_ITERATIONS):
+        width, height = rng.choice([(100, 70), (64, 64), (37, 90)])
+        frame = Frame(rng, width, height, rng.choice([1, 2, 4]))
+        stale = DirtyMap()
+        lib.dirty_init(ctypes.byref(stale), width, height)
+        for _ in range(rng.randrange(0, 6)):
+            lib.dirty_add(ctypes.byref(stale), ctypes.byref(random_rect(rng, width, height)))
+        shift = stale.shift
+        stale_tiles = map_tiles(stale)
+
+        # Every stale tile ends up equal to the front buffer, then the writes
+        frame.refresh(shift, stale_tiles)
+
+        tracker = DirtyTracker()
+        lib.dirty_tracker_reset(ctypes.byref(tracker), ctypes.byref(frame.target),
+                                ctypes.addressof(frame.front), ctypes.byref(stale))
+        drawn = set()
+        for _ in range(rng.randrange(0, 8)):
+            r = random_rect(rng, width, height)
+            covers = rng.random() < 0.5
+            lib.dirty_track(ctypes.byref(tracker), ctypes.byref(frame.target), ctypes.byref(r), covers)
+            value = rng.getrandbits(8)
+            if covers:
+                frame.write(r.x0, r.y0, r.x1, r.y1, value)
+            else:
+                # Only the first row of the rect
+                frame.write(r.x0, r.y0, r.x1, min(r.y0 + 1, r.y1), value)
+            drawn |= rect_tiles(shift, width, height, r.x0, r.y0, r.x1, r.y1)
+        lib.dirty_flush(ctypes.byref(tracker), ctypes.byref(frame.target))
+
+        if bytes(frame.back.raw) != bytes(frame.model):
+            print(f"  {RED}Failed:{NC} pixels, case {i}")
+            return print_result(False, f"dirty_track/dirty_flush ({FUZZ_ITERATIONS} cases)")
+        if map_tiles(tracker.drawn) != drawn or not lib.dirty_empty(ctypes.byref(tracker.stale)):
+            print(f"  {RED}Failed:{NC} maps, case {i}")
+            return print_result(False, f"dirty_track/dirty_flush ({FUZZ_ITERATIONS} cases)")
+        if tracker.copied_bytes > len(stale_tiles) * (1 << (2 * shift)) * frame.bytes_pp:
+            print(f"  {RED}Failed:{NC} copied {tracker.copied_bytes} bytes, case {i}")
+            return print_result(False, f"dirty_track/dirty_flush ({FUZZ_ITERATIONS} cases)")
+    return print_result(True, f"dirty_track/dirty_flush ({FUZZ_ITERATIONS} cases)")
+
+def test_covered_not_copied(lib):
+    """A write covering the whole screen copies nothing"""
+    rng = random.Random(FUZZ_SEED + 2)
+    frame = Frame(rng, 100, 70, 4)
+    stale = DirtyMap()
+    lib.dirty_init(ctypes.byref(stale), 100, 70)
+    lib.dirty_add(ctypes.byref(stale), ctypes.byref(DirtyRect(0, 0, 100, 70)))
+    tracker = DirtyTracker()
+    lib.dirty_tracker_reset(ctypes.byref(tracker), ctypes.byref(frame.target),
+                            ctypes.addressof(frame.front), ctypes.byref(stale))
+    lib.dirty_track(ctypes.byref(tracker), ctypes.byref(frame.target),
+                    ctypes.byref(DirtyRect(-5, -5, 200, 200)), True)
+    lib.dirty_flush(ctypes.byref(tracker), ctypes.byref(frame.target))
+    return print_result(tracker.copied_bytes == 0 and tracker.drawn_bytes == 100 * 70 * 4,
+                        "covering write skips the copy")
+
+def main():
+    """Main test function"""
+    print("=" * 40)
+    print("PIP-OS Dirty Region Unit Tests")
+    print("=" * 40)
+    print()
+
+    # Compile test module
+    lib_path = compile_test_module()
+    if not lib_path:
+        print(f"{RED}Failed to compile test module{NC}")
+        return 1
+
+    try:
+        # Load shared library
+        lib = ctypes.CDLL(lib_path)
+        setup(lib)
+
+        # Run tests
+        print("\nRunning tests...")
+        results = []
+        results.append(test_tile_size(lib))
+        results.append(test_take_rects(lib))
+        results.append(test_merge(lib))
+        results.append(test_tracker(lib))
+        results.append(test_covered_not_copied(lib))
+
+        # Summary
+        print("\n" + "=" * 40)
+        print("Test Summary")
+        print("=" * 40)
+        passed = sum(results)
+        total = len(results)
+        print(f"{GREEN}Passed:{NC} {passed}/{total}")
+        print(f"{RED}Failed:{NC} {total - passed}/{total}")
+        print()
+
+        if passed == total:
+            print(f"{GREEN}All tests passed!{NC}")
+            return 0
+        else:
+            print(f"{RED}Some tests failed.{NC}")
+            return 1
+
+    finally:
+        # Cleanup
+        if os.path.exists(lib_path):
+            os.unlink(lib_path)
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,485 @@
+#!/usr/bin/env python3
+"""
+PIP-OS Batched Drawing Unit Tests
+
+This script compiles the kernel's batched drawing in a host environment,
+with the draw target in host memory, and checks the batches it runs
+against the same commands drawn one by one with the rasterizer, at 8, 16
+and 32 bits per pixel.
+"""
+
+import subprocess
+import sys
+import os
+import tempfile
+import ctypes
+import mmap
+import random
+
+# Color codes for output
+GREEN = '\033[0;32m'
+RED = '\033[0;31m'
+YELLOW = '\033[1;33m'
+NC = '\033[0m'  # No Color
+
+def print_result(passed, test_name):
+    """Print test result with color"""
+    if passed:
+        print(f"{GREEN}✓{NC} {test_name}")
+        return True
+    else:
+        print(f"{RED}✗{NC} {test_name}")
+        return False
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+KERNEL_DIR = os.path.join(SCRIPT_DIR, '..', 'src', 'kernel')
+SOURCES = [os.path.join(KERNEL_DIR, name) for name in
+           ('raster.c', 'dirty.c', 'text.c', 'font.c', 'arena.c',
+            os.path.join('k_libc', 'k_string.c'))]
+
+# A single core without a cycle counter. fb_info_t holds 32-bit addresses,
+# the draw target is mapped below 1GB.
+STUBS = r'''
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/mman.h>
+
+#define SPINLOCK_H
+typedef struct { int held; } spinlock_t;
+#define SPINLOCK_INIT(name) { 0 }
+uint32_t test_lock_errors;
+static void spin_lock(spinlock_t *lock) { test_lock_errors += lock->held++; }
+static void spin_unlock(spinlock_t *lock) { test_lock_errors += --lock->held != 0; }
+
+#define CPU_H
+static inline uint32_t cpu_cycles(void) { return 0; }
+
+#define TRACE_H
+#define TRACE_BEGIN(name, format, ...) do { } while (0)
+#define TRACE_END(name) do { } while (0)
+
+#include "draw.c"
+
+uint32_t pmm_order_for(size_t size) { (void)size; return 0; }
+void *pmm_alloc_pages(uint32_t order) { (void)order; return NULL; }
+void pmm_free_pages(void *pages, uint32_t order) { (void)pages; (void)order; }
+int k_printf(const char *format, ...) { (void)format; return 0; }
+
+static fb_info_t test_fb;
+
+uint8_t *test_alloc(uint32_t size)
+{
+    void *p = mmap((void *)0x28000000, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+bool test_target(uint8_t *pixels, uint32_t width, uint32_t height, uint32_t pitch, uint32_t depth)
+{
+    test_fb.width = test_fb.vWidth = width;
+    test_fb.height = test_fb.vHeight = height;
+    test_fb.pitch = pitch;
+    test_fb.depth = depth;
+    test_fb.fb = (uint32_t)(uintptr_t)pixels;
+    test_fb.fbSize = height * pitch;
+    return draw_set_target(&test_fb);
+}
+
+uint32_t test_color(uint32_t bytes_pp, uint32_t rgba)
+{
+    return raster_color(bytes_pp, rgba);
+}
+'''
+
+FUZZ_ITERATIONS = 200
+FUZZ_SEED = 0xD4A3
+
+WIDTH = 71
+HEIGHT = 43
+PAD = 5         # pixels of padding per row
+
+DRAW_OP_POINT = 0
+DRAW_OP_LINE = 1
+DRAW_OP_RECT = 2
+DRAW_OP_TEXT = 3
+DRAW_OP_BLIT = 4
+DRAW_OP_CLIP = 5
+DRAW_OP_CLEAR = 6
+DRAW_FLAG_FILL = 1
+DRAW_COORD_MAX = 16383
+
+DIRTY_ROWS_MAX = 64
+DIRTY_WORDS = 2
+
+class DrawCmd(ctypes.Structure):
+    _fields_ = [('op', ctypes.c_uint8),
+                ('flags', ctypes.c_uint8),
+                ('length', ctypes.c_uint16),
+                ('x0', ctypes.c_int16), ('y0', ctypes.c_int16),
+                ('x1', ctypes.c_int16), ('y1', ctypes.c_int16),
+                ('color', ctypes.c_uint32),
+                ('data', ctypes.c_size_t)]   # uintptr_t
+
+class DirtyMap(ctypes.Structure):
+    _fields_ = [('shift', ctypes.c_uint32),
+                ('width', ctypes.c_uint32), ('height', ctypes.c_uint32),
+                ('cols', ctypes.c_uint32), ('rows', ctypes.c_uint32),
+                ('bits', (ctypes.c_uint32 * DIRTY_WORDS) * DIRTY_ROWS_MAX)]
+
+class RasterTarget(ctypes.Structure):
+    _fields_ = [('pixels', ctypes.c_void_p),
+                ('width', ctypes.c_uint32),
+                ('height', ctypes.c_uint32),
+                ('pitch', ctypes.c_uint32),
+                ('bytes_pp', ctypes.c_uint32)]
+
+class RasterClip(ctypes.Structure):
+    _fields_ = [('x0', ctypes.c_int32), ('y0', ctypes.c_int32),
+                ('x1', ctypes.c_int32), ('y1', ctypes.c_int32)]
+
+def compile_test_module():
+    """Compile the kernel draw.c and its dependencies for host testing"""
+    print("Compiling batched drawing for testing...")
+
+    test_so_file = None
+    stubs_file = None
+    try:
+        fd, test_so_file = tempfile.mkstemp(suffix='.so')
+        os.close(fd)
+        fd, stubs_file = tempfile.mkstemp(suffix='.c')
+        with os.fdopen(fd, 'w') as f:
+            f.write(STUBS)
+
+        result = subprocess.run(
+            ['gcc', '-shared', '-fPIC', '-O2', '-ffreestanding',
+             '-fno-tree-loop-distribute-patterns', '-I', KERNEL_DIR,
+             '-o', test_so_file, stubs_file] + SOURCES,
+            capture_output=True,
+            text=True
+        )
+
+        if result.returncode != 0:
+            print(f"{RED}Compilation failed:{NC}")
+            print(result.stderr)
+            os.unlink(test_so_file)
+            return None
+
+        print(f"{GREEN}Compilation successful{NC}")
+        return test_so_file
+
+    except Exception as e:
+        print(f"{RED}Error during compilation: {e}{NC}")
+        if test_so_file and os.path.exists(test_so_file):
+            os.unlink(test_so_file)
+        return None
+    finally:
+        if stubs_file and os.path.exists(stubs_file):
+            os.unlink(stubs_file)
+
+def setup(lib):
+    target = ctypes.POINTER(RasterTarget)
+    clip = ctypes.POINTER(RasterClip)
+    i32, u32 = ctypes.c_int32, ctypes.c_uint32
+    lib.test_alloc.argtypes = [u32]
+    lib.test_alloc.restype = ctypes.c_void_p
+    lib.test_target.argtypes = [ctypes.c_void_p, u32, u32, u32, u32]
+    lib.test_target.restype = ctypes.c_bool
+    lib.test_color.argtypes = [u32, u32]
+    lib.test_color.restype = u32
+    lib.draw_batch.argtypes = [ctypes.POINTER(DrawCmd), u32, u32, ctypes.c_void_p]
+    lib.draw_batch.restype = i32
+    lib.draw_line.argtypes = [i32, i32, i32, i32, u32]
+    lib.draw_line.restype = ctypes.c_bool
+    lib.draw_point.argtypes = [i32, i32, u32]
+    lib.draw_point.restype = ctypes.c_bool
+    lib.draw_begin_frame.argtypes = [ctypes.c_void_p, ctypes.POINTER(DirtyMap)]
+    lib.draw_end_frame.argtypes = [ctypes.POINTER(DirtyMap), ctypes.POINTER(u32), ctypes.POINTER(u32)]
+    lib.draw_end_frame.restype = ctypes.c_bool
+    lib.dirty_init.argtypes = [ctypes.POINTER(DirtyMap), u32, u32]
+    lib.dirty_fill.argtypes = [ctypes.POINTER(DirtyMap)]
+    lib.raster_clip_reset.argtypes = [target, clip]
+    lib.raster_clip_set.argtypes = [target, clip, i32, i32, i32, i32]
+    lib.raster_point.argtypes = [target, clip, i32, i32, u32]
+    lib.raster_line.argtypes = [target, clip, i32, i32, i32, i32, u32]
+    lib.raster_fill_rect.argtypes = [target, clip, i32, i32, i32, i32, u32]
+    lib.raster_rect.argtypes = [target, clip, i32, i32, i32, i32, u32]
+    lib.raster_blit.argtypes = [target, clip, i32, i32, i32, i32, ctypes.c_void_p, u32]
+    lib.text_draw.argtypes = [target, clip, i32, i32, ctypes.c_void_p, u32, u32, u32]
+
+def model_color(bytes_pp, rgba):
+    """Pixel value of a 32 bpp color: palette level of the brightest
+    channel at 8 bpp, RGB565 at 16 bpp"""
+    r, g, b = rgba & 0xFF, (rgba >> 8) & 0xFF, (rgba >> 16) & 0xFF
+    if bytes_pp == 1:
+        return max(r, g, b)
+    if bytes_pp == 2:
+        return (r >> 3) << 11 | (g >> 2) << 5 | b >> 3
+    return rgba
+
+def test_color(lib):
+    """raster_color against the model, with the channel edges"""
+    rng = random.Random(FUZZ_SEED)
+    colors = [0x00000000, 0xFFFFFFFF, 0xFF0000FF, 0xFF00FF00, 0xFFFF0000,
+              0xFF80FF1A, 0x00070307, 0x00F8FCF8, 0xFF040804]
+    colors += [rng.getrandbits(32) for _ in range(1000)]
+    passed = True
+    for bytes_pp in (1, 2, 4):
+        for rgba in colors:
+            got = lib.test_color(bytes_pp, rgba)
+            if got != model_color(bytes_pp, rgba):
+                print(f"  {RED}Failed:{NC} {rgba:08X} at {bytes_pp * 8}bpp: {got:X}")
+                passed = False
+                break
+    return print_result(passed, "raster_color (RGB565, palette levels)")
+
+def random_command(rng):
+    op = rng.choice([DRAW_OP_POINT, DRAW_OP_LINE, DRAW_OP_LINE, DRAW_OP_RECT,
+                     DRAW_OP_RECT, DRAW_OP_CLIP, DRAW_OP_CLEAR])
+    cmd = DrawCmd(op=op, color=rng.getrandbits(32))
+    cmd.x0, cmd.y0 = rng.randrange(-10, WIDTH + 10), rng.randrange(-10, HEIGHT + 10)
+    if op == DRAW_OP_LINE:
+        cmd.x1, cmd.y1 = rng.randrange(-10, WIDTH + 10), rng.randrange(-10, HEIGHT + 10)
+    elif op == DRAW_OP_RECT:
+        cmd.x1, cmd.y1 = rng.randrange(0, WIDTH), rng.randrange(0, HEIGHT)
+        cmd.flags = rng.choice([0, DRAW_FLAG_FILL])
+    elif op == DRAW_OP_CLIP and rng.random() > 0.2:
+        cmd.x1, cmd.y1 = rng.randrange(1, WIDTH), rng.randrange(1, HEIGHT)
+    return cmd
+
+def model_batch(lib, target, cmds):
+    """The commands of a batch drawn one by one with the rasterizer"""
+    t = ctypes.byref(target)
+    clip = RasterClip()
+    c = ctypes.byref(clip)
+    lib.raster_clip_reset(t, c)
+    for cmd in cmds:
+        color = model_color(target.bytes_pp, cmd.color)
+        if cmd.op == DRAW_OP_POINT:
+            lib.raster_point(t, c, cmd.x0, cmd.y0, color)
+        elif cmd.op == DRAW_OP_LINE:
+            lib.raster_line(t, c, cmd.x0, cmd.y0, cmd.x1, cmd.y1, color)
+        elif cmd.op == DRAW_OP_RECT and cmd.flags & DRAW_FLAG_FILL:
+            lib.raster_fill_rect(t, c, cmd.x0, cmd.y0, cmd.x1, cmd.y1, color)
+        elif cmd.op == DRAW_OP_RECT:
+            lib.raster_rect(t, c, cmd.x0, cmd.y0, cmd.x1, cmd.y1, color)
+        elif cmd.op == DRAW_OP_CLIP and cmd.x1 == 0 and cmd.y1 == 0:
+            lib.raster_clip_reset(t, c)
+        elif cmd.op == DRAW_OP_CLIP:
+            lib.raster_clip_set(t, c, cmd.x0, cmd.y0, cmd.x1, cmd.y1)
+        elif cmd.op == DRAW_OP_CLEAR:
+            lib.raster_fill_rect(t, c, clip.x0, clip.y0, clip.x1 - clip.x0, clip.y1 - clip.y0, color)
+
+def test_batches(lib, pixels):
+    """Random batches against the same commands drawn one by one"""
+    rng = random.Random(FUZZ_SEED + 1)
+    passed = True
+    for i in range(FUZZ_ITERATIONS):
+        bytes_pp = rng.choice([1, 2, 4])
+        pitch = (WIDTH + PAD) * bytes_pp
+        size = pitch * HEIGHT
+        init = bytes(rng.getrandbits(8) for _ in range(size))
+        ctypes.memmove(pixels, init, size)
+        if not lib.test_target(pixels, WIDTH, HEIGHT, pitch, bytes_pp * 8):
+            print(f"  {RED}Failed:{NC} no draw target at {bytes_pp * 8}bpp")
+            return print_result(False, "draw_batch against the rasterizer")
+
+        cmds = [random_command(rng) for _ in range(rng.randrange(1, 40))]
+        array = (DrawCmd * len(cmds))(*cmds)
+        got = lib.draw_batch(array, len(cmds), 0, None)
+
+        model = ctypes.create_string_buffer(init, size)
+        model_batch(lib, RasterTarget(ctypes.addressof(model), WIDTH, HEIGHT, pitch, bytes_pp), cmds)
+
+        if got != len(cmds) or ctypes.string_at(pixels, size) != model.raw:
+            print(f"  {RED}Failed:{NC} batch {i} at {bytes_pp * 8}bpp, returned {got}")
+            passed = False
+            break
+    lock_errors = ctypes.c_uint32.in_dll(lib, 'test_lock_errors').value
+    return print_result(passed and lock_errors == 0,
+                        f"draw_batch against the rasterizer ({FUZZ_ITERATIONS} batches)")
+
+def random_line(rng):
+    """A line near the screen, or with ends anywhere in the coordinate range"""
+    cmd = DrawCmd(op=DRAW_OP_LINE, color=rng.getrandbits(32))
+    ends = []
+    for _ in range(2):
+        if rng.random() < 0.5:
+            ends += [rng.randrange(-DRAW_COORD_MAX, DRAW_COORD_MAX + 1),
+                     rng.randrange(-DRAW_COORD_MAX, DRAW_COORD_MAX + 1)]
+        else:
+            ends += [rng.randrange(-30, WIDTH + 30), rng.randrange(-30, HEIGHT + 30)]
+    cmd.x0, cmd.y0, cmd.x1, cmd.y1 = ends
+    return cmd
+
+def test_line_tiles(lib, pixels):
+    """Lines, clipped or not, mark every tile they draw on: the tiles left
+    stale are brought back from the front buffer at the end of the frame,
+    over any pixel drawn there without a mark"""
+    rng = random.Random(FUZZ_SEED + 2)
+    passed = True
+    for i in range(FUZZ_ITERATIONS):
+        bytes_pp = rng.choice([1, 2, 4])
+        pitch = (WIDTH + PAD) * bytes_pp
+        size = pitch * HEIGHT
+        ctypes.memmove(pixels, bytes(rng.getrandbits(8) for _ in range(size)), size)
+        front = ctypes.create_string_buffer(bytes(rng.getrandbits(8) for _ in range(size)), size)
+        lib.test_target(pixels, WIDTH, HEIGHT, pitch, bytes_pp * 8)
+
+        stale = DirtyMap()
+        lib.dirty_init(ctypes.byref(stale), WIDTH, HEIGHT)
+        lib.dirty_fill(ctypes.byref(stale))
+        lib.draw_begin_frame(front, ctypes.byref(stale))
+
+        cmds = []
+        for _ in range(rng.randrange(1, 8)):
+            if rng.random() < 0.3:
+                cmds.append(random_command(rng))
+            cmds.append(random_line(rng))
+        array = (DrawCmd * len(cmds))(*cmds)
+        got = lib.draw_batch(array, len(cmds), 0, None)
+        drawn, drawn_bytes, copied_bytes = DirtyMap(), ctypes.c_uint32(), ctypes.c_uint32()
+        lib.draw_end_frame(ctypes.byref(drawn), ctypes.byref(drawn_bytes), ctypes.byref(copied_bytes))
+
+        model = ctypes.create_string_buffer(front.raw, size)
+        model_batch(lib, RasterTarget(ctypes.addressof(model), WIDTH, HEIGHT, pitch, bytes_pp), cmds)
+        # Only the pixels of the rows count, the padding is copied with the tiles or not
+        same = all(ctypes.string_at(pixels + y * pitch, WIDTH * bytes_pp)
+                   == model.raw[y * pitch:y * pitch + WIDTH * bytes_pp] for y in range(HEIGHT))
+        if got != len(cmds) or not same:
+            print(f"  {RED}Failed:{NC} frame {i} at {bytes_pp * 8}bpp, returned {got}")
+            passed = False
+            break
+    return print_result(passed, f"Lines mark the tiles they draw on ({FUZZ_ITERATIONS} frames)")
+
+def test_coord_range(lib, pixels):
+    """Points and line ends beyond DRAW_COORD_MAX are rejected"""
+    pitch = WIDTH * 4
+    size = pitch * HEIGHT
+    ctypes.memset(pixels, 0, size)
+    lib.test_target(pixels, WIDTH, HEIGHT, pitch, 32)
+    far = DRAW_COORD_MAX + 1
+    passed = lib.draw_line(-DRAW_COORD_MAX, 3, DRAW_COORD_MAX, 5, 0xFFFFFFFF)
+    passed = passed and lib.draw_point(-DRAW_COORD_MAX, DRAW_COORD_MAX, 0xFFFFFFFF)
+    passed = passed and not lib.draw_line(0, 0, far, 10, 0xFFFFFFFF)
+    passed = passed and not lib.draw_line(-0x7FFFFFFF, 0, 0x7FFFFFFF, 20, 0xFFFFFFFF)
+    passed = passed and not lib.draw_point(3, -far, 0xFFFFFFFF)
+    for cmd in (DrawCmd(op=DRAW_OP_LINE, x0=0, y0=0, x1=10, y1=far),
+                DrawCmd(op=DRAW_OP_LINE, x0=-far, y0=0, x1=10, y1=10),
+                DrawCmd(op=DRAW_OP_POINT, x0=far, y0=0)):
+        passed = passed and lib.draw_batch(ctypes.byref(cmd), 1, 0, None) == -1
+    return print_result(passed, "Coordinates beyond DRAW_COORD_MAX rejected")
+
+def test_rejected(lib, pixels):
+    """A batch with a bad command draws nothing"""
+    pitch = WIDTH * 4
+    size = pitch * HEIGHT
+    ctypes.memset(pixels, 0x5A, size)
+    lib.test_target(pixels, WIDTH, HEIGHT, pitch, 32)
+    cmds = (DrawCmd * 3)(DrawCmd(op=DRAW_OP_CLEAR, color=0xFFFFFFFF),
+                         DrawCmd(op=DRAW_OP_RECT, x0=1, y0=1, x1=-4, y1=3),
+                         DrawCmd(op=99))
+    passed = lib.draw_batch(cmds, 3, 0, None) == -1
+    passed = passed and ctypes.string_at(pixels, size) == b'\x5A' * size
+    return print_result(passed, "Rejected batch draws nothing")
+
+def test_host_pointers(lib, pixels):
+    """Text and blit data at 64-bit host addresses, the full pointer kept"""
+    rng = random.Random(FUZZ_SEED + 4)
+    # Anonymous mappings sit above 4 GiB on 64-bit hosts
+    data = mmap.mmap(-1, 4 * mmap.PAGESIZE)
+    address = ctypes.addressof(ctypes.c_char.from_buffer(data))
+    passed = ctypes.sizeof(ctypes.c_void_p) == 4 or address > 0xFFFFFFFF
+
+    text = b'PIP-OS 0123 <>?'
+    ctypes.memmove(address, text, len(text))
+    blit = address + mmap.PAGESIZE
+    stride, w, h = 29, 23, 17
+    ctypes.memmove(blit, bytes(rng.getrandbits(8) for _ in range(stride * h * 4)), stride * h * 4)
+
+    for bytes_pp in (1, 2, 4):
+        pitch = (WIDTH + PAD) * bytes_pp
+        size = pitch * HEIGHT
+        init = bytes(rng.getrandbits(8) for _ in range(size))
+        ctypes.memmove(pixels, init, size)
+        lib.test_target(pixels, WIDTH, HEIGHT, pitch, bytes_pp * 8)
+
+        cmds = (DrawCmd * 2)(
+            DrawCmd(op=DRAW_OP_TEXT, x0=-3, y0=5, x1=2, color=rng.getrandbits(32),
+                    data=address, length=len(text)),
+            DrawCmd(op=DRAW_OP_BLIT, x0=WIDTH - 20, y0=HEIGHT - 10, x1=w, y1=h,
+                    data=blit, length=stride))
+        got = lib.draw_batch(cmds, 2, 0, None)
+
+        model = ctypes.create_string_buffer(init, size)
+        target = RasterTarget(ctypes.addressof(model), WIDTH, HEIGHT, pitch, bytes_pp)
+        clip = RasterClip()
+        lib.raster_clip_reset(ctypes.byref(target), ctypes.byref(clip))
+        lib.text_draw(ctypes.byref(target), ctypes.byref(clip), -3, 5, address, len(text), 2,
+                      model_color(bytes_pp, cmds[0].color))
+        lib.raster_blit(ctypes.byref(target), ctypes.byref(clip), WIDTH - 20, HEIGHT - 10,
+                        w, h, blit, stride)
+
+        if got != 2 or ctypes.string_at(pixels, size) != model.raw:
+            print(f"  {RED}Failed:{NC} at {bytes_pp * 8}bpp, returned {got}")
+            passed = False
+    return print_result(passed, "Text and blit from 64-bit addresses")
+
+def main():
+    """Main test function"""
+    print("=" * 40)
+    print("PIP-OS Batched Drawing Unit Tests")
+    print("=" * 40)
+    print()
+
+    # Compile test module
+    lib_path = compile_test_module()
+    if not lib_path:
+        print(f"{RED}Failed to compile test module{NC}")
+        return 1
+
+    try:
+        # Load shared library
+        lib = ctypes.CDLL(lib_path)
+        setup(lib)
+
+        pixels = lib.test_alloc((WIDTH + PAD) * 4 * HEIGHT)
+        if not pixels:
+            print(f"{RED}Failed to map the draw target{NC}")
+            return 1
+
+        # Run tests
+        print("\nRunning tests...")
+        results = []
+        results.append(test_color(lib))
+        results.append(test_batches(lib, pixels))
+        results.append(test_line_tiles(lib, pixels))
+        results.append(test_coord_range(lib, pixels))
+        results.append(test_rejected(lib, pixels))
+        results.append(test_host_pointers(lib, pixels))
+
+        # Summary
+        print("\n" + "=" * 40)
+        print("Test Summary")
+        print("=" * 40)
+        passed = sum(results)
+        total = len(results)
+        print(f"{GREEN}Passed:{NC} {passed}/{total}")
+        print(f"{RED}Failed:{NC} {total - passed}/{total}")
+        print()
+
+        if passed == total:
+            print(f"{GREEN}All tests passed!{NC}")
+            return 0
+        else:
+            print(f"{RED}Some tests failed.{NC}")
+            return 1
+
+    finally:
+        # Cleanup
+        if os.path.exists(lib_path):
+            os.unlink(lib_path)
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,393 @@
+#!/usr/bin/env python3
+"""
+PIP-OS Framebuffer Console Unit Tests
+
+This script compiles the kernel's framebuffer console in a host environment
+with the console frames in host memory, prints random text through it and
+checks the rows on screen at the console's virtual offset against a Python
+model of the terminal, at 8, 16 and 32 bits per pixel.
+"""
+
+import subprocess
+import sys
+import os
+import tempfile
+import ctypes
+import random
+
+# Color codes for output
+GREEN = '\033[0;32m'
+RED = '\033[0;31m'
+YELLOW = '\033[1;33m'
+NC = '\033[0m'  # No Color
+
+def print_result(passed, test_name):
+    """Print test result with color"""
+    if passed:
+        print(f"{GREEN}✓{NC} {test_name}")
+        return True
+    else:
+        print(f"{RED}✗{NC} {test_name}")
+        return False
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+KERNEL_DIR = os.path.join(SCRIPT_DIR, '..', 'src', 'kernel')
+SOURCES = [os.path.join(KERNEL_DIR, name) for name in
+           ('fbcon.c', 'font.c', 'raster.c', os.path.join('k_libc', 'k_string.c'))]
+
+# The framebuffer side of the console. fb_info_t holds 32-bit addresses,
+# the console frames are mapped below 1GB.
+STUBS = r'''
+#define _GNU_SOURCE
+#include <stddef.h>
+#include <sys/mman.h>
+#include "framebuffer.h"
+
+uint32_t test_width, test_height, test_pitch, test_depth;
+uint8_t *test_pixels;
+int32_t test_offset = -1;
+uint32_t test_scrolls;
+bool test_busy;   /* fb_lock or the mailbox held by the interrupted code */
+static bool test_shown;
+
+uint8_t *test_alloc(uint32_t size)
+{
+    void *p = mmap((void *)0x20000000, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    test_pixels = p == MAP_FAILED ? NULL : p;
+    return test_pixels;
+}
+
+bool fb_get_console(fb_info_t *console)
+{
+    if (!test_pixels)
+        return false;
+    console->width = console->vWidth = test_width;
+    console->height = test_height;
+    console->vHeight = FB_CONSOLE_FRAMES * test_height;
+    console->pitch = test_pitch;
+    console->depth = test_depth;
+    console->xOffset = console->yOffset = 0;
+    console->fb = (uint32_t)(uintptr_t)test_pixels;
+    console->fbSize = console->vHeight * test_pitch;
+    return true;
+}
+
+void fb_show_console(uint32_t y)
+{
+    test_shown = true;
+    test_offset = y;
+}
+
+void fb_show_console_locked(uint32_t y)
+{
+    fb_show_console(y);
+}
+
+bool fb_panic_console(uint32_t y)
+{
+    if (test_busy)
+        return false;
+    fb_show_console(y);
+    return true;
+}
+
+/* another frame takes the screen, as a boot splash does */
+void test_hide(void)
+{
+    test_shown = false;
+    test_offset = -1;
+}
+
+void fb_scroll_console(uint32_t y)
+{
+    test_scrolls++;
+    if (test_shown)
+        test_offset = y;
+}
+'''
+
+FUZZ_SEED = 0xC0A5
+FONT_FIRST = 0x20
+FONT_LAST = 0x7E
+DEFAULT_COLOR = 0xFF80FF1A
+
+WIDTH = 83      # 10 columns, 3 pixels never written
+HEIGHT = 48     # 6 rows
+PAD = 5
+
+def compile_test_module():
+    """Compile the kernel fbcon.c and its dependencies for host testing"""
+    print("Compiling framebuffer console for testing...")
+
+    test_so_file = None
+    stubs_file = None
+    try:
+        fd, test_so_file = tempfile.mkstemp(suffix='.so')
+        os.close(fd)
+        fd, stubs_file = tempfile.mkstemp(suffix='.c')
+        with os.fdopen(fd, 'w') as f:
+            f.write(STUBS)
+
+        result = subprocess.run(
+            ['gcc', '-shared', '-fPIC', '-O2', '-ffreestanding',
+             '-fno-tree-loop-distribute-patterns', '-I', KERNEL_DIR,
+             '-o', test_so_file] + SOURCES + [stubs_file],
+            capture_output=True,
+            text=True
+        )
+
+        if result.returncode != 0:
+            print(f"{RED}Compilation failed:{NC}")
+            print(result.stderr)
+            os.unlink(test_so_file)
+            return None
+
+        print(f"{GREEN}Compilation successful{NC}")
+        return test_so_file
+
+    except Exception as e:
+        print(f"{RED}Error during compilation: {e}{NC}")
+        if test_so_file and os.path.exists(test_so_file):
+            os.unlink(test_so_file)
+        return None
+
+    finally:
+        if stubs_file and os.path.exists(stubs_file):
+            os.unlink(stubs_file)
+
+def pixel_color(bytes_pp):
+    """raster_color of the default color"""
+    r, g, b = DEFAULT_COLOR & 0xFF, (DEFAULT_COLOR >> 8) & 0xFF, (DEFAULT_COLOR >> 16) & 0xFF
+    if bytes_pp == 1:
+        return max(r, g, b)
+    if bytes_pp == 2:
+        return (r >> 3) << 11 | (g >> 2) << 5 | b >> 3
+    return DEFAULT_COLOR
+
+class Terminal:
+    """What the console should show"""
+
+    def __init__(self, cols, rows):
+        self.cols, self.rows = cols, rows
+        self.lines = [[' '] * cols]
+        self.col = 0
+
+    def newline(self):
+        self.col = 0
+        self.lines.append([' '] * self.cols)
+
+    def putc(self, c):
+        if c == 0x0A:
+            self.newline()
+        elif c == 0x0D:
+            self.col = 0
+        elif c == 0x08:
+            self.col = max(self.col - 1, 0)
+        elif c == 0x09:
+            self.col = (self.col + 8) & ~7
+            if self.col >= self.cols:
+                self.newline()
+        elif c >= FONT_FIRST:
+            if self.col == self.cols:
+                self.newline()
+            self.lines[-1][self.col] = chr(c) if c <= FONT_LAST else '?'
+            self.col += 1
+
+    def screen(self):
+        shown = self.lines[-self.rows:]
+        return shown + [[' '] * self.cols for _ in range(self.rows - len(shown))]
+
+def render(font, screen, bytes_pp):
+    """Pixel rows of a screen of text, as the console draws them"""
+    fg = pixel_color(bytes_pp).to_bytes(bytes_pp, 'little')
+    bg = bytes(bytes_pp)
+    out = bytearray()
+    for line in screen:
+        for row in range(8):
+            data = bytearray()
+            for c in line:
+                bits = font[ord(c) - FONT_FIRST][row]
+                for px in range(8):
+                    data += fg if bits & (1 << px) else bg
+            out += data + bytes((WIDTH - len(line) * 8) * bytes_pp)
+    return bytes(out)
+
+class Console:
+    """The console frames of the host stubs"""
+
+    def __init__(self, lib, bytes_pp):
+        self.lib = lib
+        self.bytes_pp = bytes_pp
+        self.pitch = (WIDTH + PAD) * bytes_pp
+        self.size = 2 * HEIGHT * self.pitch
+        for name, value in (('test_width', WIDTH), ('test_height', HEIGHT),
+                            ('test_pitch', self.pitch), ('test_depth', bytes_pp * 8)):
+            ctypes.c_uint32.in_dll(lib, name).value = value
+        self.pixels = ctypes.c_void_p.in_dll(lib, 'test_pixels').value
+        # Garbage first, fbcon_init must clear it
+        ctypes.memset(self.pixels, 0xA5, self.size)
+
+    def offset(self):
+        return ctypes.c_int32.in_dll(self.lib, 'test_offset').value
+
+    def scrolls(self):
+        return ctypes.c_uint32.in_dll(self.lib, 'test_scrolls').value
+
+    def window(self):
+        """The pixels on screen, without the padding of the rows"""
+        start = self.offset() * self.pitch
+        rows = ctypes.string_at(self.pixels + start, HEIGHT * self.pitch)
+        return b''.join(rows[y * self.pitch:y * self.pitch + WIDTH * self.bytes_pp]
+                        for y in range(HEIGHT))
+
+def setup(lib):
+    lib.fbcon_init.restype = ctypes.c_bool
+    lib.fbcon_putc.argtypes = [ctypes.c_char]
+    lib.test_alloc.argtypes = [ctypes.c_uint32]
+    lib.test_alloc.restype = ctypes.c_void_p
+
+    glyphs = FONT_LAST - FONT_FIRST + 1
+    table = ((ctypes.c_uint8 * 8) * glyphs).in_dll(lib, 'font_8x8')
+    return [bytes(table[i]) for i in range(glyphs)]
+
+def random_text(rng, length):
+    choices = [0x0A] * 6 + [0x0D, 0x08, 0x09, 0x01, 0x80] + list(range(FONT_FIRST, FONT_LAST + 1))
+    return bytes(rng.choice(choices) for _ in range(length))
+
+def test_no_console(lib):
+    """Without console frames fbcon_init fails and output is dropped"""
+    lib.fbcon_putc(b'A')
+    return print_result(not lib.fbcon_init(), "fbcon_init without console frames")
+
+def test_scrolling(lib, font):
+    """Random output, the rows on screen match the terminal model"""
+    rng = random.Random(FUZZ_SEED)
+    passed = True
+    cols, rows = WIDTH // 8, HEIGHT // 8
+
+    for bytes_pp in (1, 2, 4):
+        console = Console(lib, bytes_pp)
+        if not lib.fbcon_init() or console.offset() != 0:
+            print(f"  {RED}Failed:{NC} fbcon_init at {bytes_pp * 8}bpp")
+            passed = False
+            continue
+
+        model = Terminal(cols, rows)
+        scrolls = console.scrolls()
+        for step in range(60):
+            text = random_text(rng, rng.randrange(1, 40))
+            for c in text:
+                lib.fbcon_putc(bytes([c]))
+                model.putc(c)
+            if console.window() != render(font, model.screen(), bytes_pp):
+                print(f"  {RED}Failed:{NC} screen after step {step} at {bytes_pp * 8}bpp")
+                passed = False
+                break
+
+        # One offset move per line scrolled
+        scrolled = len(model.lines) - rows
+        if console.scrolls() - scrolls != max(scrolled, 0):
+            print(f"  {RED}Failed:{NC} {console.scrolls() - scrolls} scrolls for {scrolled} lines")
+            passed = False
+
+    return print_result(passed, "Console output and scrolling (8/16/32 bpp)")
+
+def test_panic(lib, font):
+    """fbcon_panic shows a cleared console, output restarts at the top"""
+    rng = random.Random(FUZZ_SEED + 1)
+    console = Console(lib, 4)
+    lib.fbcon_init()
+    for c in random_text(rng, 300):
+        lib.fbcon_putc(bytes([c]))
+
+    lib.fbcon_panic()
+    model = Terminal(WIDTH // 8, HEIGHT // 8)
+    for c in b'*** Data abort ***\r\n  PC 0x8000':
+        lib.fbcon_putc(bytes([c]))
+        model.putc(c)
+
+    passed = console.offset() == 0 and console.window() == render(font, model.screen(), 4)
+
+    # Busy framebuffer: the screen stays as it was, nothing waits
+    lib.test_hide()
+    ctypes.c_bool.in_dll(lib, 'test_busy').value = True
+    lib.fbcon_panic()
+    ctypes.c_bool.in_dll(lib, 'test_busy').value = False
+    if console.offset() != -1:
+        print(f"  {RED}Failed:{NC} busy panic moved the offset to {console.offset()}")
+        passed = False
+
+    return print_result(passed, "fbcon_panic")
+
+def test_show(lib, font):
+    """Output while hidden scrolls nothing, fbcon_show brings it back current"""
+    rng = random.Random(FUZZ_SEED + 2)
+    console = Console(lib, 2)
+    lib.fbcon_init()
+    model = Terminal(WIDTH // 8, HEIGHT // 8)
+    text = random_text(rng, 200)
+    for i, c in enumerate(text):
+        if i == 50:
+            lib.test_hide()
+        lib.fbcon_putc(bytes([c]))
+        model.putc(c)
+
+    passed = console.offset() == -1
+    lib.fbcon_show()
+    passed = passed and console.window() == render(font, model.screen(), 2)
+    return print_result(passed, "fbcon_show after output while hidden")
+
+def main():
+    """Main test function"""
+    print("=" * 40)
+    print("PIP-OS Framebuffer Console Unit Tests")
+    print("=" * 40)
+    print()
+
+    # Compile test module
+    lib_path = compile_test_module()
+    if not lib_path:
+        print(f"{RED}Failed to compile test module{NC}")
+        return 1
+
+    try:
+        # Load shared library
+        lib = ctypes.CDLL(lib_path)
+        font = setup(lib)
+
+        # Run tests
+        print("\nRunning tests...")
+        results = []
+        results.append(test_no_console(lib))
+        if not lib.test_alloc(2 * HEIGHT * (WIDTH + PAD) * 4):
+            print(f"{RED}Could not map the console frames{NC}")
+            return 1
+        results.append(test_scrolling(lib, font))
+        results.append(test_panic(lib, font))
+        results.append(test_show(lib, font))
+
+        # Summary
+        print("\n" + "=" * 40)
+        print("Test Summary")
+        print("=" * 40)
+        passed = sum(results)
+        total = len(results)
+        print(f"{GREEN}Passed:{NC} {passed}/{total}")
+        print(f"{RED}Failed:{NC} {total - passed}/{total}")
+        print()
+
+        if passed == total:
+            print(f"{GREEN}All tests passed!{NC}")
+            return 0
+        else:
+            print(f"{RED}Some tests failed.{NC}")
+            return 1
+
+    finally:
+        # Cleanup
+        if os.path.exists(lib_path):
+            os.unlink(lib_path)
+
+if __name__ == "__main__":
+    sys.exit(main())
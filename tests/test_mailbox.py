@@ -0,0 +1,771 @@
+#!/usr/bin/env python3
+"""
+PIP-OS Mailbox Request Queue Unit Tests
+
+This script compiles the kernel's mailbox driver in a host environment on
+an emulated VideoCore mailbox: an 8-deep ARM to VideoCore FIFO, a
+VideoCore to ARM FIFO and the mailbox interrupt. Requests sent on several
+channels at once are checked to get their own answers in order, through
+callbacks and waits, with the write FIFO full, answers nobody waits for,
+polled waits before the interrupt and with IRQs masked, and waits in wfi
+after it.
+"""
+
+import subprocess
+import sys
+import os
+import tempfile
+import ctypes
+import random
+
+# Color codes for output
+GREEN = '\033[0;32m'
+RED = '\033[0;31m'
+YELLOW = '\033[1;33m'
+NC = '\033[0m'  # No Color
+
+def print_result(passed, test_name):
+    """Print test result with color"""
+    if passed:
+        print(f"{GREEN}✓{NC} {test_name}")
+        return True
+    else:
+        print(f"{RED}✗{NC} {test_name}")
+        return False
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+KERNEL_DIR = os.path.join(SCRIPT_DIR, '..', 'src', 'kernel')
+
+# The mailbox registers are FIFOs of the test. The VideoCore is the test
+# too : it takes the written messages and answers them, or, while
+# test_vc_auto is set, answers the oldest one at every status read.
+# wfi lets it answer everything, then raises the interrupt.
+STUBS = r'''
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define __INTERRUPTS_H__
+#define IRQ_ARM_MAILBOX 65
+typedef uintptr_t irq_flags_t;
+typedef void (*irq_handler_t)(void *arg);
+uint32_t test_masked;
+static inline irq_flags_t irq_save(void) { irq_flags_t flags = test_masked ? 0x80 : 0; test_masked = 1; return flags; }
+static inline void irq_restore(irq_flags_t flags) { test_masked = (flags & 0x80) != 0; }
+static inline bool irq_flags_masked(irq_flags_t flags) { return (flags & 0x80) != 0; }
+static irq_handler_t test_irq_handler;
+uint32_t test_irq_enabled;
+static bool irq_register(uint32_t irq, irq_handler_t handler, void *arg)
+{
+    (void)irq;
+    (void)arg;
+    test_irq_handler = handler;
+    return true;
+}
+static void irq_enable(uint32_t irq) { test_irq_enabled = irq; }
+
+#define SPINLOCK_H
+typedef struct { int held; } spinlock_t;
+#define SPINLOCK_INIT(name) { 0 }
+uint32_t test_lock_errors;
+static irq_flags_t spin_lock_irqsave(spinlock_t *lock)
+{
+    irq_flags_t flags = irq_save();
+    test_lock_errors += lock->held++;
+    return flags;
+}
+static bool spin_trylock(spinlock_t *lock)
+{
+    if (lock->held)
+        return false;
+    lock->held = 1;
+    return true;
+}
+static void spin_unlock_irqrestore(spinlock_t *lock, irq_flags_t flags)
+{
+    test_lock_errors += --lock->held != 0;
+    irq_restore(flags);
+}
+
+#define CACHE_H
+static void *test_cleaned;  // the last buffer given to the VideoCore
+static inline void dmb(void) { }
+static inline void dcache_clean_invalidate_range(const void *start, size_t size) { test_cleaned = (void *)start; (void)size; }
+static inline void dcache_invalidate_range(const void *start, size_t size) { (void)start; (void)size; }
+
+#define CLOCK_H
+uint64_t test_ticks;
+static uint64_t clock_ticks(void) { return test_ticks += 3; }
+static uint64_t clock_ticks_to_ns(uint64_t ticks) { return ticks * 1000; }
+
+#define TRACE_H
+#define TRACE_BEGIN(name, format, ...) do { } while (0)
+#define TRACE_END(name) do { } while (0)
+
+#define __K_STDIO_H__
+static int k_printf(const char *format, ...) { (void)format; return 0; }
+
+#define __K_STRING_H__
+static void *k_memcpy(void *dest, const void *src, size_t n) { return memcpy(dest, src, n); }
+static void *k_memset(void *dest, int c, size_t n) { return memset(dest, c, n); }
+
+#include "io.h"
+
+#define TEST_FIFO 8
+#define TEST_QUEUE 4096
+uint32_t test_to_vc[TEST_QUEUE];
+uint32_t test_to_vc_count;
+uint32_t test_to_arm[TEST_QUEUE];
+uint32_t test_to_arm_head, test_to_arm_count;
+uint32_t test_config;
+uint32_t test_vc_auto;
+uint32_t test_overflow;
+
+// The answer of the emulated VideoCore to <message>
+uint32_t test_answer(uint32_t message)
+{
+    return ((message & 0xFFFFFFF0) ^ 0x5A5A5A50) | (message & 0xF);
+}
+
+void test_vc_push(uint32_t value)
+{
+    test_to_arm[(test_to_arm_head + test_to_arm_count++) % TEST_QUEUE] = value;
+}
+
+// Property buffers on channel 8 answered in place, as the firmware does :
+// every tag but test_unknown, value i of a tag being its id + i
+uint32_t test_firmware;
+uint32_t test_firmware_fail;
+uint32_t test_unknown = 0x000DEAD0;
+
+static void test_firmware_answer(uint32_t message)
+{
+    uint32_t *buffer = test_cleaned;
+    if ((message & 0xF) != MB_CHANNEL_TAGS || !buffer ||
+        (uint32_t)(uintptr_t)buffer != (message & ~0xFu))
+        return;
+    for (uint32_t i = 2; buffer[i] != 0; i += 3 + buffer[i + 1] / 4) {   // up to the end tag
+        if (buffer[i] == test_unknown)
+            continue;
+        buffer[i + 2] = 0x80000000 | buffer[i + 1];      // answered, value length
+        for (uint32_t v = 0; v < buffer[i + 1] / 4; v++)
+            buffer[i + 3 + v] = buffer[i] + v;
+    }
+    buffer[1] = test_firmware_fail ? RPI_FIRMWARE_STATUS_ERROR : RPI_FIRMWARE_STATUS_SUCCESS;
+}
+
+// The VideoCore answers the oldest message written
+static void test_vc_step(void)
+{
+    if (test_to_vc_count) {
+        if (test_firmware)
+            test_firmware_answer(test_to_vc[0]);
+        test_vc_push(test_answer(test_to_vc[0]));
+        memmove(test_to_vc, test_to_vc + 1, --test_to_vc_count * 4);
+    }
+}
+
+#define __UART_H__
+static void mmio_write(uint32_t reg, uint32_t data)
+{
+    if (reg == MAIL_WRITE) {
+        test_overflow += test_to_vc_count >= TEST_FIFO;
+        test_to_vc[test_to_vc_count++] = data;
+    } else if (reg == MAIL_CONFIG) {
+        test_config = data;
+    }
+}
+static uint32_t mmio_read(uint32_t reg)
+{
+    if (reg == MAIL_RSTATUS) {
+        if (test_vc_auto && !test_to_arm_count)
+            test_vc_step();
+        return test_to_arm_count ? 0 : MAIL_EMPTY;
+    }
+    if (reg == MAIL_WSTATUS)
+        return test_to_vc_count >= TEST_FIFO ? MAIL_FULL : 0;
+    if (reg == MAIL_READ && test_to_arm_count) {
+        uint32_t value = test_to_arm[test_to_arm_head];
+        test_to_arm_head = (test_to_arm_head + 1) % TEST_QUEUE;
+        test_to_arm_count--;
+        return value;
+    }
+    return 0;
+}
+
+void test_interrupt(void)
+{
+    irq_flags_t flags = irq_save();
+    test_irq_handler(NULL);
+    irq_restore(flags);
+}
+
+#define CPU_H
+uint32_t test_core;
+uint32_t test_wfi;
+static inline uint32_t core_id(void) { return test_core; }
+static void cpu_wfi(void)
+{
+    // The VideoCore answers, its interrupt wakes the core up and is taken
+    // once IRQs are unmasked : here already
+    while (test_to_vc_count)
+        test_vc_step();
+    test_wfi++;
+    if (test_to_arm_count && (test_config & 1))
+        test_irq_handler(NULL);
+}
+
+#include "mailbox.c"
+
+#define TEST_REQUESTS 256
+#define TEST_LOG 4096
+
+mailbox_request_t test_requests[TEST_REQUESTS];
+uint32_t test_log_id[TEST_LOG];
+uint32_t test_log_answer[TEST_LOG];
+uint32_t test_log_count;
+uint32_t test_resend[TEST_REQUESTS];    // sends again from the callback, that many times
+
+static void test_callback(uint32_t answer, void *arg)
+{
+    uint32_t id = (uintptr_t)arg;
+    mailbox_request_t *request = &test_requests[id];
+
+    test_log_id[test_log_count] = id;
+    test_log_answer[test_log_count] = answer;
+    test_log_count = (test_log_count + 1) % TEST_LOG;
+    if (test_resend[id]) {
+        test_resend[id]--;
+        mailbox_send(request, request->message + 0x10, request->channel, test_callback, arg);
+    }
+}
+
+void test_send(uint32_t id, uint32_t message, uint32_t channel, bool callback)
+{
+    mailbox_send(&test_requests[id], message, channel,
+                 callback ? test_callback : NULL, (void *)(uintptr_t)id);
+}
+
+bool test_done(uint32_t id)
+{
+    return mailbox_done(&test_requests[id]);
+}
+
+uint32_t test_wait(uint32_t id)
+{
+    return mailbox_wait(&test_requests[id]);
+}
+
+void test_poll(void)
+{
+    mailbox_poll();
+}
+
+uint32_t test_stray(void)
+{
+    mailbox_stats_t stats;
+    mailbox_get_stats(&stats);
+    return stats.stray;
+}
+
+mailbox_batch_t test_batch;
+
+uint32_t test_cached(void)
+{
+    mailbox_stats_t stats;
+    mailbox_get_stats(&stats);
+    return stats.cached;
+}
+
+// The property buffer held by the code a fatal exception interrupted
+void test_property_hold(bool held)
+{
+    mailbox_property_lock.held = held;
+}
+
+uint32_t test_transactions(void)
+{
+    mailbox_stats_t stats;
+    mailbox_get_stats(&stats);
+    return stats.transactions;
+}
+'''
+
+FUZZ_SEED = 0x3A11
+REQUESTS = 256
+FIFO = 8
+BATCH_WORDS = 128
+UNKNOWN_TAG = 0x000DEAD0
+
+TAG_GET_VERSION = 0x00000001
+TAG_GET_BOARD_MODEL = 0x00010001
+TAG_GET_BOARD_REVISION = 0x00010002
+TAG_GET_BOARD_MAC_ADDRESS = 0x00010003
+TAG_GET_BOARD_SERIAL = 0x00010004
+TAG_GET_ARM_MEMORY = 0x00010005
+TAG_GET_VC_MEMORY = 0x00010006
+
+class Board(ctypes.Structure):
+    """mailbox_board_t"""
+    _fields_ = [('firmware', ctypes.c_uint32), ('model', ctypes.c_uint32),
+                ('revision', ctypes.c_uint32), ('serial', ctypes.c_uint64),
+                ('mac', ctypes.c_uint8 * 6), ('arm_base', ctypes.c_uint32),
+                ('arm_size', ctypes.c_uint32), ('vc_base', ctypes.c_uint32),
+                ('vc_size', ctypes.c_uint32)]
+
+def firmware_values(tag_id, words):
+    """The emulated firmware answers value i of a tag with its id + i"""
+    return [tag_id + i for i in range(words)]
+
+def compile_test_module():
+    """Compile the kernel mailbox.c for host testing"""
+    print("Compiling mailbox for testing...")
+
+    test_so_file = None
+    stubs_file = None
+    try:
+        fd, test_so_file = tempfile.mkstemp(suffix='.so')
+        os.close(fd)
+        fd, stubs_file = tempfile.mkstemp(suffix='.c')
+        with os.fdopen(fd, 'w') as f:
+            f.write(STUBS)
+
+        result = subprocess.run(
+            ['gcc', '-shared', '-fPIC', '-O2', '-DBCM2836=1',
+             '-I', KERNEL_DIR, '-o', test_so_file, stubs_file],
+            capture_output=True,
+            text=True
+        )
+
+        if result.returncode != 0:
+            print(f"{RED}Compilation failed:{NC}")
+            print(result.stderr)
+            os.unlink(test_so_file)
+            return None
+
+        print(f"{GREEN}Compilation successful{NC}")
+        return test_so_file
+
+    except Exception as e:
+        print(f"{RED}Error during compilation: {e}{NC}")
+        if test_so_file and os.path.exists(test_so_file):
+            os.unlink(test_so_file)
+        return None
+    finally:
+        if stubs_file and os.path.exists(stubs_file):
+            os.unlink(stubs_file)
+
+def answer(message):
+    return ((message & 0xFFFFFFF0) ^ 0x5A5A5A50) | (message & 0xF)
+
+class VideoCore:
+    """The emulated mailbox FIFOs, the VideoCore side driven by the test"""
+
+    def __init__(self, lib):
+        self.lib = lib
+        self.to_vc = (ctypes.c_uint32 * 4096).in_dll(lib, 'test_to_vc')
+        self.to_vc_count = ctypes.c_uint32.in_dll(lib, 'test_to_vc_count')
+        self.to_arm_count = ctypes.c_uint32.in_dll(lib, 'test_to_arm_count')
+        self.auto = ctypes.c_uint32.in_dll(lib, 'test_vc_auto')
+        self.overflow = ctypes.c_uint32.in_dll(lib, 'test_overflow')
+        self.masked = ctypes.c_uint32.in_dll(lib, 'test_masked')
+        self.core = ctypes.c_uint32.in_dll(lib, 'test_core')
+        self.wfi = ctypes.c_uint32.in_dll(lib, 'test_wfi')
+        self.lock_errors = ctypes.c_uint32.in_dll(lib, 'test_lock_errors')
+        self.firmware = ctypes.c_uint32.in_dll(lib, 'test_firmware')
+        self.firmware_fail = ctypes.c_uint32.in_dll(lib, 'test_firmware_fail')
+        self.batch = (ctypes.c_uint32 * BATCH_WORDS).in_dll(lib, 'test_batch')
+        self.log_id = (ctypes.c_uint32 * 4096).in_dll(lib, 'test_log_id')
+        self.log_answer = (ctypes.c_uint32 * 4096).in_dll(lib, 'test_log_answer')
+        self.log_count = ctypes.c_uint32.in_dll(lib, 'test_log_count')
+        self.resend = (ctypes.c_uint32 * REQUESTS).in_dll(lib, 'test_resend')
+        # Messages the VideoCore took and not answered yet, per channel
+        self.taken = {}
+
+    def take(self):
+        """Empty the ARM to VideoCore FIFO, never deeper than 8"""
+        count = self.to_vc_count.value
+        ok = count <= FIFO
+        for i in range(count):
+            message = self.to_vc[i]
+            self.taken.setdefault(message & 0xF, []).append(message)
+        self.to_vc_count.value = 0
+        return ok
+
+    def answer(self, channel):
+        self.lib.test_vc_push(answer(self.taken[channel].pop(0)))
+
+    def callbacks(self):
+        """Callbacks since the last call, (id, answer)"""
+        log = [(self.log_id[i], self.log_answer[i]) for i in range(self.log_count.value)]
+        self.log_count.value = 0
+        return log
+
+def setup(lib):
+    lib.mailbox_irq_init.argtypes = []
+    lib.mailbox_irq_init.restype = None
+    lib.mailbox_call.argtypes = [ctypes.c_uint32, ctypes.c_uint32]
+    lib.mailbox_call.restype = ctypes.c_uint32
+    lib.test_send.argtypes = [ctypes.c_uint32, ctypes.c_uint32, ctypes.c_uint32, ctypes.c_bool]
+    lib.test_send.restype = None
+    lib.test_done.argtypes = [ctypes.c_uint32]
+    lib.test_done.restype = ctypes.c_bool
+    lib.test_wait.argtypes = [ctypes.c_uint32]
+    lib.test_wait.restype = ctypes.c_uint32
+    lib.test_poll.argtypes = []
+    lib.test_poll.restype = None
+    lib.test_interrupt.argtypes = []
+    lib.test_interrupt.restype = None
+    lib.test_vc_push.argtypes = [ctypes.c_uint32]
+    lib.test_vc_push.restype = None
+    lib.test_stray.argtypes = []
+    lib.test_stray.restype = ctypes.c_uint32
+    lib.test_transactions.argtypes = []
+    lib.test_transactions.restype = ctypes.c_uint32
+    lib.test_cached.argtypes = []
+    lib.test_cached.restype = ctypes.c_uint32
+    lib.mailbox_batch_init.argtypes = [ctypes.c_void_p]
+    lib.mailbox_batch_init.restype = None
+    lib.mailbox_batch_add.argtypes = [ctypes.c_void_p, ctypes.c_uint32, ctypes.c_uint32]
+    lib.mailbox_batch_add.restype = ctypes.c_void_p
+    lib.mailbox_batch_process.argtypes = [ctypes.c_void_p]
+    lib.mailbox_batch_process.restype = ctypes.c_bool
+    lib.mailbox_batch_send.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p]
+    lib.mailbox_batch_send.restype = ctypes.c_bool
+    lib.mailbox_batch_answered.argtypes = [ctypes.c_void_p]
+    lib.mailbox_batch_answered.restype = ctypes.c_bool
+    lib.mailbox_get.argtypes = [ctypes.c_uint32]
+    lib.mailbox_get.restype = ctypes.c_uint32
+    lib.mailbox_board.argtypes = []
+    lib.mailbox_board.restype = ctypes.POINTER(Board)
+    lib.test_property_hold.argtypes = [ctypes.c_bool]
+    lib.test_property_hold.restype = None
+    lib.mailbox_try_process.argtypes = [ctypes.c_void_p, ctypes.c_uint32]
+    lib.mailbox_try_process.restype = ctypes.c_bool
+
+def test_fuzz(lib, vc):
+    """Requests on every channel at once, answered out of order between
+    channels, with answers nobody waits for among them"""
+    rng = random.Random(FUZZ_SEED)
+    vc.auto.value = 0
+    vc.callbacks()
+    passed = True
+    stray = lib.test_stray()
+    transactions = lib.test_transactions()
+    answered = 0
+    strays = 0
+
+    # id : message, for the requests in flight
+    sent = {}
+    free = list(range(REQUESTS))
+    # Per channel, the ids in the order sent
+    order = {}
+
+    for step in range(20000):
+        op = rng.randrange(6)
+        if op < 2 and free:
+            id = free.pop(rng.randrange(len(free)))
+            channel = rng.choice([0, 1, 8, 8, 8, 9])
+            message = rng.randrange(1 << 28) << 4 | channel
+            lib.test_send(id, message, channel, True)
+            sent[id] = message
+            order.setdefault(channel, []).append(id)
+        elif op == 2:
+            passed = vc.take() and passed
+        elif op == 3:
+            channels = [c for c, m in vc.taken.items() if m]
+            for _ in range(rng.randrange(1, 4)):
+                if channels:
+                    vc.answer(rng.choice(channels))
+                    channels = [c for c, m in vc.taken.items() if m]
+        elif op == 4 and rng.randrange(8) == 0:
+            # A channel with nothing sent on it
+            lib.test_vc_push(rng.randrange(1 << 28) << 4 | 5)
+            strays += 1
+        else:
+            if rng.randrange(2):
+                lib.test_interrupt()
+            else:
+                lib.test_poll()
+
+        for id, got in vc.callbacks():
+            channel = sent[id] & 0xF
+            # Their own answer, in the order of their channel
+            passed = passed and order[channel][0] == id
+            passed = passed and got == answer(sent[id]) & 0xFFFFFFF0
+            passed = passed and lib.test_done(id)
+            order[channel].pop(0)
+            del sent[id]
+            free.append(id)
+            answered += 1
+
+    passed = passed and all(not lib.test_done(id) for id in sent)
+    passed = passed and vc.overflow.value == 0 and vc.lock_errors.value == 0
+    passed = passed and lib.test_stray() - stray == strays
+    passed = passed and lib.test_transactions() - transactions == answered
+    passed = passed and answered > 5000
+
+    # Answer what is left
+    while sent:
+        vc.take()
+        for channel, messages in vc.taken.items():
+            while messages:
+                vc.answer(channel)
+        lib.test_poll()
+        for id, _ in vc.callbacks():
+            del sent[id]
+    return print_result(passed, "Requests matched with their answers")
+
+def test_full(lib, vc):
+    """More requests than the write FIFO holds, written as it empties"""
+    vc.auto.value = 0
+    vc.callbacks()
+    for id in range(40):
+        lib.test_send(id, (id + 1) << 4 | 8, 8, True)
+    passed = vc.to_vc_count.value == FIFO
+
+    answered = []
+    for _ in range(40):
+        passed = vc.take() and passed
+        while vc.taken.get(8):
+            vc.answer(8)
+        lib.test_interrupt()
+        answered += [id for id, _ in vc.callbacks()]
+
+    passed = passed and answered == list(range(40)) and vc.overflow.value == 0
+    return print_result(passed, "Full write FIFO queues the requests")
+
+def test_polled(lib, vc):
+    """Waits poll before the interrupt, without losing the answers of other
+    channels"""
+    vc.auto.value = 1
+    vc.callbacks()
+    stray = lib.test_stray()
+
+    # An earlier request on another channel, its answer comes first
+    lib.test_send(0, 0x12340 | 1, 1, True)
+    got = lib.mailbox_call(0x56780 | 8, 8)
+    passed = got == answer(0x56780 | 8) & 0xFFFFFFF0
+    passed = passed and lib.test_done(0) and vc.callbacks() == [(0, answer(0x12341) & 0xFFFFFFF0)]
+    passed = passed and lib.test_stray() == stray and vc.wfi.value == 0
+
+    # A request resent from its callback, a chain of 5
+    vc.resend[1] = 4
+    lib.test_send(1, 0x100 | 8, 8, True)
+    lib.test_wait(1)
+    while not lib.test_done(1):
+        lib.test_poll()
+    chain = vc.callbacks()
+    passed = passed and [a for _, a in chain] == [answer(0x100 + 0x10 * i | 8) & 0xFFFFFFF0
+                                                  for i in range(5)]
+    return print_result(passed, "Polled waits before the interrupt")
+
+def test_irq(lib, vc):
+    """Waits in wfi on core 0 once the interrupt is on, polled with IRQs
+    masked and on the other cores"""
+    lib.mailbox_irq_init()
+    config = ctypes.c_uint32.in_dll(lib, 'test_config')
+    enabled = ctypes.c_uint32.in_dll(lib, 'test_irq_enabled')
+    passed = config.value & 1 == 1 and enabled.value == 65
+
+    # Core 0, IRQs on : the VideoCore answers while the core sleeps
+    vc.auto.value = 0
+    waits = vc.wfi.value
+    got = lib.mailbox_call(0xABC00 | 8, 8)
+    passed = passed and got == answer(0xABC08) & 0xFFFFFFF0 and vc.wfi.value > waits
+    passed = passed and vc.masked.value == 0
+
+    # IRQs masked : no wfi, the mailbox is polled
+    vc.auto.value = 1
+    waits = vc.wfi.value
+    vc.masked.value = 1
+    got = lib.mailbox_call(0xDEF00 | 8, 8)
+    passed = passed and got == answer(0xDEF08) & 0xFFFFFFF0 and vc.wfi.value == waits
+    passed = passed and vc.masked.value == 1
+    vc.masked.value = 0
+
+    # Another core polls, and completes the requests of core 0 on the way
+    vc.callbacks()
+    lib.test_send(2, 0x22220 | 1, 1, True)
+    vc.core.value = 1
+    got = lib.mailbox_call(0x33330 | 8, 8)
+    vc.core.value = 0
+    passed = passed and got == answer(0x33338) & 0xFFFFFFF0 and vc.wfi.value == waits
+    passed = passed and lib.test_done(2) and [id for id, _ in vc.callbacks()] == [2]
+    passed = passed and vc.lock_errors.value == 0
+    return print_result(passed, "Interrupt driven waits")
+
+def test_try_process(lib, vc):
+    """mailbox_try_process gives up on a busy property buffer, sends nothing
+    and leaves IRQs as they were"""
+    vc.auto.value = 1
+    transactions = lib.test_transactions()
+    tag = (ctypes.c_uint32 * 5)(0x00048009, 8, 8, 0, 480)
+
+    lib.test_property_hold(True)
+    passed = not lib.mailbox_try_process(tag, ctypes.sizeof(tag))
+    passed = passed and vc.to_vc_count.value == 0 and vc.masked.value == 0
+    passed = passed and lib.test_transactions() == transactions
+    lib.test_property_hold(False)
+
+    passed = passed and lib.mailbox_try_process(tag, ctypes.sizeof(tag))
+    passed = passed and lib.test_transactions() == transactions + 1
+    passed = passed and vc.masked.value == 0 and vc.lock_errors.value == 0
+    return print_result(passed, "Property call without waiting for the lock")
+
+def test_batch(lib, vc):
+    """Tags laid out back to back with zeroed values, NULL and nothing sent
+    once one does not fit, each answered in place"""
+    rng = random.Random(FUZZ_SEED + 1)
+    vc.auto.value = 1
+    vc.firmware.value = 1
+    batch = ctypes.addressof(vc.batch)
+    buffer = (ctypes.c_uint32 * BATCH_WORDS).from_address(batch)
+    passed = True
+
+    for _ in range(200):
+        ctypes.memset(batch, 0xA5, BATCH_WORDS * 4)
+        lib.mailbox_batch_init(batch)
+        length = 2
+        tags = []
+        while True:
+            tag_id = rng.choice([UNKNOWN_TAG, rng.randrange(1, 1 << 20)])
+            words = rng.randrange(0, 24)
+            value = lib.mailbox_batch_add(batch, tag_id, words)
+            fits = length + 3 + words + 1 <= BATCH_WORDS
+            if not fits or not value:
+                passed = passed and not value and not fits
+                break
+            start = length + 3
+            passed = passed and value == batch + start * 4
+            passed = passed and list(buffer[length:start]) == [tag_id, words * 4, 0]
+            passed = passed and all(v == 0 for v in buffer[start:start + words])
+            tags.append((tag_id, words, value))
+            length = start + words
+            if rng.randrange(6) == 0:
+                break
+
+        transactions = lib.test_transactions()
+        if value:
+            passed = passed and lib.mailbox_batch_process(batch)
+            passed = passed and buffer[0] == (length + 1) * 4 and buffer[length] == 0
+            passed = passed and lib.test_transactions() == transactions + 1
+            for tag_id, words, value in tags:
+                known = tag_id != UNKNOWN_TAG
+                values = list((ctypes.c_uint32 * words).from_address(value))
+                expected = firmware_values(tag_id, words) if known else [0] * words
+                passed = passed and lib.mailbox_batch_answered(value) == known
+                passed = passed and values == expected
+        else:
+            # Overflow : the batch is never sent
+            passed = passed and not lib.mailbox_batch_process(batch)
+            passed = passed and not lib.mailbox_batch_send(batch, None, None)
+            passed = passed and lib.test_transactions() == transactions
+            passed = passed and vc.to_vc_count.value == 0
+
+    # A failed batch
+    lib.mailbox_batch_init(batch)
+    lib.mailbox_batch_add(batch, TAG_GET_VERSION, 1)
+    vc.firmware_fail.value = 1
+    passed = passed and not lib.mailbox_batch_process(batch)
+    vc.firmware_fail.value = 0
+
+    vc.firmware.value = 0
+    passed = passed and vc.lock_errors.value == 0
+    return print_result(passed, "Batch layout, overflow and answers")
+
+def test_board(lib, vc):
+    """mailbox_get answers the fixed properties from the board read once,
+    read again after the firmware failed it"""
+    vc.auto.value = 1
+    vc.firmware.value = 1
+
+    # Failed : no board, mailbox_get asks the firmware itself
+    vc.firmware_fail.value = 1
+    transactions = lib.test_transactions()
+    cached = lib.test_cached()
+    passed = not lib.mailbox_board()
+    lib.mailbox_get(TAG_GET_BOARD_MODEL)
+    passed = passed and lib.test_cached() == cached
+    passed = passed and lib.test_transactions() == transactions + 3
+    vc.firmware_fail.value = 0
+
+    # One batch for the board, none for the cached properties after it
+    transactions = lib.test_transactions()
+    got = [lib.mailbox_get(tag) for tag in
+           (TAG_GET_BOARD_MODEL, TAG_GET_VERSION, TAG_GET_BOARD_REVISION, TAG_GET_BOARD_MODEL)]
+    passed = passed and got == [TAG_GET_BOARD_MODEL, TAG_GET_VERSION,
+                                TAG_GET_BOARD_REVISION, TAG_GET_BOARD_MODEL]
+    passed = passed and lib.test_transactions() == transactions + 1
+    passed = passed and lib.test_cached() == cached + 4
+
+    board = lib.mailbox_board().contents
+    serial = firmware_values(TAG_GET_BOARD_SERIAL, 2)
+    mac = b''.join(v.to_bytes(4, 'little') for v in firmware_values(TAG_GET_BOARD_MAC_ADDRESS, 2))
+    passed = passed and board.serial == serial[1] << 32 | serial[0]
+    passed = passed and bytes(board.mac) == mac[:6]
+    passed = passed and [board.arm_base, board.arm_size] == firmware_values(TAG_GET_ARM_MEMORY, 2)
+    passed = passed and [board.vc_base, board.vc_size] == firmware_values(TAG_GET_VC_MEMORY, 2)
+
+    # Other properties still go to the firmware
+    passed = passed and lib.mailbox_get(TAG_GET_ARM_MEMORY) == TAG_GET_ARM_MEMORY
+    passed = passed and lib.test_transactions() == transactions + 2
+    passed = passed and lib.test_cached() == cached + 4
+
+    vc.firmware.value = 0
+    return print_result(passed, "Board properties cached")
+
+def main():
+    """Main test function"""
+    print("=" * 40)
+    print("PIP-OS Mailbox Unit Tests")
+    print("=" * 40)
+    print()
+
+    # Compile test module
+    lib_path = compile_test_module()
+    if not lib_path:
+        print(f"{RED}Failed to compile test module{NC}")
+        return 1
+
+    try:
+        # Load shared library
+        lib = ctypes.CDLL(lib_path)
+        setup(lib)
+        vc = VideoCore(lib)
+
+        # Run tests
+        print("\nRunning tests...")
+        results = []
+        results.append(test_polled(lib, vc))
+        results.append(test_irq(lib, vc))
+        results.append(test_fuzz(lib, vc))
+        results.append(test_full(lib, vc))
+        results.append(test_try_process(lib, vc))
+        results.append(test_batch(lib, vc))
+        results.append(test_board(lib, vc))
+
+        # Summary
+        print("\n" + "=" * 40)
+        print("Test Summary")
+        print("=" * 40)
+        passed = sum(results)
+        total = len(results)
+        print(f"{GREEN}Passed:{NC} {passed}/{total}")
+        print(f"{RED}Failed:{NC} {total - passed}/{total}")
+        print()
+
+        if passed == total:
+            print(f"{GREEN}All tests passed!{NC}")
+            return 0
+        else:
+            print(f"{RED}Some tests failed.{NC}")
+            return 1
+
+    finally:
+        # Cleanup
+        if os.path.exists(lib_path):
+            os.unlink(lib_path)
+
+if __name__ == "__main__":
+    sys.exit(main())
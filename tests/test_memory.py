@@ -11,6 +11,8 @@ import sys
 import os
 import tempfile
 import ctypes
+import ctypes.util
+import random
 
 # Color codes for output
 GREEN = '\033[0;32m'
@@ -27,94 +29,46 @@ def print_result(passed, test_name):
         print(f"{RED}✗{NC} {test_name}")
         return False
 
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+K_STRING_SRC = os.path.join(SCRIPT_DIR, '..', 'src', 'kernel', 'k_libc', 'k_string.c')
+K_LIBC_DIR = os.path.dirname(K_STRING_SRC)
+
+FUZZ_ITERATIONS = 2000
+FUZZ_SEED = 0x7108
+
 def compile_test_module():
-    """Compile kernel memory functions for host testing"""
+    """Compile the kernel k_string.c for host testing"""
     print("Compiling memory functions for testing...")
-    
-    # Create a test wrapper C file
-    test_wrapper = """
-#include <stddef.h>
-#include <stdint.h>
-
-// k_memcmp implementation
-int k_memcmp(const void *s1, const void *s2, size_t n)
-{
-    const uint8_t *p1 = (const uint8_t *)s1;
-    const uint8_t *p2 = (const uint8_t *)s2;
-
-    for (size_t i = 0; i < n; i++) {
-        if (p1[i] != p2[i]) {
-            return (int)(p1[i] - p2[i]);
-        }
-    }
-
-    return 0;
-}
-
-// k_memcpy implementation
-void *k_memcpy(void *dest, const void *src, size_t n)
-{
-    uint8_t *bdest = (uint8_t*)dest;
-    uint8_t *bsrc = (uint8_t*)src;
-
-    for (size_t i = 0; i < n; i++) {
-        bdest[i] = bsrc[i];
-    }
-
-    return dest;
-}
-
-// k_strlen implementation
-uint32_t k_strlen(char *s)
-{
-    uint32_t n = 0;
-    while (s[n] != '\\0')
-    {
-        n++;
-    }
-    return n;
-}
-
-// memset implementation (standard)
-void *memset(void *s, int c, size_t n)
-{
-    uint8_t *p = (uint8_t *)s;
-    for (size_t i = 0; i < n; i++) {
-        p[i] = (uint8_t)c;
-    }
-    return s;
-}
-"""
-    
-    # Write to temp file and compile
+
+    test_so_file = None
     try:
-        with tempfile.NamedTemporaryFile(mode='w', suffix='.c', delete=False) as f:
-            test_c_file = f.name
-            f.write(test_wrapper)
-        
-        test_so_file = test_c_file.replace('.c', '.so')
-        
-        # Compile to shared library
+        fd, test_so_file = tempfile.mkstemp(suffix='.so')
+        os.close(fd)
+
+        # Same freestanding flags as the kernel build, host architecture
+        # takes the generic word-at-a-time paths
         result = subprocess.run(
-            ['gcc', '-shared', '-fPIC', '-o', test_so_file, test_c_file],
+            ['gcc', '-shared', '-fPIC', '-O2', '-ffreestanding',
+             '-fno-tree-loop-distribute-patterns', '-I', K_LIBC_DIR,
+             '-o', test_so_file, K_STRING_SRC],
             capture_output=True,
             text=True
         )
-        
+
         if result.returncode != 0:
             print(f"{RED}Compilation failed:{NC}")
             print(result.stderr)
+            os.unlink(test_so_file)
             return None
-        
+
         print(f"{GREEN}Compilation successful{NC}")
         return test_so_file
-    
+
     except Exception as e:
         print(f"{RED}Error during compilation: {e}{NC}")
+        if test_so_file and os.path.exists(test_so_file):
+            os.unlink(test_so_file)
         return None
-    finally:
-        if os.path.exists(test_c_file):
-            os.unlink(test_c_file)
 
 def test_k_strlen(lib):
     """Test k_strlen function"""
@@ -179,18 +133,112 @@ def test_k_memcpy(lib):
     return print_result(passed, "k_memcpy tests")
 
 def test_memset(lib):
-    """Test memset function"""
-    lib.memset.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_size_t]
-    lib.memset.restype = ctypes.c_void_p
+    """Test k_memset function"""
+    lib.k_memset.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_size_t]
+    lib.k_memset.restype = ctypes.c_void_p
     
     # Test setting memory
     size = 10
     buffer = (ctypes.c_ubyte * size)()
     
-    lib.memset(buffer, 0xAA, size)
+    lib.k_memset(buffer, 0xAA, size)
     
     passed = all(b == 0xAA for b in buffer)
-    return print_result(passed, "memset tests")
+    return print_result(passed, "k_memset tests")
+
+def test_k_memmove(lib):
+    """Test k_memmove function with overlapping regions"""
+    lib.k_memmove.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_size_t]
+    lib.k_memmove.restype = ctypes.c_void_p
+
+    data = bytes(range(64))
+    buffer = (ctypes.c_ubyte * 64).from_buffer_copy(data)
+    base = ctypes.addressof(buffer)
+
+    # Shift up by 3 bytes (destination inside source)
+    lib.k_memmove(base + 3, base, 40)
+    passed = bytes(buffer)[3:43] == data[0:40]
+
+    # Shift down by 5 bytes (source inside destination)
+    buffer = (ctypes.c_ubyte * 64).from_buffer_copy(data)
+    base = ctypes.addressof(buffer)
+    lib.k_memmove(base, base + 5, 40)
+    passed = passed and bytes(buffer)[0:40] == data[5:45]
+
+    return print_result(passed, "k_memmove tests")
+
+def sign(value):
+    return (value > 0) - (value < 0)
+
+def test_fuzz_against_libc(lib):
+    """Compare every function against glibc on random sizes and alignments"""
+    libc = ctypes.CDLL(ctypes.util.find_library('c'))
+    for func in (libc.memcpy, libc.memmove, libc.memset):
+        func.restype = ctypes.c_void_p
+    libc.memcpy.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_size_t]
+    libc.memmove.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_size_t]
+    libc.memset.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_size_t]
+    libc.memcmp.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_size_t]
+    libc.memcmp.restype = ctypes.c_int
+    libc.strlen.argtypes = [ctypes.c_void_p]
+    libc.strlen.restype = ctypes.c_size_t
+    lib.k_strlen.argtypes = [ctypes.c_void_p]
+
+    rng = random.Random(FUZZ_SEED)
+    size = 4096
+    failures = []
+
+    def buffers():
+        data = bytes(rng.getrandbits(8) for _ in range(size))
+        return ((ctypes.c_ubyte * size).from_buffer_copy(data),
+                (ctypes.c_ubyte * size).from_buffer_copy(data))
+
+    for i in range(FUZZ_ITERATIONS):
+        # Lengths biased towards the head/tail and block boundaries
+        n = rng.choice([rng.randrange(0, 80), rng.randrange(0, 1500)])
+        src_off = rng.randrange(0, 16)
+        dst_off = rng.randrange(0, 16)
+        op = rng.choice(['memcpy', 'memmove', 'memset', 'memcmp', 'strlen'])
+
+        mine, ref = buffers()
+        mine_base, ref_base = ctypes.addressof(mine), ctypes.addressof(ref)
+
+        if op == 'memcpy':
+            src = 2048 + src_off
+            lib.k_memcpy(mine_base + dst_off, mine_base + src, n)
+            libc.memcpy(ref_base + dst_off, ref_base + src, n)
+            ok = bytes(mine) == bytes(ref)
+        elif op == 'memmove':
+            # Overlapping windows in both directions
+            src = 512 + src_off
+            dst = src + rng.randrange(-64, 65)
+            lib.k_memmove(mine_base + dst, mine_base + src, n)
+            libc.memmove(ref_base + dst, ref_base + src, n)
+            ok = bytes(mine) == bytes(ref)
+        elif op == 'memset':
+            value = rng.getrandbits(8)
+            lib.k_memset(mine_base + dst_off, value, n)
+            libc.memset(ref_base + dst_off, value, n)
+            ok = bytes(mine) == bytes(ref)
+        elif op == 'memcmp':
+            other = (ctypes.c_ubyte * size).from_buffer_copy(bytes(mine))
+            if n > 0 and rng.random() < 0.7:
+                other[2048 + src_off + rng.randrange(0, n)] ^= 1 << rng.randrange(0, 8)
+            a = mine_base + 2048 + dst_off
+            b = ctypes.addressof(other) + 2048 + src_off
+            a_ref = ref_base + 2048 + dst_off
+            ok = sign(lib.k_memcmp(a, b, n)) == sign(libc.memcmp(a_ref, b, n))
+        else:
+            mine[dst_off + n] = 0
+            ok = lib.k_strlen(mine_base + dst_off) == libc.strlen(mine_base + dst_off)
+
+        if not ok:
+            failures.append(f"{op}(n={n}, src_off={src_off}, dst_off={dst_off})")
+
+    for failure in failures[:10]:
+        print(f"  {RED}Failed:{NC} {failure}")
+
+    return print_result(not failures, f"fuzzing against libc ({FUZZ_ITERATIONS} cases)")
 
 def main():
     """Main test function"""
@@ -216,6 +264,8 @@ def main():
         results.append(test_k_memcmp(lib))
         results.append(test_k_memcpy(lib))
         results.append(test_memset(lib))
+        results.append(test_k_memmove(lib))
+        results.append(test_fuzz_against_libc(lib))
         
         # Summary
         print("\n" + "=" * 40)
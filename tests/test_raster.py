@@ -0,0 +1,349 @@
+#!/usr/bin/env python3
+"""
+PIP-OS Rasterizer Unit Tests
+
+This script compiles the kernel's 2D rasterizer in a host environment and
+checks every primitive against a per-pixel Python model, at 8, 16 and 32
+bits per pixel, on targets with padded rows.
+"""
+
+import subprocess
+import sys
+import os
+import tempfile
+import ctypes
+import random
+
+# Color codes for output
+GREEN = '\033[0;32m'
+RED = '\033[0;31m'
+YELLOW = '\033[1;33m'
+NC = '\033[0m'  # No Color
+
+def print_result(passed, test_name):
+    """Print test result with color"""
+    if passed:
+        print(f"{GREEN}✓{NC} {test_name}")
+        return True
+    else:
+        print(f"{RED}✗{NC} {test_name}")
+        return False
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+KERNEL_DIR = os.path.join(SCRIPT_DIR, '..', 'src', 'kernel')
+RASTER_SRC = os.path.join(KERNEL_DIR, 'raster.c')
+K_STRING_SRC = os.path.join(KERNEL_DIR, 'k_libc', 'k_string.c')
+
+FUZZ_ITERATIONS = 300
+FUZZ_SEED = 0x2A57
+
+RASTER_COORD_MAX = 1 << 28
+
+WIDTH = 53
+HEIGHT = 37
+PAD = 7         # pixels of padding per row, rows start off word alignment
+
+class RasterTarget(ctypes.Structure):
+    _fields_ = [('pixels', ctypes.c_void_p),
+                ('width', ctypes.c_uint32),
+                ('height', ctypes.c_uint32),
+                ('pitch', ctypes.c_uint32),
+                ('bytes_pp', ctypes.c_uint32)]
+
+class RasterClip(ctypes.Structure):
+    _fields_ = [('x0', ctypes.c_int32), ('y0', ctypes.c_int32),
+                ('x1', ctypes.c_int32), ('y1', ctypes.c_int32)]
+
+def compile_test_module():
+    """Compile the kernel raster.c for host testing"""
+    print("Compiling rasterizer for testing...")
+
+    test_so_file = None
+    try:
+        fd, test_so_file = tempfile.mkstemp(suffix='.so')
+        os.close(fd)
+
+        result = subprocess.run(
+            ['gcc', '-shared', '-fPIC', '-O2', '-ffreestanding',
+             '-fno-tree-loop-distribute-patterns', '-I', KERNEL_DIR,
+             '-o', test_so_file, RASTER_SRC, K_STRING_SRC],
+            capture_output=True,
+            text=True
+        )
+
+        if result.returncode != 0:
+            print(f"{RED}Compilation failed:{NC}")
+            print(result.stderr)
+            os.unlink(test_so_file)
+            return None
+
+        print(f"{GREEN}Compilation successful{NC}")
+        return test_so_file
+
+    except Exception as e:
+        print(f"{RED}Error during compilation: {e}{NC}")
+        if test_so_file and os.path.exists(test_so_file):
+            os.unlink(test_so_file)
+        return None
+
+class Surface:
+    """A C target and its Python model, with a guard area after the rows"""
+
+    def __init__(self, bytes_pp, rng):
+        self.bytes_pp = bytes_pp
+        self.pitch = (WIDTH + PAD) * bytes_pp
+        self.size = self.pitch * HEIGHT + 64
+        # Random offset so the rows start at any alignment
+        self.offset = rng.randrange(0, 4) * (bytes_pp if bytes_pp < 4 else 0)
+        init = bytes(rng.getrandbits(8) for _ in range(self.size + 8))
+        self.buffer = ctypes.create_string_buffer(init, self.size + 8)
+        self.model = bytearray(init)
+        self.target = RasterTarget(ctypes.addressof(self.buffer) + self.offset,
+                                   WIDTH, HEIGHT, self.pitch, bytes_pp)
+
+    def plot(self, clip, x, y, color):
+        if clip.x0 <= x < clip.x1 and clip.y0 <= y < clip.y1:
+            at = self.offset + y * self.pitch + x * self.bytes_pp
+            mask = (1 << (8 * self.bytes_pp)) - 1
+            self.model[at:at + self.bytes_pp] = (color & mask).to_bytes(self.bytes_pp, 'little')
+
+    def matches(self):
+        return bytes(self.buffer.raw) == bytes(self.model)
+
+def model_line(surface, clip, x0, y0, x1, y1, color):
+    dx = abs(x1 - x0)
+    dy = -abs(y1 - y0)
+    sx = 1 if x1 > x0 else -1
+    sy = 1 if y1 > y0 else -1
+    err = dx + dy
+    while True:
+        surface.plot(clip, x0, y0, color)
+        if x0 == x1 and y0 == y1:
+            break
+        e2 = 2 * err
+        if e2 >= dy:
+            err += dy
+            x0 += sx
+        if e2 <= dx:
+            err += dx
+            y0 += sy
+
+def model_long_line(surface, clip, x0, y0, x1, y1, color):
+    """model_line for lines too long to step through: pixel i of the major
+    axis at (2 * minor * i + major) // (2 * major) on the minor one, only
+    for the i landing on the clip rect columns or rows"""
+    dx, dy = abs(x1 - x0), abs(y1 - y0)
+    sx = 1 if x1 > x0 else -1
+    sy = 1 if y1 > y0 else -1
+    steep = dy > dx
+    major, minor = (dy, dx) if steep else (dx, dy)
+    start, step, size = (y0, sy, (clip.y0, clip.y1)) if steep else (x0, sx, (clip.x0, clip.x1))
+    for c in range(size[0], size[1]):
+        i = (c - start) * step
+        if 0 <= i <= major:
+            j = (2 * minor * i + major) // (2 * major)
+            if steep:
+                surface.plot(clip, x0 + sx * j, c, color)
+            else:
+                surface.plot(clip, c, y0 + sy * j, color)
+
+def model_fill(surface, clip, x, y, w, h, color):
+    for row in range(y, y + h):
+        for col in range(x, x + w):
+            surface.plot(clip, col, row, color)
+
+def model_rect(surface, clip, x, y, w, h, color):
+    if w <= 2 or h <= 2:
+        model_fill(surface, clip, x, y, w, h, color)
+        return
+    model_fill(surface, clip, x, y, w, 1, color)
+    model_fill(surface, clip, x, y + h - 1, w, 1, color)
+    model_fill(surface, clip, x, y + 1, 1, h - 2, color)
+    model_fill(surface, clip, x + w - 1, y + 1, 1, h - 2, color)
+
+def setup(lib):
+    target = ctypes.POINTER(RasterTarget)
+    clip = ctypes.POINTER(RasterClip)
+    i32, u32 = ctypes.c_int32, ctypes.c_uint32
+    lib.raster_clip_set.argtypes = [target, clip, i32, i32, i32, i32]
+    lib.raster_point.argtypes = [target, clip, i32, i32, u32]
+    lib.raster_hline.argtypes = [target, clip, i32, i32, i32, u32]
+    lib.raster_vline.argtypes = [target, clip, i32, i32, i32, u32]
+    lib.raster_line.argtypes = [target, clip, i32, i32, i32, i32, u32]
+    lib.raster_fill_rect.argtypes = [target, clip, i32, i32, i32, i32, u32]
+    lib.raster_rect.argtypes = [target, clip, i32, i32, i32, i32, u32]
+    lib.raster_blit.argtypes = [target, clip, i32, i32, i32, i32, ctypes.c_void_p, u32]
+    lib.raster_cell.argtypes = [target, clip, i32, i32, ctypes.c_void_p, u32, u32, u32]
+    lib.raster_clear.argtypes = [target, u32]
+
+def random_clip(lib, surface, rng):
+    clip = RasterClip()
+    if rng.random() < 0.3:
+        lib.raster_clip_set(ctypes.byref(surface.target), ctypes.byref(clip), 0, 0, WIDTH, HEIGHT)
+    else:
+        lib.raster_clip_set(ctypes.byref(surface.target), ctypes.byref(clip),
+                            rng.randrange(-10, WIDTH), rng.randrange(-10, HEIGHT),
+                            rng.randrange(0, WIDTH + 20), rng.randrange(0, HEIGHT + 20))
+    return clip
+
+def coord(rng, size):
+    return rng.randrange(-20, size + 20)
+
+def fuzz_primitive(lib, name, rng):
+    """Random calls of one primitive, compared with the model"""
+    for i in range(FUZZ_ITERATIONS):
+        bytes_pp = rng.choice([1, 2, 4])
+        surface = Surface(bytes_pp, rng)
+        clip = random_clip(lib, surface, rng)
+        color = rng.getrandbits(32)
+        target, c = ctypes.byref(surface.target), ctypes.byref(clip)
+
+        if name == 'point':
+            x, y = coord(rng, WIDTH), coord(rng, HEIGHT)
+            lib.raster_point(target, c, x, y, color)
+            surface.plot(clip, x, y, color)
+        elif name == 'hline':
+            x, y, w = coord(rng, WIDTH), coord(rng, HEIGHT), rng.randrange(-2, WIDTH + 20)
+            lib.raster_hline(target, c, x, y, w, color)
+            model_fill(surface, clip, x, y, w, 1, color)
+        elif name == 'vline':
+            x, y, h = coord(rng, WIDTH), coord(rng, HEIGHT), rng.randrange(-2, HEIGHT + 20)
+            lib.raster_vline(target, c, x, y, h, color)
+            model_fill(surface, clip, x, y, 1, h, color)
+        elif name == 'line':
+            x0, y0 = coord(rng, WIDTH), coord(rng, HEIGHT)
+            x1, y1 = coord(rng, WIDTH), coord(rng, HEIGHT)
+            if rng.random() < 0.2:
+                y1 = y0
+            elif rng.random() < 0.2:
+                x1 = x0
+            lib.raster_line(target, c, x0, y0, x1, y1, color)
+            model_line(surface, clip, x0, y0, x1, y1, color)
+        elif name == 'far_line':
+            # Ends well off the target, the visible part starts far along
+            x0, y0 = rng.randrange(-3000, 3000), rng.randrange(-3000, 3000)
+            x1, y1 = coord(rng, WIDTH), coord(rng, HEIGHT)
+            if rng.random() < 0.5:
+                x0, y0, x1, y1 = x1, y1, x0, y0
+            lib.raster_line(target, c, x0, y0, x1, y1, color)
+            model_line(surface, clip, x0, y0, x1, y1, color)
+        elif name == 'long_line':
+            # Up to the coordinate limit, and past it : not drawn
+            limit = RASTER_COORD_MAX + (1 if rng.random() < 0.2 else 0)
+            x0, y0 = rng.choice([-limit, limit]), rng.randrange(-limit, limit + 1)
+            if rng.random() < 0.5:
+                x0, y0 = y0, x0
+            x1, y1 = coord(rng, WIDTH), coord(rng, HEIGHT)
+            lib.raster_line(target, c, x0, y0, x1, y1, color)
+            if limit == RASTER_COORD_MAX:
+                model_long_line(surface, clip, x0, y0, x1, y1, color)
+        elif name in ('fill_rect', 'rect'):
+            x, y = coord(rng, WIDTH), coord(rng, HEIGHT)
+            w, h = rng.randrange(0, WIDTH), rng.randrange(0, HEIGHT)
+            if name == 'fill_rect':
+                lib.raster_fill_rect(target, c, x, y, w, h, color)
+                model_fill(surface, clip, x, y, w, h, color)
+            else:
+                lib.raster_rect(target, c, x, y, w, h, color)
+                model_rect(surface, clip, x, y, w, h, color)
+        elif name == 'blit':
+            x, y = coord(rng, WIDTH), coord(rng, HEIGHT)
+            w, h = rng.randrange(0, 30), rng.randrange(0, 30)
+            stride = w + rng.randrange(0, 5)
+            src = [rng.getrandbits(8 * bytes_pp) for _ in range(stride * max(h, 1))]
+            raw = b''.join(p.to_bytes(bytes_pp, 'little') for p in src)
+            src_buffer = ctypes.create_string_buffer(raw, len(raw) + 4)
+            lib.raster_blit(target, c, x, y, w, h, src_buffer, stride)
+            for row in range(h):
+                for col in range(w):
+                    surface.plot(clip, x + col, y + row, src[row * stride + col])
+        elif name == 'cell':
+            x, y = coord(rng, WIDTH), coord(rng, HEIGHT)
+            height = rng.randrange(0, 17)
+            bits = bytes(rng.getrandbits(8) for _ in range(height))
+            bg = rng.getrandbits(32)
+            lib.raster_cell(target, c, x, y, bits, height, color, bg)
+            for row in range(height):
+                for col in range(8):
+                    surface.plot(clip, x + col, y + row, color if bits[row] >> col & 1 else bg)
+        elif name == 'clear':
+            lib.raster_clear(target, color)
+            full = RasterClip(0, 0, WIDTH, HEIGHT)
+            model_fill(surface, full, 0, 0, WIDTH, HEIGHT, color)
+
+        if not surface.matches():
+            print(f"  {RED}Failed:{NC} {name} at {bytes_pp * 8}bpp, case {i}")
+            return False
+    return True
+
+def test_primitives(lib):
+    """Fuzz every primitive against the model"""
+    results = []
+    for n, name in enumerate(['point', 'hline', 'vline', 'line', 'far_line', 'long_line', 'fill_rect', 'rect', 'blit', 'cell', 'clear']):
+        rng = random.Random(FUZZ_SEED + n)
+        results.append(print_result(fuzz_primitive(lib, name, rng),
+                                    f"raster_{name} ({FUZZ_ITERATIONS} cases)"))
+    return results
+
+def test_unpadded_clear(lib):
+    """A target without row padding is cleared as a single span"""
+    passed = True
+    for bytes_pp in (1, 2, 4):
+        size = WIDTH * HEIGHT * bytes_pp
+        buffer = ctypes.create_string_buffer(b'\xAA' * (size + 8), size + 8)
+        target = RasterTarget(ctypes.addressof(buffer), WIDTH, HEIGHT, WIDTH * bytes_pp, bytes_pp)
+        lib.raster_clear(ctypes.byref(target), 0x12345678)
+        pixel = (0x12345678 & ((1 << (8 * bytes_pp)) - 1)).to_bytes(bytes_pp, 'little')
+        if buffer.raw != pixel * (WIDTH * HEIGHT) + b'\xAA' * 8:
+            print(f"  {RED}Failed:{NC} clear at {bytes_pp * 8}bpp")
+            passed = False
+    return print_result(passed, "raster_clear without row padding")
+
+def main():
+    """Main test function"""
+    print("=" * 40)
+    print("PIP-OS Rasterizer Unit Tests")
+    print("=" * 40)
+    print()
+
+    # Compile test module
+    lib_path = compile_test_module()
+    if not lib_path:
+        print(f"{RED}Failed to compile test module{NC}")
+        return 1
+
+    try:
+        # Load shared library
+        lib = ctypes.CDLL(lib_path)
+        setup(lib)
+
+        # Run tests
+        print("\nRunning tests...")
+        results = []
+        results.extend(test_primitives(lib))
+        results.append(test_unpadded_clear(lib))
+
+        # Summary
+        print("\n" + "=" * 40)
+        print("Test Summary")
+        print("=" * 40)
+        passed = sum(results)
+        total = len(results)
+        print(f"{GREEN}Passed:{NC} {passed}/{total}")
+        print(f"{RED}Failed:{NC} {total - passed}/{total}")
+        print()
+
+        if passed == total:
+            print(f"{GREEN}All tests passed!{NC}")
+            return 0
+        else:
+            print(f"{RED}Some tests failed.{NC}")
+            return 1
+
+    finally:
+        # Cleanup
+        if os.path.exists(lib_path):
+            os.unlink(lib_path)
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,261 @@
+#!/usr/bin/env python3
+"""
+PIP-OS Byte Ring Unit Tests
+
+This script compiles the kernel's single producer, single consumer byte
+ring (the UART transmit and receive queues) in a host environment, checks
+random puts, peeks and gets against a Python model, across the wrap of the
+indexes, and streams bytes between a producer and a consumer thread.
+"""
+
+import subprocess
+import sys
+import os
+import tempfile
+import ctypes
+import random
+from collections import deque
+
+# Color codes for output
+GREEN = '\033[0;32m'
+RED = '\033[0;31m'
+YELLOW = '\033[1;33m'
+NC = '\033[0m'  # No Color
+
+def print_result(passed, test_name):
+    """Print test result with color"""
+    if passed:
+        print(f"{GREEN}✓{NC} {test_name}")
+        return True
+    else:
+        print(f"{RED}✗{NC} {test_name}")
+        return False
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+KERNEL_DIR = os.path.join(SCRIPT_DIR, '..', 'src', 'kernel')
+
+# The barriers of cache.h are ARM instructions, ring.c is built with host
+# ones. The threads stream a counter through the ring and count the bytes
+# arriving out of order.
+STUBS = r'''
+#define CACHE_H
+static inline void dmb(void) { __sync_synchronize(); }
+
+#include "ring.c"
+
+#include <pthread.h>
+
+static ring_t test_ring;
+static uint8_t test_data[4096];
+static uint32_t test_total;
+
+static void *test_producer(void *arg)
+{
+    uint8_t chunk[13];
+    uint32_t sent = 0;
+
+    (void)arg;
+    while (sent < test_total) {
+        uint32_t size = test_total - sent < sizeof(chunk) ? test_total - sent : sizeof(chunk);
+        for (uint32_t i = 0; i < size; i++)
+            chunk[i] = (uint8_t)(sent + i);
+        uint32_t put = ring_put(&test_ring, chunk, size);
+        // Keep the bytes that did not fit for the next put
+        sent += put;
+    }
+    return NULL;
+}
+
+uint32_t test_stream(uint32_t total)
+{
+    pthread_t producer;
+    uint32_t received = 0, errors = 0;
+
+    test_total = total;
+    ring_init(&test_ring, test_data, sizeof(test_data));
+    pthread_create(&producer, NULL, test_producer, NULL);
+
+    while (received < total) {
+        const uint8_t *data;
+        uint32_t size = ring_peek(&test_ring, &data);
+        for (uint32_t i = 0; i < size; i++)
+            errors += data[i] != (uint8_t)(received + i);
+        ring_consume(&test_ring, size);
+        received += size;
+    }
+
+    pthread_join(producer, NULL);
+    return errors + !ring_empty(&test_ring);
+}
+'''
+
+FUZZ_SEED = 0x5B1C
+
+class Ring(ctypes.Structure):
+    _fields_ = [('data', ctypes.c_void_p),
+                ('mask', ctypes.c_uint32),
+                ('head', ctypes.c_uint32),
+                ('tail', ctypes.c_uint32)]
+
+def compile_test_module():
+    """Compile the kernel ring.c for host testing"""
+    print("Compiling byte ring for testing...")
+
+    test_so_file = None
+    stubs_file = None
+    try:
+        fd, test_so_file = tempfile.mkstemp(suffix='.so')
+        os.close(fd)
+        fd, stubs_file = tempfile.mkstemp(suffix='.c')
+        with os.fdopen(fd, 'w') as f:
+            f.write(STUBS)
+
+        result = subprocess.run(
+            ['gcc', '-shared', '-fPIC', '-O2', '-pthread',
+             '-I', KERNEL_DIR, '-o', test_so_file, stubs_file],
+            capture_output=True,
+            text=True
+        )
+
+        if result.returncode != 0:
+            print(f"{RED}Compilation failed:{NC}")
+            print(result.stderr)
+            os.unlink(test_so_file)
+            return None
+
+        print(f"{GREEN}Compilation successful{NC}")
+        return test_so_file
+
+    except Exception as e:
+        print(f"{RED}Error during compilation: {e}{NC}")
+        if test_so_file and os.path.exists(test_so_file):
+            os.unlink(test_so_file)
+        return None
+    finally:
+        if stubs_file and os.path.exists(stubs_file):
+            os.unlink(stubs_file)
+
+def setup(lib):
+    ring_p = ctypes.POINTER(Ring)
+    lib.ring_init.argtypes = [ring_p, ctypes.c_void_p, ctypes.c_uint32]
+    lib.ring_init.restype = None
+    lib.ring_put.argtypes = [ring_p, ctypes.c_void_p, ctypes.c_uint32]
+    lib.ring_put.restype = ctypes.c_uint32
+    lib.ring_get.argtypes = [ring_p, ctypes.c_void_p, ctypes.c_uint32]
+    lib.ring_get.restype = ctypes.c_uint32
+    lib.ring_peek.argtypes = [ring_p, ctypes.POINTER(ctypes.POINTER(ctypes.c_uint8))]
+    lib.ring_peek.restype = ctypes.c_uint32
+    lib.ring_consume.argtypes = [ring_p, ctypes.c_uint32]
+    lib.ring_consume.restype = None
+    lib.test_stream.argtypes = [ctypes.c_uint32]
+    lib.test_stream.restype = ctypes.c_uint32
+
+def fuzz(lib, rng, size, start):
+    """Random operations on a ring of <size> bytes whose indexes start at
+    <start>, against a deque"""
+    storage = ctypes.create_string_buffer(size)
+    ring = Ring()
+    lib.ring_init(ctypes.byref(ring), storage, size)
+    ring.head = ring.tail = start
+    model = deque()
+
+    for _ in range(2000):
+        op = rng.randrange(3)
+        if op == 0:
+            data = bytes(rng.randrange(256) for _ in range(rng.randrange(size + 8)))
+            put = lib.ring_put(ctypes.byref(ring), data, len(data))
+            if put != min(len(data), size - len(model)):
+                return False
+            model.extend(data[:put])
+        elif op == 1:
+            want = rng.randrange(size + 8)
+            out = ctypes.create_string_buffer(max(want, 1))
+            got = lib.ring_get(ctypes.byref(ring), out, want)
+            if got != min(want, len(model)):
+                return False
+            if out.raw[:got] != bytes(model.popleft() for _ in range(got)):
+                return False
+        else:
+            # A peek ends at the end of the storage, never past the data
+            ptr = ctypes.POINTER(ctypes.c_uint8)()
+            n = lib.ring_peek(ctypes.byref(ring), ctypes.byref(ptr))
+            if n != min(len(model), size - (ring.tail & (size - 1))):
+                return False
+            if bytes(ptr[:n]) != bytes(list(model)[:n]):
+                return False
+            take = rng.randrange(n + 1)
+            lib.ring_consume(ctypes.byref(ring), take)
+            for _ in range(take):
+                model.popleft()
+
+        if (ring.head - ring.tail) & 0xFFFFFFFF != len(model):
+            return False
+    return True
+
+def test_fuzz(lib):
+    """Puts, gets and peeks against a model"""
+    rng = random.Random(FUZZ_SEED)
+    passed = all(fuzz(lib, rng, size, 0) for size in (1, 2, 16, 256))
+    return print_result(passed, "Ring puts, gets and peeks")
+
+def test_index_wrap(lib):
+    """Indexes wrapping at 2^32"""
+    rng = random.Random(FUZZ_SEED + 1)
+    passed = all(fuzz(lib, rng, size, 0x100000000 - rng.randrange(1, 4 * size))
+                 for size in (16, 256) for _ in range(4))
+    return print_result(passed, "Ring indexes wrapping at 2^32")
+
+def test_threads(lib):
+    """A producer and a consumer thread, the size of the UART TX ring"""
+    passed = lib.test_stream(1 << 20) == 0
+    return print_result(passed, "Ring streamed between two threads")
+
+def main():
+    """Main test function"""
+    print("=" * 40)
+    print("PIP-OS Byte Ring Unit Tests")
+    print("=" * 40)
+    print()
+
+    # Compile test module
+    lib_path = compile_test_module()
+    if not lib_path:
+        print(f"{RED}Failed to compile test module{NC}")
+        return 1
+
+    try:
+        # Load shared library
+        lib = ctypes.CDLL(lib_path)
+        setup(lib)
+
+        # Run tests
+        print("\nRunning tests...")
+        results = []
+        results.append(test_fuzz(lib))
+        results.append(test_index_wrap(lib))
+        results.append(test_threads(lib))
+
+        # Summary
+        print("\n" + "=" * 40)
+        print("Test Summary")
+        print("=" * 40)
+        passed = sum(results)
+        total = len(results)
+        print(f"{GREEN}Passed:{NC} {passed}/{total}")
+        print(f"{RED}Failed:{NC} {total - passed}/{total}")
+        print()
+
+        if passed == total:
+            print(f"{GREEN}All tests passed!{NC}")
+            return 0
+        else:
+            print(f"{RED}Some tests failed.{NC}")
+            return 1
+
+    finally:
+        # Cleanup
+        if os.path.exists(lib_path):
+            os.unlink(lib_path)
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,430 @@
+#!/usr/bin/env python3
+"""
+PIP-OS Serial Terminal Model Unit Tests
+
+This script compiles the kernel's terminal screen model in a host
+environment, feeds the sequences its diff renderer sends to a Python VT100
+emulator and checks that the emulated screen follows the model, within the
+byte budget of every render and with short cursor motions.
+"""
+
+import subprocess
+import sys
+import os
+import tempfile
+import ctypes
+import random
+
+# Color codes for output
+GREEN = '\033[0;32m'
+RED = '\033[0;31m'
+YELLOW = '\033[1;33m'
+NC = '\033[0m'  # No Color
+
+def print_result(passed, test_name):
+    """Print test result with color"""
+    if passed:
+        print(f"{GREEN}✓{NC} {test_name}")
+        return True
+    else:
+        print(f"{RED}✗{NC} {test_name}")
+        return False
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+KERNEL_DIR = os.path.join(SCRIPT_DIR, '..', 'src', 'kernel')
+SOURCES = [os.path.join(KERNEL_DIR, 'term.c')]
+
+# The UART side, collecting what is sent
+STUBS = r'''
+#include <stddef.h>
+#include <string.h>
+
+char test_sent[65536];
+size_t test_sent_length;
+
+void uart_write(const char *buffer, size_t size)
+{
+    memcpy(test_sent + test_sent_length, buffer, size);
+    test_sent_length += size;
+}
+
+void uart_puts(const char *str)
+{
+    uart_write(str, strlen(str));
+}
+'''
+
+FUZZ_SEED = 0x7E12
+COLS = 80
+ROWS = 24
+BOLD, UNDERLINE, BLINK, REVERSE = 1, 2, 4, 8
+
+def fg(color):
+    return (8 | color) << 4
+
+class Cell(ctypes.Structure):
+    _fields_ = [('ch', ctypes.c_uint8), ('attr', ctypes.c_uint8)]
+
+class Stats(ctypes.Structure):
+    _fields_ = [('renders', ctypes.c_uint32), ('bytes', ctypes.c_uint32),
+                ('cells', ctypes.c_uint32), ('deferred', ctypes.c_uint32)]
+
+class Term(ctypes.Structure):
+    _fields_ = [('cells', (Cell * COLS) * ROWS),
+                ('shown', (Cell * COLS) * ROWS),
+                ('dirty', ctypes.c_uint32),
+                ('next_row', ctypes.c_uint32),
+                ('row', ctypes.c_int32),
+                ('col', ctypes.c_int32),
+                ('attr', ctypes.c_uint8),
+                ('ready', ctypes.c_bool),
+                ('stats', Stats)]
+
+def compile_test_module():
+    """Compile the kernel term.c for host testing"""
+    print("Compiling terminal model for testing...")
+
+    test_so_file = None
+    stubs_file = None
+    try:
+        fd, test_so_file = tempfile.mkstemp(suffix='.so')
+        os.close(fd)
+        fd, stubs_file = tempfile.mkstemp(suffix='.c')
+        with os.fdopen(fd, 'w') as f:
+            f.write(STUBS)
+
+        result = subprocess.run(
+            ['gcc', '-shared', '-fPIC', '-O2', '-ffreestanding',
+             '-I', KERNEL_DIR, '-o', test_so_file] + SOURCES + [stubs_file],
+            capture_output=True,
+            text=True
+        )
+
+        if result.returncode != 0:
+            print(f"{RED}Compilation failed:{NC}")
+            print(result.stderr)
+            os.unlink(test_so_file)
+            return None
+
+        print(f"{GREEN}Compilation successful{NC}")
+        return test_so_file
+
+    except Exception as e:
+        print(f"{RED}Error during compilation: {e}{NC}")
+        if test_so_file and os.path.exists(test_so_file):
+            os.unlink(test_so_file)
+        return None
+    finally:
+        if stubs_file and os.path.exists(stubs_file):
+            os.unlink(stubs_file)
+
+class Vt100:
+    """The terminal end: cursor motion, SGR, EL and ED, no wrapping"""
+
+    def __init__(self):
+        self.screen = [[(ord('?'), 0)] * COLS for _ in range(ROWS)]
+        self.row = self.col = 0
+        self.attr = 0x55            # unknown until reset
+        self.pending = False        # the last column was written
+        self.errors = []
+
+    def sgr(self, params):
+        for p in params or [0]:
+            if p == 0:
+                self.attr = 0
+            elif p in (1, 4, 5, 7):
+                self.attr |= {1: BOLD, 4: UNDERLINE, 5: BLINK, 7: REVERSE}[p]
+            elif 30 <= p <= 37:
+                self.attr = (self.attr & 0x0F) | fg(p - 30)
+            else:
+                self.errors.append(f"SGR {p}")
+
+    def csi(self, params, op):
+        values = [int(p) if p else 0 for p in params.split(';')] if params else []
+        n = max(values[0], 1) if values else 1
+        self.pending = False
+        if op == 'H':
+            row = values[0] if values else 1
+            col = values[1] if len(values) > 1 else 1
+            self.row, self.col = max(row, 1) - 1, max(col, 1) - 1
+        elif op == 'A':
+            self.row = max(self.row - n, 0)
+        elif op == 'B':
+            self.row = min(self.row + n, ROWS - 1)
+        elif op == 'C':
+            self.col = min(self.col + n, COLS - 1)
+        elif op == 'D':
+            self.col = max(self.col - n, 0)
+        elif op == 'm':
+            self.sgr(values)
+        elif op == 'K' and not values:
+            for col in range(self.col, COLS):
+                self.screen[self.row][col] = (ord(' '), self.attr)
+        elif op == 'J' and values == [2]:
+            self.screen = [[(ord(' '), self.attr)] * COLS for _ in range(ROWS)]
+        else:
+            self.errors.append(f"CSI {params}{op}")
+
+    def feed(self, data):
+        i = 0
+        while i < len(data):
+            c = data[i]
+            i += 1
+            if c == 0x1B:
+                if data[i:i + 1] != b'[':
+                    self.errors.append("ESC without CSI")
+                    continue
+                j = i + 1
+                while data[j] not in b'@ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz':
+                    j += 1
+                self.csi(data[i + 1:j].decode(), chr(data[j]))
+                i = j + 1
+            elif c == 0x0D:
+                self.col, self.pending = 0, False
+            elif c == 0x0A:
+                if self.row == ROWS - 1:
+                    self.errors.append("LF on the last row scrolls")
+                self.row = min(self.row + 1, ROWS - 1)
+            elif c == 0x08:
+                self.col, self.pending = max(self.col - 1, 0), False
+            elif 0x20 <= c <= 0x7E:
+                if self.pending:
+                    self.errors.append("relies on wrapping")
+                self.screen[self.row][self.col] = (c, self.attr)
+                if self.col == COLS - 1:
+                    self.pending = True
+                else:
+                    self.col += 1
+            else:
+                self.errors.append(f"byte {c:#x}")
+
+def grid(cells):
+    return [[(cells[r][c].ch, cells[r][c].attr) for c in range(COLS)] for r in range(ROWS)]
+
+def setup(lib):
+    term = ctypes.POINTER(Term)
+    lib.term_init.argtypes = [term]
+    lib.term_clear.argtypes = [term]
+    lib.term_set.argtypes = [term, ctypes.c_uint32, ctypes.c_uint32, ctypes.c_char, ctypes.c_uint8]
+    lib.term_write.argtypes = [term, ctypes.c_uint32, ctypes.c_uint32, ctypes.c_char_p,
+                               ctypes.c_uint32, ctypes.c_uint8]
+    lib.term_render.argtypes = [term, ctypes.c_char_p, ctypes.c_uint32]
+    lib.term_render.restype = ctypes.c_uint32
+    lib.term_present.argtypes = [term, ctypes.c_uint32]
+    lib.term_release.argtypes = [term]
+
+class Session:
+    """A model and the emulated terminal it renders to"""
+
+    def __init__(self, lib):
+        self.lib = lib
+        self.term = Term()
+        self.vt = Vt100()
+        lib.term_init(ctypes.byref(self.term))
+
+    def render(self, budget):
+        out = ctypes.create_string_buffer(budget + 1)
+        length = self.lib.term_render(ctypes.byref(self.term), out, budget)
+        data = out.raw[:length]
+        self.vt.feed(data)
+        return data
+
+    def sync(self):
+        """Render until nothing is left"""
+        for _ in range(1000):
+            if not self.render(4096):
+                return True
+        return False
+
+    def set(self, row, col, c, attr):
+        self.lib.term_set(ctypes.byref(self.term), row, col, c, attr)
+
+    def random_edit(self, rng):
+        attrs = [0, 0, fg(2), fg(2) | BOLD, REVERSE, UNDERLINE | BLINK, fg(7)]
+        kind = rng.random()
+        if kind < 0.02:
+            self.lib.term_clear(ctypes.byref(self.term))
+        elif kind < 0.25:
+            row, col = rng.randrange(ROWS), rng.randrange(-5, COLS)
+            text = bytes(rng.randrange(0x20, 0x7F) for _ in range(rng.randrange(1, 30)))
+            self.lib.term_write(ctypes.byref(self.term), row, max(col, 0), text, len(text),
+                                rng.choice(attrs))
+        elif kind < 0.35:
+            # Blank a row from some column, EL material
+            row, col = rng.randrange(ROWS), rng.randrange(COLS)
+            self.lib.term_write(ctypes.byref(self.term), row, col, b' ' * COLS, COLS, 0)
+        else:
+            self.set(rng.randrange(ROWS), rng.randrange(COLS),
+                     bytes([rng.randrange(0x20, 0x7F)]), rng.choice(attrs))
+
+def test_first_render(lib):
+    """The first render resets and clears the terminal, then draws"""
+    s = Session(lib)
+    s.lib.term_write(ctypes.byref(s.term), 3, 10, b'PIP-OS V7.1.0.8', 15, fg(2) | BOLD)
+    data = s.render(4096)
+    passed = data.startswith(b'\033[0m\033[2J\033[H') and not s.vt.errors
+    passed = passed and s.vt.screen == grid(s.term.cells) and not s.render(4096)
+    return print_result(passed, "First render resets the terminal and draws the model")
+
+def test_budget_fuzz(lib):
+    """Random edits and budgets: renders fit, the terminal tracks the shown grid"""
+    rng = random.Random(FUZZ_SEED)
+    passed = True
+    for case in range(20):
+        s = Session(lib)
+        for frame in range(60):
+            for _ in range(rng.randrange(0, 40)):
+                s.random_edit(rng)
+            budget = rng.choice([11, 16, 40, 100, 384, 2000])
+            data = s.render(budget)
+            if len(data) > budget or s.vt.errors or \
+               (s.term.ready and s.vt.screen != grid(s.term.shown)):
+                print(f"  {RED}Failed:{NC} case {case} frame {frame}: {s.vt.errors[:3]}")
+                passed = False
+                break
+        if not passed:
+            break
+        if not s.sync() or s.vt.screen != grid(s.term.cells) or s.vt.errors:
+            print(f"  {RED}Failed:{NC} case {case} does not converge")
+            passed = False
+            break
+    return print_result(passed, "Random edits under random byte budgets (20 x 60 frames)")
+
+def test_short_motions(lib):
+    """Cells near the cursor are reached with a byte or two"""
+    s = Session(lib)
+    s.lib.term_write(ctypes.byref(s.term), 5, 0, b'0123456789', 10, 0)
+    s.sync()
+    # The cursor is right after the text at 5,10
+    cases = [((5, 10), b'A', 0, b'A'),             # in place
+             ((6, 11), b'B', 0, b'\nB'),           # LF keeps the column
+             ((6, 0), b'C', 0, b'\rC'),            # CR beats CUB
+             ((6, 3), b'D', 0, b'  D'),            # blank gap cells sent again
+             ((6, 5), b'F', 0, b' F'),
+             ((6, 5), b'G', 0, b'\bG'),            # BS
+             ((6, 6), b'H', BOLD, b'\033[;1mH'),   # SGR on a change only
+             ((6, 7), b'I', BOLD, b'I'),
+             ((20, 40), b'J', 0, b'\033[21;41H\033[mJ')]
+    passed = True
+    for (row, col), c, attr, expected in cases:
+        s.set(row, col, c, attr)
+        data = s.render(4096)
+        if data != expected:
+            print(f"  {RED}Failed:{NC} {c} at {row},{col}: {data!r}, expected {expected!r}")
+            passed = False
+    passed = passed and s.vt.screen == grid(s.term.cells) and not s.vt.errors
+    return print_result(passed, "Shortest cursor motions")
+
+def test_erase_line(lib):
+    """A row blanked to its end is cleared with EL"""
+    s = Session(lib)
+    s.lib.term_write(ctypes.byref(s.term), 7, 0, b'RobCo Industries Unified OS', 27, fg(2))
+    s.sync()
+    s.lib.term_write(ctypes.byref(s.term), 7, 5, b' ' * 30, 30, 0)
+    data = s.render(4096)
+    passed = data == b'\r\033[5C\033[m\033[K'
+    passed = passed and s.vt.screen == grid(s.term.cells) and not s.vt.errors
+    return print_result(passed, "Blank row ends cleared with EL")
+
+def test_animation_cost(lib):
+    """A rain of a few cells a frame costs a fraction of full repaints"""
+    rng = random.Random(FUZZ_SEED + 1)
+    s = Session(lib)
+    s.sync()
+    heads = [rng.randrange(-ROWS, 0) for _ in range(COLS)]
+    total = 0
+    for frame in range(100):
+        for col in range(0, COLS, 3):
+            heads[col] += 1
+            row = heads[col]
+            if 0 <= row < ROWS:
+                s.set(row, col, bytes([rng.randrange(0x21, 0x7F)]), fg(2) | BOLD)
+            if 0 <= row - 1 < ROWS:
+                s.set(row - 1, col, bytes([rng.randrange(0x21, 0x7F)]), fg(2))
+            if 0 <= row - 8 < ROWS:
+                s.set(row - 8, col, b' ', 0)
+            if row - 8 >= ROWS:
+                heads[col] = rng.randrange(-ROWS, 0)
+        total += len(s.render(4096))
+    passed = total < 100 * COLS * ROWS // 4 and s.vt.screen == grid(s.term.cells)
+    print(f"  {total // 100} bytes a frame, a full repaint is at least {COLS * ROWS}")
+    return print_result(passed, "Diffed animation cost")
+
+def test_present_release(lib):
+    """term_present keeps to its budget, term_release hands the terminal back"""
+    sent = ctypes.c_size_t.in_dll(lib, 'test_sent_length')
+    buffer = (ctypes.c_char * 65536).in_dll(lib, 'test_sent')
+    term = Term()
+    lib.term_init(ctypes.byref(term))
+    lib.term_write(ctypes.byref(term), 0, 0, b'X' * 80, 80, 0)
+
+    sent.value = 0
+    lib.term_present(ctypes.byref(term), 50)
+    passed = sent.value == 50
+    lib.term_present(ctypes.byref(term), 100000)
+    passed = passed and sent.value == 11 + 80 and not term.dirty
+
+    # Attributes reset, the cursor at the start of the last row, the screen left as it is
+    release = b'\033[0m\033[%dH' % ROWS
+    lib.term_release(ctypes.byref(term))
+    passed = passed and buffer.raw[11 + 80:sent.value] == release
+    vt = Vt100()
+    vt.feed(buffer.raw[:sent.value])
+    passed = passed and vt.screen[0][:80] == [(ord('X'), vt.attr)] * 80
+    passed = passed and (vt.row, vt.col, vt.attr) == (ROWS - 1, 0, 0)
+    lib.term_present(ctypes.byref(term), 1024)
+    passed = passed and sent.value == 2 * (11 + 80) + len(release) and not term.dirty
+    return print_result(passed, "term_present budget and term_release")
+
+def main():
+    """Main test function"""
+    print("=" * 40)
+    print("PIP-OS Serial Terminal Model Unit Tests")
+    print("=" * 40)
+    print()
+
+    # Compile test module
+    lib_path = compile_test_module()
+    if not lib_path:
+        print(f"{RED}Failed to compile test module{NC}")
+        return 1
+
+    try:
+        # Load shared library
+        lib = ctypes.CDLL(lib_path)
+        setup(lib)
+
+        # Run tests
+        print("\nRunning tests...")
+        results = []
+        results.append(test_first_render(lib))
+        results.append(test_budget_fuzz(lib))
+        results.append(test_short_motions(lib))
+        results.append(test_erase_line(lib))
+        results.append(test_animation_cost(lib))
+        results.append(test_present_release(lib))
+
+        # Summary
+        print("\n" + "=" * 40)
+        print("Test Summary")
+        print("=" * 40)
+        passed = sum(results)
+        total = len(results)
+        print(f"{GREEN}Passed:{NC} {passed}/{total}")
+        print(f"{RED}Failed:{NC} {total - passed}/{total}")
+        print()
+
+        if passed == total:
+            print(f"{GREEN}All tests passed!{NC}")
+            return 0
+        else:
+            print(f"{RED}Some tests failed.{NC}")
+            return 1
+
+    finally:
+        # Cleanup
+        if os.path.exists(lib_path):
+            os.unlink(lib_path)
+
+if __name__ == "__main__":
+    sys.exit(main())
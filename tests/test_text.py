@@ -0,0 +1,334 @@
+#!/usr/bin/env python3
+"""
+PIP-OS Text Renderer Unit Tests
+
+This script compiles the kernel's glyph cache and text run renderer in a
+host environment and checks the runs against a per-pixel Python model of
+the 8x8 font, at 8, 16 and 32 bits per pixel, every size, clipped or not.
+"""
+
+import subprocess
+import sys
+import os
+import tempfile
+import ctypes
+import random
+
+# Color codes for output
+GREEN = '\033[0;32m'
+RED = '\033[0;31m'
+YELLOW = '\033[1;33m'
+NC = '\033[0m'  # No Color
+
+def print_result(passed, test_name):
+    """Print test result with color"""
+    if passed:
+        print(f"{GREEN}✓{NC} {test_name}")
+        return True
+    else:
+        print(f"{RED}✗{NC} {test_name}")
+        return False
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+KERNEL_DIR = os.path.join(SCRIPT_DIR, '..', 'src', 'kernel')
+SOURCES = [os.path.join(KERNEL_DIR, name) for name in
+           ('text.c', 'font.c', 'raster.c', 'arena.c', os.path.join('k_libc', 'k_string.c'))]
+
+# The cache uses a static buffer, the page allocator and console are not linked
+STUBS = r'''
+#include <stdint.h>
+#include <stddef.h>
+uint32_t pmm_order_for(size_t size) { (void)size; return 0; }
+void *pmm_alloc_pages(uint32_t order) { (void)order; return NULL; }
+void pmm_free_pages(void *pages, uint32_t order) { (void)pages; (void)order; }
+int k_printf(const char *format, ...) { (void)format; return 0; }
+'''
+
+FUZZ_ITERATIONS = 400
+FUZZ_SEED = 0x7E47
+
+WIDTH = 97
+HEIGHT = 45
+PAD = 3         # pixels of padding per row
+
+FONT_WIDTH = 8
+FONT_HEIGHT = 8
+FONT_FIRST = 0x20
+FONT_LAST = 0x7E
+SIZE_MAX = 4
+
+class RasterTarget(ctypes.Structure):
+    _fields_ = [('pixels', ctypes.c_void_p),
+                ('width', ctypes.c_uint32),
+                ('height', ctypes.c_uint32),
+                ('pitch', ctypes.c_uint32),
+                ('bytes_pp', ctypes.c_uint32)]
+
+class RasterClip(ctypes.Structure):
+    _fields_ = [('x0', ctypes.c_int32), ('y0', ctypes.c_int32),
+                ('x1', ctypes.c_int32), ('y1', ctypes.c_int32)]
+
+class TextCacheStats(ctypes.Structure):
+    _fields_ = [('hits', ctypes.c_uint32),
+                ('misses', ctypes.c_uint32),
+                ('flushes', ctypes.c_uint32),
+                ('glyphs', ctypes.c_uint32),
+                ('bytes', ctypes.c_uint32)]
+
+def compile_test_module():
+    """Compile the kernel text.c and its dependencies for host testing"""
+    print("Compiling text renderer for testing...")
+
+    test_so_file = None
+    stubs_file = None
+    try:
+        fd, test_so_file = tempfile.mkstemp(suffix='.so')
+        os.close(fd)
+        fd, stubs_file = tempfile.mkstemp(suffix='.c')
+        with os.fdopen(fd, 'w') as f:
+            f.write(STUBS)
+
+        result = subprocess.run(
+            ['gcc', '-shared', '-fPIC', '-O2', '-ffreestanding',
+             '-fno-tree-loop-distribute-patterns', '-I', KERNEL_DIR,
+             '-o', test_so_file] + SOURCES + [stubs_file],
+            capture_output=True,
+            text=True
+        )
+
+        if result.returncode != 0:
+            print(f"{RED}Compilation failed:{NC}")
+            print(result.stderr)
+            os.unlink(test_so_file)
+            return None
+
+        print(f"{GREEN}Compilation successful{NC}")
+        return test_so_file
+
+    except Exception as e:
+        print(f"{RED}Error during compilation: {e}{NC}")
+        if test_so_file and os.path.exists(test_so_file):
+            os.unlink(test_so_file)
+        return None
+
+    finally:
+        if stubs_file and os.path.exists(stubs_file):
+            os.unlink(stubs_file)
+
+class Surface:
+    """A C target and its Python model, with a guard area after the rows"""
+
+    def __init__(self, bytes_pp, rng, pad=PAD):
+        self.bytes_pp = bytes_pp
+        self.pitch = (WIDTH + pad) * bytes_pp
+        self.size = self.pitch * HEIGHT + 64
+        # Random offset so the rows start at any alignment
+        self.offset = rng.randrange(0, 4) * (bytes_pp if bytes_pp < 4 else 0)
+        init = bytes(rng.getrandbits(8) for _ in range(self.size + 8))
+        self.buffer = ctypes.create_string_buffer(init, self.size + 8)
+        self.model = bytearray(init)
+        self.target = RasterTarget(ctypes.addressof(self.buffer) + self.offset,
+                                   WIDTH, HEIGHT, self.pitch, bytes_pp)
+
+    def plot(self, clip, x, y, color):
+        if clip.x0 <= x < clip.x1 and clip.y0 <= y < clip.y1:
+            at = self.offset + y * self.pitch + x * self.bytes_pp
+            mask = (1 << (8 * self.bytes_pp)) - 1
+            self.model[at:at + self.bytes_pp] = (color & mask).to_bytes(self.bytes_pp, 'little')
+
+    def matches(self):
+        return bytes(self.buffer.raw) == bytes(self.model)
+
+def model_text(font, surface, clip, x, y, text, size, color):
+    size = max(1, min(size, SIZE_MAX))
+    for n, c in enumerate(text):
+        if c < FONT_FIRST or c > FONT_LAST:
+            c = ord('?')
+        glyph = font[c - FONT_FIRST]
+        gx = x + n * FONT_WIDTH * size
+        for row in range(FONT_HEIGHT * size):
+            for px in range(FONT_WIDTH * size):
+                if glyph[row // size] & (1 << (px // size)):
+                    surface.plot(clip, gx + px, y + row, color)
+
+def setup(lib):
+    target = ctypes.POINTER(RasterTarget)
+    clip = ctypes.POINTER(RasterClip)
+    i32, u32 = ctypes.c_int32, ctypes.c_uint32
+    lib.raster_clip_set.argtypes = [target, clip, i32, i32, i32, i32]
+    lib.text_draw.argtypes = [target, clip, i32, i32, ctypes.c_char_p, u32, u32, u32]
+    lib.text_width.argtypes = [u32, u32]
+    lib.text_width.restype = u32
+    lib.text_height.argtypes = [u32]
+    lib.text_height.restype = u32
+    lib.text_get_stats.argtypes = [ctypes.POINTER(TextCacheStats)]
+
+    glyphs = (FONT_LAST - FONT_FIRST + 1)
+    table = ((ctypes.c_uint8 * FONT_HEIGHT) * glyphs).in_dll(lib, 'font_8x8')
+    return [bytes(table[i]) for i in range(glyphs)]
+
+def stats(lib):
+    s = TextCacheStats()
+    lib.text_get_stats(ctypes.byref(s))
+    return s
+
+def draw(lib, surface, clip, x, y, text, size, color):
+    lib.text_draw(ctypes.byref(surface.target), ctypes.byref(clip), x, y,
+                  text, len(text), size, color)
+
+def random_clip(lib, surface, rng):
+    clip = RasterClip()
+    if rng.random() < 0.4:
+        lib.raster_clip_set(ctypes.byref(surface.target), ctypes.byref(clip), 0, 0, WIDTH, HEIGHT)
+    else:
+        lib.raster_clip_set(ctypes.byref(surface.target), ctypes.byref(clip),
+                            rng.randrange(-10, WIDTH), rng.randrange(-10, HEIGHT),
+                            rng.randrange(0, WIDTH + 20), rng.randrange(0, HEIGHT + 20))
+    return clip
+
+def random_text(rng):
+    length = rng.choice([0, 1, 3, 12, 40, 70])
+    return bytes(rng.randrange(FONT_FIRST, FONT_LAST + 1) if rng.random() < 0.95
+                 else rng.choice([0x01, 0x0A, 0x7F, 0xC3]) for _ in range(length))
+
+def test_fuzz(lib, font):
+    """Random runs against the model, any depth, size, position and clip"""
+    rng = random.Random(FUZZ_SEED)
+    for i in range(FUZZ_ITERATIONS):
+        bytes_pp = rng.choice([1, 2, 4])
+        # Odd pitches leave the rows off word alignment
+        surface = Surface(bytes_pp, rng, PAD if rng.random() < 0.8 else PAD + 2)
+        clip = random_clip(lib, surface, rng)
+        size = rng.randrange(0, SIZE_MAX + 2)
+        x, y = rng.randrange(-40, WIDTH + 10), rng.randrange(-40, HEIGHT + 10)
+        text = random_text(rng)
+        color = rng.getrandbits(32)
+
+        draw(lib, surface, clip, x, y, text, size, color)
+        model_text(font, surface, clip, x, y, text, size, color)
+
+        if not surface.matches():
+            print(f"  {RED}Failed:{NC} {text!r} size {size} at {x},{y}, "
+                  f"{bytes_pp * 8}bpp, case {i}")
+            return print_result(False, f"text_draw ({FUZZ_ITERATIONS} cases)")
+    return print_result(True, f"text_draw ({FUZZ_ITERATIONS} cases)")
+
+def test_cache_hits(lib, font):
+    """A run drawn again at the same alignment only hits the cache"""
+    rng = random.Random(FUZZ_SEED + 1)
+    passed = True
+    for bytes_pp in (1, 2, 4):
+        surface = Surface(bytes_pp, rng)
+        clip = RasterClip(0, 0, WIDTH, HEIGHT)
+        text = b'PIP-OS 7.1'
+
+        draw(lib, surface, clip, 4, 4, text, 1, 0xFF80FF1A)
+        before = stats(lib)
+        draw(lib, surface, clip, 4, 20, text, 1, 0x12345678)
+        after = stats(lib)
+
+        if after.misses != before.misses or after.hits != before.hits + len(text):
+            print(f"  {RED}Failed:{NC} {after.hits - before.hits} hits, "
+                  f"{after.misses - before.misses} misses at {bytes_pp * 8}bpp")
+            passed = False
+    return print_result(passed, "Cached glyphs are reused across colors")
+
+def test_depth_flush(lib, font):
+    """Changing the target depth empties the cache"""
+    rng = random.Random(FUZZ_SEED + 2)
+    clip = RasterClip(0, 0, WIDTH, HEIGHT)
+
+    draw(lib, Surface(4, rng), clip, 0, 0, b'A', 1, 1)
+    before = stats(lib)
+    draw(lib, Surface(2, rng), clip, 0, 0, b'A', 1, 1)
+    after = stats(lib)
+
+    passed = after.flushes == before.flushes + 1 and after.glyphs == 1
+    return print_result(passed, "Cache flushed on a depth change")
+
+def test_overflow(lib, font):
+    """Runs needing more glyphs than the cache holds stay correct"""
+    rng = random.Random(FUZZ_SEED + 3)
+    passed = True
+    before = stats(lib)
+    text = bytes(range(FONT_FIRST, FONT_LAST + 1))
+
+    # Every glyph at size 4, four alignments, 32 bpp : more than the cache holds
+    for rep in range(4):
+        surface = Surface(4, rng)
+        clip = RasterClip(0, 0, WIDTH, HEIGHT)
+        for n in range(0, len(text), 3):
+            part = text[n:n + 3]
+            draw(lib, surface, clip, rep, 4, part, 4, 0xFFFFFFFF)
+            model_text(font, surface, clip, rep, 4, part, 4, 0xFFFFFFFF)
+        passed &= surface.matches()
+
+    for bytes_pp in (1, 2):
+        surface = Surface(bytes_pp, rng)
+        clip = RasterClip(0, 0, WIDTH, HEIGHT)
+        for x in range(-3, 5):
+            draw(lib, surface, clip, x, 2, text, 3, 0x5A5A5A5A)
+            model_text(font, surface, clip, x, 2, text, 3, 0x5A5A5A5A)
+        passed &= surface.matches()
+
+    passed &= stats(lib).flushes > before.flushes
+    return print_result(passed, "Cache overflow flushes between chunks")
+
+def test_metrics(lib):
+    """Run sizes follow the clamped scale"""
+    passed = (lib.text_width(10, 1) == 80 and lib.text_width(3, 0) == 24
+              and lib.text_width(2, 9) == 64 and lib.text_height(2) == 16
+              and lib.text_height(7) == 32)
+    return print_result(passed, "text_width / text_height")
+
+def main():
+    """Main test function"""
+    print("=" * 40)
+    print("PIP-OS Text Renderer Unit Tests")
+    print("=" * 40)
+    print()
+
+    # Compile test module
+    lib_path = compile_test_module()
+    if not lib_path:
+        print(f"{RED}Failed to compile test module{NC}")
+        return 1
+
+    try:
+        # Load shared library
+        lib = ctypes.CDLL(lib_path)
+        font = setup(lib)
+
+        # Run tests
+        print("\nRunning tests...")
+        results = []
+        results.append(test_fuzz(lib, font))
+        results.append(test_cache_hits(lib, font))
+        results.append(test_depth_flush(lib, font))
+        results.append(test_overflow(lib, font))
+        results.append(test_metrics(lib))
+
+        # Summary
+        print("\n" + "=" * 40)
+        print("Test Summary")
+        print("=" * 40)
+        passed = sum(results)
+        total = len(results)
+        print(f"{GREEN}Passed:{NC} {passed}/{total}")
+        print(f"{RED}Failed:{NC} {total - passed}/{total}")
+        print()
+
+        if passed == total:
+            print(f"{GREEN}All tests passed!{NC}")
+            return 0
+        else:
+            print(f"{RED}Some tests failed.{NC}")
+            return 1
+
+    finally:
+        # Cleanup
+        if os.path.exists(lib_path):
+            os.unlink(lib_path)
+
+if __name__ == "__main__":
+    sys.exit(main())
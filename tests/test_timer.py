@@ -0,0 +1,503 @@
+#!/usr/bin/env python3
+"""
+PIP-OS Timer Wheel Unit Tests
+
+This script compiles the kernel's timer wheel in a host environment on an
+emulated system timer: a counter the test moves forward and a compare
+channel whose match raises the timer interrupt. Random one-shot and
+periodic timers, cancels, restarts and handlers touching their own timer
+are checked against a Python model of their deadlines, along with the
+compare channel never set past the next deadline, the interrupts taken
+while idle, and sleeps.
+"""
+
+import subprocess
+import sys
+import os
+import tempfile
+import ctypes
+import random
+
+# Color codes for output
+GREEN = '\033[0;32m'
+RED = '\033[0;31m'
+YELLOW = '\033[1;33m'
+NC = '\033[0m'  # No Color
+
+def print_result(passed, test_name):
+    """Print test result with color"""
+    if passed:
+        print(f"{GREEN}✓{NC} {test_name}")
+        return True
+    else:
+        print(f"{RED}✗{NC} {test_name}")
+        return False
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+KERNEL_DIR = os.path.join(SCRIPT_DIR, '..', 'src', 'kernel')
+
+# The counter and compare channel are variables of the test, the timer
+# interrupt is a call. wfi runs the hardware up to the compare value. The
+# handlers log their timer and the time, and may cancel or restart it.
+STUBS = r'''
+#include <stdint.h>
+#include <stdbool.h>
+
+#define __INTERRUPTS_H__
+#define IRQ_SYSTEM_TIMER_1 1
+typedef uintptr_t irq_flags_t;
+typedef void (*irq_handler_t)(void *arg);
+uint32_t test_masked;
+static inline irq_flags_t irq_save(void) { return test_masked ? 0x80 : 0; }
+static inline void irq_restore(irq_flags_t flags) { (void)flags; }
+static inline bool irq_flags_masked(irq_flags_t flags) { return (flags & 0x80) != 0; }
+static irq_handler_t test_irq_handler;
+static void *test_irq_arg;
+static bool irq_register(uint32_t irq, irq_handler_t handler, void *arg)
+{
+    (void)irq;
+    test_irq_handler = handler;
+    test_irq_arg = arg;
+    return true;
+}
+static void irq_enable(uint32_t irq) { (void)irq; }
+
+#define SPINLOCK_H
+typedef struct { int held; } spinlock_t;
+#define SPINLOCK_INIT(name) { 0 }
+uint32_t test_lock_errors;
+static void spin_lock(spinlock_t *lock) { test_lock_errors += lock->held++; }
+static void spin_unlock(spinlock_t *lock) { test_lock_errors += --lock->held != 0; }
+static irq_flags_t spin_lock_irqsave(spinlock_t *lock) { spin_lock(lock); return 0; }
+static void spin_unlock_irqrestore(spinlock_t *lock, irq_flags_t flags)
+{
+    (void)flags;
+    spin_unlock(lock);
+}
+
+#include "io.h"
+#define __UART_H__
+uint64_t test_now;
+uint32_t test_compare;
+uint32_t test_spin_us;      // the counter runs that much per read of CLO
+static void mmio_write(uint32_t reg, uint32_t data)
+{
+    if (reg == SYSTEM_TIMER_C1)
+        test_compare = data;
+}
+static uint32_t mmio_read(uint32_t reg)
+{
+    if (reg == SYSTEM_TIMER_CHI)
+        return test_now >> 32;
+    if (reg == SYSTEM_TIMER_CLO)
+        return (uint32_t)(test_now += test_spin_us);
+    return 0;
+}
+
+void test_interrupt(void)
+{
+    test_irq_handler(test_irq_arg);
+}
+
+#define CPU_H
+static inline uint32_t core_id(void) { return 0; }
+static inline void cpu_sev(void) { }
+static inline void cpu_wfe(void) { }
+uint32_t test_wfi;
+static void cpu_wfi(void)
+{
+    // Up to the match, then its interrupt
+    test_now += (uint32_t)(test_compare - (uint32_t)test_now);
+    test_wfi++;
+    test_interrupt();
+}
+
+#include "timer.c"
+
+#define TEST_TIMERS 64
+#define TEST_LOG    65536
+
+timer_event_t test_timers[TEST_TIMERS];
+uint32_t test_action[TEST_TIMERS];      // 1 : cancel, 2 : restart after test_ms
+uint32_t test_ms[TEST_TIMERS];
+uint32_t test_log_id[TEST_LOG];
+uint64_t test_log_time[TEST_LOG];
+uint32_t test_log_count;
+
+static void test_handler(void *arg)
+{
+    uint32_t id = (uintptr_t)arg;
+
+    if (test_log_count < TEST_LOG) {
+        test_log_id[test_log_count] = id;
+        test_log_time[test_log_count] = test_now;
+        test_log_count++;
+    }
+    if (test_action[id] == 1)
+        timer_cancel(&test_timers[id]);
+    else if (test_action[id] == 2)
+        timer_after(&test_timers[id], test_ms[id], test_handler, arg);
+}
+
+void test_after(uint32_t id, uint32_t ms)
+{
+    timer_after(&test_timers[id], ms, test_handler, (void *)(uintptr_t)id);
+}
+
+bool test_every(uint32_t id, uint32_t period_us)
+{
+    return timer_every(&test_timers[id], period_us, test_handler, (void *)(uintptr_t)id);
+}
+
+void test_cancel(uint32_t id)
+{
+    timer_cancel(&test_timers[id]);
+}
+
+bool test_pending(uint32_t id)
+{
+    return timer_pending(&test_timers[id]);
+}
+'''
+
+FUZZ_SEED = 0x71E4
+TIMERS = 64
+TICK_US = 1024
+MIN_US = 8
+
+def compile_test_module():
+    """Compile the kernel timer.c for host testing"""
+    print("Compiling timer wheel for testing...")
+
+    test_so_file = None
+    stubs_file = None
+    try:
+        fd, test_so_file = tempfile.mkstemp(suffix='.so')
+        os.close(fd)
+        fd, stubs_file = tempfile.mkstemp(suffix='.c')
+        with os.fdopen(fd, 'w') as f:
+            f.write(STUBS)
+
+        result = subprocess.run(
+            ['gcc', '-shared', '-fPIC', '-O2', '-DBCM2836=1',
+             '-I', KERNEL_DIR, '-o', test_so_file, stubs_file],
+            capture_output=True,
+            text=True
+        )
+
+        if result.returncode != 0:
+            print(f"{RED}Compilation failed:{NC}")
+            print(result.stderr)
+            os.unlink(test_so_file)
+            return None
+
+        print(f"{GREEN}Compilation successful{NC}")
+        return test_so_file
+
+    except Exception as e:
+        print(f"{RED}Error during compilation: {e}{NC}")
+        if test_so_file and os.path.exists(test_so_file):
+            os.unlink(test_so_file)
+        return None
+    finally:
+        if stubs_file and os.path.exists(stubs_file):
+            os.unlink(stubs_file)
+
+def tick(us):
+    return -(-us // TICK_US)
+
+class Wheel:
+    """The emulated system timer, and the model of the timers"""
+
+    def __init__(self, lib):
+        self.lib = lib
+        self.now = ctypes.c_uint64.in_dll(lib, 'test_now')
+        self.compare = ctypes.c_uint32.in_dll(lib, 'test_compare')
+        self.action = (ctypes.c_uint32 * TIMERS).in_dll(lib, 'test_action')
+        self.ms = (ctypes.c_uint32 * TIMERS).in_dll(lib, 'test_ms')
+        self.log_id = (ctypes.c_uint32 * 65536).in_dll(lib, 'test_log_id')
+        self.log_time = (ctypes.c_uint64 * 65536).in_dll(lib, 'test_log_time')
+        self.log_count = ctypes.c_uint32.in_dll(lib, 'test_log_count')
+        self.lock_errors = ctypes.c_uint32.in_dll(lib, 'test_lock_errors')
+        self.interrupts = 0
+        self.errors = []
+        self.fired = []
+        # id : [deadline, period]
+        self.model = {}
+
+    def check_compare(self):
+        """Set no later than the first deadline, nor behind the counter"""
+        now = self.now.value
+        at = now + ((self.compare.value - now) & 0xFFFFFFFF)
+        if at == now or at - now > 0x80000000:
+            self.errors.append(('compare passed', now, at))
+        if self.model:
+            first = min(tick(d) * TICK_US for d, _ in self.model.values())
+            if at > max(first, now + MIN_US):
+                self.errors.append(('compare late', now, at, first))
+
+    def after(self, id, ms, action=0, restart_ms=0):
+        self.action[id] = action
+        self.ms[id] = restart_ms
+        self.lib.test_after(id, ms)
+        self.model[id] = [self.now.value + ms * 1000, 0]
+        self.check_compare()
+
+    def every(self, id, period, action=0):
+        self.action[id] = action
+        self.lib.test_every(id, period)
+        self.model[id] = [self.now.value + period, period]
+        self.check_compare()
+
+    def cancel(self, id):
+        self.lib.test_cancel(id)
+        self.model.pop(id, None)
+
+    def advance(self, us):
+        """Run the counter, with the interrupt of a match on the way
+        taken at the end"""
+        before = self.now.value
+        self.now.value = before + us
+        if ((self.compare.value - before - 1) & 0xFFFFFFFF) < us:
+            self.interrupt()
+
+    def interrupt(self):
+        now = self.now.value
+        self.log_count.value = 0
+        self.lib.test_interrupt()
+        self.interrupts += 1
+
+        for i in range(self.log_count.value):
+            id, time = self.log_id[i], self.log_time[i]
+            self.fired.append((id, time))
+            if id not in self.model:
+                self.errors.append(('not pending', id, time))
+                continue
+            deadline, period = self.model[id]
+            if tick(deadline) > time // TICK_US:
+                self.errors.append(('early', id, time, deadline))
+            if period:
+                deadline += period
+                if deadline <= now:
+                    deadline = now + period
+                self.model[id] = [deadline, period]
+            else:
+                del self.model[id]
+            if self.action[id] == 1:
+                del self.model[id]
+            elif self.action[id] == 2:
+                self.model[id] = [time + self.ms[id] * 1000, 0]
+
+        # Nothing due left behind
+        for id, (deadline, _) in self.model.items():
+            if tick(deadline) <= now // TICK_US:
+                self.errors.append(('missed', id, now, deadline))
+        for id in range(TIMERS):
+            if bool(self.lib.test_pending(id)) != (id in self.model):
+                self.errors.append(('pending', id))
+        self.check_compare()
+
+    def run_until_idle(self, limit):
+        while self.model and self.now.value < limit:
+            self.advance(TICK_US)
+
+def setup(lib):
+    lib.timer_init.argtypes = []
+    lib.timer_init.restype = None
+    lib.timer_sleep.argtypes = [ctypes.c_uint32]
+    lib.timer_sleep.restype = None
+    lib.test_after.argtypes = [ctypes.c_uint32, ctypes.c_uint32]
+    lib.test_after.restype = None
+    lib.test_every.argtypes = [ctypes.c_uint32, ctypes.c_uint32]
+    lib.test_every.restype = ctypes.c_bool
+    lib.test_cancel.argtypes = [ctypes.c_uint32]
+    lib.test_cancel.restype = None
+    lib.test_pending.argtypes = [ctypes.c_uint32]
+    lib.test_pending.restype = ctypes.c_bool
+    lib.test_interrupt.argtypes = []
+    lib.test_interrupt.restype = None
+
+def clear(wheel):
+    for id in range(TIMERS):
+        wheel.cancel(id)
+        wheel.action[id] = 0
+
+def test_fuzz(lib, wheel):
+    """Random timers, cancels and restarts, the counter moving in random
+    steps across the 32-bit wrap"""
+    rng = random.Random(FUZZ_SEED)
+    clear(wheel)
+    wheel.now.value = 0xFFFFFFFF - 20000000
+    wheel.errors = []
+    fired = len(wheel.fired)
+
+    for step in range(20000):
+        op = rng.randrange(10)
+        id = rng.randrange(TIMERS)
+        if op == 0:
+            wheel.after(id, rng.choice([0, 1, rng.randrange(100), rng.randrange(5000),
+                                        rng.randrange(200000)]))
+        elif op == 1:
+            wheel.every(id, rng.choice([rng.randrange(1, 2000), rng.randrange(1, 100000),
+                                        33333, 10000]), action=0)
+        elif op == 2:
+            wheel.cancel(id)
+        else:
+            wheel.advance(rng.choice([rng.randrange(1, 50), rng.randrange(1, 3000),
+                                      rng.randrange(1, 100000)]))
+        if wheel.errors:
+            break
+
+    passed = not wheel.errors and len(wheel.fired) - fired > 1000
+    passed = passed and wheel.lock_errors.value == 0
+    if wheel.errors:
+        print(wheel.errors[:5])
+    return print_result(passed, "Timers fire on time against a model")
+
+def test_far(lib, wheel):
+    """Deadlines past the wheel, hours away"""
+    clear(wheel)
+    wheel.errors = []
+    # 6 hours, more than the 4.8 of the top level
+    for id, ms in enumerate([6 * 3600 * 1000, 4 * 3600 * 1000 + 17, 3600 * 1000 + 1, 65 * 1000]):
+        wheel.after(id, ms)
+    start = wheel.interrupts
+    limit = wheel.now.value + 7 * 3600 * 1000000
+    while wheel.model and wheel.now.value < limit:
+        wheel.advance(250000)
+
+    # Tickless : a few interrupts to move timers down, two per 71 minutes
+    # at most when nothing is due
+    passed = not wheel.errors and not wheel.model and wheel.interrupts - start < 60
+    if wheel.errors:
+        print(wheel.errors[:5])
+    return print_result(passed, "Deadlines hours away, few interrupts")
+
+def test_handlers(lib, wheel):
+    """Handlers cancelling and restarting their own timer"""
+    clear(wheel)
+    wheel.errors = []
+    fired = len(wheel.fired)
+
+    wheel.every(0, 5000, action=1)          # cancels itself at the first call
+    wheel.every(1, 3000)
+    wheel.after(2, 7, action=2, restart_ms=7)   # a chain of one-shots
+    wheel.after(3, 0)
+    for _ in range(100):
+        wheel.advance(TICK_US)
+
+    ids = [id for id, _ in wheel.fired[fired:]]
+    passed = not wheel.errors and ids.count(0) == 1 and ids.count(3) == 1
+    passed = passed and 30 <= ids.count(1) <= 35 and 12 <= ids.count(2) <= 15
+    if wheel.errors:
+        print(wheel.errors[:5])
+    return print_result(passed, "Handlers cancel and restart their timer")
+
+def test_period(lib, wheel):
+    """A 30 frames per second timer keeps its rate, late interrupts
+    dropping the periods they missed"""
+    clear(wheel)
+    wheel.errors = []
+    fired = len(wheel.fired)
+    start = wheel.now.value
+
+    wheel.every(5, 33333)
+    while wheel.now.value < start + 10 * 1000000:
+        wheel.advance(100)
+    count = len(wheel.fired) - fired
+
+    # IRQs masked for 200ms once
+    wheel.now.value += 200000
+    wheel.interrupt()
+    before = len(wheel.fired)
+    for _ in range(2000):
+        wheel.advance(100)
+    after = len(wheel.fired) - before
+    wheel.cancel(5)
+
+    passed = not wheel.errors and count in (299, 300) and after in (5, 6, 7)
+    if wheel.errors:
+        print(wheel.errors[:5])
+    return print_result(passed, "Periodic timers keep their rate")
+
+def test_sleep(lib, wheel):
+    """Sleeps in wfi until their timer"""
+    clear(wheel)
+    wfi = ctypes.c_uint32.in_dll(lib, 'test_wfi')
+    passed = True
+    for ms in (0, 1, 10, 100, 1234):
+        start, waits = wheel.now.value, wfi.value
+        lib.timer_sleep(ms)
+        slept = wheel.now.value - start
+        passed = passed and ms * 1000 <= slept < ms * 1000 + TICK_US + MIN_US
+        # The compare channel is not polled
+        passed = passed and wfi.value - waits <= 4
+
+    # IRQs masked : the timer interrupt would never come, the counter is
+    # spun on
+    masked = ctypes.c_uint32.in_dll(lib, 'test_masked')
+    spin = ctypes.c_uint32.in_dll(lib, 'test_spin_us')
+    masked.value, spin.value = 1, 7
+    for ms in (0, 1, 25):
+        start, waits = wheel.now.value, wfi.value
+        lib.timer_sleep(ms)
+        slept = wheel.now.value - start
+        passed = passed and ms * 1000 <= slept <= ms * 1000 + 3 * 7
+        passed = passed and wfi.value == waits
+    masked.value, spin.value = 0, 0
+    return print_result(passed, "Sleeps wait in wfi, spin with IRQs masked")
+
+def main():
+    """Main test function"""
+    print("=" * 40)
+    print("PIP-OS Timer Wheel Unit Tests")
+    print("=" * 40)
+    print()
+
+    # Compile test module
+    lib_path = compile_test_module()
+    if not lib_path:
+        print(f"{RED}Failed to compile test module{NC}")
+        return 1
+
+    try:
+        # Load shared library
+        lib = ctypes.CDLL(lib_path)
+        setup(lib)
+        wheel = Wheel(lib)
+        wheel.now.value = 123456789
+        lib.timer_init()
+
+        # Run tests
+        print("\nRunning tests...")
+        results = []
+        results.append(test_fuzz(lib, wheel))
+        results.append(test_far(lib, wheel))
+        results.append(test_handlers(lib, wheel))
+        results.append(test_period(lib, wheel))
+        results.append(test_sleep(lib, wheel))
+
+        # Summary
+        print("\n" + "=" * 40)
+        print("Test Summary")
+        print("=" * 40)
+        passed = sum(results)
+        total = len(results)
+        print(f"{GREEN}Passed:{NC} {passed}/{total}")
+        print(f"{RED}Failed:{NC} {total - passed}/{total}")
+        print()
+
+        if passed == total:
+            print(f"{GREEN}All tests passed!{NC}")
+            return 0
+        else:
+            print(f"{RED}Some tests failed.{NC}")
+            return 1
+
+    finally:
+        # Cleanup
+        if os.path.exists(lib_path):
+            os.unlink(lib_path)
+
+if __name__ == "__main__":
+    sys.exit(main())
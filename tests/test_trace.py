@@ -0,0 +1,409 @@
+#!/usr/bin/env python3
+"""
+PIP-OS Trace Unit Tests
+
+This script compiles the kernel's trace rings in a host environment with
+four emulated cores, records events through the TRACE macros, drains them
+into a captured UART stream mixed with text output and decodes it with
+tools/trace_decode.py, the event descriptions read from the trace_events
+section of the compiled library, against a Python model of the records.
+"""
+
+import subprocess
+import sys
+import os
+import tempfile
+import ctypes
+import random
+import json
+
+# Color codes for output
+GREEN = '\033[0;32m'
+RED = '\033[0;31m'
+YELLOW = '\033[1;33m'
+NC = '\033[0m'  # No Color
+
+def print_result(passed, test_name):
+    """Print test result with color"""
+    if passed:
+        print(f"{GREEN}✓{NC} {test_name}")
+        return True
+    else:
+        print(f"{RED}✗{NC} {test_name}")
+        return False
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+KERNEL_DIR = os.path.join(SCRIPT_DIR, '..', 'src', 'kernel')
+sys.path.insert(0, os.path.join(SCRIPT_DIR, '..', 'tools'))
+
+import trace_decode
+
+SOURCES = [os.path.join(KERNEL_DIR, 'crc32.c')]
+
+# The core, clocksource, lock and timer of trace.c, then the UART it drains to,
+# collecting what is sent with the room the test leaves, and the events.
+STUBS = r'''
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define __INTERRUPTS_H__
+typedef uintptr_t irq_flags_t;
+typedef void (*irq_handler_t)(void *arg);
+static inline irq_flags_t irq_save(void) { return 0; }
+static inline void irq_restore(irq_flags_t flags) { (void)flags; }
+
+#define SPINLOCK_H
+typedef struct { bool locked; } spinlock_t;
+#define SPINLOCK_INIT(name) { false }
+static inline bool spin_trylock(spinlock_t *lock)
+{
+    if (lock->locked)
+        return false;
+    return lock->locked = true;
+}
+static inline void spin_unlock(spinlock_t *lock) { lock->locked = false; }
+
+#define CACHE_H
+static inline void dmb(void) { __sync_synchronize(); }
+
+#define CPU_H
+#include "mm.h"
+uint32_t test_core;
+static inline uint32_t core_id(void) { return test_core; }
+
+#define CLOCK_H
+uint64_t test_clock;
+static inline uint64_t clock_ticks(void) { return test_clock; }
+static inline uint32_t clock_hz(void) { return 19200000; }
+
+#define TIMER_H
+typedef struct { uint32_t period; } timer_event_t;
+static bool timer_every(timer_event_t *timer, uint32_t period_us,
+                        irq_handler_t handler, void *arg)
+{
+    (void)timer; (void)period_us; (void)handler; (void)arg;
+    return true;
+}
+
+uint8_t test_sent[1 << 20];
+size_t test_sent_length;
+size_t test_room = 1 << 20;
+
+void uart_write(const char *buffer, size_t size)
+{
+    memcpy(test_sent + test_sent_length, buffer, size);
+    test_sent_length += size;
+}
+
+size_t uart_tx_room(void)
+{
+    return test_room;
+}
+
+#include "trace.c"
+
+void test_span(uint32_t n, int32_t delta)
+{
+    TRACE_BEGIN("span", "n %u delta %d", n, delta);
+    TRACE_INSTANT("mark", "at %x", n * 16);
+    TRACE_END("span");
+}
+
+void test_point(uint32_t a, uint32_t b, uint32_t c, uint32_t d, uint32_t e)
+{
+    TRACE_INSTANT("point", "%u %u %u %u %08X", a, b, c, d, e);
+}
+
+size_t test_frame_max(void)
+{
+    return sizeof(trace_buffer);
+}
+
+void test_plain(void)
+{
+    TRACE_INSTANT("plain", "");
+}
+'''
+
+FUZZ_SEED = 0x7ACE
+CORES = 4
+RECORDS = 512
+CLOCK_HZ = 19200000
+
+def compile_test_module():
+    """Compile the kernel trace.c for host testing"""
+    print("Compiling trace rings for testing...")
+
+    test_so_file = None
+    stubs_file = None
+    try:
+        fd, test_so_file = tempfile.mkstemp(suffix='.so')
+        os.close(fd)
+        fd, stubs_file = tempfile.mkstemp(suffix='.c')
+        with os.fdopen(fd, 'w') as f:
+            f.write(STUBS)
+
+        result = subprocess.run(
+            ['gcc', '-shared', '-fPIC', '-O2', '-ffreestanding',
+             '-DBCM2836=1', '-DTRACE=1',
+             '-I', KERNEL_DIR, '-o', test_so_file] + SOURCES + [stubs_file],
+            capture_output=True,
+            text=True
+        )
+
+        if result.returncode != 0:
+            print(f"{RED}Compilation failed:{NC}")
+            print(result.stderr)
+            os.unlink(test_so_file)
+            return None
+
+        print(f"{GREEN}Compilation successful{NC}")
+        return test_so_file
+
+    except Exception as e:
+        print(f"{RED}Error during compilation: {e}{NC}")
+        if test_so_file and os.path.exists(test_so_file):
+            os.unlink(test_so_file)
+        return None
+    finally:
+        if stubs_file and os.path.exists(stubs_file):
+            os.unlink(stubs_file)
+
+class Trace:
+    """The library, its clock and core, and the events it should record"""
+
+    def __init__(self, lib, section):
+        self.lib = lib
+        self.section = section
+        self.core = ctypes.c_uint32.in_dll(lib, 'test_core')
+        self.clock = ctypes.c_uint64.in_dll(lib, 'test_clock')
+        self.room = ctypes.c_size_t.in_dll(lib, 'test_room')
+        self.sent_length = ctypes.c_size_t.in_dll(lib, 'test_sent_length')
+        self.sent = (ctypes.c_uint8 * (1 << 20)).in_dll(lib, 'test_sent')
+        self.expected = [[] for _ in range(CORES)]
+        self.dropped = [0] * CORES
+        self.capture = b''
+
+    def queued(self, core):
+        return sum(1 for e in self.expected[core] if not e[3])
+
+    def record(self, core, phase, name, msg):
+        """One record the core should keep, or drop when its ring is full"""
+        if self.queued(core) >= RECORDS:
+            self.dropped[core] += 1
+        else:
+            self.expected[core].append([self.clock.value, phase, name, False, msg])
+
+    def span(self, core, n, delta):
+        self.core.value = core
+        self.lib.test_span(n, delta)
+        self.record(core, 'B', 'span', 'n %u delta %d' % (n, delta))
+        self.record(core, 'i', 'mark', 'at %x' % ((n * 16) & 0xFFFFFFFF))
+        self.record(core, 'E', 'span', None)
+
+    def point(self, core, args):
+        self.core.value = core
+        self.lib.test_point(*args)
+        self.record(core, 'i', 'point', '%u %u %u %u %08X' % tuple(args))
+
+    def drain(self, text=b''):
+        """Drain into the capture, after some text output"""
+        self.capture += text
+        sent = self.lib.trace_drain()
+        data = bytes(self.sent[:self.sent_length.value])
+        self.capture += data
+        self.sent_length.value = 0
+
+        # The records sent leave room in the ring
+        for core, _, _, records in trace_decode.find_frames(data):
+            pending = [e for e in self.expected[core] if not e[3]]
+            for e in pending[:len(records)]:
+                e[3] = True
+        return sent
+
+def setup(lib):
+    lib.test_span.argtypes = [ctypes.c_uint32, ctypes.c_int32]
+    lib.test_span.restype = None
+    lib.test_point.argtypes = [ctypes.c_uint32] * 5
+    lib.test_point.restype = None
+    lib.test_frame_max.argtypes = []
+    lib.test_frame_max.restype = ctypes.c_size_t
+    lib.test_plain.argtypes = []
+    lib.test_plain.restype = None
+    lib.trace_drain.argtypes = []
+    lib.trace_drain.restype = ctypes.c_uint32
+    lib.crc32_init()
+
+def check_decoded(trace, events):
+    """The decoded events of each core, in order, against the model"""
+    start = min(e[0] for core in trace.expected for e in core)
+    for core in range(CORES):
+        got = [e for e in events if e.get('tid') == core and e['ph'] != 'C']
+        want = trace.expected[core]
+        if len(got) != len(want):
+            return False
+        for g, (time, phase, name, _, msg) in zip(got, want):
+            if g['name'] != name or g['ph'] != phase:
+                return False
+            if abs(g['ts'] - (time - start) * 1e6 / CLOCK_HZ) > 1e-6:
+                return False
+            if g.get('args', {}).get('msg') != msg:
+                return False
+    return True
+
+def test_round_trip(lib, section):
+    """Random events on random cores, drained between text output"""
+    rng = random.Random(FUZZ_SEED)
+    trace = Trace(lib, section)
+
+    for step in range(300):
+        trace.clock.value += rng.randrange(1, 5000)
+        core = rng.randrange(CORES)
+        if rng.randrange(2):
+            trace.span(core, rng.randrange(1 << 32), rng.randrange(-1000, 1000))
+        else:
+            trace.point(core, [rng.randrange(1 << 32) for _ in range(5)])
+        if rng.randrange(10) == 0:
+            trace.drain(b'kernel text PTRC and more text\r\n')
+    while trace.drain(bytes(rng.randrange(256) for _ in range(40))):
+        pass
+
+    events = trace_decode.decode(section, trace.capture)
+    passed = check_decoded(trace, events)
+    json.dumps({'traceEvents': events})
+    return print_result(passed, "Events decoded from frames among text")
+
+def test_full_ring(lib, section):
+    """Records past a full ring are dropped and counted"""
+    trace = Trace(lib, section)
+    for i in range(RECORDS + 37):
+        trace.clock.value += 10
+        trace.point(2, [i, 0, 0, 0, 0])
+    trace.point(1, [1, 2, 3, 4, 5])
+    while trace.drain():
+        pass
+
+    events = trace_decode.decode(section, trace.capture)
+    frames = trace_decode.find_frames(trace.capture)
+    passed = check_decoded(trace, events)
+    passed = passed and trace.dropped[2] == 37
+    passed = passed and all(f[2] == (37 if f[0] == 2 else 0) for f in frames)
+    passed = passed and any(e['ph'] == 'C' and e['args'] == {'core 2': 37} for e in events)
+    return print_result(passed, "Full ring drops and counts records")
+
+def test_uart_room(lib, section):
+    """Nothing queued without room for a whole frame"""
+    trace = Trace(lib, section)
+    for i in range(40):
+        trace.clock.value += 100
+        trace.span(0, i, -i)
+
+    frame_max = lib.test_frame_max()
+    trace.room.value = frame_max - 1
+    passed = trace.drain() == 0 and not trace.capture
+
+    trace.room.value = frame_max
+    passed = passed and trace.drain() == 120
+    trace.room.value = 1 << 20
+    events = trace_decode.decode(section, trace.capture)
+    passed = passed and check_decoded(trace, events)
+    return print_result(passed, "Drain waits for UART room")
+
+def test_corrupt_frame(lib, section):
+    """A frame with a byte changed on the line is skipped alone"""
+    trace = Trace(lib, section)
+    for i in range(3):
+        trace.clock.value += 1000
+        trace.point(3, [i, i, i, i, i])
+        trace.drain(b'text\r\n')
+    lib.test_plain()
+
+    frames = trace_decode.find_frames(trace.capture)
+    second = trace.capture.index(b'PTRC', trace.capture.index(b'PTRC') + 1)
+    damaged = bytearray(trace.capture)
+    damaged[second + 20] ^= 0x40
+    kept = trace_decode.find_frames(bytes(damaged))
+    passed = len(frames) == 3 and kept == [frames[0], frames[2]]
+
+    # The plain event, left in the ring, has no arguments
+    trace.drain()
+    events = trace_decode.decode(section, trace.capture)
+    passed = passed and events[-1]['name'] == 'plain' and 'args' not in events[-1]
+    return print_result(passed, "Corrupted frames skipped by the decoder")
+
+def test_spans_nest(lib, section):
+    """Begin and end events pair up on every core"""
+    rng = random.Random(FUZZ_SEED + 1)
+    trace = Trace(lib, section)
+    for step in range(200):
+        trace.clock.value += rng.randrange(1, 100)
+        trace.span(rng.randrange(CORES), step, 0)
+    while trace.drain():
+        pass
+
+    depth = {}
+    passed = True
+    for e in trace_decode.decode(section, trace.capture):
+        if e['ph'] == 'B':
+            depth[e['tid']] = depth.get(e['tid'], 0) + 1
+        elif e['ph'] == 'E':
+            depth[e['tid']] = depth.get(e['tid'], 0) - 1
+            passed = passed and depth[e['tid']] >= 0
+    passed = passed and all(d == 0 for d in depth.values())
+    return print_result(passed, "Spans nest on every core")
+
+def main():
+    """Main test function"""
+    print("=" * 40)
+    print("PIP-OS Trace Unit Tests")
+    print("=" * 40)
+    print()
+
+    # Compile test module
+    lib_path = compile_test_module()
+    if not lib_path:
+        print(f"{RED}Failed to compile test module{NC}")
+        return 1
+
+    try:
+        # Load shared library
+        lib = ctypes.CDLL(lib_path)
+        setup(lib)
+        with open(lib_path, 'rb') as f:
+            section = trace_decode.elf_section(f.read(), 'trace_events')
+
+        # Run tests
+        print("\nRunning tests...")
+        results = []
+        results.append(test_round_trip(lib, section))
+        results.append(test_full_ring(lib, section))
+        results.append(test_uart_room(lib, section))
+        results.append(test_corrupt_frame(lib, section))
+        results.append(test_spans_nest(lib, section))
+
+        # Summary
+        print("\n" + "=" * 40)
+        print("Test Summary")
+        print("=" * 40)
+        passed = sum(results)
+        total = len(results)
+        print(f"{GREEN}Passed:{NC} {passed}/{total}")
+        print(f"{RED}Failed:{NC} {total - passed}/{total}")
+        print()
+
+        if passed == total:
+            print(f"{GREEN}All tests passed!{NC}")
+            return 0
+        else:
+            print(f"{RED}Some tests failed.{NC}")
+            return 1
+
+    finally:
+        # Cleanup
+        if os.path.exists(lib_path):
+            os.unlink(lib_path)
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+"""
+PIP-OS Trace Decoder
+
+Picks the trace frames (src/kernel/trace.h) out of a capture of the
+kernel's serial output, text and all, and writes them as Chrome trace JSON
+for chrome://tracing or https://ui.perfetto.dev. The event names and
+argument formats are read from the trace_events section of the kernel.elf
+the kernel was built as: the records only carry offsets into it.
+
+Usage:
+    python3 tools/trace_decode.py build/kernel.elf capture.bin > trace.json
+
+Frames that fail their CRC, a byte lost on the line, are skipped.
+"""
+
+import json
+import re
+import struct
+import sys
+import zlib
+
+TRACE_MAGIC = b'PTRC'
+TRACE_ARGS = 5
+FRAME = struct.Struct('<4sHHII')
+RECORD = struct.Struct('<QI%dI' % TRACE_ARGS)
+FRAME_RECORDS_MAX = 4096
+
+CONVERSION = re.compile(r'%([-0 #+]*)(\d*)([duxXcp%])')
+
+def elf_section(elf, name):
+    """Contents of the section <name> of an ELF file, None if it has none"""
+    if elf[:4] != b'\x7fELF':
+        raise ValueError("not an ELF file")
+    wide = elf[4] == 2
+    endian = '<' if elf[5] == 1 else '>'
+
+    if wide:
+        shoff, = struct.unpack_from(endian + 'Q', elf, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + 'HHH', elf, 0x3A)
+        header = struct.Struct(endian + 'IIQQQQIIQQ')
+    else:
+        shoff, = struct.unpack_from(endian + 'I', elf, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + 'HHH', elf, 0x2E)
+        header = struct.Struct(endian + 'IIIIIIIIII')
+
+    sections = [header.unpack_from(elf, shoff + i * shentsize) for i in range(shnum)]
+    names = sections[shstrndx]
+    for section in sections:
+        start = names[4] + section[0]
+        found = elf[start:elf.index(b'\0', start)].decode()
+        if found == name:
+            return elf[section[4]:section[4] + section[5]]
+    return None
+
+def event(section, offset):
+    """Phase, name and argument format of the event at <offset>"""
+    end = section.index(b'\0', offset)
+    phase = chr(section[offset])
+    name = section[offset + 1:end].decode()
+    fmt = section[end + 1:section.index(b'\0', end + 1)].decode()
+    return phase, name, fmt
+
+def format_args(fmt, args):
+    """printf of the 32-bit arguments, as the kernel's k_printf would"""
+    values = iter(args)
+
+    def convert(match):
+        flags, width, conv = match.groups()
+        if conv == '%':
+            return '%'
+        value = next(values, 0)
+        if conv == 'd':
+            value -= (value & 0x80000000) << 1
+        elif conv == 'c':
+            return chr(value & 0xFF)
+        elif conv == 'p':
+            return '0x%08x' % value
+        return ('%' + flags + width + conv) % value
+
+    return CONVERSION.sub(convert, fmt)
+
+def find_frames(data):
+    """(core, clock_hz, dropped, records) of every valid frame in <data>"""
+    frames = []
+    pos = data.find(TRACE_MAGIC)
+    while pos >= 0:
+        if pos + FRAME.size <= len(data):
+            _, core, count, clock_hz, dropped = FRAME.unpack_from(data, pos)
+            end = pos + FRAME.size + count * RECORD.size
+            if 0 < count <= FRAME_RECORDS_MAX and clock_hz and end + 4 <= len(data):
+                crc, = struct.unpack_from('<I', data, end)
+                if zlib.crc32(data[pos:end]) == crc:
+                    records = [RECORD.unpack_from(data, pos + FRAME.size + i * RECORD.size)
+                               for i in range(count)]
+                    frames.append((core, clock_hz, dropped, records))
+                    pos = data.find(TRACE_MAGIC, end + 4)
+                    continue
+        pos = data.find(TRACE_MAGIC, pos + 1)
+    return frames
+
+def decode(section, data):
+    """Chrome trace events of the frames in <data>"""
+    frames = find_frames(data)
+    if not frames:
+        return []
+    start = min(record[0] for frame in frames for record in frame[3])
+
+    events = []
+    dropped = {}
+    for core, clock_hz, lost, records in frames:
+        for time, offset, *args in records:
+            phase, name, fmt = event(section, offset)
+            entry = {
+                'name': name,
+                'ph': phase,
+                'ts': (time - start) * 1e6 / clock_hz,
+                'pid': 0,
+                'tid': core,
+            }
+            if phase == 'i':
+                entry['s'] = 't'
+            if fmt:
+                entry['args'] = {'msg': format_args(fmt, args)}
+            events.append(entry)
+
+        if lost != dropped.get(core, 0):
+            dropped[core] = lost
+            events.append({
+                'name': 'dropped',
+                'ph': 'C',
+                'ts': events[-1]['ts'],
+                'pid': 0,
+                'args': {'core %d' % core: lost},
+            })
+
+    # Cores are drained in turn, the timeline is merged here
+    events.sort(key=lambda e: e['ts'])
+    return events
+
+def main():
+    if len(sys.argv) != 3:
+        print(__doc__.strip(), file=sys.stderr)
+        return 2
+
+    with open(sys.argv[1], 'rb') as f:
+        section = elf_section(f.read(), 'trace_events')
+    if section is None:
+        print("no trace_events section, was the kernel built with TRACE=1?", file=sys.stderr)
+        return 1
+    with open(sys.argv[2], 'rb') as f:
+        events = decode(section, f.read())
+
+    json.dump({'traceEvents': events, 'displayTimeUnit': 'ns'}, sys.stdout)
+    print()
+    print("%d events" % len(events), file=sys.stderr)
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())